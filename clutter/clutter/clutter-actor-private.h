@@ -293,6 +293,9 @@ void clutter_actor_update_stage_views (ClutterActor *self,
 
 void clutter_actor_queue_immediate_relayout (ClutterActor *self);
 
+void clutter_actor_cull_occluded_children (ClutterActor        *self,
+                                           ClutterPaintContext *paint_context);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_ACTOR_PRIVATE_H__ */
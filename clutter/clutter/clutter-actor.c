@@ -1056,6 +1056,8 @@ static ClutterPaintVolume *_clutter_actor_get_paint_volume_mutable (ClutterActor
 
 static guint8   clutter_actor_get_paint_opacity_internal        (ClutterActor *self);
 
+static cairo_region_t * clutter_actor_real_get_opaque_region (ClutterActor *self);
+
 static inline void clutter_actor_set_background_color_internal (ClutterActor *self,
                                                                 const ClutterColor *color);
 
@@ -3732,6 +3734,378 @@ clutter_actor_paint_node (ClutterActor        *actor,
   return TRUE;
 }
 
+/* Maximum distance from the pixel grid a transformed vertex may have to
+ * still be considered aligned to it */
+#define OCCLUSION_EPSILON (1.0f / 256.0f)
+
+static gboolean
+has_enabled_effects (ClutterActor *self)
+{
+  const GList *l;
+
+  if (self->priv->effects == NULL)
+    return FALSE;
+
+  for (l = _clutter_meta_group_peek_metas (self->priv->effects); l; l = l->next)
+    {
+      if (clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (l->data)))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Opaque regions are nearly always made of a handful of rectangles, keep
+ * those on the stack instead of allocating for every actor every frame */
+#define MAX_STACK_RECTS 8
+
+/* Transforms @boxes, in actor coordinates, into the largest stage
+ * rectangles they fully cover. Fails unless the actor is only translated
+ * and scaled relative to the stage. */
+static gboolean
+boxes_to_stage_rects (ClutterActor          *self,
+                      const ClutterActorBox *boxes,
+                      int                    n_boxes,
+                      cairo_rectangle_int_t *rects)
+{
+  graphene_point3d_t stack_vertices[MAX_STACK_RECTS * 8];
+  g_autofree graphene_point3d_t *heap_vertices = NULL;
+  graphene_point3d_t *vertices;
+  graphene_point3d_t *transformed;
+  int i;
+
+  if (n_boxes <= MAX_STACK_RECTS)
+    vertices = stack_vertices;
+  else
+    vertices = heap_vertices = g_new (graphene_point3d_t, n_boxes * 8);
+
+  transformed = vertices + n_boxes * 4;
+
+  for (i = 0; i < n_boxes; i++)
+    {
+      const ClutterActorBox *box = &boxes[i];
+      graphene_point3d_t *v = &vertices[i * 4];
+
+      graphene_point3d_init (&v[0], box->x1, box->y1, 0.f);
+      graphene_point3d_init (&v[1], box->x2, box->y1, 0.f);
+      graphene_point3d_init (&v[2], box->x1, box->y2, 0.f);
+      graphene_point3d_init (&v[3], box->x2, box->y2, 0.f);
+    }
+
+  if (!_clutter_actor_fully_transform_vertices (self, vertices, transformed,
+                                                n_boxes * 4))
+    return FALSE;
+
+  for (i = 0; i < n_boxes; i++)
+    {
+      const graphene_point3d_t *v = &transformed[i * 4];
+      int x1, y1, x2, y2;
+
+      if (fabsf (v[0].y - v[1].y) > OCCLUSION_EPSILON ||
+          fabsf (v[2].y - v[3].y) > OCCLUSION_EPSILON ||
+          fabsf (v[0].x - v[2].x) > OCCLUSION_EPSILON ||
+          fabsf (v[1].x - v[3].x) > OCCLUSION_EPSILON ||
+          v[3].x < v[0].x || v[3].y < v[0].y)
+        return FALSE;
+
+      x1 = ceilf (v[0].x - OCCLUSION_EPSILON);
+      y1 = ceilf (v[0].y - OCCLUSION_EPSILON);
+      x2 = floorf (v[3].x + OCCLUSION_EPSILON);
+      y2 = floorf (v[3].y + OCCLUSION_EPSILON);
+
+      rects[i] = (cairo_rectangle_int_t) {
+        .x = x1,
+        .y = y1,
+        .width = MAX (x2 - x1, 0),
+        .height = MAX (y2 - y1, 0),
+      };
+    }
+
+  return TRUE;
+}
+
+static gboolean
+get_background_opaque_rect (ClutterActor          *self,
+                            cairo_rectangle_int_t *rect)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  if (!priv->bg_color_set || priv->bg_color.alpha != 255)
+    return FALSE;
+
+  *rect = (cairo_rectangle_int_t) {
+    .width = floorf (clutter_actor_box_get_width (&priv->allocation)),
+    .height = floorf (clutter_actor_box_get_height (&priv->allocation)),
+  };
+
+  return TRUE;
+}
+
+static void
+subtract_stage_opaque_region (ClutterActor                *self,
+                              cairo_region_t              *unoccluded_region,
+                              const cairo_rectangle_int_t *occluder_clip)
+{
+  ClutterActorBox stack_boxes[MAX_STACK_RECTS];
+  cairo_rectangle_int_t stack_rects[MAX_STACK_RECTS];
+  g_autofree ClutterActorBox *heap_boxes = NULL;
+  g_autofree cairo_rectangle_int_t *heap_rects = NULL;
+  ClutterActorBox *boxes = stack_boxes;
+  cairo_rectangle_int_t *rects = stack_rects;
+  int n_rects, i;
+
+  /* Avoid creating a region just to read the allocation back from it */
+  if (CLUTTER_ACTOR_GET_CLASS (self)->get_opaque_region ==
+      clutter_actor_real_get_opaque_region)
+    {
+      cairo_rectangle_int_t rect;
+
+      if (!get_background_opaque_rect (self, &rect))
+        return;
+
+      rects[0] = rect;
+      n_rects = 1;
+    }
+  else
+    {
+      cairo_region_t *opaque_region;
+
+      opaque_region = clutter_actor_get_opaque_region (self);
+      if (!opaque_region)
+        return;
+
+      n_rects = cairo_region_num_rectangles (opaque_region);
+      if (n_rects > MAX_STACK_RECTS)
+        {
+          boxes = heap_boxes = g_new (ClutterActorBox, n_rects);
+          rects = heap_rects = g_new (cairo_rectangle_int_t, n_rects);
+        }
+
+      for (i = 0; i < n_rects; i++)
+        cairo_region_get_rectangle (opaque_region, i, &rects[i]);
+
+      cairo_region_destroy (opaque_region);
+    }
+
+  for (i = 0; i < n_rects; i++)
+    {
+      boxes[i] = (ClutterActorBox) {
+        .x1 = rects[i].x,
+        .y1 = rects[i].y,
+        .x2 = rects[i].x + rects[i].width,
+        .y2 = rects[i].y + rects[i].height,
+      };
+    }
+
+  if (n_rects == 0 || !boxes_to_stage_rects (self, boxes, n_rects, rects))
+    return;
+
+  /* The rectangles of a region don't overlap, so subtracting them one by
+   * one is the same as subtracting their union, without building it. */
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect = rects[i];
+
+      if (occluder_clip &&
+          !_clutter_util_rectangle_intersection (&rect, occluder_clip, &rect))
+        continue;
+
+      if (rect.width == 0 || rect.height == 0)
+        continue;
+
+      cairo_region_subtract_rectangle (unoccluded_region, &rect);
+    }
+}
+
+/* Whether clutter_actor_paint() gets past its opacity check for @self,
+ * and the actor is shown rather than only mapped for painting elsewhere. */
+static gboolean
+is_painted_in_stage (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  int opacity;
+
+  if (!CLUTTER_ACTOR_IS_VISIBLE (self))
+    return FALSE;
+
+  opacity = priv->opacity_override >= 0 ? priv->opacity_override
+                                         : priv->opacity;
+
+  return opacity != 0;
+}
+
+static void
+cull_occluded_actors (ClutterActor                *self,
+                      ClutterPaintContext         *paint_context,
+                      cairo_region_t              *unoccluded_region,
+                      const cairo_rectangle_int_t *occluder_clip,
+                      gboolean                     parent_painted)
+{
+  ClutterActorPrivate *priv = self->priv;
+  cairo_rectangle_int_t child_occluder_clip;
+  ClutterActorBox paint_box;
+  ClutterActor *child;
+  gboolean painted;
+
+  if (!CLUTTER_ACTOR_IS_MAPPED (self) ||
+      priv->inhibit_culling_counter > 0)
+    return;
+
+  painted = parent_painted && is_painted_in_stage (self);
+
+  if (cairo_region_is_empty (unoccluded_region))
+    {
+      clutter_paint_context_add_occluded_actor (paint_context, self);
+      return;
+    }
+
+  if (clutter_actor_get_paint_box (self, &paint_box))
+    {
+      cairo_rectangle_int_t paint_rect;
+
+      paint_rect.x = floorf (paint_box.x1);
+      paint_rect.y = floorf (paint_box.y1);
+      paint_rect.width = ceilf (paint_box.x2 - paint_rect.x);
+      paint_rect.height = ceilf (paint_box.y2 - paint_rect.y);
+
+      if (cairo_region_contains_rectangle (unoccluded_region, &paint_rect) ==
+          CAIRO_REGION_OVERLAP_OUT)
+        {
+          clutter_paint_context_add_occluded_actor (paint_context, self);
+          return;
+        }
+    }
+
+  /* Effects and offscreen redirection may change where and how the actor
+   * and its children end up on the stage, so neither can be trusted to
+   * cover or to be covered by anything but as a whole. */
+  if (has_enabled_effects (self) || needs_flatten_effect (self))
+    return;
+
+  /* Clips are rectangles, and so are their intersections, which means the
+   * clip applying to occluders never needs to be a region. */
+  if (priv->has_clip || priv->clip_to_allocation)
+    {
+      ClutterActorBox clip_box;
+
+      if (priv->has_clip)
+        {
+          clip_box.x1 = priv->clip.origin.x;
+          clip_box.y1 = priv->clip.origin.y;
+          clip_box.x2 = priv->clip.origin.x + priv->clip.size.width;
+          clip_box.y2 = priv->clip.origin.y + priv->clip.size.height;
+        }
+      else
+        {
+          clip_box.x1 = 0.f;
+          clip_box.y1 = 0.f;
+          clip_box.x2 = clutter_actor_box_get_width (&priv->allocation);
+          clip_box.y2 = clutter_actor_box_get_height (&priv->allocation);
+        }
+
+      if (boxes_to_stage_rects (self, &clip_box, 1, &child_occluder_clip))
+        {
+          if (occluder_clip)
+            _clutter_util_rectangle_intersection (&child_occluder_clip,
+                                                  occluder_clip,
+                                                  &child_occluder_clip);
+        }
+      else
+        {
+          /* Nothing painted with a transformed clip counts as covering */
+          child_occluder_clip = (cairo_rectangle_int_t) { 0 };
+        }
+
+      occluder_clip = &child_occluder_clip;
+    }
+
+  /* Children are painted on top of their parent, so go through them first,
+   * from top to bottom, before looking at what the actor itself covers. */
+  for (child = priv->last_child; child; child = child->priv->prev_sibling)
+    {
+      cull_occluded_actors (child, paint_context,
+                            unoccluded_region, occluder_clip,
+                            painted);
+    }
+
+  /* Only what this pass actually paints opaquely covers anything; the
+   * paint opacity alone doesn't tell, as an opacity override on the actor
+   * hides a transparent, and thus unpainted, ancestor. */
+  if (painted && clutter_actor_get_paint_opacity_internal (self) == 255)
+    subtract_stage_opaque_region (self, unoccluded_region, occluder_clip);
+}
+
+/*
+ * clutter_actor_cull_occluded_children:
+ * @self: the root #ClutterActor, usually the stage
+ * @paint_context: the #ClutterPaintContext about to be used for painting
+ *
+ * Walks the actors below @self from top to bottom, accumulating the
+ * opaque regions reported via clutter_actor_get_opaque_region(), and marks
+ * every actor whose painted area ends up fully covered within the redraw
+ * clip as occluded in @paint_context, so that clutter_actor_paint() skips
+ * it and its children.
+ */
+void
+clutter_actor_cull_occluded_children (ClutterActor        *self,
+                                      ClutterPaintContext *paint_context)
+{
+  const cairo_region_t *redraw_clip;
+  cairo_region_t *unoccluded_region;
+  ClutterActor *child;
+
+  if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_DISABLE_CULLING))
+    return;
+
+  redraw_clip = clutter_paint_context_get_redraw_clip (paint_context);
+  if (!redraw_clip)
+    return;
+
+  unoccluded_region = cairo_region_copy (redraw_clip);
+
+  for (child = self->priv->last_child; child; child = child->priv->prev_sibling)
+    cull_occluded_actors (child, paint_context, unoccluded_region, NULL, TRUE);
+
+  cairo_region_destroy (unoccluded_region);
+}
+
+static gboolean
+gpu_tracing_enabled (ClutterPaintContext *paint_context)
+{
+  CoglFramebuffer *framebuffer =
+    clutter_paint_context_get_framebuffer (paint_context);
+  CoglContext *context = cogl_framebuffer_get_context (framebuffer);
+
+  return cogl_context_is_gpu_tracing_enabled (context);
+}
+
+/* Paints the tree of @self between two GPU timestamp queries, so that the
+ * GPU time spent on the actor, its children and effects shows up in the
+ * profiler. */
+static void
+paint_node_traced (ClutterActor        *self,
+                   ClutterPaintNode    *root_node,
+                   ClutterPaintContext *paint_context)
+{
+  CoglFramebuffer *framebuffer =
+    clutter_paint_context_get_framebuffer (paint_context);
+  CoglContext *context = cogl_framebuffer_get_context (framebuffer);
+  CoglTimestampQuery *begin_query;
+  CoglTimestampQuery *end_query;
+
+  begin_query = cogl_framebuffer_create_timestamp_query (framebuffer);
+
+  clutter_paint_node_paint (root_node, paint_context);
+
+  /* Queries are ordered with everything submitted to the GPU, so this
+   * also covers what effects rendered into offscreen framebuffers */
+  end_query = cogl_framebuffer_create_timestamp_query (framebuffer);
+
+  cogl_context_add_gpu_trace_span (context, begin_query, end_query,
+                                   "GPU (actor paint)",
+                                   _clutter_actor_get_debug_name (self));
+}
+
 /**
  * clutter_actor_paint:
  * @self: A #ClutterActor
@@ -3920,6 +4294,9 @@ clutter_actor_paint (ClutterActor        *self,
                      CLUTTER_DEBUG_DISABLE_CLIPPED_REDRAWS)))
         _clutter_actor_update_last_paint_volume (self);
 
+      if (clutter_paint_context_is_actor_occluded (paint_context, self))
+        return;
+
       success = cull_actor (self, paint_context, &result);
 
       if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_REDRAWS))
@@ -3937,7 +4314,10 @@ clutter_actor_paint (ClutterActor        *self,
   if (G_UNLIKELY (clutter_paint_debug_flags & CLUTTER_DEBUG_PAINT_VOLUMES))
     _clutter_actor_draw_paint_volume (self, actor_node);
 
-  clutter_paint_node_paint (root_node, paint_context);
+  if (G_UNLIKELY (gpu_tracing_enabled (paint_context)))
+    paint_node_traced (self, root_node, paint_context);
+  else
+    clutter_paint_node_paint (root_node, paint_context);
 
   /* If we make it here then the actor has run through a complete
      paint run including all the effects so it's no longer dirty */
@@ -5955,6 +6335,17 @@ clutter_actor_get_default_paint_volume (ClutterActor *self)
   return res;
 }
 
+static cairo_region_t *
+clutter_actor_real_get_opaque_region (ClutterActor *self)
+{
+  cairo_rectangle_int_t rect;
+
+  if (!get_background_opaque_rect (self, &rect))
+    return NULL;
+
+  return cairo_region_create_rectangle (&rect);
+}
+
 static gboolean
 clutter_actor_real_has_overlaps (ClutterActor *self)
 {
@@ -6068,6 +6459,7 @@ clutter_actor_class_init (ClutterActorClass *klass)
   klass->get_accessible = clutter_actor_real_get_accessible;
   klass->get_paint_volume = clutter_actor_real_get_paint_volume;
   klass->has_overlaps = clutter_actor_real_has_overlaps;
+  klass->get_opaque_region = clutter_actor_real_get_opaque_region;
   klass->calculate_resource_scale = clutter_actor_real_calculate_resource_scale;
   klass->paint = clutter_actor_real_paint;
   klass->destroy = clutter_actor_real_destroy;
@@ -16475,6 +16867,35 @@ clutter_actor_has_overlaps (ClutterActor *self)
   return CLUTTER_ACTOR_GET_CLASS (self)->has_overlaps (self);
 }
 
+/**
+ * clutter_actor_get_opaque_region:
+ * @self: A #ClutterActor
+ *
+ * Retrieves the region of the actor, in actor coordinates, that is
+ * painted fully opaque when the actor is painted at full opacity.
+ *
+ * Clutter uses this to skip painting actors that end up completely
+ * covered by other actors. Custom actors painting opaque content can
+ * report it by implementing the #ClutterActorClass.get_opaque_region()
+ * virtual function. By default, the allocation of actors with a fully
+ * opaque background color is reported as opaque.
+ *
+ * Returns: (transfer full) (nullable): the opaque region, or %NULL
+ */
+cairo_region_t *
+clutter_actor_get_opaque_region (ClutterActor *self)
+{
+  ClutterActorClass *klass;
+
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (self), NULL);
+
+  klass = CLUTTER_ACTOR_GET_CLASS (self);
+  if (!klass->get_opaque_region)
+    return NULL;
+
+  return klass->get_opaque_region (self);
+}
+
 /**
  * clutter_actor_has_effects:
  * @self: A #ClutterActor
@@ -214,6 +214,9 @@ struct _ClutterActor
  * @paint_node: virtual function for creating paint nodes and attaching
  *   them to the render tree
  * @touch_event: signal class closure for #ClutterActor::touch-event
+ * @get_opaque_region: virtual function, returns the region of the actor,
+ *   in actor coordinates, that is painted fully opaque. Used to skip
+ *   painting actors covered by it. See clutter_actor_get_opaque_region()
  *
  * Base class for actors.
  */
@@ -303,9 +306,11 @@ struct _ClutterActorClass
   float    (* calculate_resource_scale) (ClutterActor *self,
                                          int           phase);
 
+  cairo_region_t * (* get_opaque_region) (ClutterActor *self);
+
   /*< private >*/
   /* padding for future expansion */
-  gpointer _padding_dummy[25];
+  gpointer _padding_dummy[24];
 };
 
 /**
@@ -604,6 +609,9 @@ float                           clutter_actor_get_resource_scale
 CLUTTER_EXPORT
 gboolean                        clutter_actor_has_overlaps                      (ClutterActor               *self);
 
+CLUTTER_EXPORT
+cairo_region_t *                clutter_actor_get_opaque_region                 (ClutterActor               *self);
+
 /* Content */
 CLUTTER_EXPORT
 void                            clutter_actor_set_content                       (ClutterActor               *self,
@@ -20,20 +20,92 @@
 
 #include "clutter-damage-history.h"
 
-#define DAMAGE_HISTORY_LENGTH 0x10
+#include <string.h>
+
+#include "clutter-debug.h"
+
+/* The history length is always a power of two, large enough to look up
+ * the largest buffer age recently reported by the swap chain. It starts
+ * out covering triple buffering, and grows when a deeper swap chain
+ * (e.g. due to shadow framebuffers or secondary GPU copies) is detected.
+ */
+#define DAMAGE_HISTORY_MIN_LENGTH 0x4
+#define DAMAGE_HISTORY_MAX_LENGTH 0x20
+
+/* Number of frames after which the history shrinks again, if no buffer
+ * age required the current length during that time. */
+#define DAMAGE_HISTORY_SHRINK_FRAMES 600
+
+/* Number of frames between printing statistics when running with
+ * CLUTTER_PAINT=damage-history-stats. */
+#define DAMAGE_HISTORY_STATS_FRAMES 600
+
+typedef enum _DamageHistoryFallback
+{
+  DAMAGE_HISTORY_FALLBACK_UNKNOWN_AGE,
+  DAMAGE_HISTORY_FALLBACK_AGE_TOO_OLD,
+  DAMAGE_HISTORY_FALLBACK_INCOMPLETE,
+
+  N_DAMAGE_HISTORY_FALLBACKS
+} DamageHistoryFallback;
 
 struct _ClutterDamageHistory
 {
-  cairo_region_t *damages[DAMAGE_HISTORY_LENGTH];
+  cairo_region_t **damages;
+  int length;
   int index;
+
+  int max_recent_age;
+  int frames_until_shrink;
+
+  struct {
+    int n_frames;
+    int n_fallbacks[N_DAMAGE_HISTORY_FALLBACKS];
+  } stats;
 };
 
+static void
+resize_damage_history (ClutterDamageHistory *history,
+                       int                   length)
+{
+  cairo_region_t **damages;
+  int age;
+
+  g_assert (length > 0 && (length & (length - 1)) == 0);
+
+  /* Keep the most recent damage, with the current entry at index 0. */
+  damages = g_new0 (cairo_region_t *, length);
+  for (age = 0; age < history->length; age++)
+    {
+      int old_index = (history->index - age) & (history->length - 1);
+
+      if (age < length)
+        damages[(-age) & (length - 1)] = history->damages[old_index];
+      else
+        g_clear_pointer (&history->damages[old_index], cairo_region_destroy);
+    }
+
+  g_free (history->damages);
+  history->damages = damages;
+  history->length = length;
+  history->index = 0;
+}
+
+static int
+get_length_for_age (int age)
+{
+  return MAX (DAMAGE_HISTORY_MIN_LENGTH, 1 << g_bit_storage (age));
+}
+
 ClutterDamageHistory *
 clutter_damage_history_new (void)
 {
   ClutterDamageHistory *history;
 
   history = g_new0 (ClutterDamageHistory, 1);
+  history->length = DAMAGE_HISTORY_MIN_LENGTH;
+  history->damages = g_new0 (cairo_region_t *, history->length);
+  history->frames_until_shrink = DAMAGE_HISTORY_SHRINK_FRAMES;
 
   return history;
 }
@@ -43,9 +115,10 @@ clutter_damage_history_free (ClutterDamageHistory *history)
 {
   int i;
 
-  for (i = 0; i < G_N_ELEMENTS (history->damages); i++)
+  for (i = 0; i < history->length; i++)
     g_clear_pointer (&history->damages[i], cairo_region_destroy);
 
+  g_free (history->damages);
   g_free (history);
 }
 
@@ -53,12 +126,31 @@ gboolean
 clutter_damage_history_is_age_valid (ClutterDamageHistory *history,
                                      int                   age)
 {
-  if (age >= DAMAGE_HISTORY_LENGTH ||
-      age < 1)
-    return FALSE;
+  if (age < 1)
+    {
+      history->stats.n_fallbacks[DAMAGE_HISTORY_FALLBACK_UNKNOWN_AGE]++;
+      return FALSE;
+    }
+
+  history->max_recent_age = MAX (history->max_recent_age, age);
+
+  if (age >= history->length)
+    {
+      history->stats.n_fallbacks[DAMAGE_HISTORY_FALLBACK_AGE_TOO_OLD]++;
+
+      /* The entries needed for this age are already lost, but make sure
+       * the following frames can be repaired. */
+      if (age < DAMAGE_HISTORY_MAX_LENGTH)
+        resize_damage_history (history, get_length_for_age (age));
+
+      return FALSE;
+    }
 
   if (!clutter_damage_history_lookup (history, age))
-    return FALSE;
+    {
+      history->stats.n_fallbacks[DAMAGE_HISTORY_FALLBACK_INCOMPLETE]++;
+      return FALSE;
+    }
 
   return TRUE;
 }
@@ -72,21 +164,66 @@ clutter_damage_history_record (ClutterDamageHistory *history,
 }
 
 static inline int
-step_damage_index (int current,
-                   int diff)
+step_damage_index (ClutterDamageHistory *history,
+                   int                   current,
+                   int                   diff)
 {
-  return (current + diff) & (DAMAGE_HISTORY_LENGTH - 1);
+  return (current + diff) & (history->length - 1);
 }
 
 void
 clutter_damage_history_step (ClutterDamageHistory *history)
 {
-  history->index = step_damage_index (history->index, 1);
+  history->index = step_damage_index (history, history->index, 1);
+  history->stats.n_frames++;
+
+  if (--history->frames_until_shrink == 0)
+    {
+      int length;
+
+      length = get_length_for_age (history->max_recent_age);
+      if (length < history->length)
+        resize_damage_history (history, length);
+
+      history->max_recent_age = 0;
+      history->frames_until_shrink = DAMAGE_HISTORY_SHRINK_FRAMES;
+    }
 }
 
 const cairo_region_t *
 clutter_damage_history_lookup (ClutterDamageHistory *history,
                                int                   age)
 {
-  return history->damages[step_damage_index (history->index, -age)];
+  return history->damages[step_damage_index (history, history->index, -age)];
+}
+
+void
+clutter_damage_history_maybe_print_stats (ClutterDamageHistory *history,
+                                          const char           *name)
+{
+  int n_fallbacks = 0;
+  int i;
+
+  if (!(clutter_paint_debug_flags & CLUTTER_DEBUG_DAMAGE_HISTORY_STATS))
+    return;
+
+  if (history->stats.n_frames < DAMAGE_HISTORY_STATS_FRAMES)
+    return;
+
+  for (i = 0; i < N_DAMAGE_HISTORY_FALLBACKS; i++)
+    n_fallbacks += history->stats.n_fallbacks[i];
+
+  g_message ("Damage history (%s): %d of %d frames (%.1f%%) fell back to "
+             "a full redraw (unknown buffer age: %d, buffer age too old: %d, "
+             "incomplete history: %d), history length: %d",
+             name ? name : "unnamed",
+             n_fallbacks,
+             history->stats.n_frames,
+             100.0 * n_fallbacks / history->stats.n_frames,
+             history->stats.n_fallbacks[DAMAGE_HISTORY_FALLBACK_UNKNOWN_AGE],
+             history->stats.n_fallbacks[DAMAGE_HISTORY_FALLBACK_AGE_TOO_OLD],
+             history->stats.n_fallbacks[DAMAGE_HISTORY_FALLBACK_INCOMPLETE],
+             history->length);
+
+  memset (&history->stats, 0, sizeof (history->stats));
 }
@@ -39,4 +39,7 @@ void clutter_damage_history_step (ClutterDamageHistory *history);
 const cairo_region_t * clutter_damage_history_lookup (ClutterDamageHistory *history,
                                                       int                   age);
 
+void clutter_damage_history_maybe_print_stats (ClutterDamageHistory *history,
+                                               const char           *name);
+
 #endif /* CLUTTER_DAMAGE_HISTORY_H */
@@ -19,6 +19,7 @@
 
 #include "clutter/clutter-frame-clock.h"
 
+#include "clutter/clutter-debug.h"
 #include "clutter/clutter-main.h"
 #include "clutter/clutter-private.h"
 #include "clutter/clutter-timeline-private.h"
@@ -36,6 +37,14 @@ static guint signals[N_SIGNALS];
 /* Wait 2ms after vblank before starting to draw next frame */
 #define SYNC_DELAY_US ms2us (2)
 
+/* Number of presented frames whose measured render time is used to
+ * predict how long the next frame will take. */
+#define RENDER_TIME_HISTORY_LENGTH 16
+
+/* Slack added on top of the slowest recently measured frame, covering
+ * jitter as well as the time it takes to queue the page flip. */
+#define RENDER_TIME_MARGIN_US ms2us (2)
+
 typedef struct _ClutterFrameListener
 {
   const ClutterFrameListenerIface *iface;
@@ -73,6 +82,16 @@ struct _ClutterFrameClock
 
   gboolean is_next_presentation_time_valid;
   int64_t next_presentation_time_us;
+  int64_t next_update_time_us;
+
+  int64_t last_dispatch_time_us;
+  int64_t last_dispatch_lateness_us;
+
+  /* Ring buffer of the time from when each frame should have been
+   * dispatched until the GPU finished rendering it. */
+  int64_t render_time_history_us[RENDER_TIME_HISTORY_LENGTH];
+  int render_time_history_index;
+  int n_render_time_samples;
 
   gboolean pending_reschedule;
   gboolean pending_reschedule_now;
@@ -178,12 +197,87 @@ maybe_reschedule_update (ClutterFrameClock *frame_clock)
     }
 }
 
+static int64_t
+get_refresh_interval_us (ClutterFrameClock *frame_clock)
+{
+  return (int64_t) (0.5 + G_USEC_PER_SEC / frame_clock->refresh_rate);
+}
+
+static void
+record_render_time (ClutterFrameClock *frame_clock,
+                    ClutterFrameInfo  *frame_info)
+{
+  int64_t refresh_interval_us;
+  int64_t dispatch_to_swap_us;
+  int64_t render_time_us;
+
+  if (!frame_info->cpu_time_before_buffer_swap_us ||
+      !(frame_info->flags & CLUTTER_FRAME_INFO_FLAG_GPU_RENDERING_DURATION))
+    return;
+
+  refresh_interval_us = get_refresh_interval_us (frame_clock);
+
+  /* A frame presented later than planned means the prediction was too
+   * optimistic; start over with the fixed schedule until the history
+   * has been refilled. */
+  if (frame_clock->is_next_presentation_time_valid &&
+      frame_info->presentation_time >
+      frame_clock->next_presentation_time_us + refresh_interval_us / 2)
+    {
+      frame_clock->n_render_time_samples = 0;
+      return;
+    }
+
+  dispatch_to_swap_us = frame_info->cpu_time_before_buffer_swap_us -
+                        frame_clock->last_dispatch_time_us;
+  render_time_us = frame_clock->last_dispatch_lateness_us +
+                   dispatch_to_swap_us +
+                   ns2us (frame_info->gpu_rendering_duration_ns);
+
+  frame_clock->render_time_history_us[frame_clock->render_time_history_index] =
+    CLAMP (render_time_us, 0, refresh_interval_us);
+  frame_clock->render_time_history_index =
+    (frame_clock->render_time_history_index + 1) % RENDER_TIME_HISTORY_LENGTH;
+  frame_clock->n_render_time_samples =
+    MIN (frame_clock->n_render_time_samples + 1, RENDER_TIME_HISTORY_LENGTH);
+}
+
+static int64_t
+compute_max_render_time_us (ClutterFrameClock *frame_clock,
+                            int64_t            refresh_interval_us)
+{
+  int64_t fixed_max_render_time_us;
+  int64_t max_render_time_us;
+  int i;
+
+  fixed_max_render_time_us = refresh_interval_us - SYNC_DELAY_US;
+
+  if (frame_clock->n_render_time_samples < RENDER_TIME_HISTORY_LENGTH ||
+      G_UNLIKELY (clutter_paint_debug_flags &
+                  CLUTTER_DEBUG_DISABLE_DYNAMIC_MAX_RENDER_TIME))
+    return fixed_max_render_time_us;
+
+  max_render_time_us = 0;
+  for (i = 0; i < RENDER_TIME_HISTORY_LENGTH; i++)
+    {
+      max_render_time_us = MAX (max_render_time_us,
+                                frame_clock->render_time_history_us[i]);
+    }
+
+  max_render_time_us += RENDER_TIME_MARGIN_US;
+
+  /* Never start drawing earlier than the fixed schedule would */
+  return MIN (max_render_time_us, fixed_max_render_time_us);
+}
+
 void
 clutter_frame_clock_notify_presented (ClutterFrameClock *frame_clock,
                                       ClutterFrameInfo  *frame_info)
 {
   int64_t presentation_time_us = frame_info->presentation_time;
 
+  record_render_time (frame_clock, frame_info);
+
   if (presentation_time_us > frame_clock->last_presentation_time_us ||
       ((presentation_time_us - frame_clock->last_presentation_time_us) >
        INT64_MAX / 2))
@@ -222,7 +316,6 @@ calculate_next_update_time_us (ClutterFrameClock *frame_clock,
 {
   int64_t last_presentation_time_us;
   int64_t now_us;
-  float refresh_rate;
   int64_t refresh_interval_us;
   int64_t min_render_time_allowed_us;
   int64_t max_render_time_allowed_us;
@@ -233,11 +326,11 @@ calculate_next_update_time_us (ClutterFrameClock *frame_clock,
 
   now_us = g_get_monotonic_time ();
 
-  refresh_rate = frame_clock->refresh_rate;
-  refresh_interval_us = (int64_t) (0.5 + G_USEC_PER_SEC / refresh_rate);
+  refresh_interval_us = get_refresh_interval_us (frame_clock);
 
   min_render_time_allowed_us = refresh_interval_us / 2;
-  max_render_time_allowed_us = refresh_interval_us - SYNC_DELAY_US;
+  max_render_time_allowed_us =
+    compute_max_render_time_us (frame_clock, refresh_interval_us);
 
   if (min_render_time_allowed_us > max_render_time_allowed_us)
     min_render_time_allowed_us = max_render_time_allowed_us;
@@ -343,6 +436,7 @@ clutter_frame_clock_schedule_update_now (ClutterFrameClock *frame_clock)
   g_warn_if_fail (next_update_time_us != -1);
 
   g_source_set_ready_time (frame_clock->source, next_update_time_us);
+  frame_clock->next_update_time_us = next_update_time_us;
   frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_SCHEDULED;
   frame_clock->is_next_presentation_time_valid = FALSE;
 }
@@ -379,6 +473,7 @@ clutter_frame_clock_schedule_update (ClutterFrameClock *frame_clock)
   g_warn_if_fail (next_update_time_us != -1);
 
   g_source_set_ready_time (frame_clock->source, next_update_time_us);
+  frame_clock->next_update_time_us = next_update_time_us;
   frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_SCHEDULED;
 }
 
@@ -395,6 +490,10 @@ clutter_frame_clock_dispatch (ClutterFrameClock *frame_clock,
 
   frame_clock->state = CLUTTER_FRAME_CLOCK_STATE_DISPATCHING;
 
+  frame_clock->last_dispatch_time_us = time_us;
+  frame_clock->last_dispatch_lateness_us =
+    MAX (time_us - frame_clock->next_update_time_us, 0);
+
   frame_count = frame_clock->frame_count++;
 
   COGL_TRACE_BEGIN (ClutterFrameClockUpdate, "Frame Clock (update)");
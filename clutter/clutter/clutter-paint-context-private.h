@@ -28,4 +28,10 @@ gboolean clutter_paint_context_is_drawing_off_stage (ClutterPaintContext *paint_
 
 CoglFramebuffer * clutter_paint_context_get_base_framebuffer (ClutterPaintContext *paint_context);
 
+void clutter_paint_context_add_occluded_actor (ClutterPaintContext *paint_context,
+                                               ClutterActor        *actor);
+
+gboolean clutter_paint_context_is_actor_occluded (ClutterPaintContext *paint_context,
+                                                  ClutterActor        *actor);
+
 #endif /* CLUTTER_PAINT_CONTEXT_PRIVATE_H */
@@ -30,6 +30,9 @@ struct _ClutterPaintContext
   ClutterStageView *view;
 
   cairo_region_t *redraw_clip;
+
+  /* Actors found to be fully covered by opaque actors painted above them */
+  GHashTable *occluded_actors;
 };
 
 G_DEFINE_BOXED_TYPE (ClutterPaintContext, clutter_paint_context,
@@ -90,6 +93,7 @@ clutter_paint_context_dispose (ClutterPaintContext *paint_context)
                     cogl_object_unref);
   paint_context->framebuffers = NULL;
   g_clear_pointer (&paint_context->redraw_clip, cairo_region_destroy);
+  g_clear_pointer (&paint_context->occluded_actors, g_hash_table_unref);
 }
 
 void
@@ -187,3 +191,23 @@ clutter_paint_context_get_paint_flags (ClutterPaintContext *paint_context)
 {
   return paint_context->paint_flags;
 }
+
+void
+clutter_paint_context_add_occluded_actor (ClutterPaintContext *paint_context,
+                                          ClutterActor        *actor)
+{
+  if (!paint_context->occluded_actors)
+    paint_context->occluded_actors = g_hash_table_new (NULL, NULL);
+
+  g_hash_table_add (paint_context->occluded_actors, actor);
+}
+
+gboolean
+clutter_paint_context_is_actor_occluded (ClutterPaintContext *paint_context,
+                                         ClutterActor        *actor)
+{
+  if (!paint_context->occluded_actors)
+    return FALSE;
+
+  return g_hash_table_contains (paint_context->occluded_actors, actor);
+}
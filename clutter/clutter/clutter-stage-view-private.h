@@ -21,6 +21,8 @@
 #include "clutter/clutter-stage-view.h"
 #include "clutter/clutter-types.h"
 
+const char * clutter_stage_view_get_name (ClutterStageView *view);
+
 void clutter_stage_view_after_paint (ClutterStageView *view,
                                      cairo_region_t   *redraw_clip);
 
@@ -44,6 +46,7 @@ void clutter_stage_view_invalidate_projection (ClutterStageView *view);
 void clutter_stage_view_set_projection (ClutterStageView *view,
                                         const CoglMatrix *matrix);
 
+CLUTTER_EXPORT
 void clutter_stage_view_add_redraw_clip (ClutterStageView            *view,
                                          const cairo_rectangle_int_t *clip);
 
@@ -57,6 +60,15 @@ cairo_region_t * clutter_stage_view_take_redraw_clip (ClutterStageView *view);
 
 CoglScanout * clutter_stage_view_take_scanout (ClutterStageView *view);
 
+CLUTTER_EXPORT
+void clutter_stage_view_inhibit_overlays (ClutterStageView *view);
+
+CLUTTER_EXPORT
+void clutter_stage_view_uninhibit_overlays (ClutterStageView *view);
+
+CLUTTER_EXPORT
+gboolean clutter_stage_view_are_overlays_inhibited (ClutterStageView *view);
+
 void clutter_stage_view_transform_rect_to_onscreen (ClutterStageView            *view,
                                                     const cairo_rectangle_int_t *src_rect,
                                                     int                          dst_width,
@@ -73,6 +73,7 @@ typedef struct _ClutterStageViewPrivate
   } shadow;
 
   CoglScanout *next_scanout;
+  int overlays_inhibit_count;
 
   gboolean has_redraw_clip;
   cairo_region_t *redraw_clip;
@@ -103,6 +104,15 @@ clutter_stage_view_get_layout (ClutterStageView      *view,
   *rect = priv->layout;
 }
 
+const char *
+clutter_stage_view_get_name (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  return priv->name;
+}
+
 /**
  * clutter_stage_view_get_framebuffer:
  * @view: a #ClutterStageView
@@ -712,6 +722,7 @@ copy_shadowfb_to_onscreen (ClutterStageView     *view,
             }
 
           clutter_damage_history_step (damage_history);
+          clutter_damage_history_maybe_print_stats (damage_history, priv->name);
         }
     }
 
@@ -1021,6 +1032,49 @@ clutter_stage_view_peek_scanout (ClutterStageView *view)
   return priv->next_scanout;
 }
 
+/**
+ * clutter_stage_view_inhibit_overlays: (skip)
+ *
+ * Makes sure everything shown on @view is painted into its framebuffer,
+ * instead of being scanned out from planes stacked above it, until
+ * clutter_stage_view_uninhibit_overlays() is called. This is needed while
+ * the framebuffer is read back, e.g. when casting it.
+ */
+void
+clutter_stage_view_inhibit_overlays (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  priv->overlays_inhibit_count++;
+}
+
+/**
+ * clutter_stage_view_uninhibit_overlays: (skip)
+ */
+void
+clutter_stage_view_uninhibit_overlays (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  g_return_if_fail (priv->overlays_inhibit_count > 0);
+
+  priv->overlays_inhibit_count--;
+}
+
+/**
+ * clutter_stage_view_are_overlays_inhibited: (skip)
+ */
+gboolean
+clutter_stage_view_are_overlays_inhibited (ClutterStageView *view)
+{
+  ClutterStageViewPrivate *priv =
+    clutter_stage_view_get_instance_private (view);
+
+  return priv->overlays_inhibit_count > 0;
+}
+
 void
 clutter_stage_view_schedule_update (ClutterStageView *view)
 {
@@ -87,6 +87,7 @@ struct _ClutterStageQueueRedrawEntry
 typedef struct _PickRecord
 {
   graphene_point_t vertex[4];
+  ClutterActorBox bounds;
   ClutterActor *actor;
   int clip_stack_top;
 } PickRecord;
@@ -95,8 +96,15 @@ typedef struct _PickClipRecord
 {
   int prev;
   graphene_point_t vertex[4];
+  ClutterActorBox bounds;
 } PickClipRecord;
 
+/* Below this many pick records, a linear search is cheaper than building the
+ * grid index.
+ */
+#define PICK_GRID_MIN_RECORDS 64
+#define PICK_GRID_SIZE 16
+
 struct _ClutterStagePrivate
 {
   /* the stage implementation */
@@ -131,6 +139,13 @@ struct _ClutterStagePrivate
   gboolean pick_stack_frozen;
   ClutterPickMode cached_pick_mode;
 
+  /* Uniform grid over the pick records, each cell holding the indices of the
+   * records whose bounds intersect it, in stacking order.
+   */
+  GArray *pick_grid_cells[PICK_GRID_SIZE * PICK_GRID_SIZE];
+  ClutterActorBox pick_grid_bounds;
+  gboolean pick_grid_valid;
+
 #ifdef CLUTTER_ENABLE_DEBUG
   gulong redraw_count;
 #endif /* CLUTTER_ENABLE_DEBUG */
@@ -279,18 +294,80 @@ remove_pick_stack_weak_refs (ClutterStage *stage)
   priv->pick_stack_frozen = FALSE;
 }
 
+static void
+clear_pick_grid (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  int i;
+
+  if (!priv->pick_grid_valid)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (priv->pick_grid_cells); i++)
+    {
+      if (priv->pick_grid_cells[i])
+        g_array_set_size (priv->pick_grid_cells[i], 0);
+    }
+
+  priv->pick_grid_valid = FALSE;
+}
+
 static void
 _clutter_stage_clear_pick_stack (ClutterStage *stage)
 {
   ClutterStagePrivate *priv = stage->priv;
 
   remove_pick_stack_weak_refs (stage);
+  clear_pick_grid (stage);
   g_array_set_size (priv->pick_stack, 0);
   g_array_set_size (priv->pick_clip_stack, 0);
   priv->pick_clip_stack_top = -1;
   priv->cached_pick_mode = CLUTTER_PICK_NONE;
 }
 
+static void
+get_vertices_bounds (const graphene_point_t *vertices,
+                     ClutterActorBox        *bounds)
+{
+  int i;
+
+  bounds->x1 = bounds->x2 = vertices[0].x;
+  bounds->y1 = bounds->y2 = vertices[0].y;
+
+  for (i = 1; i < 4; i++)
+    {
+      bounds->x1 = MIN (bounds->x1, vertices[i].x);
+      bounds->y1 = MIN (bounds->y1, vertices[i].y);
+      bounds->x2 = MAX (bounds->x2, vertices[i].x);
+      bounds->y2 = MAX (bounds->y2, vertices[i].y);
+    }
+}
+
+static void
+intersect_bounds (ClutterActorBox       *bounds,
+                  const ClutterActorBox *other)
+{
+  bounds->x1 = MAX (bounds->x1, other->x1);
+  bounds->y1 = MAX (bounds->y1, other->y1);
+  bounds->x2 = MIN (bounds->x2, other->x2);
+  bounds->y2 = MIN (bounds->y2, other->y2);
+}
+
+static gboolean
+is_empty_bounds (const ClutterActorBox *bounds)
+{
+  return bounds->x2 < bounds->x1 || bounds->y2 < bounds->y1;
+}
+
+static gboolean
+bounds_contains_point (const ClutterActorBox *bounds,
+                       float                  x,
+                       float                  y)
+{
+  return (x >= bounds->x1 && x <= bounds->x2 &&
+          y >= bounds->y1 && y <= bounds->y2);
+}
+
 void
 clutter_stage_log_pick (ClutterStage           *stage,
                         const graphene_point_t *vertices,
@@ -310,6 +387,16 @@ clutter_stage_log_pick (ClutterStage           *stage,
   rec.actor = actor;
   rec.clip_stack_top = priv->pick_clip_stack_top;
 
+  get_vertices_bounds (vertices, &rec.bounds);
+  if (rec.clip_stack_top >= 0)
+    {
+      const PickClipRecord *clip = &g_array_index (priv->pick_clip_stack,
+                                                   PickClipRecord,
+                                                   rec.clip_stack_top);
+
+      intersect_bounds (&rec.bounds, &clip->bounds);
+    }
+
   g_array_append_val (priv->pick_stack, rec);
 }
 
@@ -329,6 +416,16 @@ clutter_stage_push_pick_clip (ClutterStage           *stage,
   clip.prev = priv->pick_clip_stack_top;
   memcpy (clip.vertex, vertices, 4 * sizeof (graphene_point_t));
 
+  get_vertices_bounds (vertices, &clip.bounds);
+  if (clip.prev >= 0)
+    {
+      const PickClipRecord *prev = &g_array_index (priv->pick_clip_stack,
+                                                   PickClipRecord,
+                                                   clip.prev);
+
+      intersect_bounds (&clip.bounds, &prev->bounds);
+    }
+
   g_array_append_val (priv->pick_clip_stack, clip);
   priv->pick_clip_stack_top = priv->pick_clip_stack->len - 1;
 }
@@ -477,6 +574,9 @@ pick_record_contains_point (ClutterStage     *stage,
   ClutterStagePrivate *priv;
   int clip_index;
 
+  if (!bounds_contains_point (&rec->bounds, x, y))
+    return FALSE;
+
   if (!is_inside_input_region (&point, rec->vertex))
       return FALSE;
 
@@ -849,6 +949,7 @@ clutter_stage_do_paint_view (ClutterStage         *stage,
   cairo_region_get_extents (redraw_clip, &clip_rect);
   setup_view_for_pick_or_paint (stage, view, &clip_rect);
 
+  clutter_actor_cull_occluded_children (CLUTTER_ACTOR (stage), paint_context);
   clutter_actor_paint (CLUTTER_ACTOR (stage), paint_context);
   clutter_paint_context_destroy (paint_context);
 }
@@ -1467,6 +1568,108 @@ _clutter_stage_has_full_redraw_queued (ClutterStage *stage)
   return is_full_stage_redraw_queued (stage);
 }
 
+static void
+get_pick_grid_cell (ClutterStage *stage,
+                    float         x,
+                    float         y,
+                    int          *out_cell_x,
+                    int          *out_cell_y)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  const ClutterActorBox *grid_bounds = &priv->pick_grid_bounds;
+  float cell_width, cell_height;
+
+  cell_width = (grid_bounds->x2 - grid_bounds->x1) / PICK_GRID_SIZE;
+  cell_height = (grid_bounds->y2 - grid_bounds->y1) / PICK_GRID_SIZE;
+
+  *out_cell_x = CLAMP ((int) ((x - grid_bounds->x1) / cell_width),
+                       0, PICK_GRID_SIZE - 1);
+  *out_cell_y = CLAMP ((int) ((y - grid_bounds->y1) / cell_height),
+                       0, PICK_GRID_SIZE - 1);
+}
+
+static void
+ensure_pick_grid (ClutterStage *stage)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  ClutterActorBox *grid_bounds = &priv->pick_grid_bounds;
+  float stage_width, stage_height;
+  int i;
+
+  if (priv->pick_grid_valid)
+    return;
+
+  if (priv->pick_stack->len < PICK_GRID_MIN_RECORDS)
+    return;
+
+  clutter_actor_get_size (CLUTTER_ACTOR (stage), &stage_width, &stage_height);
+  *grid_bounds = (ClutterActorBox) CLUTTER_ACTOR_BOX_INIT (0.f, 0.f,
+                                                           stage_width,
+                                                           stage_height);
+  if (grid_bounds->x2 <= grid_bounds->x1 ||
+      grid_bounds->y2 <= grid_bounds->y1)
+    return;
+
+  for (i = 0; i < priv->pick_stack->len; i++)
+    {
+      const PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord, i);
+      ClutterActorBox bounds = rec->bounds;
+      int cell_x1, cell_y1, cell_x2, cell_y2;
+      int cell_x, cell_y;
+
+      intersect_bounds (&bounds, grid_bounds);
+      if (is_empty_bounds (&bounds))
+        continue;
+
+      get_pick_grid_cell (stage, bounds.x1, bounds.y1, &cell_x1, &cell_y1);
+      get_pick_grid_cell (stage, bounds.x2, bounds.y2, &cell_x2, &cell_y2);
+
+      for (cell_y = cell_y1; cell_y <= cell_y2; cell_y++)
+        {
+          for (cell_x = cell_x1; cell_x <= cell_x2; cell_x++)
+            {
+              GArray **cell =
+                &priv->pick_grid_cells[cell_y * PICK_GRID_SIZE + cell_x];
+
+              if (!*cell)
+                *cell = g_array_new (FALSE, FALSE, sizeof (int));
+
+              g_array_append_val (*cell, i);
+            }
+        }
+    }
+
+  priv->pick_grid_valid = TRUE;
+}
+
+static ClutterActor *
+pick_from_grid (ClutterStage *stage,
+                float         x,
+                float         y)
+{
+  ClutterStagePrivate *priv = stage->priv;
+  GArray *cell;
+  int cell_x, cell_y;
+  int i;
+
+  get_pick_grid_cell (stage, x, y, &cell_x, &cell_y);
+  cell = priv->pick_grid_cells[cell_y * PICK_GRID_SIZE + cell_x];
+  if (!cell)
+    return CLUTTER_ACTOR (stage);
+
+  for (i = cell->len - 1; i >= 0; i--)
+    {
+      int rec_index = g_array_index (cell, int, i);
+      const PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord,
+                                              rec_index);
+
+      if (rec->actor && pick_record_contains_point (stage, rec, x, y))
+        return rec->actor;
+    }
+
+  return CLUTTER_ACTOR (stage);
+}
+
 static ClutterActor *
 _clutter_stage_do_pick_on_view (ClutterStage     *stage,
                                 float             x,
@@ -1499,10 +1702,16 @@ _clutter_stage_do_pick_on_view (ClutterStage     *stage,
       add_pick_stack_weak_refs (stage);
     }
 
-  /* Search all "painted" pickable actors from front to back. A linear search
-   * is required, and also performs fine since there is typically only
-   * on the order of dozens of actors in the list (on screen) at a time.
+  /* With many pickable actors, only search the records overlapping the grid
+   * cell containing the point. Each record is also rejected early based on
+   * its bounding box.
    */
+  ensure_pick_grid (stage);
+  if (priv->pick_grid_valid &&
+      bounds_contains_point (&priv->pick_grid_bounds, x, y))
+    return pick_from_grid (stage, x, y);
+
+  /* Search all "painted" pickable actors from front to back. */
   for (i = priv->pick_stack->len - 1; i >= 0; i--)
     {
       const PickRecord *rec = &g_array_index (priv->pick_stack, PickRecord, i);
@@ -1715,6 +1924,7 @@ clutter_stage_finalize (GObject *object)
 {
   ClutterStage *stage = CLUTTER_STAGE (object);
   ClutterStagePrivate *priv = stage->priv;
+  int i;
 
   g_queue_foreach (priv->event_queue, (GFunc) clutter_event_free, NULL);
   g_queue_free (priv->event_queue);
@@ -1726,6 +1936,8 @@ clutter_stage_finalize (GObject *object)
   _clutter_stage_clear_pick_stack (stage);
   g_array_free (priv->pick_clip_stack, TRUE);
   g_array_free (priv->pick_stack, TRUE);
+  for (i = 0; i < G_N_ELEMENTS (priv->pick_grid_cells); i++)
+    g_clear_pointer (&priv->pick_grid_cells[i], g_array_unref);
 
   if (priv->fps_timer != NULL)
     g_timer_destroy (priv->fps_timer);
@@ -3721,7 +3933,9 @@ capture_view_into (ClutterStage          *stage,
 
       _clutter_stage_maybe_setup_viewport (stage, view);
       region = cairo_region_create_rectangle (rect);
+      clutter_stage_view_inhibit_overlays (view);
       clutter_stage_do_paint_view (stage, view, region);
+      clutter_stage_view_uninhibit_overlays (view);
       cairo_region_destroy (region);
     }
 
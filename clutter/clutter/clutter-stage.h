@@ -114,6 +114,27 @@ struct _ClutterPerspective
   gfloat z_far;
 };
 
+/**
+ * ClutterFrameInfoFlag: (skip)
+ * @CLUTTER_FRAME_INFO_FLAG_NONE: No flags
+ * @CLUTTER_FRAME_INFO_FLAG_GPU_RENDERING_DURATION: The GPU rendering
+ *   duration of the frame was measured
+ * @CLUTTER_FRAME_INFO_FLAG_HW_CLOCK: The presentation time and sequence
+ *   were provided by the display hardware
+ * @CLUTTER_FRAME_INFO_FLAG_ZERO_COPY: Client buffers were scanned out
+ *   directly in the frame
+ * @CLUTTER_FRAME_INFO_FLAG_VSYNC: The frame was presented in sync with the
+ *   vertical retrace
+ */
+typedef enum
+{
+  CLUTTER_FRAME_INFO_FLAG_NONE = 0,
+  CLUTTER_FRAME_INFO_FLAG_GPU_RENDERING_DURATION = 1 << 0,
+  CLUTTER_FRAME_INFO_FLAG_HW_CLOCK = 1 << 1,
+  CLUTTER_FRAME_INFO_FLAG_ZERO_COPY = 1 << 2,
+  CLUTTER_FRAME_INFO_FLAG_VSYNC = 1 << 3,
+} ClutterFrameInfoFlag;
+
 /**
  * ClutterFrameInfo: (skip)
  */
@@ -122,6 +143,20 @@ struct _ClutterFrameInfo
   int64_t frame_counter;
   int64_t presentation_time;
   float refresh_rate;
+
+  ClutterFrameInfoFlag flags;
+
+  /* Vertical retrace counter, if CLUTTER_FRAME_INFO_FLAG_HW_CLOCK is set */
+  unsigned int sequence;
+
+  /* Zero if the frame was not swapped */
+  int64_t cpu_time_before_journal_flush_us;
+  int64_t cpu_time_before_buffer_swap_us;
+
+  /* Zero if it is not known when the page flip was submitted */
+  int64_t flip_submitted_time_us;
+
+  int64_t gpu_rendering_duration_ns;
 };
 
 typedef struct _ClutterCapture
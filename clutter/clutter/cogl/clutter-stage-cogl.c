@@ -461,6 +461,7 @@ clutter_stage_cogl_redraw_view_primary (ClutterStageCogl *stage_cogl,
     clutter_stage_view_cogl_get_instance_private (view_cogl);
   CoglFramebuffer *fb = clutter_stage_view_get_framebuffer (view);
   CoglFramebuffer *onscreen = clutter_stage_view_get_onscreen (view);
+  CoglContext *cogl_context;
   cairo_rectangle_int_t view_rect;
   gboolean is_full_redraw;
   gboolean use_clipped_redraw = TRUE;
@@ -587,6 +588,8 @@ clutter_stage_cogl_redraw_view_primary (ClutterStageCogl *stage_cogl,
         }
 
       clutter_damage_history_step (view_priv->damage_history);
+      clutter_damage_history_maybe_print_stats (view_priv->damage_history,
+                                                clutter_stage_view_get_name (view));
     }
 
   if (use_clipped_redraw)
@@ -647,6 +650,11 @@ clutter_stage_cogl_redraw_view_primary (ClutterStageCogl *stage_cogl,
                     swap_with_damage);
 
   cairo_region_destroy (swap_region);
+
+  /* Report the GPU timings of earlier frames the GPU is done with */
+  cogl_context = cogl_framebuffer_get_context (fb);
+  if (G_UNLIKELY (cogl_context_is_gpu_tracing_enabled (cogl_context)))
+    cogl_context_collect_gpu_trace_spans (cogl_context);
 }
 
 static gboolean
@@ -759,6 +767,8 @@ frame_cb (CoglOnscreen  *onscreen,
           void          *user_data)
 {
   ClutterStageView *view = user_data;
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  CoglContext *cogl_context = cogl_framebuffer_get_context (framebuffer);
   ClutterFrameInfo clutter_frame_info;
 
   if (frame_event == COGL_FRAME_EVENT_SYNC)
@@ -768,8 +778,41 @@ frame_cb (CoglOnscreen  *onscreen,
     .frame_counter = cogl_frame_info_get_global_frame_counter (frame_info),
     .refresh_rate = cogl_frame_info_get_refresh_rate (frame_info),
     .presentation_time = ns2us (cogl_frame_info_get_presentation_time (frame_info)),
+    .cpu_time_before_journal_flush_us =
+      cogl_frame_info_get_time_before_journal_flush_us (frame_info),
+    .cpu_time_before_buffer_swap_us =
+      cogl_frame_info_get_time_before_buffer_swap_us (frame_info),
+    .flip_submitted_time_us =
+      cogl_frame_info_get_flip_submitted_time_us (frame_info),
   };
 
+  if (cogl_frame_info_is_hw_clock (frame_info))
+    {
+      clutter_frame_info.flags |= CLUTTER_FRAME_INFO_FLAG_HW_CLOCK;
+      clutter_frame_info.sequence = cogl_frame_info_get_sequence (frame_info);
+    }
+
+  if (cogl_frame_info_is_zero_copy (frame_info))
+    clutter_frame_info.flags |= CLUTTER_FRAME_INFO_FLAG_ZERO_COPY;
+
+  if (cogl_frame_info_is_vsync (frame_info))
+    clutter_frame_info.flags |= CLUTTER_FRAME_INFO_FLAG_VSYNC;
+
+  if (cogl_has_feature (cogl_context, COGL_FEATURE_ID_TIMESTAMP_QUERY))
+    {
+      int64_t gpu_rendering_duration_ns;
+
+      gpu_rendering_duration_ns =
+        cogl_frame_info_get_rendering_duration_ns (frame_info);
+      if (gpu_rendering_duration_ns >= 0)
+        {
+          clutter_frame_info.flags |=
+            CLUTTER_FRAME_INFO_FLAG_GPU_RENDERING_DURATION;
+          clutter_frame_info.gpu_rendering_duration_ns =
+            gpu_rendering_duration_ns;
+        }
+    }
+
   clutter_stage_view_notify_presented (view, &clutter_frame_info);
 }
 
@@ -141,6 +141,10 @@ struct _CoglContext
   GArray           *journal_flush_attributes_array;
   GArray           *journal_clip_bounds;
 
+  /* GPU trace spans waiting for the GPU to complete them */
+  gboolean          gpu_tracing_enabled;
+  GQueue            gpu_trace_spans;
+
   /* Some simple caching, to minimize state changes... */
   CoglPipeline     *current_pipeline;
   unsigned long     current_pipeline_changes_since_flush;
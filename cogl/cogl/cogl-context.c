@@ -46,6 +46,7 @@
 #include "cogl-onscreen-private.h"
 #include "cogl-attribute-private.h"
 #include "cogl1-context.h"
+#include "cogl-timestamp-query-private.h"
 #include "cogl-gtype-private.h"
 #include "winsys/cogl-winsys-private.h"
 
@@ -249,6 +250,8 @@ cogl_context_new (CoglDisplay *display,
     g_array_new (TRUE, FALSE, sizeof (CoglAttribute *));
   context->journal_clip_bounds = NULL;
 
+  g_queue_init (&context->gpu_trace_spans);
+
   context->current_pipeline = NULL;
   context->current_pipeline_changes_since_flush = 0;
   context->current_pipeline_with_color_attrib = FALSE;
@@ -320,6 +323,8 @@ _cogl_context_free (CoglContext *context)
   const CoglWinsysVtable *winsys = _cogl_context_get_winsys (context);
   const CoglDriverVtable *driver = _cogl_context_get_driver (context);
 
+  _cogl_context_clear_gpu_trace_spans (context);
+
   winsys->context_deinit (context);
 
   if (context->default_gl_texture_2d_tex)
@@ -479,6 +484,39 @@ cogl_context_format_supports_upload (CoglContext *ctx,
   return ctx->texture_driver->format_supports_upload (ctx, format);
 }
 
+/*
+ * Whether reading an onscreen framebuffer into a pixel buffer in @format
+ * is done entirely by GL. Otherwise the read flips or converts the pixels
+ * on the CPU, which maps the buffer and waits for the GPU.
+ */
+gboolean
+cogl_context_format_supports_async_read (CoglContext     *ctx,
+                                         CoglPixelFormat  format)
+{
+  CoglPixelFormat required_format;
+  GLenum gl_intformat;
+  GLenum gl_format;
+  GLenum gl_type;
+
+  if (!ctx->driver_vtable->pixel_format_to_gl)
+    return FALSE;
+
+  if (!_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_MESA_PACK_INVERT))
+    return FALSE;
+
+  required_format = ctx->driver_vtable->pixel_format_to_gl (ctx,
+                                                            format,
+                                                            &gl_intformat,
+                                                            &gl_format,
+                                                            &gl_type);
+  if ((required_format & ~COGL_PREMULT_BIT) != (format & ~COGL_PREMULT_BIT))
+    return FALSE;
+
+  return (_cogl_has_private_feature (ctx,
+                                     COGL_PRIVATE_FEATURE_READ_PIXELS_ANY_FORMAT) ||
+          (gl_format == GL_RGBA && gl_type == GL_UNSIGNED_BYTE));
+}
+
 void
 cogl_context_set_named_pipeline (CoglContext     *context,
                                  CoglPipelineKey *key,
@@ -196,6 +196,11 @@ cogl_is_context (void *object);
  *    time stamps will be recorded in #CoglFrameInfo objects.
  * @COGL_FEATURE_ID_BLIT_FRAMEBUFFER: Whether blitting using
  *    cogl_blit_framebuffer() is supported.
+ * @COGL_FEATURE_ID_GENERATE_MIPMAP: Whether the GPU can generate the
+ *    mipmaps of non-power-of-two 2D textures, as enabled with
+ *    cogl_primitive_texture_set_auto_mipmap().
+ * @COGL_FEATURE_ID_TIMESTAMP_QUERY: Whether GPU timestamps can be
+ *    queried with cogl_framebuffer_create_timestamp_query().
  *
  * All the capabilities that can vary between different GPUs supported
  * by Cogl. Applications that depend on any of these features should explicitly
@@ -215,6 +220,8 @@ typedef enum _CoglFeatureID
   COGL_FEATURE_ID_BUFFER_AGE,
   COGL_FEATURE_ID_TEXTURE_EGL_IMAGE_EXTERNAL,
   COGL_FEATURE_ID_BLIT_FRAMEBUFFER,
+  COGL_FEATURE_ID_GENERATE_MIPMAP,
+  COGL_FEATURE_ID_TIMESTAMP_QUERY,
 
   /*< private >*/
   _COGL_N_FEATURE_IDS   /*< skip >*/
@@ -36,6 +36,7 @@
 #include "cogl-framebuffer-private.h"
 #include "cogl-attribute-private.h"
 #include "cogl-sampler-cache-private.h"
+#include "cogl-timestamp-query.h"
 
 typedef struct _CoglDriverVtable CoglDriverVtable;
 
@@ -282,6 +283,28 @@ struct _CoglDriverVtable
   (* set_uniform) (CoglContext *ctx,
                    GLint location,
                    const CoglBoxedValue *value);
+
+  /* Inserts a timestamp query after the commands submitted so far */
+  CoglTimestampQuery *
+  (* create_timestamp_query) (CoglContext *context);
+
+  void
+  (* free_timestamp_query) (CoglContext *context,
+                            CoglTimestampQuery *query);
+
+  /* Waits for the result of the query and marks it as disjoint if the
+   * GPU clock may have jumped while it was pending */
+  int64_t
+  (* timestamp_query_get_time_ns) (CoglContext *context,
+                                   CoglTimestampQuery *query);
+
+  int64_t
+  (* get_gpu_time_ns) (CoglContext *context);
+
+  /* Checks whether the result of the query is ready, without waiting */
+  gboolean
+  (* timestamp_query_is_available) (CoglContext *context,
+                                    CoglTimestampQuery *query);
 };
 
 #define COGL_DRIVER_ERROR (_cogl_driver_error_quark ())
@@ -33,6 +33,18 @@
 
 #include "cogl-frame-info.h"
 #include "cogl-object-private.h"
+#include "cogl-timestamp-query.h"
+
+typedef enum _CoglFrameInfoFlag
+{
+  COGL_FRAME_INFO_FLAG_NONE = 0,
+  /* presentation_time was provided by the display hardware */
+  COGL_FRAME_INFO_FLAG_HW_CLOCK = 1 << 0,
+  /* Client buffers were scanned out without being copied */
+  COGL_FRAME_INFO_FLAG_ZERO_COPY = 1 << 1,
+  /* The frame was presented in sync with the vertical retrace */
+  COGL_FRAME_INFO_FLAG_VSYNC = 1 << 2,
+} CoglFrameInfoFlag;
 
 struct _CoglFrameInfo
 {
@@ -42,7 +54,18 @@ struct _CoglFrameInfo
   int64_t presentation_time;
   float refresh_rate;
 
+  CoglFrameInfoFlag flags;
+  unsigned int sequence;
+
   int64_t global_frame_counter;
+
+  int64_t cpu_time_before_journal_flush_us;
+  int64_t cpu_time_before_buffer_swap_us;
+  int64_t gpu_time_before_buffer_swap_ns;
+  CoglTimestampQuery *timestamp_query;
+
+  /* Set by the winsys when the page flip of the frame was submitted */
+  int64_t flip_submitted_time_us;
 };
 
 COGL_EXPORT
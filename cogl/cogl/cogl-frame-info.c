@@ -32,6 +32,7 @@
 
 #include "cogl-frame-info-private.h"
 #include "cogl-gtype-private.h"
+#include "cogl-timestamp-query-private.h"
 
 static void _cogl_frame_info_free (CoglFrameInfo *info);
 
@@ -52,6 +53,8 @@ cogl_frame_info_new (int64_t global_frame_counter)
 static void
 _cogl_frame_info_free (CoglFrameInfo *info)
 {
+  g_clear_pointer (&info->timestamp_query, cogl_timestamp_query_free);
+
   g_slice_free (CoglFrameInfo, info);
 }
 
@@ -78,3 +81,64 @@ cogl_frame_info_get_global_frame_counter (CoglFrameInfo *info)
 {
   return info->global_frame_counter;
 }
+
+int64_t
+cogl_frame_info_get_time_before_journal_flush_us (CoglFrameInfo *info)
+{
+  return info->cpu_time_before_journal_flush_us;
+}
+
+int64_t
+cogl_frame_info_get_time_before_buffer_swap_us (CoglFrameInfo *info)
+{
+  return info->cpu_time_before_buffer_swap_us;
+}
+
+int64_t
+cogl_frame_info_get_flip_submitted_time_us (CoglFrameInfo *info)
+{
+  return info->flip_submitted_time_us;
+}
+
+int64_t
+cogl_frame_info_get_rendering_duration_ns (CoglFrameInfo *info)
+{
+  int64_t gpu_time_rendering_done_ns;
+
+  if (!info->timestamp_query)
+    return -1;
+
+  gpu_time_rendering_done_ns =
+    cogl_timestamp_query_get_time_ns (info->timestamp_query);
+
+  /* The GPU clock may have jumped while the frame was rendered */
+  if (info->timestamp_query->is_disjoint)
+    return -1;
+
+  return MAX (gpu_time_rendering_done_ns -
+              info->gpu_time_before_buffer_swap_ns, 0);
+}
+
+gboolean
+cogl_frame_info_is_hw_clock (CoglFrameInfo *info)
+{
+  return !!(info->flags & COGL_FRAME_INFO_FLAG_HW_CLOCK);
+}
+
+gboolean
+cogl_frame_info_is_zero_copy (CoglFrameInfo *info)
+{
+  return !!(info->flags & COGL_FRAME_INFO_FLAG_ZERO_COPY);
+}
+
+gboolean
+cogl_frame_info_is_vsync (CoglFrameInfo *info)
+{
+  return !!(info->flags & COGL_FRAME_INFO_FLAG_VSYNC);
+}
+
+unsigned int
+cogl_frame_info_get_sequence (CoglFrameInfo *info)
+{
+  return info->sequence;
+}
@@ -137,6 +137,102 @@ float cogl_frame_info_get_refresh_rate (CoglFrameInfo *info);
 COGL_EXPORT
 int64_t cogl_frame_info_get_global_frame_counter (CoglFrameInfo *info);
 
+/**
+ * cogl_frame_info_get_time_before_journal_flush_us: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Gets the monotonic time at which painting of the frame was done and
+ * the batched drawing started being flushed to the GPU.
+ *
+ * Return value: the time in microseconds, or 0 if the frame was not
+ *   swapped
+ */
+COGL_EXPORT
+int64_t cogl_frame_info_get_time_before_journal_flush_us (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_get_time_before_buffer_swap_us: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Gets the monotonic time at which the frame was handed to the window
+ * system, i.e. when the CPU side of the rendering was complete.
+ *
+ * Return value: the time in microseconds, or 0 if the frame was not
+ *   swapped
+ */
+COGL_EXPORT
+int64_t cogl_frame_info_get_time_before_buffer_swap_us (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_get_flip_submitted_time_us: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Gets the monotonic time at which the page flip presenting the frame was
+ * submitted to the display hardware.
+ *
+ * Return value: the time in microseconds, or 0 if it is not known
+ */
+COGL_EXPORT
+int64_t cogl_frame_info_get_flip_submitted_time_us (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_get_rendering_duration_ns: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Gets how long the GPU kept executing the commands of the frame after
+ * it was handed to the window system. This needs the
+ * %COGL_FEATURE_ID_TIMESTAMP_QUERY feature, and should only be called
+ * once the frame has been presented, as it otherwise waits for the GPU.
+ *
+ * Return value: the duration in nanoseconds, or -1 if not available,
+ *   e.g. because the GPU reported a disjoint operation in the meantime
+ */
+COGL_EXPORT
+int64_t cogl_frame_info_get_rendering_duration_ns (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_is_hw_clock: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: whether the presentation time was provided by the
+ *   display hardware
+ */
+COGL_EXPORT
+gboolean cogl_frame_info_is_hw_clock (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_is_zero_copy: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: whether client buffers were scanned out directly in the
+ *   frame, without being composited
+ */
+COGL_EXPORT
+gboolean cogl_frame_info_is_zero_copy (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_is_vsync: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: whether the frame was presented in sync with the vertical
+ *   retrace of the display
+ */
+COGL_EXPORT
+gboolean cogl_frame_info_is_vsync (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_get_sequence: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Gets the vertical retrace counter of the display at the time the frame
+ * was presented. Only meaningful if cogl_frame_info_is_hw_clock() returns
+ * %TRUE.
+ *
+ * Return value: the retrace counter
+ */
+COGL_EXPORT
+unsigned int cogl_frame_info_get_sequence (CoglFrameInfo *info);
+
 G_END_DECLS
 
 #endif /* __COGL_FRAME_INFO_H */
@@ -40,6 +40,7 @@
 #include "cogl-object-private.h"
 #include "cogl-util.h"
 #include "cogl-texture-private.h"
+#include "cogl-texture-2d-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-onscreen-template-private.h"
 #include "cogl-clip-stack.h"
@@ -2059,6 +2060,21 @@ draw_wireframe (CoglContext *ctx,
 }
 #endif
 
+/* Rendering to the base level of a texture invalidates any mipmaps
+ * generated from it */
+static void
+mark_offscreen_texture_modified (CoglFramebuffer *framebuffer)
+{
+  CoglOffscreen *offscreen;
+
+  if (!cogl_is_offscreen (framebuffer))
+    return;
+
+  offscreen = COGL_OFFSCREEN (framebuffer);
+  if (offscreen->texture_level == 0)
+    _cogl_texture_2d_externally_modified (offscreen->texture);
+}
+
 /* This can be called directly by the CoglJournal to draw attributes
  * skipping the implicit journal flush, the framebuffer flush and
  * pipeline validation. */
@@ -2097,6 +2113,8 @@ _cogl_framebuffer_draw_attributes (CoglFramebuffer *framebuffer,
                                                        n_attributes,
                                                        flags);
     }
+
+  mark_offscreen_texture_modified (framebuffer);
 }
 
 void
@@ -2136,6 +2154,8 @@ _cogl_framebuffer_draw_indexed_attributes (CoglFramebuffer *framebuffer,
                                                                n_attributes,
                                                                flags);
     }
+
+  mark_offscreen_texture_modified (framebuffer);
 }
 
 void
@@ -40,6 +40,7 @@
 #include "cogl-attribute-private.h"
 #include "cogl-point-in-poly-private.h"
 #include "cogl-private.h"
+#include "cogl-timestamp-query-private.h"
 #include "cogl1-context.h"
 
 #include <string.h>
@@ -1363,6 +1364,7 @@ _cogl_journal_flush (CoglJournal *journal)
   CoglFramebuffer *framebuffer;
   CoglContext *ctx;
   CoglJournalFlushState state;
+  CoglTimestampQuery *begin_query = NULL;
   int i;
   COGL_STATIC_TIMER (flush_timer,
                      "Mainloop", /* parent */
@@ -1394,6 +1396,9 @@ _cogl_journal_flush (CoglJournal *journal)
    * that the timer isn't started recursively. */
   COGL_TIMER_START (_cogl_uprof_context, flush_timer);
 
+  if (G_UNLIKELY (ctx->gpu_tracing_enabled))
+    begin_query = _cogl_context_create_timestamp_query (ctx);
+
   if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_BATCHING)))
     g_print ("BATCHING: journal len = %d\n", journal->entries->len);
 
@@ -1473,6 +1478,17 @@ _cogl_journal_flush (CoglJournal *journal)
 
   cogl_object_unref (state.attribute_buffer);
 
+  if (G_UNLIKELY (begin_query))
+    {
+      CoglTimestampQuery *end_query;
+      g_autofree char *description = NULL;
+
+      end_query = _cogl_context_create_timestamp_query (ctx);
+      description = g_strdup_printf ("%d entries", journal->entries->len);
+      cogl_context_add_gpu_trace_span (ctx, begin_query, end_query,
+                                       "GPU (journal flush)", description);
+    }
+
   COGL_TIMER_START (_cogl_uprof_context, discard_timer);
   _cogl_journal_discard (journal);
   COGL_TIMER_STOP (_cogl_uprof_context, discard_timer);
@@ -52,4 +52,8 @@ COGL_EXPORT
 gboolean cogl_context_format_supports_upload (CoglContext     *ctx,
                                               CoglPixelFormat  format);
 
+COGL_EXPORT
+gboolean cogl_context_format_supports_async_read (CoglContext     *ctx,
+                                                  CoglPixelFormat  format);
+
 #endif /* __COGL_MUTTER_H___ */
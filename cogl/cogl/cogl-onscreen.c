@@ -290,6 +290,27 @@ _cogl_onscreen_queue_event (CoglOnscreen *onscreen,
   _cogl_onscreen_queue_dispatch_idle (onscreen);
 }
 
+static void
+_cogl_onscreen_record_swap_time (CoglOnscreen  *onscreen,
+                                 CoglFrameInfo *info)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  CoglContext *context = framebuffer->context;
+
+  /* The timestamp query completes once the GPU has caught up with
+   * everything submitted for this frame; comparing it against the GPU
+   * clock right now tells how much longer than the CPU it needed. */
+  if (cogl_has_feature (context, COGL_FEATURE_ID_TIMESTAMP_QUERY))
+    {
+      info->gpu_time_before_buffer_swap_ns =
+        cogl_context_get_gpu_time_ns (context);
+      info->timestamp_query =
+        cogl_framebuffer_create_timestamp_query (framebuffer);
+    }
+
+  info->cpu_time_before_buffer_swap_us = g_get_monotonic_time ();
+}
+
 void
 cogl_onscreen_swap_buffers_with_damage (CoglOnscreen *onscreen,
                                         const int *rectangles,
@@ -304,8 +325,11 @@ cogl_onscreen_swap_buffers_with_damage (CoglOnscreen *onscreen,
   info->frame_counter = onscreen->frame_counter;
   g_queue_push_tail (&onscreen->pending_frame_infos, info);
 
+  info->cpu_time_before_journal_flush_us = g_get_monotonic_time ();
   _cogl_framebuffer_flush_journal (framebuffer);
 
+  _cogl_onscreen_record_swap_time (onscreen, info);
+
   winsys = _cogl_framebuffer_get_winsys (framebuffer);
   winsys->onscreen_swap_buffers_with_damage (onscreen,
                                              rectangles, n_rectangles,
@@ -353,8 +377,11 @@ cogl_onscreen_swap_region (CoglOnscreen *onscreen,
   info->frame_counter = onscreen->frame_counter;
   g_queue_push_tail (&onscreen->pending_frame_infos, info);
 
+  info->cpu_time_before_journal_flush_us = g_get_monotonic_time ();
   _cogl_framebuffer_flush_journal (framebuffer);
 
+  _cogl_onscreen_record_swap_time (onscreen, info);
+
   winsys = _cogl_framebuffer_get_winsys (framebuffer);
 
   /* This should only be called if the winsys advertises
@@ -58,6 +58,8 @@ typedef enum
   COGL_PRIVATE_FEATURE_TEXTURE_SWIZZLE,
   COGL_PRIVATE_FEATURE_TEXTURE_MAX_LEVEL,
   COGL_PRIVATE_FEATURE_OES_EGL_SYNC,
+  COGL_PRIVATE_FEATURE_PROGRAM_BINARY,
+  COGL_PRIVATE_FEATURE_DISJOINT_TIMER_QUERY,
   /* If this is set then the winsys is responsible for queueing dirty
    * events. Otherwise a dirty event will be queued when the onscreen
    * is first allocated or when it is shown or resized */
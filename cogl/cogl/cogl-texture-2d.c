@@ -396,20 +396,23 @@ _cogl_texture_2d_pre_paint (CoglTexture *tex, CoglTexturePrePaintFlags flags)
 {
   CoglTexture2D *tex_2d = COGL_TEXTURE_2D (tex);
 
-  /* Only update if the mipmaps are dirty */
-  if ((flags & COGL_TEXTURE_NEEDS_MIPMAP) &&
-      tex_2d->auto_mipmap && tex_2d->mipmaps_dirty)
+  if ((flags & COGL_TEXTURE_NEEDS_MIPMAP) && tex_2d->auto_mipmap)
     {
       CoglContext *ctx = tex->context;
 
       /* Since we are about to ask the GPU to generate mipmaps of tex, we
-       * better make sure tex is up-to-date.
+       * better make sure tex is up-to-date. Flushing rendering to the
+       * texture also marks the mipmaps as dirty.
        */
       _cogl_texture_flush_journal_rendering (tex);
 
-      ctx->driver_vtable->texture_2d_generate_mipmap (tex_2d);
+      /* Only update if the mipmaps are dirty */
+      if (tex_2d->mipmaps_dirty)
+        {
+          ctx->driver_vtable->texture_2d_generate_mipmap (tex_2d);
 
-      tex_2d->mipmaps_dirty = FALSE;
+          tex_2d->mipmaps_dirty = FALSE;
+        }
     }
 }
 
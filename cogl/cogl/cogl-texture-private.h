@@ -359,7 +359,7 @@ _cogl_texture_set_region (CoglTexture *texture,
                           int level,
                           GError **error);
 
-gboolean
+COGL_EXPORT gboolean
 _cogl_texture_set_region_from_bitmap (CoglTexture *texture,
                                       int src_x,
                                       int src_y,
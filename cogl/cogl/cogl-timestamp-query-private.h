@@ -0,0 +1,56 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __COGL_TIMESTAMP_QUERY_PRIVATE_H__
+#define __COGL_TIMESTAMP_QUERY_PRIVATE_H__
+
+#include "cogl-gl-header.h"
+#include "cogl-timestamp-query.h"
+
+struct _CoglTimestampQuery
+{
+  CoglContext *context;
+  GLuint id;
+
+  /* Order of creation, used to tell which queries were pending when a
+   * disjoint event was reported */
+  uint64_t serial;
+
+  gboolean has_result;
+  gboolean is_disjoint;
+  int64_t time_ns;
+};
+
+CoglTimestampQuery *
+_cogl_context_create_timestamp_query (CoglContext *context);
+
+void
+_cogl_context_clear_gpu_trace_spans (CoglContext *context);
+
+#endif /* __COGL_TIMESTAMP_QUERY_PRIVATE_H__ */
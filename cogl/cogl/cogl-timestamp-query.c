@@ -0,0 +1,220 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "cogl-config.h"
+
+#include "cogl-context-private.h"
+#include "cogl-framebuffer-private.h"
+#include "cogl-timestamp-query-private.h"
+#include "cogl-trace.h"
+
+/* Spans are dropped rather than queued forever if they never complete,
+ * e.g. because nothing collects them */
+#define MAX_PENDING_GPU_TRACE_SPANS 4096
+
+typedef struct _CoglGpuTraceSpan
+{
+  CoglTimestampQuery *begin_query;
+  CoglTimestampQuery *end_query;
+  const char *name;
+  char *description;
+} CoglGpuTraceSpan;
+
+CoglTimestampQuery *
+_cogl_context_create_timestamp_query (CoglContext *context)
+{
+  return context->driver_vtable->create_timestamp_query (context);
+}
+
+CoglTimestampQuery *
+cogl_framebuffer_create_timestamp_query (CoglFramebuffer *framebuffer)
+{
+  CoglContext *context = framebuffer->context;
+
+  g_return_val_if_fail (cogl_has_feature (context,
+                                          COGL_FEATURE_ID_TIMESTAMP_QUERY),
+                        NULL);
+
+  /* The query only covers work that has actually been submitted to GL */
+  _cogl_framebuffer_flush_journal (framebuffer);
+
+  return _cogl_context_create_timestamp_query (context);
+}
+
+int64_t
+cogl_timestamp_query_get_time_ns (CoglTimestampQuery *query)
+{
+  CoglContext *context = query->context;
+
+  if (!query->has_result)
+    {
+      query->time_ns =
+        context->driver_vtable->timestamp_query_get_time_ns (context, query);
+      query->has_result = TRUE;
+    }
+
+  return query->time_ns;
+}
+
+gboolean
+cogl_timestamp_query_is_available (CoglTimestampQuery *query)
+{
+  CoglContext *context = query->context;
+
+  if (query->has_result)
+    return TRUE;
+
+  return context->driver_vtable->timestamp_query_is_available (context,
+                                                               query);
+}
+
+void
+cogl_timestamp_query_free (CoglTimestampQuery *query)
+{
+  CoglContext *context = query->context;
+
+  context->driver_vtable->free_timestamp_query (context, query);
+}
+
+int64_t
+cogl_context_get_gpu_time_ns (CoglContext *context)
+{
+  g_return_val_if_fail (cogl_has_feature (context,
+                                          COGL_FEATURE_ID_TIMESTAMP_QUERY),
+                        0);
+
+  return context->driver_vtable->get_gpu_time_ns (context);
+}
+
+static void
+gpu_trace_span_free (CoglGpuTraceSpan *span)
+{
+  cogl_timestamp_query_free (span->begin_query);
+  cogl_timestamp_query_free (span->end_query);
+  g_free (span->description);
+  g_free (span);
+}
+
+void
+_cogl_context_clear_gpu_trace_spans (CoglContext *context)
+{
+  CoglGpuTraceSpan *span;
+
+  while ((span = g_queue_pop_head (&context->gpu_trace_spans)))
+    gpu_trace_span_free (span);
+}
+
+void
+cogl_context_set_gpu_tracing_enabled (CoglContext *context,
+                                      gboolean     enabled)
+{
+  g_return_if_fail (!enabled ||
+                    cogl_has_feature (context,
+                                      COGL_FEATURE_ID_TIMESTAMP_QUERY));
+
+  if (context->gpu_tracing_enabled == enabled)
+    return;
+
+  if (!enabled)
+    {
+      cogl_context_collect_gpu_trace_spans (context);
+      _cogl_context_clear_gpu_trace_spans (context);
+    }
+
+  context->gpu_tracing_enabled = enabled;
+}
+
+gboolean
+cogl_context_is_gpu_tracing_enabled (CoglContext *context)
+{
+  return context->gpu_tracing_enabled;
+}
+
+void
+cogl_context_add_gpu_trace_span (CoglContext        *context,
+                                 CoglTimestampQuery *begin_query,
+                                 CoglTimestampQuery *end_query,
+                                 const char         *name,
+                                 const char         *description)
+{
+  CoglGpuTraceSpan *span;
+
+  span = g_new0 (CoglGpuTraceSpan, 1);
+  span->begin_query = begin_query;
+  span->end_query = end_query;
+  span->name = name;
+  span->description = g_strdup (description);
+
+  g_queue_push_tail (&context->gpu_trace_spans, span);
+
+  if (context->gpu_trace_spans.length > MAX_PENDING_GPU_TRACE_SPANS)
+    gpu_trace_span_free (g_queue_pop_head (&context->gpu_trace_spans));
+}
+
+void
+cogl_context_collect_gpu_trace_spans (CoglContext *context)
+{
+  int64_t gpu_now_ns;
+  int64_t cpu_now_ns;
+  CoglGpuTraceSpan *span;
+
+  if (g_queue_is_empty (&context->gpu_trace_spans))
+    return;
+
+  /* GPU timestamps are in their own clock; map them onto the monotonic
+   * clock used for the CPU side traces by comparing the current time of
+   * both. */
+  gpu_now_ns = cogl_context_get_gpu_time_ns (context);
+  cpu_now_ns = g_get_monotonic_time () * 1000;
+
+  /* Spans are added after their end query has been created, and the GPU
+   * executes commands in order, so they complete in the order of the
+   * queue. */
+  while ((span = g_queue_peek_head (&context->gpu_trace_spans)))
+    {
+      int64_t begin_ns;
+      int64_t end_ns;
+
+      if (!cogl_timestamp_query_is_available (span->end_query))
+        break;
+
+      begin_ns = cogl_timestamp_query_get_time_ns (span->begin_query);
+      end_ns = cogl_timestamp_query_get_time_ns (span->end_query);
+
+      /* The GPU clock may have jumped while the span was pending */
+      if (!span->begin_query->is_disjoint && !span->end_query->is_disjoint)
+        cogl_trace_add_mark (cpu_now_ns - (gpu_now_ns - begin_ns),
+                             MAX (end_ns - begin_ns, 0),
+                             span->name,
+                             span->description);
+
+      g_queue_pop_head (&context->gpu_trace_spans);
+      gpu_trace_span_free (span);
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(COGL_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TIMESTAMP_QUERY_H__
+#define __COGL_TIMESTAMP_QUERY_H__
+
+#include <cogl/cogl-types.h>
+#include <cogl/cogl-context.h>
+#include <cogl/cogl-framebuffer.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-timestamp-query
+ * @short_description: Functions for measuring GPU execution time
+ *
+ * A timestamp query records the GPU clock at the point in the command
+ * stream where it was created, once the GPU has executed everything
+ * submitted before it. Comparing it against cogl_context_get_gpu_time_ns()
+ * or against another query gives the time the GPU spent on the commands
+ * in between.
+ *
+ * These functions are only available if the
+ * %COGL_FEATURE_ID_TIMESTAMP_QUERY feature is advertised.
+ */
+
+/**
+ * CoglTimestampQuery:
+ *
+ * An opaque handle to a pending GPU timestamp query.
+ */
+typedef struct _CoglTimestampQuery CoglTimestampQuery;
+
+/**
+ * cogl_framebuffer_create_timestamp_query: (skip)
+ * @framebuffer: A #CoglFramebuffer
+ *
+ * Flushes any batched drawing of @framebuffer and inserts a timestamp
+ * query after it in the GPU command stream.
+ *
+ * Return value: (transfer full): a new #CoglTimestampQuery, to be freed
+ *   with cogl_timestamp_query_free()
+ */
+COGL_EXPORT CoglTimestampQuery *
+cogl_framebuffer_create_timestamp_query (CoglFramebuffer *framebuffer);
+
+/**
+ * cogl_timestamp_query_get_time_ns: (skip)
+ * @query: A #CoglTimestampQuery
+ *
+ * Retrieves the GPU time at which the commands preceding @query were
+ * completed. This waits for the GPU to reach the query if it has not
+ * done so yet; the result is cached, so calling it again is cheap.
+ *
+ * Return value: the GPU time in nanoseconds, in the same clock as
+ *   cogl_context_get_gpu_time_ns()
+ */
+COGL_EXPORT int64_t
+cogl_timestamp_query_get_time_ns (CoglTimestampQuery *query);
+
+/**
+ * cogl_timestamp_query_is_available: (skip)
+ * @query: A #CoglTimestampQuery
+ *
+ * Checks whether the GPU has reached @query, without waiting for it.
+ * Once this returns %TRUE, cogl_timestamp_query_get_time_ns() does not
+ * block.
+ *
+ * Return value: %TRUE if the result of @query is available
+ */
+COGL_EXPORT gboolean
+cogl_timestamp_query_is_available (CoglTimestampQuery *query);
+
+/**
+ * cogl_timestamp_query_free: (skip)
+ * @query: A #CoglTimestampQuery
+ *
+ * Frees @query and the GL resources associated with it.
+ */
+COGL_EXPORT void
+cogl_timestamp_query_free (CoglTimestampQuery *query);
+
+/**
+ * cogl_context_get_gpu_time_ns: (skip)
+ * @context: A #CoglContext
+ *
+ * Queries the current GPU time without waiting for any pending
+ * commands to be executed.
+ *
+ * Return value: the current GPU time in nanoseconds
+ */
+COGL_EXPORT int64_t
+cogl_context_get_gpu_time_ns (CoglContext *context);
+
+/**
+ * cogl_context_set_gpu_tracing_enabled: (skip)
+ * @context: A #CoglContext
+ * @enabled: Whether to trace GPU execution
+ *
+ * Enables or disables tracing of GPU execution time. While enabled,
+ * Cogl measures how long the GPU spends on every journal flush, and
+ * the spans added with cogl_context_add_gpu_trace_span() are reported
+ * as marks to the profiler active on the current thread, see
+ * cogl_set_tracing_enabled_on_thread().
+ *
+ * Measuring breaks up batching of drawing commands, so this should
+ * only be enabled while profiling. Disabling it discards the spans the
+ * GPU has not completed yet. This requires the
+ * %COGL_FEATURE_ID_TIMESTAMP_QUERY feature.
+ */
+COGL_EXPORT void
+cogl_context_set_gpu_tracing_enabled (CoglContext *context,
+                                      gboolean     enabled);
+
+/**
+ * cogl_context_is_gpu_tracing_enabled: (skip)
+ * @context: A #CoglContext
+ *
+ * Return value: whether tracing of GPU execution time is enabled
+ */
+COGL_EXPORT gboolean
+cogl_context_is_gpu_tracing_enabled (CoglContext *context);
+
+/**
+ * cogl_context_add_gpu_trace_span: (skip)
+ * @context: A #CoglContext
+ * @begin_query: (transfer full): query created before the traced commands
+ * @end_query: (transfer full): query created after the traced commands
+ * @name: static name of the span
+ * @description: (nullable): description of the span, e.g. what was drawn
+ *
+ * Adds a span of GPU execution to be reported once the GPU has
+ * completed it. Results are collected without waiting for the GPU, by
+ * cogl_context_collect_gpu_trace_spans(), usually a few frames later.
+ */
+COGL_EXPORT void
+cogl_context_add_gpu_trace_span (CoglContext        *context,
+                                 CoglTimestampQuery *begin_query,
+                                 CoglTimestampQuery *end_query,
+                                 const char         *name,
+                                 const char         *description);
+
+/**
+ * cogl_context_collect_gpu_trace_spans: (skip)
+ * @context: A #CoglContext
+ *
+ * Reports the pending GPU trace spans the GPU has completed, without
+ * waiting for the remaining ones. Meant to be called once per frame.
+ */
+COGL_EXPORT void
+cogl_context_collect_gpu_trace_spans (CoglContext *context);
+
+G_END_DECLS
+
+#endif /* __COGL_TIMESTAMP_QUERY_H__ */
@@ -273,6 +273,37 @@ cogl_trace_end (CoglTraceHead *head)
   g_mutex_unlock (&cogl_trace_mutex);
 }
 
+void
+cogl_trace_add_mark (int64_t     begin_time_ns,
+                     int64_t     duration_ns,
+                     const char *name,
+                     const char *description)
+{
+  CoglTraceContext *trace_context;
+  CoglTraceThreadContext *trace_thread_context;
+
+  trace_thread_context = g_private_get (&cogl_trace_thread_data);
+  if (!trace_thread_context)
+    return;
+
+  trace_context = cogl_trace_context;
+
+  g_mutex_lock (&cogl_trace_mutex);
+  if (!sysprof_capture_writer_add_mark (trace_context->writer,
+                                        begin_time_ns,
+                                        trace_thread_context->cpu_id,
+                                        trace_thread_context->pid,
+                                        duration_ns,
+                                        trace_thread_context->group,
+                                        name,
+                                        description))
+    {
+      if (errno == EPIPE)
+        cogl_set_tracing_disabled_on_thread (g_main_context_get_thread_default ());
+    }
+  g_mutex_unlock (&cogl_trace_mutex);
+}
+
 #else
 
 #include <string.h>
@@ -300,4 +331,12 @@ cogl_set_tracing_disabled_on_thread (void *data)
   fprintf (stderr, "Tracing not enabled");
 }
 
+void
+cogl_trace_add_mark (int64_t     begin_time_ns,
+                     int64_t     duration_ns,
+                     const char *name,
+                     const char *description)
+{
+}
+
 #endif /* HAVE_TRACING */
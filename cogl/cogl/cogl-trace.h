@@ -67,6 +67,17 @@ cogl_trace_begin (CoglTraceHead *head,
 COGL_EXPORT void
 cogl_trace_end (CoglTraceHead *head);
 
+/*
+ * Adds a mark with explicit times, in nanoseconds of the monotonic clock,
+ * e.g. for work measured elsewhere than on the CPU. Does nothing unless
+ * tracing is enabled on the current thread.
+ */
+COGL_EXPORT void
+cogl_trace_add_mark (int64_t     begin_time_ns,
+                     int64_t     duration_ns,
+                     const char *name,
+                     const char *description);
+
 static inline void
 cogl_auto_trace_end_helper (CoglTraceHead **head)
 {
@@ -112,6 +123,17 @@ cogl_set_tracing_enabled_on_thread (void       *data,
 COGL_EXPORT void
 cogl_set_tracing_disabled_on_thread (void *data);
 
+/*
+ * Adds a mark with explicit times, in nanoseconds of the monotonic clock,
+ * e.g. for work measured elsewhere than on the CPU. Does nothing unless
+ * tracing is enabled on the current thread.
+ */
+COGL_EXPORT void
+cogl_trace_add_mark (int64_t     begin_time_ns,
+                     int64_t     duration_ns,
+                     const char *name,
+                     const char *description);
+
 #endif /* COGL_HAS_TRACING */
 
 #endif /* COGL_TRACE_H */
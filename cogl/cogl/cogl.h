@@ -120,6 +120,7 @@
 #include <cogl/cogl-frame-info.h>
 #include <cogl/cogl-poll.h>
 #include <cogl/cogl-fence.h>
+#include <cogl/cogl-timestamp-query.h>
 #include <cogl/cogl-glib-source.h>
 #include <cogl/cogl-trace.h>
 #include <cogl/cogl-scanout.h>
@@ -33,6 +33,7 @@
 #include "cogl-context-private.h"
 #include "cogl-object-private.h"
 #include "cogl-glsl-shader-boilerplate.h"
+#include "driver/gl/cogl-pipeline-opengl-private.h"
 #include "driver/gl/cogl-util-gl-private.h"
 #include "deprecated/cogl-shader-private.h"
 
@@ -52,7 +53,7 @@ _cogl_shader_free (CoglShader *shader)
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
     if (shader->gl_handle)
-      GE (ctx, glDeleteShader (shader->gl_handle));
+      _cogl_glsl_delete_shader (ctx, shader->gl_handle);
 
   g_slice_free (CoglShader, shader);
 }
@@ -142,7 +142,7 @@ destroy_shader_state (void *user_data,
   if (--shader_state->ref_count == 0)
     {
       if (shader_state->gl_shader)
-        GE( ctx, glDeleteShader (shader_state->gl_shader) );
+        _cogl_glsl_delete_shader (ctx, shader_state->gl_shader);
 
       g_free (shader_state->unit_state);
 
@@ -345,7 +345,7 @@ _cogl_pipeline_fragend_glsl_start (CoglPipeline *pipeline,
         {
           if (shader_state->gl_shader)
             {
-              GE( ctx, glDeleteShader (shader_state->gl_shader) );
+              _cogl_glsl_delete_shader (ctx, shader_state->gl_shader);
               shader_state->gl_shader = 0;
             }
           return;
@@ -155,6 +155,10 @@ _cogl_glsl_shader_set_source_with_boilerplate (CoglContext *ctx,
                                                const char **strings_in,
                                                const GLint *lengths_in);
 
+void
+_cogl_glsl_delete_shader (CoglContext *ctx,
+                          GLuint shader_gl_handle);
+
 void
 _cogl_sampler_gl_init (CoglContext *context,
                        CoglSamplerCacheEntry *entry);
@@ -51,8 +51,13 @@
 #include "driver/gl/cogl-pipeline-fragend-glsl-private.h"
 #include "driver/gl/cogl-pipeline-vertend-glsl-private.h"
 #include "driver/gl/cogl-pipeline-progend-glsl-private.h"
+#include "driver/gl/cogl-program-binary-cache-private.h"
 #include "deprecated/cogl-program-private.h"
 
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
 /* These are used to generalise updating some uniforms that are
    required when building for drivers missing some fixed function
    state that we use */
@@ -312,12 +317,12 @@ dirty_program_state (CoglPipeline *pipeline)
                              NULL);
 }
 
-static void
+static gboolean
 link_program (GLint gl_program)
 {
   GLint link_status;
 
-  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+  _COGL_GET_CONTEXT (ctx, FALSE);
 
   GE( ctx, glLinkProgram (gl_program) );
 
@@ -341,6 +346,8 @@ link_program (GLint gl_program)
 
       g_free (log);
     }
+
+  return link_status;
 }
 
 typedef struct
@@ -655,7 +662,7 @@ _cogl_shader_compile_real (CoglHandle handle,
           _cogl_pipeline_layer_and_unit_numbers_equal (prev, pipeline))
         return;
 
-      GE (ctx, glDeleteShader (shader->gl_handle));
+      _cogl_glsl_delete_shader (ctx, shader->gl_handle);
       shader->gl_handle = 0;
 
       if (shader->compilation_pipeline)
@@ -787,6 +794,7 @@ _cogl_pipeline_progend_glsl_end (CoglPipeline *pipeline,
 
   if (program_state->program == 0)
     {
+      CoglProgramBinaryCache *program_binary_cache;
       GLuint backend_shader;
       GSList *l;
 
@@ -821,7 +829,37 @@ _cogl_pipeline_progend_glsl_end (CoglPipeline *pipeline,
       GE( ctx, glBindAttribLocation (program_state->program,
                                      0, "cogl_position_in"));
 
-      link_program (program_state->program);
+      /* Linking can take a significant amount of time with some
+       * drivers so try to reuse a binary of an identical program
+       * from a previous run first */
+      program_binary_cache = _cogl_program_binary_cache_get (ctx);
+      if (program_binary_cache)
+        {
+          g_autofree char *key = NULL;
+
+          key = _cogl_program_binary_cache_get_key (program_binary_cache,
+                                                    program_state->program);
+
+          if (!key ||
+              !_cogl_program_binary_cache_load (program_binary_cache,
+                                                program_state->program,
+                                                key))
+            {
+              if (key && ctx->glProgramParameteri)
+                GE( ctx, glProgramParameteri (program_state->program,
+                                              GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                              GL_TRUE) );
+
+              if (link_program (program_state->program) && key)
+                _cogl_program_binary_cache_store (program_binary_cache,
+                                                  program_state->program,
+                                                  key);
+            }
+        }
+      else
+        {
+          link_program (program_state->program);
+        }
 
       program_changed = TRUE;
     }
@@ -47,6 +47,7 @@
 #include "cogl-pipeline-state-private.h"
 #include "cogl-glsl-shader-boilerplate.h"
 #include "driver/gl/cogl-pipeline-vertend-glsl-private.h"
+#include "driver/gl/cogl-program-binary-cache-private.h"
 #include "deprecated/cogl-program-private.h"
 
 const CoglPipelineVertend _cogl_pipeline_glsl_vertend;
@@ -96,7 +97,7 @@ destroy_shader_state (void *user_data,
   if (--shader_state->ref_count == 0)
     {
       if (shader_state->gl_shader)
-        GE( ctx, glDeleteShader (shader_state->gl_shader) );
+        _cogl_glsl_delete_shader (ctx, shader_state->gl_shader);
 
       g_slice_free (CoglPipelineShaderState, shader_state);
     }
@@ -171,6 +172,7 @@ _cogl_glsl_shader_set_source_with_boilerplate (CoglContext *ctx,
                                                const char **strings_in,
                                                const GLint *lengths_in)
 {
+  CoglProgramBinaryCache *program_binary_cache;
   const char *vertex_boilerplate;
   const char *fragment_boilerplate;
 
@@ -271,11 +273,34 @@ _cogl_glsl_shader_set_source_with_boilerplate (CoglContext *ctx,
       g_string_free (buf, TRUE);
     }
 
+  program_binary_cache = _cogl_program_binary_cache_get (ctx);
+  if (program_binary_cache)
+    _cogl_program_binary_cache_set_shader_source (program_binary_cache,
+                                                  shader_gl_handle,
+                                                  shader_gl_type,
+                                                  count,
+                                                  strings,
+                                                  lengths);
+
   GE( ctx, glShaderSource (shader_gl_handle, count,
                            (const char **) strings, lengths) );
 
   g_free (version_string);
 }
+
+void
+_cogl_glsl_delete_shader (CoglContext *ctx,
+                          GLuint shader_gl_handle)
+{
+  CoglGLContext *gl_context = _cogl_driver_gl_context (ctx);
+
+  /* Doesn't create the cache, as nothing can be recorded without it */
+  if (gl_context->program_binary_cache)
+    _cogl_program_binary_cache_remove_shader (gl_context->program_binary_cache,
+                                              shader_gl_handle);
+
+  GE( ctx, glDeleteShader (shader_gl_handle) );
+}
 GLuint
 _cogl_pipeline_vertend_glsl_get_shader (CoglPipeline *pipeline)
 {
@@ -414,7 +439,7 @@ _cogl_pipeline_vertend_glsl_start (CoglPipeline *pipeline,
         {
           if (shader_state->gl_shader)
             {
-              GE( ctx, glDeleteShader (shader_state->gl_shader) );
+              _cogl_glsl_delete_shader (ctx, shader_state->gl_shader);
               shader_state->gl_shader = 0;
             }
           return;
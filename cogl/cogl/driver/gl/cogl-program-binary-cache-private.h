@@ -0,0 +1,69 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef __COGL_PROGRAM_BINARY_CACHE_PRIVATE_H
+#define __COGL_PROGRAM_BINARY_CACHE_PRIVATE_H
+
+#include "cogl-context-private.h"
+
+typedef struct _CoglProgramBinaryCache CoglProgramBinaryCache;
+
+CoglProgramBinaryCache *
+_cogl_program_binary_cache_get (CoglContext *ctx);
+
+void
+_cogl_program_binary_cache_free (CoglProgramBinaryCache *cache);
+
+void
+_cogl_program_binary_cache_set_shader_source (CoglProgramBinaryCache *cache,
+                                              GLuint shader,
+                                              GLenum shader_type,
+                                              GLsizei count,
+                                              const char **strings,
+                                              const GLint *lengths);
+
+void
+_cogl_program_binary_cache_remove_shader (CoglProgramBinaryCache *cache,
+                                          GLuint shader);
+
+char *
+_cogl_program_binary_cache_get_key (CoglProgramBinaryCache *cache,
+                                    GLuint program);
+
+gboolean
+_cogl_program_binary_cache_load (CoglProgramBinaryCache *cache,
+                                 GLuint program,
+                                 const char *key);
+
+void
+_cogl_program_binary_cache_store (CoglProgramBinaryCache *cache,
+                                  GLuint program,
+                                  const char *key);
+
+#endif /* __COGL_PROGRAM_BINARY_CACHE_PRIVATE_H */
@@ -0,0 +1,613 @@
+/*
+ * Cogl
+ *
+ * A Low Level GPU Graphics and Utilities API
+ *
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "cogl-config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "cogl-context-private.h"
+#include "cogl-debug.h"
+#include "cogl-private.h"
+#include "driver/gl/cogl-util-gl-private.h"
+#include "driver/gl/cogl-program-binary-cache-private.h"
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+/* Header prepended to program binaries stored in the on-disk cache.
+ * The binary format is driver specific so it is stored alongside the
+ * data. Bump the version whenever the layout changes. */
+#define PROGRAM_BINARY_MAGIC "CoglPB01"
+#define PROGRAM_BINARY_HEADER_SIZE (sizeof (PROGRAM_BINARY_MAGIC) - 1 + \
+                                    sizeof (uint32_t))
+
+/* Least recently used entries are removed once the cache directory
+ * grows past this size */
+#define PROGRAM_BINARY_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+/* Entries are named after a hex encoded SHA-256 */
+#define PROGRAM_BINARY_KEY_LENGTH 64
+
+typedef enum _CacheJobType
+{
+  CACHE_JOB_INDEX,
+  CACHE_JOB_WRITE,
+  CACHE_JOB_TOUCH,
+  CACHE_JOB_REMOVE,
+} CacheJobType;
+
+typedef struct _CacheJob
+{
+  CacheJobType type;
+  char *key;
+  char *contents;
+  gsize length;
+} CacheJob;
+
+typedef struct _CacheEntry
+{
+  gsize size;
+  int64_t last_used;
+} CacheEntry;
+
+struct _CoglProgramBinaryCache
+{
+  CoglContext *ctx;
+
+  char *dir;
+  char *driver_digest;
+
+  /* SHA-256 of the complete source of each shader object, recorded
+   * when the source is set so that building a program key never has
+   * to read the sources back from GL */
+  GHashTable *shader_digests;
+
+  /* Disk I/O and eviction happen on this pool so that they never
+   * block painting. Only a single thread is used so jobs run in the
+   * order they were pushed. */
+  GThreadPool *io_pool;
+
+  /* The following are shared with the I/O thread */
+  GMutex mutex;
+  gboolean index_ready;
+  GHashTable *entries;
+  gsize total_size;
+};
+
+static void
+cache_job_free (CacheJob *job)
+{
+  g_free (job->key);
+  g_free (job->contents);
+  g_free (job);
+}
+
+static void
+push_job (CoglProgramBinaryCache *cache,
+          CacheJobType type,
+          const char *key,
+          char *contents,
+          gsize length)
+{
+  CacheJob *job;
+
+  job = g_new0 (CacheJob, 1);
+  job->type = type;
+  job->key = g_strdup (key);
+  job->contents = contents;
+  job->length = length;
+
+  g_thread_pool_push (cache->io_pool, job, NULL);
+}
+
+static gboolean
+is_valid_key (const char *name)
+{
+  int i;
+
+  for (i = 0; i < PROGRAM_BINARY_KEY_LENGTH; i++)
+    {
+      if (!g_ascii_isxdigit (name[i]))
+        return FALSE;
+    }
+
+  return name[i] == '\0';
+}
+
+static void
+add_entry_locked (CoglProgramBinaryCache *cache,
+                  const char *key,
+                  gsize size,
+                  int64_t last_used)
+{
+  CacheEntry *entry;
+
+  entry = g_hash_table_lookup (cache->entries, key);
+  if (entry)
+    {
+      cache->total_size -= entry->size;
+    }
+  else
+    {
+      entry = g_new0 (CacheEntry, 1);
+      g_hash_table_insert (cache->entries, g_strdup (key), entry);
+    }
+
+  entry->size = size;
+  entry->last_used = last_used;
+  cache->total_size += size;
+}
+
+static void
+remove_entry_locked (CoglProgramBinaryCache *cache,
+                     const char *key)
+{
+  CacheEntry *entry;
+
+  entry = g_hash_table_lookup (cache->entries, key);
+  if (!entry)
+    return;
+
+  cache->total_size -= entry->size;
+  g_hash_table_remove (cache->entries, key);
+}
+
+/* Runs on the I/O thread */
+static void
+evict_entries (CoglProgramBinaryCache *cache)
+{
+  while (TRUE)
+    {
+      g_autofree char *path = NULL;
+      g_autofree char *oldest_key = NULL;
+      const char *oldest = NULL;
+      int64_t oldest_last_used = G_MAXINT64;
+      GHashTableIter iter;
+      gpointer key, value;
+
+      g_mutex_lock (&cache->mutex);
+
+      if (cache->total_size <= PROGRAM_BINARY_CACHE_MAX_SIZE)
+        {
+          g_mutex_unlock (&cache->mutex);
+          return;
+        }
+
+      g_hash_table_iter_init (&iter, cache->entries);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          CacheEntry *entry = value;
+
+          if (entry->last_used < oldest_last_used)
+            {
+              oldest_last_used = entry->last_used;
+              oldest = key;
+            }
+        }
+
+      if (!oldest)
+        {
+          g_mutex_unlock (&cache->mutex);
+          return;
+        }
+
+      oldest_key = g_strdup (oldest);
+      remove_entry_locked (cache, oldest_key);
+
+      g_mutex_unlock (&cache->mutex);
+
+      path = g_build_filename (cache->dir, oldest_key, NULL);
+      g_unlink (path);
+    }
+}
+
+/* Runs on the I/O thread */
+static void
+index_entries (CoglProgramBinaryCache *cache)
+{
+  GDir *dir;
+  const char *name;
+
+  dir = g_dir_open (cache->dir, 0, NULL);
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)))
+        {
+          g_autofree char *path = NULL;
+          GStatBuf buf;
+
+          /* Skips temporary files left behind by interrupted writes */
+          if (!is_valid_key (name))
+            continue;
+
+          path = g_build_filename (cache->dir, name, NULL);
+          if (g_stat (path, &buf) != 0 || !S_ISREG (buf.st_mode))
+            continue;
+
+          /* The modification time is bumped whenever an entry is
+           * used, so it carries the LRU order across runs */
+          g_mutex_lock (&cache->mutex);
+          add_entry_locked (cache, name, buf.st_size,
+                            (int64_t) buf.st_mtime * G_USEC_PER_SEC);
+          g_mutex_unlock (&cache->mutex);
+        }
+
+      g_dir_close (dir);
+    }
+
+  evict_entries (cache);
+
+  g_mutex_lock (&cache->mutex);
+  cache->index_ready = TRUE;
+  g_mutex_unlock (&cache->mutex);
+}
+
+/* Runs on the I/O thread */
+static void
+write_entry (CoglProgramBinaryCache *cache,
+             CacheJob *job)
+{
+  g_autofree char *path = NULL;
+  g_autoptr (GError) error = NULL;
+
+  if (g_mkdir_with_parents (cache->dir, 0700) != 0)
+    return;
+
+  path = g_build_filename (cache->dir, job->key, NULL);
+  if (!g_file_set_contents (path, job->contents, job->length, &error))
+    {
+      g_debug ("Failed to store program binary: %s", error->message);
+      return;
+    }
+
+  g_mutex_lock (&cache->mutex);
+  add_entry_locked (cache, job->key, job->length, g_get_real_time ());
+  g_mutex_unlock (&cache->mutex);
+
+  evict_entries (cache);
+}
+
+static void
+run_cache_job (gpointer data,
+               gpointer user_data)
+{
+  CacheJob *job = data;
+  CoglProgramBinaryCache *cache = user_data;
+  g_autofree char *path = NULL;
+
+  switch (job->type)
+    {
+    case CACHE_JOB_INDEX:
+      index_entries (cache);
+      break;
+    case CACHE_JOB_WRITE:
+      write_entry (cache, job);
+      break;
+    case CACHE_JOB_TOUCH:
+      path = g_build_filename (cache->dir, job->key, NULL);
+      g_utime (path, NULL);
+      break;
+    case CACHE_JOB_REMOVE:
+      path = g_build_filename (cache->dir, job->key, NULL);
+      g_unlink (path);
+      break;
+    }
+
+  cache_job_free (job);
+}
+
+static void
+checksum_update_gl_string (GChecksum *checksum,
+                           CoglContext *ctx,
+                           GLenum name)
+{
+  const char *str = (const char *) ctx->glGetString (name);
+
+  if (str)
+    g_checksum_update (checksum, (const guchar *) str, strlen (str) + 1);
+}
+
+static CoglProgramBinaryCache *
+program_binary_cache_new (CoglContext *ctx)
+{
+  CoglProgramBinaryCache *cache;
+  GChecksum *checksum;
+
+  cache = g_new0 (CoglProgramBinaryCache, 1);
+  cache->ctx = ctx;
+  cache->dir = g_build_filename (g_get_user_cache_dir (),
+                                 "cogl", "programs",
+                                 NULL);
+
+  /* Binaries are only valid for the driver that built them */
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  checksum_update_gl_string (checksum, ctx, GL_VENDOR);
+  checksum_update_gl_string (checksum, ctx, GL_RENDERER);
+  checksum_update_gl_string (checksum, ctx, GL_VERSION);
+  cache->driver_digest = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  cache->shader_digests = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  g_mutex_init (&cache->mutex);
+  cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_free);
+
+  cache->io_pool = g_thread_pool_new (run_cache_job, cache,
+                                      1, FALSE, NULL);
+
+  /* Until the index is built every lookup misses, which only means
+   * that the first few programs are linked from source */
+  push_job (cache, CACHE_JOB_INDEX, NULL, NULL, 0);
+
+  return cache;
+}
+
+CoglProgramBinaryCache *
+_cogl_program_binary_cache_get (CoglContext *ctx)
+{
+  CoglGLContext *gl_context = _cogl_driver_gl_context (ctx);
+
+  if (!_cogl_has_private_feature (ctx, COGL_PRIVATE_FEATURE_PROGRAM_BINARY) ||
+      COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_PROGRAM_CACHES))
+    return NULL;
+
+  if (!gl_context->program_binary_cache)
+    gl_context->program_binary_cache = program_binary_cache_new (ctx);
+
+  return gl_context->program_binary_cache;
+}
+
+void
+_cogl_program_binary_cache_free (CoglProgramBinaryCache *cache)
+{
+  /* Lets pending writes finish so that they aren't lost */
+  g_thread_pool_free (cache->io_pool, FALSE, TRUE);
+
+  g_hash_table_destroy (cache->entries);
+  g_mutex_clear (&cache->mutex);
+  g_hash_table_destroy (cache->shader_digests);
+  g_free (cache->driver_digest);
+  g_free (cache->dir);
+  g_free (cache);
+}
+
+void
+_cogl_program_binary_cache_set_shader_source (CoglProgramBinaryCache *cache,
+                                              GLuint shader,
+                                              GLenum shader_type,
+                                              GLsizei count,
+                                              const char **strings,
+                                              const GLint *lengths)
+{
+  GChecksum *checksum;
+  int i;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  g_checksum_update (checksum,
+                     (const guchar *) &shader_type,
+                     sizeof (shader_type));
+
+  for (i = 0; i < count; i++)
+    {
+      gssize length = lengths && lengths[i] >= 0 ? lengths[i] : -1;
+
+      g_checksum_update (checksum, (const guchar *) strings[i], length);
+    }
+
+  /* Every shader Cogl creates gets its source through here before
+   * being attached, and its digest is dropped again when it is deleted
+   * through _cogl_glsl_delete_shader() */
+  g_hash_table_insert (cache->shader_digests,
+                       GUINT_TO_POINTER (shader),
+                       g_strdup (g_checksum_get_string (checksum)));
+
+  g_checksum_free (checksum);
+}
+
+/* Called when the shader object is deleted, so that the digests of
+ * shaders that are gone don't pile up */
+void
+_cogl_program_binary_cache_remove_shader (CoglProgramBinaryCache *cache,
+                                          GLuint shader)
+{
+  g_hash_table_remove (cache->shader_digests, GUINT_TO_POINTER (shader));
+}
+
+static int
+compare_digests (const void *a,
+                 const void *b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/* The key identifies a linked program by the driver that built it and
+ * the sources of every shader attached to it. */
+char *
+_cogl_program_binary_cache_get_key (CoglProgramBinaryCache *cache,
+                                    GLuint program)
+{
+  CoglContext *ctx = cache->ctx;
+  g_autofree GLuint *shaders = NULL;
+  g_autofree const char **digests = NULL;
+  GLint n_attached = 0;
+  GLsizei n_shaders = 0;
+  GChecksum *checksum;
+  char *key;
+  int i;
+
+  GE( ctx, glGetProgramiv (program, GL_ATTACHED_SHADERS, &n_attached) );
+  if (n_attached <= 0)
+    return NULL;
+
+  shaders = g_new0 (GLuint, n_attached);
+  GE( ctx, glGetAttachedShaders (program, n_attached, &n_shaders, shaders) );
+  if (n_shaders <= 0)
+    return NULL;
+
+  digests = g_new0 (const char *, n_shaders);
+  for (i = 0; i < n_shaders; i++)
+    {
+      digests[i] = g_hash_table_lookup (cache->shader_digests,
+                                        GUINT_TO_POINTER (shaders[i]));
+      if (!digests[i])
+        return NULL;
+    }
+
+  /* The order GL reports attached shaders in is unspecified and
+   * doesn't affect the linked program */
+  qsort (digests, n_shaders, sizeof (const char *), compare_digests);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  g_checksum_update (checksum, (const guchar *) cache->driver_digest, -1);
+  for (i = 0; i < n_shaders; i++)
+    g_checksum_update (checksum, (const guchar *) digests[i], -1);
+
+  key = g_strdup (g_checksum_get_string (checksum));
+
+  g_checksum_free (checksum);
+
+  return key;
+}
+
+gboolean
+_cogl_program_binary_cache_load (CoglProgramBinaryCache *cache,
+                                 GLuint program,
+                                 const char *key)
+{
+  CoglContext *ctx = cache->ctx;
+  g_autofree char *path = NULL;
+  g_autofree char *contents = NULL;
+  gsize length;
+  uint32_t binary_format;
+  GLint link_status = GL_FALSE;
+  CacheEntry *entry;
+
+  /* Misses are answered from the index without touching the disk */
+  g_mutex_lock (&cache->mutex);
+  entry = cache->index_ready ?
+    g_hash_table_lookup (cache->entries, key) : NULL;
+  if (entry)
+    entry->last_used = g_get_real_time ();
+  g_mutex_unlock (&cache->mutex);
+
+  if (!entry)
+    return FALSE;
+
+  /* A hit is read synchronously as it stands in for linking the
+   * program, which is considerably slower */
+  path = g_build_filename (cache->dir, key, NULL);
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    goto invalid;
+
+  if (length <= PROGRAM_BINARY_HEADER_SIZE ||
+      memcmp (contents, PROGRAM_BINARY_MAGIC,
+              sizeof (PROGRAM_BINARY_MAGIC) - 1) != 0)
+    goto invalid;
+
+  memcpy (&binary_format,
+          contents + sizeof (PROGRAM_BINARY_MAGIC) - 1,
+          sizeof (binary_format));
+
+  _cogl_gl_util_clear_gl_errors (ctx);
+
+  ctx->glProgramBinary (program,
+                        binary_format,
+                        contents + PROGRAM_BINARY_HEADER_SIZE,
+                        length - PROGRAM_BINARY_HEADER_SIZE);
+
+  if (_cogl_gl_util_get_error (ctx) != GL_NO_ERROR)
+    goto invalid;
+
+  GE( ctx, glGetProgramiv (program, GL_LINK_STATUS, &link_status) );
+  if (!link_status)
+    goto invalid;
+
+  push_job (cache, CACHE_JOB_TOUCH, key, NULL, 0);
+
+  return TRUE;
+
+invalid:
+  /* The driver may reject binaries after an update, so drop the stale
+   * entry and let the caller link from source */
+  g_mutex_lock (&cache->mutex);
+  remove_entry_locked (cache, key);
+  g_mutex_unlock (&cache->mutex);
+
+  push_job (cache, CACHE_JOB_REMOVE, key, NULL, 0);
+
+  return FALSE;
+}
+
+void
+_cogl_program_binary_cache_store (CoglProgramBinaryCache *cache,
+                                  GLuint program,
+                                  const char *key)
+{
+  CoglContext *ctx = cache->ctx;
+  char *contents;
+  GLint binary_length = 0;
+  GLsizei out_length = 0;
+  GLenum binary_format = 0;
+  uint32_t format;
+
+  GE( ctx, glGetProgramiv (program,
+                           GL_PROGRAM_BINARY_LENGTH,
+                           &binary_length) );
+  if (binary_length <= 0)
+    return;
+
+  contents = g_malloc (PROGRAM_BINARY_HEADER_SIZE + binary_length);
+
+  _cogl_gl_util_clear_gl_errors (ctx);
+
+  ctx->glGetProgramBinary (program,
+                           binary_length,
+                           &out_length,
+                           &binary_format,
+                           contents + PROGRAM_BINARY_HEADER_SIZE);
+
+  if (_cogl_gl_util_get_error (ctx) != GL_NO_ERROR || out_length <= 0)
+    {
+      g_free (contents);
+      return;
+    }
+
+  format = binary_format;
+  memcpy (contents, PROGRAM_BINARY_MAGIC, sizeof (PROGRAM_BINARY_MAGIC) - 1);
+  memcpy (contents + sizeof (PROGRAM_BINARY_MAGIC) - 1,
+          &format, sizeof (format));
+
+  push_job (cache, CACHE_JOB_WRITE, key,
+            contents, PROGRAM_BINARY_HEADER_SIZE + out_length);
+}
@@ -36,6 +36,7 @@
 #include "cogl-context.h"
 #include "cogl-gl-header.h"
 #include "cogl-texture.h"
+#include "cogl-timestamp-query.h"
 
 /* In OpenGL ES context, GL_CONTEXT_LOST has a _KHR prefix */
 #ifndef GL_CONTEXT_LOST
@@ -83,6 +84,14 @@ typedef struct _CoglGLContext {
   /* This is used for generated fake unique sampler object numbers
    when the sampler object extension is not supported */
   GLuint next_fake_sampler_object_number;
+
+  /* Serial of the last timestamp query created, and of the last one
+   * that was pending when the GPU reported a disjoint event */
+  uint64_t timestamp_query_serial;
+  uint64_t disjoint_timestamp_query_serial;
+
+  /* Created on first use when program binaries are supported */
+  struct _CoglProgramBinaryCache *program_binary_cache;
 } CoglGLContext;
 
 CoglGLContext *
@@ -134,4 +143,22 @@ _cogl_gl_util_parse_gl_version (const char *version_string,
 CoglGraphicsResetStatus
 _cogl_gl_get_graphics_reset_status (CoglContext *context);
 
+CoglTimestampQuery *
+_cogl_gl_create_timestamp_query (CoglContext *context);
+
+void
+_cogl_gl_free_timestamp_query (CoglContext        *context,
+                               CoglTimestampQuery *query);
+
+int64_t
+_cogl_gl_timestamp_query_get_time_ns (CoglContext        *context,
+                                      CoglTimestampQuery *query);
+
+int64_t
+_cogl_gl_get_gpu_time_ns (CoglContext *context);
+
+gboolean
+_cogl_gl_timestamp_query_is_available (CoglContext        *context,
+                                       CoglTimestampQuery *query);
+
 #endif /* _COGL_UTIL_GL_PRIVATE_H_ */
@@ -34,7 +34,9 @@
 
 #include "cogl-types.h"
 #include "cogl-context-private.h"
+#include "cogl-timestamp-query-private.h"
 #include "driver/gl/cogl-pipeline-opengl-private.h"
+#include "driver/gl/cogl-program-binary-cache-private.h"
 #include "driver/gl/cogl-util-gl-private.h"
 
 /* This is a relatively new extension */
@@ -55,6 +57,19 @@
 #define GL_UNKNOWN_CONTEXT_RESET_ARB 0x8255
 #endif
 
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
 #ifdef COGL_GL_DEBUG
 /* GL error to string conversion */
 static const struct {
@@ -126,6 +141,11 @@ _cogl_driver_gl_context_init (CoglContext *context)
 void
 _cogl_driver_gl_context_deinit (CoglContext *context)
 {
+  CoglGLContext *gl_context = _cogl_driver_gl_context (context);
+
+  if (gl_context->program_binary_cache)
+    _cogl_program_binary_cache_free (gl_context->program_binary_cache);
+
   _cogl_destroy_texture_units (context);
   g_free (context->driver_context);
 }
@@ -352,3 +372,87 @@ _cogl_gl_get_graphics_reset_status (CoglContext *context)
       return COGL_GRAPHICS_RESET_STATUS_NO_ERROR;
     }
 }
+
+CoglTimestampQuery *
+_cogl_gl_create_timestamp_query (CoglContext *context)
+{
+  CoglGLContext *gl_context = _cogl_driver_gl_context (context);
+  CoglTimestampQuery *query;
+
+  query = g_new0 (CoglTimestampQuery, 1);
+  query->context = context;
+  query->serial = ++gl_context->timestamp_query_serial;
+
+  GE (context, glGenQueries (1, &query->id));
+  GE (context, glQueryCounter (query->id, GL_TIMESTAMP));
+
+  return query;
+}
+
+void
+_cogl_gl_free_timestamp_query (CoglContext        *context,
+                               CoglTimestampQuery *query)
+{
+  GE (context, glDeleteQueries (1, &query->id));
+  g_free (query);
+}
+
+static gboolean
+is_timestamp_query_disjoint (CoglContext        *context,
+                             CoglTimestampQuery *query)
+{
+  CoglGLContext *gl_context = _cogl_driver_gl_context (context);
+  GLint disjoint = GL_FALSE;
+
+  if (!_cogl_has_private_feature (context,
+                                  COGL_PRIVATE_FEATURE_DISJOINT_TIMER_QUERY))
+    return FALSE;
+
+  /* Reading the flag clears it, and a disjoint event invalidates every
+   * query that was pending at the time, so remember up to which query
+   * results have to be discarded */
+  GE (context, glGetIntegerv (GL_GPU_DISJOINT_EXT, &disjoint));
+  if (disjoint)
+    gl_context->disjoint_timestamp_query_serial =
+      gl_context->timestamp_query_serial;
+
+  return query->serial <= gl_context->disjoint_timestamp_query_serial;
+}
+
+int64_t
+_cogl_gl_timestamp_query_get_time_ns (CoglContext        *context,
+                                      CoglTimestampQuery *query)
+{
+  int64_t query_time_ns = 0;
+
+  GE (context, glGetQueryObjecti64v (query->id,
+                                     GL_QUERY_RESULT,
+                                     &query_time_ns));
+
+  query->is_disjoint = is_timestamp_query_disjoint (context, query);
+
+  return query_time_ns;
+}
+
+int64_t
+_cogl_gl_get_gpu_time_ns (CoglContext *context)
+{
+  int64_t gpu_time_ns = 0;
+
+  GE (context, glGetInteger64v (GL_TIMESTAMP, &gpu_time_ns));
+
+  return gpu_time_ns;
+}
+
+gboolean
+_cogl_gl_timestamp_query_is_available (CoglContext        *context,
+                                       CoglTimestampQuery *query)
+{
+  int64_t available = 0;
+
+  GE (context, glGetQueryObjecti64v (query->id,
+                                     GL_QUERY_RESULT_AVAILABLE,
+                                     &available));
+
+  return available != 0;
+}
@@ -482,6 +482,19 @@ _cogl_driver_update_features (CoglContext *ctx,
     COGL_FLAGS_SET (ctx->features,
                     COGL_FEATURE_ID_BLIT_FRAMEBUFFER, TRUE);
 
+  /* GL 2.0 and later support mipmaps of npot textures */
+  if (ctx->glGenerateMipmap)
+    COGL_FLAGS_SET (ctx->features,
+                    COGL_FEATURE_ID_GENERATE_MIPMAP, TRUE);
+
+  if (ctx->glQueryCounter)
+    COGL_FLAGS_SET (ctx->features,
+                    COGL_FEATURE_ID_TIMESTAMP_QUERY, TRUE);
+
+  if (_cogl_check_extension ("GL_EXT_disjoint_timer_query", gl_extensions))
+    COGL_FLAGS_SET (private_features,
+                    COGL_PRIVATE_FEATURE_DISJOINT_TIMER_QUERY, TRUE);
+
   COGL_FLAGS_SET (private_features, COGL_PRIVATE_FEATURE_PBOS, TRUE);
 
   COGL_FLAGS_SET (ctx->features, COGL_FEATURE_ID_MAP_BUFFER_FOR_READ, TRUE);
@@ -499,6 +512,10 @@ _cogl_driver_update_features (CoglContext *ctx,
     COGL_FLAGS_SET (private_features,
                     COGL_PRIVATE_FEATURE_SAMPLER_OBJECTS, TRUE);
 
+  if (ctx->glGetProgramBinary && ctx->glProgramBinary)
+    COGL_FLAGS_SET (private_features,
+                    COGL_PRIVATE_FEATURE_PROGRAM_BINARY, TRUE);
+
   if (COGL_CHECK_GL_VERSION (gl_major, gl_minor, 3, 3) ||
       _cogl_check_extension ("GL_ARB_texture_swizzle", gl_extensions) ||
       _cogl_check_extension ("GL_EXT_texture_swizzle", gl_extensions))
@@ -600,4 +617,10 @@ _cogl_driver_gl =
     _cogl_sampler_gl_init,
     _cogl_sampler_gl_free,
     _cogl_gl_set_uniform, /* XXX name is weird... */
+
+    _cogl_gl_create_timestamp_query,
+    _cogl_gl_free_timestamp_query,
+    _cogl_gl_timestamp_query_get_time_ns,
+    _cogl_gl_get_gpu_time_ns,
+    _cogl_gl_timestamp_query_is_available,
   };
@@ -365,10 +365,27 @@ _cogl_driver_update_features (CoglContext *context,
   if (context->glGenSamplers)
     COGL_FLAGS_SET (private_features, COGL_PRIVATE_FEATURE_SAMPLER_OBJECTS, TRUE);
 
+  if (context->glGetProgramBinary && context->glProgramBinary)
+    COGL_FLAGS_SET (private_features, COGL_PRIVATE_FEATURE_PROGRAM_BINARY, TRUE);
+
   if (context->glBlitFramebuffer)
     COGL_FLAGS_SET (context->features,
                     COGL_FEATURE_ID_BLIT_FRAMEBUFFER, TRUE);
 
+  if (context->glGenerateMipmap &&
+      (COGL_CHECK_GL_VERSION (gl_major, gl_minor, 3, 0) ||
+       _cogl_check_extension ("GL_OES_texture_npot", gl_extensions)))
+    COGL_FLAGS_SET (context->features,
+                    COGL_FEATURE_ID_GENERATE_MIPMAP, TRUE);
+
+  if (context->glQueryCounter)
+    COGL_FLAGS_SET (context->features,
+                    COGL_FEATURE_ID_TIMESTAMP_QUERY, TRUE);
+
+  if (_cogl_check_extension ("GL_EXT_disjoint_timer_query", gl_extensions))
+    COGL_FLAGS_SET (private_features,
+                    COGL_PRIVATE_FEATURE_DISJOINT_TIMER_QUERY, TRUE);
+
   if (_cogl_check_extension ("GL_OES_element_index_uint", gl_extensions))
     {
       COGL_FLAGS_SET (context->features,
@@ -488,4 +505,10 @@ _cogl_driver_gles =
     _cogl_sampler_gl_init,
     _cogl_sampler_gl_free,
     _cogl_gl_set_uniform,
+
+    _cogl_gl_create_timestamp_query,
+    _cogl_gl_free_timestamp_query,
+    _cogl_gl_timestamp_query_get_time_ns,
+    _cogl_gl_get_gpu_time_ns,
+    _cogl_gl_timestamp_query_is_available,
   };
@@ -232,6 +232,55 @@ COGL_EXT_FUNCTION (void, glDrawBuffers,
                    (GLsizei n, const GLenum *bufs))
 COGL_EXT_END ()
 
+COGL_EXT_BEGIN (get_program_binary, 4, 1,
+                COGL_EXT_IN_GLES3,
+                "ARB:\0OES\0",
+                "get_program_binary\0")
+COGL_EXT_FUNCTION (void, glGetProgramBinary,
+                   (GLuint           program,
+                    GLsizei          bufSize,
+                    GLsizei         *length,
+                    GLenum          *binaryFormat,
+                    void            *binary))
+COGL_EXT_FUNCTION (void, glProgramBinary,
+                   (GLuint           program,
+                    GLenum           binaryFormat,
+                    const void      *binary,
+                    GLsizei          length))
+COGL_EXT_END ()
+
+COGL_EXT_BEGIN (program_parameteri, 4, 1,
+                COGL_EXT_IN_GLES3,
+                "ARB:\0",
+                "get_program_binary\0")
+COGL_EXT_FUNCTION (void, glProgramParameteri,
+                   (GLuint           program,
+                    GLenum           pname,
+                    GLint            value))
+COGL_EXT_END ()
+
+COGL_EXT_BEGIN (timer_query, 3, 3,
+                0,
+                "ARB:\0EXT\0",
+                "timer_query\0disjoint_timer_query\0")
+COGL_EXT_FUNCTION (void, glGenQueries,
+                   (GLsizei          n,
+                    GLuint          *ids))
+COGL_EXT_FUNCTION (void, glDeleteQueries,
+                   (GLsizei          n,
+                    const GLuint    *ids))
+COGL_EXT_FUNCTION (void, glQueryCounter,
+                   (GLuint           id,
+                    GLenum           target))
+COGL_EXT_FUNCTION (void, glGetQueryObjecti64v,
+                   (GLuint           id,
+                    GLenum           pname,
+                    int64_t         *params))
+COGL_EXT_FUNCTION (void, glGetInteger64v,
+                   (GLenum           pname,
+                    int64_t         *data))
+COGL_EXT_END ()
+
 COGL_EXT_BEGIN (robustness, 255, 255,
                 0,
                 "ARB\0",
@@ -1021,6 +1021,11 @@ meta_backend_initable_init (GInitable     *initable,
 
   meta_backend_post_init (backend);
 
+#ifdef HAVE_PROFILER
+  meta_profiler_track_frame_timings (priv->profiler,
+                                     CLUTTER_STAGE (priv->stage));
+#endif
+
   return TRUE;
 }
 
@@ -1358,6 +1363,10 @@ meta_backend_set_client_pointer_constraint (MetaBackend           *backend,
   g_clear_object (&priv->client_pointer_constraint);
   if (constraint)
     priv->client_pointer_constraint = g_object_ref (constraint);
+
+  if (META_BACKEND_GET_CLASS (backend)->set_pointer_constraint)
+    META_BACKEND_GET_CLASS (backend)->set_pointer_constraint (backend,
+                                                              constraint);
 }
 
 ClutterBackend *
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * MetaFrameTimings records when each phase of every painted stage view
+ * frame happened, from the start of the update until the presentation
+ * feedback, so that dropped frames can be diagnosed after the fact.
+ *
+ * The records are kept in a fixed size ring buffer. Records are only
+ * ever written from the main thread, while readers may run anywhere;
+ * every slot is guarded by a sequence counter that is odd while the slot
+ * is being written, so readers never block the compositor and simply
+ * retry or skip slots that changed under them.
+ */
+
+#include "config.h"
+
+#include "backends/meta-frame-timings.h"
+
+#include <gio/gio.h>
+#include <string.h>
+
+#define N_RECORDS 1024
+
+/* Frames presented later than this many refresh cycles after their
+ * update started are counted as missed. */
+#define MISSED_FRAME_THRESHOLD 1.5
+
+enum
+{
+  MISSED_FRAME,
+
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS];
+
+typedef struct _MetaFrameTimingsSlot
+{
+  int sequence;
+  MetaFrameTimingsRecord record;
+} MetaFrameTimingsSlot;
+
+struct _MetaFrameTimings
+{
+  GObject parent;
+
+  MetaFrameTimingsSlot slots[N_RECORDS];
+  unsigned int n_written;
+
+  uint64_t n_missed_frames;
+};
+
+G_DEFINE_TYPE (MetaFrameTimings, meta_frame_timings, G_TYPE_OBJECT)
+
+static GQuark quark_pending_record;
+
+static void
+push_record (MetaFrameTimings             *frame_timings,
+             const MetaFrameTimingsRecord *record)
+{
+  MetaFrameTimingsSlot *slot;
+
+  slot = &frame_timings->slots[frame_timings->n_written % N_RECORDS];
+
+  g_atomic_int_inc (&slot->sequence);
+  slot->record = *record;
+  g_atomic_int_inc (&slot->sequence);
+
+  g_atomic_int_inc (&frame_timings->n_written);
+}
+
+static gboolean
+read_slot (MetaFrameTimings       *frame_timings,
+           unsigned int            index,
+           MetaFrameTimingsRecord *out_record)
+{
+  MetaFrameTimingsSlot *slot = &frame_timings->slots[index % N_RECORDS];
+  int sequence;
+
+  while (TRUE)
+    {
+      sequence = g_atomic_int_get (&slot->sequence);
+      if (sequence & 1)
+        continue;
+
+      *out_record = slot->record;
+
+      if (g_atomic_int_get (&slot->sequence) == sequence)
+        break;
+    }
+
+  /* The slot was reused for a newer record while we got to it */
+  if (g_atomic_int_get (&frame_timings->n_written) - index > N_RECORDS)
+    return FALSE;
+
+  return TRUE;
+}
+
+/**
+ * meta_frame_timings_get_records:
+ * @frame_timings: a #MetaFrameTimings
+ *
+ * Returns: (transfer full): a #GArray of #MetaFrameTimingsRecord, oldest
+ *   first
+ */
+GArray *
+meta_frame_timings_get_records (MetaFrameTimings *frame_timings)
+{
+  GArray *records;
+  unsigned int n_written;
+  unsigned int n_records;
+  unsigned int i;
+
+  n_written = g_atomic_int_get (&frame_timings->n_written);
+  n_records = MIN (n_written, N_RECORDS);
+
+  records = g_array_sized_new (FALSE, FALSE,
+                               sizeof (MetaFrameTimingsRecord),
+                               n_records);
+
+  for (i = n_written - n_records; i != n_written; i++)
+    {
+      MetaFrameTimingsRecord record;
+
+      if (read_slot (frame_timings, i, &record))
+        g_array_append_val (records, record);
+    }
+
+  return records;
+}
+
+uint64_t
+meta_frame_timings_get_n_missed_frames (MetaFrameTimings *frame_timings)
+{
+  return frame_timings->n_missed_frames;
+}
+
+gboolean
+meta_frame_timings_dump (MetaFrameTimings  *frame_timings,
+                         const char        *filename,
+                         GError           **error)
+{
+  g_autoptr (GArray) records = NULL;
+  g_autoptr (GString) string = NULL;
+  unsigned int i;
+
+  records = meta_frame_timings_get_records (frame_timings);
+
+  string = g_string_new ("# view frame update relayout paint flush swap "
+                         "flip presentation refresh-rate\n");
+
+  for (i = 0; i < records->len; i++)
+    {
+      MetaFrameTimingsRecord *record =
+        &g_array_index (records, MetaFrameTimingsRecord, i);
+
+      g_string_append_printf (string,
+                              "%s %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %" G_GINT64_FORMAT
+                              " %.3f\n",
+                              record->view_name,
+                              record->frame_counter,
+                              record->update_time_us,
+                              record->relayout_done_time_us,
+                              record->paint_done_time_us,
+                              record->flush_done_time_us,
+                              record->swap_done_time_us,
+                              record->flip_submitted_time_us,
+                              record->presentation_time_us,
+                              record->refresh_rate);
+    }
+
+  return g_file_set_contents (filename, string->str, string->len, error);
+}
+
+static MetaFrameTimingsRecord *
+ensure_pending_record (ClutterStageView *view)
+{
+  MetaFrameTimingsRecord *record;
+
+  record = g_object_get_qdata (G_OBJECT (view), quark_pending_record);
+  if (!record)
+    {
+      g_autofree char *name = NULL;
+
+      record = g_new0 (MetaFrameTimingsRecord, 1);
+      g_object_get (view, "name", &name, NULL);
+      g_strlcpy (record->view_name, name ? name : "unnamed",
+                 sizeof (record->view_name));
+      g_strdelimit (record->view_name, " \t\n", '-');
+
+      g_object_set_qdata_full (G_OBJECT (view), quark_pending_record,
+                               record, g_free);
+    }
+
+  return record;
+}
+
+static void
+on_before_update (ClutterStage     *stage,
+                  ClutterStageView *view,
+                  MetaFrameTimings *frame_timings)
+{
+  MetaFrameTimingsRecord *record = ensure_pending_record (view);
+  char view_name[META_FRAME_TIMINGS_VIEW_NAME_LENGTH];
+
+  memcpy (view_name, record->view_name, sizeof (view_name));
+  *record = (MetaFrameTimingsRecord) { 0 };
+  memcpy (record->view_name, view_name, sizeof (view_name));
+
+  record->update_time_us = g_get_monotonic_time ();
+}
+
+static void
+on_before_paint (ClutterStage     *stage,
+                 ClutterStageView *view,
+                 MetaFrameTimings *frame_timings)
+{
+  ensure_pending_record (view)->relayout_done_time_us = g_get_monotonic_time ();
+}
+
+static void
+on_after_paint (ClutterStage     *stage,
+                ClutterStageView *view,
+                MetaFrameTimings *frame_timings)
+{
+  ensure_pending_record (view)->swap_done_time_us = g_get_monotonic_time ();
+}
+
+static void
+on_presented (ClutterStage     *stage,
+              ClutterStageView *view,
+              ClutterFrameInfo *frame_info,
+              MetaFrameTimings *frame_timings)
+{
+  MetaFrameTimingsRecord *record = ensure_pending_record (view);
+  int64_t refresh_interval_us;
+
+  /* Nothing was painted for this view since the last presentation */
+  if (!record->swap_done_time_us)
+    return;
+
+  record->frame_counter = frame_info->frame_counter;
+  record->paint_done_time_us = frame_info->cpu_time_before_journal_flush_us;
+  record->flush_done_time_us = frame_info->cpu_time_before_buffer_swap_us;
+  record->flip_submitted_time_us = frame_info->flip_submitted_time_us;
+  record->presentation_time_us = frame_info->presentation_time;
+  record->refresh_rate = frame_info->refresh_rate;
+
+  push_record (frame_timings, record);
+
+  if (frame_info->refresh_rate > 0.0)
+    {
+      refresh_interval_us =
+        (int64_t) (0.5 + G_USEC_PER_SEC / frame_info->refresh_rate);
+
+      if (record->presentation_time_us - record->update_time_us >
+          MISSED_FRAME_THRESHOLD * refresh_interval_us)
+        {
+          frame_timings->n_missed_frames++;
+          g_signal_emit (frame_timings, signals[MISSED_FRAME], 0);
+        }
+    }
+
+  record->swap_done_time_us = 0;
+}
+
+MetaFrameTimings *
+meta_frame_timings_new (ClutterStage *stage)
+{
+  MetaFrameTimings *frame_timings;
+
+  frame_timings = g_object_new (META_TYPE_FRAME_TIMINGS, NULL);
+
+  g_signal_connect_object (stage, "before-update",
+                           G_CALLBACK (on_before_update),
+                           frame_timings, 0);
+  g_signal_connect_object (stage, "before-paint",
+                           G_CALLBACK (on_before_paint),
+                           frame_timings, 0);
+  g_signal_connect_object (stage, "after-paint",
+                           G_CALLBACK (on_after_paint),
+                           frame_timings, 0);
+  g_signal_connect_object (stage, "presented",
+                           G_CALLBACK (on_presented),
+                           frame_timings, 0);
+
+  return frame_timings;
+}
+
+static void
+meta_frame_timings_init (MetaFrameTimings *frame_timings)
+{
+}
+
+static void
+meta_frame_timings_class_init (MetaFrameTimingsClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  signals[MISSED_FRAME] =
+    g_signal_new ("missed-frame",
+                  G_TYPE_FROM_CLASS (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+
+  quark_pending_record =
+    g_quark_from_static_string ("meta-frame-timings-pending-record");
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_FRAME_TIMINGS_H
+#define META_FRAME_TIMINGS_H
+
+#include <glib-object.h>
+
+#include "clutter/clutter.h"
+
+#define META_FRAME_TIMINGS_VIEW_NAME_LENGTH 32
+
+typedef struct _MetaFrameTimingsRecord
+{
+  char view_name[META_FRAME_TIMINGS_VIEW_NAME_LENGTH];
+  int64_t frame_counter;
+
+  /* CLOCK_MONOTONIC times in microseconds, 0 if not measured */
+  int64_t update_time_us;
+  int64_t relayout_done_time_us;
+  int64_t paint_done_time_us;
+  int64_t flush_done_time_us;
+  int64_t swap_done_time_us;
+  int64_t flip_submitted_time_us;
+  int64_t presentation_time_us;
+
+  float refresh_rate;
+} MetaFrameTimingsRecord;
+
+#define META_TYPE_FRAME_TIMINGS (meta_frame_timings_get_type ())
+G_DECLARE_FINAL_TYPE (MetaFrameTimings, meta_frame_timings,
+                      META, FRAME_TIMINGS, GObject)
+
+MetaFrameTimings * meta_frame_timings_new (ClutterStage *stage);
+
+GArray * meta_frame_timings_get_records (MetaFrameTimings *frame_timings);
+
+uint64_t meta_frame_timings_get_n_missed_frames (MetaFrameTimings *frame_timings);
+
+gboolean meta_frame_timings_dump (MetaFrameTimings  *frame_timings,
+                                  const char        *filename,
+                                  GError           **error);
+
+#endif /* META_FRAME_TIMINGS_H */
@@ -25,7 +25,10 @@
 #include <glib/gi18n.h>
 #include <gio/gunixfdlist.h>
 
+#include "backends/meta-frame-timings.h"
+#include "clutter/clutter.h"
 #include "cogl/cogl.h"
+#include "meta-dbus-frame-timings.h"
 
 #define META_SYSPROF_PROFILER_DBUS_PATH "/org/gnome/Sysprof3/Profiler"
 
@@ -37,6 +40,10 @@ struct _MetaProfiler
   GCancellable *cancellable;
 
   gboolean running;
+  gboolean gpu_tracing;
+
+  MetaDBusFrameTimings *frame_timings_skeleton;
+  MetaFrameTimings *frame_timings;
 };
 
 static void
@@ -48,6 +55,33 @@ G_DEFINE_TYPE_WITH_CODE (MetaProfiler,
                          G_IMPLEMENT_INTERFACE (META_DBUS_TYPE_SYSPROF3_PROFILER,
                                                 meta_sysprof_capturer_init_iface))
 
+static CoglContext *
+get_cogl_context (void)
+{
+  return clutter_backend_get_cogl_context (clutter_get_default_backend ());
+}
+
+/*
+ * Measuring GPU time per actor and journal flush breaks up batching of
+ * drawing commands, so it's only done when asked for, either through the
+ * "gpu-timing" option of Start(), or with MUTTER_DEBUG_GPU_TIMING=1.
+ */
+static gboolean
+should_trace_gpu (GVariant *options)
+{
+  gboolean gpu_timing = FALSE;
+
+  if (!cogl_has_feature (get_cogl_context (), COGL_FEATURE_ID_TIMESTAMP_QUERY))
+    return FALSE;
+
+  if (g_strcmp0 (g_getenv ("MUTTER_DEBUG_GPU_TIMING"), "1") == 0)
+    return TRUE;
+
+  g_variant_lookup (options, "gpu-timing", "b", &gpu_timing);
+
+  return gpu_timing;
+}
+
 static gboolean
 handle_start (MetaDBusSysprof3Profiler *dbus_profiler,
               GDBusMethodInvocation    *invocation,
@@ -93,7 +127,12 @@ handle_start (MetaDBusSysprof3Profiler *dbus_profiler,
 
   profiler->running = TRUE;
 
-  g_debug ("Profiler running");
+  profiler->gpu_tracing = should_trace_gpu (options);
+  if (profiler->gpu_tracing)
+    cogl_context_set_gpu_tracing_enabled (get_cogl_context (), TRUE);
+
+  g_debug ("Profiler running%s",
+           profiler->gpu_tracing ? " with GPU timing" : "");
 
   meta_dbus_sysprof3_profiler_complete_start (dbus_profiler, invocation, NULL);
   return TRUE;
@@ -114,6 +153,12 @@ handle_stop (MetaDBusSysprof3Profiler *dbus_profiler,
       return TRUE;
     }
 
+  if (profiler->gpu_tracing)
+    {
+      cogl_context_set_gpu_tracing_enabled (get_cogl_context (), FALSE);
+      profiler->gpu_tracing = FALSE;
+    }
+
   cogl_set_tracing_disabled_on_thread (g_main_context_default ());
   profiler->running = FALSE;
 
@@ -130,6 +175,105 @@ meta_sysprof_capturer_init_iface (MetaDBusSysprof3ProfilerIface *iface)
   iface->handle_stop = handle_stop;
 }
 
+static gboolean
+handle_get_frame_timings (MetaDBusFrameTimings  *skeleton,
+                          GDBusMethodInvocation *invocation,
+                          MetaProfiler          *profiler)
+{
+  g_autoptr (GArray) records = NULL;
+  GVariantBuilder builder;
+  unsigned int i;
+
+  if (!profiler->frame_timings)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             G_DBUS_ERROR,
+                                             G_DBUS_ERROR_FAILED,
+                                             "Frame timings not available");
+      return TRUE;
+    }
+
+  records = meta_frame_timings_get_records (profiler->frame_timings);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(stxxxxxxxd)"));
+  for (i = 0; i < records->len; i++)
+    {
+      MetaFrameTimingsRecord *record =
+        &g_array_index (records, MetaFrameTimingsRecord, i);
+
+      g_variant_builder_add (&builder, "(stxxxxxxxd)",
+                             record->view_name,
+                             (uint64_t) record->frame_counter,
+                             record->update_time_us,
+                             record->relayout_done_time_us,
+                             record->paint_done_time_us,
+                             record->flush_done_time_us,
+                             record->swap_done_time_us,
+                             record->flip_submitted_time_us,
+                             record->presentation_time_us,
+                             (double) record->refresh_rate);
+    }
+
+  meta_dbus_frame_timings_complete_get_frame_timings (skeleton, invocation,
+                                                      g_variant_builder_end (&builder));
+  return TRUE;
+}
+
+static gboolean
+handle_dump (MetaDBusFrameTimings  *skeleton,
+             GDBusMethodInvocation *invocation,
+             MetaProfiler          *profiler)
+{
+  g_autofree char *filename = NULL;
+  g_autoptr (GError) error = NULL;
+
+  if (!profiler->frame_timings)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             G_DBUS_ERROR,
+                                             G_DBUS_ERROR_FAILED,
+                                             "Frame timings not available");
+      return TRUE;
+    }
+
+  filename = g_build_filename (g_get_user_runtime_dir (),
+                               "mutter-frame-timings.txt",
+                               NULL);
+
+  if (!meta_frame_timings_dump (profiler->frame_timings, filename, &error))
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             G_DBUS_ERROR,
+                                             G_DBUS_ERROR_FAILED,
+                                             "Failed to dump frame timings: %s",
+                                             error->message);
+      return TRUE;
+    }
+
+  meta_dbus_frame_timings_complete_dump (skeleton, invocation, filename);
+  return TRUE;
+}
+
+static void
+on_missed_frame (MetaFrameTimings *frame_timings,
+                 MetaProfiler     *profiler)
+{
+  meta_dbus_frame_timings_set_missed_frames (
+    profiler->frame_timings_skeleton,
+    meta_frame_timings_get_n_missed_frames (frame_timings));
+}
+
+void
+meta_profiler_track_frame_timings (MetaProfiler *profiler,
+                                   ClutterStage *stage)
+{
+  g_return_if_fail (!profiler->frame_timings);
+
+  profiler->frame_timings = meta_frame_timings_new (stage);
+  g_signal_connect (profiler->frame_timings, "missed-frame",
+                    G_CALLBACK (on_missed_frame), profiler);
+}
+
 static void
 on_bus_acquired_cb (GObject      *source,
                     GAsyncResult *result,
@@ -161,6 +305,18 @@ on_bus_acquired_cb (GObject      *source,
       return;
     }
 
+  interface_skeleton =
+    G_DBUS_INTERFACE_SKELETON (profiler->frame_timings_skeleton);
+  if (!g_dbus_interface_skeleton_export (interface_skeleton,
+                                         connection,
+                                         META_SYSPROF_PROFILER_DBUS_PATH,
+                                         &error))
+    {
+      g_warning ("Failed to export frame timings object: %s\n",
+                 error->message);
+      return;
+    }
+
   profiler->connection = g_steal_pointer (&connection);
 }
 
@@ -173,6 +329,8 @@ meta_profiler_finalize (GObject *object)
 
   g_clear_object (&self->cancellable);
   g_clear_object (&self->connection);
+  g_clear_object (&self->frame_timings);
+  g_clear_object (&self->frame_timings_skeleton);
 
   G_OBJECT_CLASS (meta_profiler_parent_class)->finalize (object);
 }
@@ -190,6 +348,12 @@ meta_profiler_init (MetaProfiler *self)
 {
   self->cancellable = g_cancellable_new ();
 
+  self->frame_timings_skeleton = meta_dbus_frame_timings_skeleton_new ();
+  g_signal_connect (self->frame_timings_skeleton, "handle-get-frame-timings",
+                    G_CALLBACK (handle_get_frame_timings), self);
+  g_signal_connect (self->frame_timings_skeleton, "handle-dump",
+                    G_CALLBACK (handle_dump), self);
+
   g_bus_get (G_BUS_TYPE_SESSION,
              self->cancellable,
              on_bus_acquired_cb,
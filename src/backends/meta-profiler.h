@@ -22,6 +22,7 @@
 
 #include <glib-object.h>
 
+#include "clutter/clutter.h"
 #include "meta-dbus-sysprof3-profiler.h"
 
 G_BEGIN_DECLS
@@ -36,6 +37,9 @@ G_DECLARE_FINAL_TYPE (MetaProfiler,
 
 MetaProfiler * meta_profiler_new (void);
 
+void meta_profiler_track_frame_timings (MetaProfiler *profiler,
+                                        ClutterStage *stage);
+
 G_END_DECLS
 
 #endif /* META_PROFILER_H */
@@ -31,6 +31,7 @@
 #include "backends/meta-stage-private.h"
 #include "clutter/clutter.h"
 #include "clutter/clutter-mutter.h"
+#include "compositor/region-utils.h"
 #include "core/boxes-private.h"
 
 struct _MetaScreenCastAreaStreamSrc
@@ -243,27 +244,28 @@ maybe_record_frame_on_idle (gpointer user_data)
 }
 
 static void
-stage_painted (MetaStage           *stage,
-               ClutterStageView    *view,
-               ClutterPaintContext *paint_context,
-               gpointer             user_data)
+stage_painted (MetaStage            *stage,
+               ClutterStageView     *view,
+               ClutterPaintContext  *paint_context,
+               const cairo_region_t *redraw_clip,
+               gpointer              user_data)
 {
   MetaScreenCastAreaStreamSrc *area_src =
     META_SCREEN_CAST_AREA_STREAM_SRC (user_data);
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (area_src);
   MetaScreenCastStream *stream = meta_screen_cast_stream_src_get_stream (src);
   MetaScreenCastAreaStream *area_stream = META_SCREEN_CAST_AREA_STREAM (stream);
-  const cairo_region_t *redraw_clip;
   MetaRectangle *area;
-
-  if (area_src->maybe_record_idle_id)
-    return;
+  float scale;
 
   area = meta_screen_cast_area_stream_get_area (area_stream);
-  redraw_clip = clutter_paint_context_get_redraw_clip (paint_context);
+  scale = meta_screen_cast_area_stream_get_scale (area_stream);
 
   if (redraw_clip)
     {
+      cairo_region_t *damage;
+      cairo_region_t *scaled_damage;
+
       switch (cairo_region_contains_rectangle (redraw_clip, area))
         {
         case CAIRO_REGION_OVERLAP_IN:
@@ -272,8 +274,26 @@ stage_painted (MetaStage           *stage,
         case CAIRO_REGION_OVERLAP_OUT:
           return;
         }
+
+      damage = cairo_region_copy (redraw_clip);
+      cairo_region_intersect_rectangle (damage, area);
+      cairo_region_translate (damage, -area->x, -area->y);
+
+      scaled_damage = meta_region_scale_double (damage, scale,
+                                                META_ROUNDING_STRATEGY_GROW);
+      meta_screen_cast_stream_src_add_damage (src, scaled_damage);
+
+      cairo_region_destroy (scaled_damage);
+      cairo_region_destroy (damage);
+    }
+  else
+    {
+      meta_screen_cast_stream_src_add_damage (src, NULL);
     }
 
+  if (area_src->maybe_record_idle_id)
+    return;
+
   area_src->maybe_record_idle_id = g_idle_add (maybe_record_frame_on_idle, src);
 }
 
@@ -446,6 +466,7 @@ meta_screen_cast_area_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *src
 static gboolean
 meta_screen_cast_area_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src,
                                                         CoglFramebuffer          *framebuffer,
+                                                        const cairo_region_t     *damage,
                                                         GError                  **error)
 {
   MetaScreenCastAreaStreamSrc *area_src =
@@ -476,8 +497,6 @@ meta_screen_cast_area_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc
                                       area, scale,
                                       paint_flags);
 
-  cogl_framebuffer_finish (framebuffer);
-
   return TRUE;
 }
 
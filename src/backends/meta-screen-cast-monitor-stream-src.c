@@ -35,6 +35,7 @@
 #include "backends/meta-stage-private.h"
 #include "clutter/clutter.h"
 #include "clutter/clutter-mutter.h"
+#include "compositor/region-utils.h"
 #include "core/boxes-private.h"
 
 struct _MetaScreenCastMonitorStreamSrc
@@ -45,6 +46,7 @@ struct _MetaScreenCastMonitorStreamSrc
   gboolean hw_cursor_inhibited;
 
   GList *watches;
+  GList *overlay_inhibited_views;
 
   gulong cursor_moved_handler_id;
   gulong cursor_changed_handler_id;
@@ -114,24 +116,81 @@ meta_screen_cast_monitor_stream_src_get_specs (MetaScreenCastStreamSrc *src,
   *frame_rate = meta_monitor_mode_get_refresh_rate (mode);
 }
 
+static float
+get_view_scale (MetaScreenCastMonitorStreamSrc *monitor_src)
+{
+  MetaMonitor *monitor;
+  MetaLogicalMonitor *logical_monitor;
+
+  if (!meta_is_stage_views_scaled ())
+    return 1.0;
+
+  monitor = get_monitor (monitor_src);
+  logical_monitor = meta_monitor_get_logical_monitor (monitor);
+
+  return meta_logical_monitor_get_scale (logical_monitor);
+}
+
+static void
+add_redraw_clip_damage (MetaScreenCastMonitorStreamSrc *monitor_src,
+                        const cairo_region_t           *redraw_clip)
+{
+  MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (monitor_src);
+  MetaMonitor *monitor;
+  MetaLogicalMonitor *logical_monitor;
+  MetaRectangle logical_monitor_layout;
+  cairo_region_t *damage;
+  cairo_region_t *scaled_damage;
+
+  if (!redraw_clip)
+    {
+      meta_screen_cast_stream_src_add_damage (src, NULL);
+      return;
+    }
+
+  monitor = get_monitor (monitor_src);
+  logical_monitor = meta_monitor_get_logical_monitor (monitor);
+  logical_monitor_layout = meta_logical_monitor_get_layout (logical_monitor);
+
+  damage = cairo_region_copy (redraw_clip);
+  cairo_region_intersect_rectangle (damage, &logical_monitor_layout);
+  cairo_region_translate (damage,
+                          -logical_monitor_layout.x,
+                          -logical_monitor_layout.y);
+
+  scaled_damage = meta_region_scale_double (damage,
+                                            get_view_scale (monitor_src),
+                                            META_ROUNDING_STRATEGY_GROW);
+  meta_screen_cast_stream_src_add_damage (src, scaled_damage);
+
+  cairo_region_destroy (scaled_damage);
+  cairo_region_destroy (damage);
+}
+
 static void
-stage_painted (MetaStage           *stage,
-               ClutterStageView    *view,
-               ClutterPaintContext *paint_context,
-               gpointer             user_data)
+stage_painted (MetaStage            *stage,
+               ClutterStageView     *view,
+               ClutterPaintContext  *paint_context,
+               const cairo_region_t *redraw_clip,
+               gpointer              user_data)
 {
+  MetaScreenCastMonitorStreamSrc *monitor_src =
+    META_SCREEN_CAST_MONITOR_STREAM_SRC (user_data);
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (user_data);
   MetaScreenCastRecordFlag flags;
 
+  add_redraw_clip_damage (monitor_src, redraw_clip);
+
   flags = META_SCREEN_CAST_RECORD_FLAG_NONE;
   meta_screen_cast_stream_src_maybe_record_frame (src, flags);
 }
 
 static void
-before_stage_painted (MetaStage           *stage,
-                      ClutterStageView    *view,
-                      ClutterPaintContext *paint_context,
-                      gpointer             user_data)
+before_stage_painted (MetaStage            *stage,
+                      ClutterStageView     *view,
+                      ClutterPaintContext  *paint_context,
+                      const cairo_region_t *redraw_clip,
+                      gpointer              user_data)
 {
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (user_data);
   CoglScanout *scanout;
@@ -141,6 +200,9 @@ before_stage_painted (MetaStage           *stage,
     {
       MetaScreenCastRecordFlag flags;
 
+      /* A new scanout buffer replaces the whole view */
+      meta_screen_cast_stream_src_add_damage (src, NULL);
+
       flags = META_SCREEN_CAST_RECORD_FLAG_NONE;
       meta_screen_cast_stream_src_maybe_record_frame (src, flags);
     }
@@ -336,6 +398,46 @@ add_view_watches (MetaScreenCastMonitorStreamSrc *monitor_src,
     }
 }
 
+/*
+ * The contents of the views are read back from their framebuffers, so they
+ * must not be scanned out from overlay planes.
+ */
+static void
+inhibit_overlays (MetaScreenCastMonitorStreamSrc *monitor_src)
+{
+  MetaBackend *backend = get_backend (monitor_src);
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaMonitor *monitor = get_monitor (monitor_src);
+  g_autoptr (GList) views = NULL;
+  GList *l;
+
+  views = meta_renderer_get_views_for_monitor (renderer, monitor);
+  for (l = views; l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+
+      clutter_stage_view_inhibit_overlays (view);
+      monitor_src->overlay_inhibited_views =
+        g_list_prepend (monitor_src->overlay_inhibited_views,
+                        g_object_ref (view));
+    }
+}
+
+static void
+uninhibit_overlays (MetaScreenCastMonitorStreamSrc *monitor_src)
+{
+  GList *l;
+
+  for (l = monitor_src->overlay_inhibited_views; l; l = l->next)
+    {
+      ClutterStageView *view = l->data;
+
+      clutter_stage_view_uninhibit_overlays (view);
+    }
+  g_list_free_full (monitor_src->overlay_inhibited_views, g_object_unref);
+  monitor_src->overlay_inhibited_views = NULL;
+}
+
 static void
 meta_screen_cast_monitor_stream_src_enable (MetaScreenCastStreamSrc *src)
 {
@@ -379,6 +481,8 @@ meta_screen_cast_monitor_stream_src_enable (MetaScreenCastStreamSrc *src)
       break;
     }
 
+  inhibit_overlays (monitor_src);
+
   clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
 }
 
@@ -408,6 +512,8 @@ meta_screen_cast_monitor_stream_src_disable (MetaScreenCastStreamSrc *src)
   if (monitor_src->hw_cursor_inhibited)
     uninhibit_hw_cursor (monitor_src);
 
+  uninhibit_overlays (monitor_src);
+
   g_clear_signal_handler (&monitor_src->cursor_moved_handler_id,
                           cursor_tracker);
   g_clear_signal_handler (&monitor_src->cursor_changed_handler_id,
@@ -517,9 +623,67 @@ meta_screen_cast_monitor_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *
   return TRUE;
 }
 
+static gboolean
+blit_view_damage (CoglFramebuffer       *view_framebuffer,
+                  CoglFramebuffer       *framebuffer,
+                  int                    x,
+                  int                    y,
+                  const cairo_region_t  *damage,
+                  GError               **error)
+{
+  cairo_rectangle_int_t view_rect;
+  cairo_region_t *view_damage;
+  int n_rects, i;
+  gboolean ret = TRUE;
+
+  view_rect = (cairo_rectangle_int_t) {
+    .x = x,
+    .y = y,
+    .width = cogl_framebuffer_get_width (view_framebuffer),
+    .height = cogl_framebuffer_get_height (view_framebuffer),
+  };
+
+  if (!damage)
+    {
+      return cogl_blit_framebuffer (view_framebuffer,
+                                    framebuffer,
+                                    0, 0,
+                                    x, y,
+                                    view_rect.width,
+                                    view_rect.height,
+                                    error);
+    }
+
+  view_damage = cairo_region_copy (damage);
+  cairo_region_intersect_rectangle (view_damage, &view_rect);
+
+  n_rects = cairo_region_num_rectangles (view_damage);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (view_damage, i, &rect);
+      if (!cogl_blit_framebuffer (view_framebuffer,
+                                  framebuffer,
+                                  rect.x - x, rect.y - y,
+                                  rect.x, rect.y,
+                                  rect.width, rect.height,
+                                  error))
+        {
+          ret = FALSE;
+          break;
+        }
+    }
+
+  cairo_region_destroy (view_damage);
+
+  return ret;
+}
+
 static gboolean
 meta_screen_cast_monitor_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src,
                                                            CoglFramebuffer          *framebuffer,
+                                                           const cairo_region_t     *damage,
                                                            GError                  **error)
 {
   MetaScreenCastMonitorStreamSrc *monitor_src =
@@ -535,11 +699,7 @@ meta_screen_cast_monitor_stream_src_record_to_framebuffer (MetaScreenCastStreamS
   monitor = get_monitor (monitor_src);
   logical_monitor = meta_monitor_get_logical_monitor (monitor);
   logical_monitor_layout = meta_logical_monitor_get_layout (logical_monitor);
-
-  if (meta_is_stage_views_scaled ())
-    view_scale = meta_logical_monitor_get_scale (logical_monitor);
-  else
-    view_scale = 1.0;
+  view_scale = get_view_scale (monitor_src);
 
   for (l = meta_renderer_get_views (renderer); l; l = l->next)
     {
@@ -569,19 +729,14 @@ meta_screen_cast_monitor_stream_src_record_to_framebuffer (MetaScreenCastStreamS
       else
         {
           view_framebuffer = clutter_stage_view_get_framebuffer (view);
-          if (!cogl_blit_framebuffer (view_framebuffer,
-                                      framebuffer,
-                                      0, 0,
-                                      x, y,
-                                      cogl_framebuffer_get_width (view_framebuffer),
-                                      cogl_framebuffer_get_height (view_framebuffer),
-                                      error))
+          if (!blit_view_damage (view_framebuffer, framebuffer,
+                                 x, y,
+                                 damage,
+                                 error))
             return FALSE;
         }
     }
 
-  cogl_framebuffer_finish (framebuffer);
-
   return TRUE;
 }
 
@@ -47,6 +47,8 @@
   (sizeof (struct spa_meta_cursor) + \
    sizeof (struct spa_meta_bitmap) + width * height * 4)
 
+#define MAX_DAMAGE_RECTS 32
+
 enum
 {
   PROP_0,
@@ -72,6 +74,15 @@ typedef struct _MetaPipeWireSource
   struct pw_loop *pipewire_loop;
 } MetaPipeWireSource;
 
+typedef struct _MetaScreenCastPendingBuffer
+{
+  MetaScreenCastStreamSrc *src;
+  struct pw_buffer *buffer;
+  CoglFramebuffer *framebuffer;
+  CoglFenceClosure *fence_closure;
+  gboolean rendered;
+} MetaScreenCastPendingBuffer;
+
 typedef struct _MetaScreenCastStreamSrcPrivate
 {
   MetaScreenCastStream *stream;
@@ -95,6 +106,10 @@ typedef struct _MetaScreenCastStreamSrcPrivate
   guint follow_up_frame_source_id;
 
   GHashTable *dmabuf_handles;
+  GList *pending_buffers;
+
+  cairo_region_t *frame_damage;
+  GHashTable *buffer_damage;
 
   int stream_width;
   int stream_height;
@@ -149,12 +164,13 @@ meta_screen_cast_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *src,
 static gboolean
 meta_screen_cast_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src,
                                                    CoglFramebuffer          *framebuffer,
+                                                   const cairo_region_t     *damage,
                                                    GError                  **error)
 {
   MetaScreenCastStreamSrcClass *klass =
     META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src);
 
-  return klass->record_to_framebuffer (src, framebuffer, error);
+  return klass->record_to_framebuffer (src, framebuffer, damage, error);
 }
 
 static void
@@ -420,10 +436,64 @@ maybe_record_cursor (MetaScreenCastStreamSrc *src,
   g_assert_not_reached ();
 }
 
+static void
+add_damage_metadata (MetaScreenCastStreamSrc *src,
+                     struct spa_buffer       *spa_buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  struct spa_meta *spa_meta_video_damage;
+  struct spa_meta_region *spa_meta_region;
+  gboolean use_extents;
+  int n_rects;
+  int i = 0;
+
+  spa_meta_video_damage = spa_buffer_find_meta (spa_buffer,
+                                                SPA_META_VideoDamage);
+  if (!spa_meta_video_damage)
+    return;
+
+  /* If the damage doesn't fit, describe it by its bounding box */
+  n_rects = cairo_region_num_rectangles (priv->frame_damage);
+  use_extents = (n_rects * sizeof (struct spa_meta_region) >
+                 spa_meta_video_damage->size);
+  if (use_extents)
+    n_rects = 1;
+
+  spa_meta_for_each (spa_meta_region, spa_meta_video_damage)
+    {
+      cairo_rectangle_int_t rect;
+
+      /* An empty region terminates the list */
+      if (i == n_rects)
+        {
+          spa_meta_region->region = SPA_REGION (0, 0, 0, 0);
+          break;
+        }
+
+      if (use_extents)
+        cairo_region_get_extents (priv->frame_damage, &rect);
+      else
+        cairo_region_get_rectangle (priv->frame_damage, i, &rect);
+
+      spa_meta_region->region = SPA_REGION (rect.x, rect.y,
+                                            rect.width, rect.height);
+      i++;
+    }
+}
+
+static void
+clear_damage (cairo_region_t **damage)
+{
+  cairo_region_destroy (*damage);
+  *damage = cairo_region_create ();
+}
+
 static gboolean
 do_record_frame (MetaScreenCastStreamSrc  *src,
                  struct spa_buffer        *spa_buffer,
                  uint8_t                  *data,
+                 const cairo_region_t     *damage,
                  GError                  **error)
 {
   MetaScreenCastStreamSrcPrivate *priv =
@@ -444,6 +514,7 @@ do_record_frame (MetaScreenCastStreamSrc  *src,
 
       return meta_screen_cast_stream_src_record_to_framebuffer (src,
                                                                 dmabuf_fbo,
+                                                                damage,
                                                                 error);
     }
 
@@ -452,6 +523,126 @@ do_record_frame (MetaScreenCastStreamSrc  *src,
   return FALSE;
 }
 
+static void
+flush_pending_buffers (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  /* Buffers are handed over in the order they were recorded, so a buffer
+   * only carrying cursor metadata can't overtake a frame still rendering. */
+  while (priv->pending_buffers)
+    {
+      MetaScreenCastPendingBuffer *pending_buffer =
+        priv->pending_buffers->data;
+
+      if (!pending_buffer->rendered)
+        break;
+
+      priv->pending_buffers = g_list_delete_link (priv->pending_buffers,
+                                                  priv->pending_buffers);
+
+      if (priv->pipewire_stream)
+        pw_stream_queue_buffer (priv->pipewire_stream, pending_buffer->buffer);
+
+      g_free (pending_buffer);
+    }
+}
+
+static void
+on_buffer_rendered (CoglFence *fence,
+                    void      *user_data)
+{
+  MetaScreenCastPendingBuffer *pending_buffer = user_data;
+
+  pending_buffer->fence_closure = NULL;
+  pending_buffer->rendered = TRUE;
+
+  flush_pending_buffers (pending_buffer->src);
+}
+
+static void
+cancel_pending_buffer (MetaScreenCastStreamSrc     *src,
+                       MetaScreenCastPendingBuffer *pending_buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  if (pending_buffer->fence_closure)
+    {
+      cogl_framebuffer_cancel_fence_callback (pending_buffer->framebuffer,
+                                              pending_buffer->fence_closure);
+    }
+  priv->pending_buffers = g_list_remove (priv->pending_buffers,
+                                         pending_buffer);
+  g_free (pending_buffer);
+}
+
+static void
+cancel_pending_buffers (MetaScreenCastStreamSrc *src)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+
+  while (priv->pending_buffers)
+    cancel_pending_buffer (src, priv->pending_buffers->data);
+}
+
+static void
+queue_buffer (MetaScreenCastStreamSrc *src,
+              struct pw_buffer        *buffer)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  struct spa_buffer *spa_buffer = buffer->buffer;
+  MetaScreenCastPendingBuffer *pending_buffer;
+
+  if (spa_buffer->datas[0].type == SPA_DATA_DmaBuf &&
+      spa_buffer->datas[0].chunk->size > 0)
+    {
+      CoglDmaBufHandle *dmabuf_handle =
+        g_hash_table_lookup (priv->dmabuf_handles,
+                             GINT_TO_POINTER (spa_buffer->datas[0].fd));
+      CoglFramebuffer *dmabuf_fbo =
+        cogl_dma_buf_handle_get_framebuffer (dmabuf_handle);
+
+      /* Hand the buffer over once the GPU is done rendering into it,
+       * instead of stalling the compositor until then. */
+      pending_buffer = g_new0 (MetaScreenCastPendingBuffer, 1);
+      pending_buffer->src = src;
+      pending_buffer->buffer = buffer;
+      pending_buffer->framebuffer = dmabuf_fbo;
+      pending_buffer->fence_closure =
+        cogl_framebuffer_add_fence_callback (dmabuf_fbo,
+                                             on_buffer_rendered,
+                                             pending_buffer);
+      if (pending_buffer->fence_closure)
+        {
+          priv->pending_buffers = g_list_append (priv->pending_buffers,
+                                                 pending_buffer);
+          cogl_framebuffer_flush (dmabuf_fbo);
+          return;
+        }
+
+      g_free (pending_buffer);
+      cogl_framebuffer_finish (dmabuf_fbo);
+    }
+
+  if (!priv->pending_buffers)
+    {
+      pw_stream_queue_buffer (priv->pipewire_stream, buffer);
+      return;
+    }
+
+  /* An earlier frame is still waiting for the GPU; queue behind it */
+  pending_buffer = g_new0 (MetaScreenCastPendingBuffer, 1);
+  pending_buffer->src = src;
+  pending_buffer->buffer = buffer;
+  pending_buffer->rendered = TRUE;
+  priv->pending_buffers = g_list_append (priv->pending_buffers,
+                                         pending_buffer);
+}
+
 gboolean
 meta_screen_cast_stream_src_pending_follow_up_frame (MetaScreenCastStreamSrc *src)
 {
@@ -502,6 +693,11 @@ meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
   uint64_t now_us;
   g_autoptr (GError) error = NULL;
 
+  /* Nothing changed since the last frame; don't bother the consumer */
+  if (!(flags & META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY) &&
+      cairo_region_is_empty (priv->frame_damage))
+    return;
+
   now_us = g_get_monotonic_time ();
   if (priv->video_format.max_framerate.num > 0 &&
       priv->last_frame_timestamp_us != 0)
@@ -542,8 +738,13 @@ meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
 
   if (!(flags & META_SCREEN_CAST_RECORD_FLAG_CURSOR_ONLY))
     {
+      cairo_region_t *buffer_damage;
+
+      /* A reused buffer only needs what changed since it was last filled */
+      buffer_damage = g_hash_table_lookup (priv->buffer_damage, buffer);
+
       g_clear_handle_id (&priv->follow_up_frame_source_id, g_source_remove);
-      if (do_record_frame (src, spa_buffer, data, &error))
+      if (do_record_frame (src, spa_buffer, data, buffer_damage, &error))
         {
           struct spa_meta_region *spa_meta_video_crop;
 
@@ -571,6 +772,14 @@ meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
                   spa_meta_video_crop->region.size.height = priv->stream_height;
                 }
             }
+
+          add_damage_metadata (src, spa_buffer);
+          clear_damage (&priv->frame_damage);
+          if (buffer_damage)
+            {
+              g_hash_table_insert (priv->buffer_damage, buffer,
+                                   cairo_region_create ());
+            }
         }
       else
         {
@@ -587,7 +796,7 @@ meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
 
   priv->last_frame_timestamp_us = now_us;
 
-  pw_stream_queue_buffer (priv->pipewire_stream, buffer);
+  queue_buffer (src, buffer);
 }
 
 static gboolean
@@ -599,12 +808,49 @@ meta_screen_cast_stream_src_is_enabled (MetaScreenCastStreamSrc *src)
   return priv->is_enabled;
 }
 
+void
+meta_screen_cast_stream_src_add_damage (MetaScreenCastStreamSrc *src,
+                                        const cairo_region_t    *damage)
+{
+  MetaScreenCastStreamSrcPrivate *priv =
+    meta_screen_cast_stream_src_get_instance_private (src);
+  cairo_rectangle_int_t stream_rect;
+  cairo_region_t *region;
+  GHashTableIter iter;
+  cairo_region_t *buffer_damage;
+
+  stream_rect = (cairo_rectangle_int_t) {
+    .width = priv->stream_width,
+    .height = priv->stream_height,
+  };
+
+  if (damage)
+    {
+      region = cairo_region_copy (damage);
+      cairo_region_intersect_rectangle (region, &stream_rect);
+    }
+  else
+    {
+      region = cairo_region_create_rectangle (&stream_rect);
+    }
+
+  cairo_region_union (priv->frame_damage, region);
+
+  g_hash_table_iter_init (&iter, priv->buffer_damage);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &buffer_damage))
+    cairo_region_union (buffer_damage, region);
+
+  cairo_region_destroy (region);
+}
+
 static void
 meta_screen_cast_stream_src_enable (MetaScreenCastStreamSrc *src)
 {
   MetaScreenCastStreamSrcPrivate *priv =
     meta_screen_cast_stream_src_get_instance_private (src);
 
+  meta_screen_cast_stream_src_add_damage (src, NULL);
+
   META_SCREEN_CAST_STREAM_SRC_GET_CLASS (src)->enable (src);
 
   priv->is_enabled = TRUE;
@@ -671,7 +917,7 @@ on_stream_param_changed (void                 *data,
   uint8_t params_buffer[1024];
   int32_t width, height, stride, size;
   struct spa_pod_builder pod_builder;
-  const struct spa_pod *params[3];
+  const struct spa_pod *params[4];
   const int bpp = 4;
 
   if (!format || id != SPA_PARAM_Format)
@@ -710,6 +956,15 @@ on_stream_param_changed (void                 *data,
     SPA_PARAM_META_type, SPA_POD_Id (SPA_META_Cursor),
     SPA_PARAM_META_size, SPA_POD_Int (CURSOR_META_SIZE (384, 384)));
 
+  params[3] = spa_pod_builder_add_object (
+    &pod_builder,
+    SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+    SPA_PARAM_META_type, SPA_POD_Id (SPA_META_VideoDamage),
+    SPA_PARAM_META_size, SPA_POD_Int (sizeof (struct spa_meta_region) *
+                                      MAX_DAMAGE_RECTS));
+
+  meta_screen_cast_stream_src_add_damage (src, NULL);
+
   pw_stream_update_params (priv->pipewire_stream, params, G_N_ELEMENTS (params));
 }
 
@@ -735,6 +990,13 @@ on_stream_add_buffer (void             *data,
   spa_data[0].mapoffset = 0;
   spa_data[0].maxsize = stride * priv->video_format.size.height;
 
+  /* Nothing has been recorded into a new buffer yet */
+  g_hash_table_insert (priv->buffer_damage, buffer,
+                       cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+                         .width = priv->stream_width,
+                         .height = priv->stream_height,
+                       }));
+
   dmabuf_handle = meta_screen_cast_create_dma_buf_handle (screen_cast,
                                                           priv->stream_width,
                                                           priv->stream_height);
@@ -800,6 +1062,21 @@ on_stream_remove_buffer (void             *data,
     meta_screen_cast_stream_src_get_instance_private (src);
   struct spa_buffer *spa_buffer = buffer->buffer;
   struct spa_data *spa_data = spa_buffer->datas;
+  GList *l;
+
+  for (l = priv->pending_buffers; l; l = l->next)
+    {
+      MetaScreenCastPendingBuffer *pending_buffer = l->data;
+
+      if (pending_buffer->buffer == buffer)
+        {
+          cancel_pending_buffer (src, pending_buffer);
+          flush_pending_buffers (src);
+          break;
+        }
+    }
+
+  g_hash_table_remove (priv->buffer_damage, buffer);
 
   if (spa_data[0].type == SPA_DATA_DmaBuf)
     {
@@ -1091,8 +1368,11 @@ meta_screen_cast_stream_src_finalize (GObject *object)
   if (meta_screen_cast_stream_src_is_enabled (src))
     meta_screen_cast_stream_src_disable (src);
 
+  cancel_pending_buffers (src);
   g_clear_pointer (&priv->pipewire_stream, pw_stream_destroy);
   g_clear_pointer (&priv->dmabuf_handles, g_hash_table_destroy);
+  g_clear_pointer (&priv->buffer_damage, g_hash_table_destroy);
+  g_clear_pointer (&priv->frame_damage, cairo_region_destroy);
   g_clear_pointer (&priv->pipewire_core, pw_core_disconnect);
   g_clear_pointer (&priv->pipewire_context, pw_context_destroy);
   g_source_destroy (&priv->pipewire_source->base);
@@ -1150,6 +1430,10 @@ meta_screen_cast_stream_src_init (MetaScreenCastStreamSrc *src)
   priv->dmabuf_handles =
     g_hash_table_new_full (NULL, NULL, NULL,
                            (GDestroyNotify) cogl_dma_buf_handle_free);
+  priv->buffer_damage =
+    g_hash_table_new_full (NULL, NULL, NULL,
+                           (GDestroyNotify) cairo_region_destroy);
+  priv->frame_damage = cairo_region_create ();
 }
 
 static void
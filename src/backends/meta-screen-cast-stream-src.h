@@ -64,6 +64,7 @@ struct _MetaScreenCastStreamSrcClass
                                  GError                  **error);
   gboolean (* record_to_framebuffer) (MetaScreenCastStreamSrc  *src,
                                       CoglFramebuffer          *framebuffer,
+                                      const cairo_region_t     *damage,
                                       GError                  **error);
   void (* record_follow_up) (MetaScreenCastStreamSrc *src);
 
@@ -73,6 +74,9 @@ struct _MetaScreenCastStreamSrcClass
                                 struct spa_meta_cursor  *spa_meta_cursor);
 };
 
+void meta_screen_cast_stream_src_add_damage (MetaScreenCastStreamSrc *src,
+                                             const cairo_region_t    *damage);
+
 void meta_screen_cast_stream_src_maybe_record_frame (MetaScreenCastStreamSrc  *src,
                                                      MetaScreenCastRecordFlag  flags);
 
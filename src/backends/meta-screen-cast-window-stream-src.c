@@ -342,6 +342,10 @@ screen_cast_window_damaged (MetaWindowActor               *actor,
   MetaScreenCastStreamSrc *src = META_SCREEN_CAST_STREAM_SRC (window_src);
   MetaScreenCastRecordFlag flags;
 
+  /* The window may have moved or resized within the stream, so there is
+   * no cheaper damage to report than the whole frame. */
+  meta_screen_cast_stream_src_add_damage (src, NULL);
+
   flags = META_SCREEN_CAST_RECORD_FLAG_NONE;
   meta_screen_cast_stream_src_maybe_record_frame (src, flags);
 }
@@ -461,6 +465,7 @@ meta_screen_cast_window_stream_src_record_to_buffer (MetaScreenCastStreamSrc  *s
 static gboolean
 meta_screen_cast_window_stream_src_record_to_framebuffer (MetaScreenCastStreamSrc  *src,
                                                           CoglFramebuffer          *framebuffer,
+                                                          const cairo_region_t     *damage,
                                                           GError                  **error)
 {
   MetaScreenCastWindowStreamSrc *window_src =
@@ -493,8 +498,6 @@ meta_screen_cast_window_stream_src_record_to_framebuffer (MetaScreenCastStreamSr
       break;
     }
 
-  cogl_framebuffer_finish (framebuffer);
-
   return TRUE;
 }
 
@@ -171,10 +171,11 @@ meta_stage_finalize (GObject *object)
 }
 
 static void
-notify_watchers_for_mode (MetaStage           *stage,
-                          ClutterStageView    *view,
-                          ClutterPaintContext *paint_context,
-                          MetaStageWatchPhase  watch_phase)
+notify_watchers_for_mode (MetaStage            *stage,
+                          ClutterStageView     *view,
+                          ClutterPaintContext  *paint_context,
+                          const cairo_region_t *redraw_clip,
+                          MetaStageWatchPhase   watch_phase)
 {
   GPtrArray *watchers;
   int i;
@@ -188,7 +189,8 @@ notify_watchers_for_mode (MetaStage           *stage,
       if (watch->view && view != watch->view)
         continue;
 
-      watch->callback (stage, view, paint_context, watch->user_data);
+      watch->callback (stage, view, paint_context, redraw_clip,
+                       watch->user_data);
     }
 }
 
@@ -198,7 +200,7 @@ meta_stage_before_paint (ClutterStage     *stage,
 {
   MetaStage *meta_stage = META_STAGE (stage);
 
-  notify_watchers_for_mode (meta_stage, view, NULL,
+  notify_watchers_for_mode (meta_stage, view, NULL, NULL,
                             META_STAGE_WATCH_BEFORE_PAINT);
 }
 
@@ -208,13 +210,15 @@ meta_stage_paint (ClutterActor        *actor,
 {
   MetaStage *stage = META_STAGE (actor);
   ClutterStageView *view;
+  const cairo_region_t *redraw_clip;
 
   CLUTTER_ACTOR_CLASS (meta_stage_parent_class)->paint (actor, paint_context);
 
   view = clutter_paint_context_get_stage_view (paint_context);
+  redraw_clip = clutter_paint_context_get_redraw_clip (paint_context);
   if (view)
     {
-      notify_watchers_for_mode (stage, view, paint_context,
+      notify_watchers_for_mode (stage, view, paint_context, redraw_clip,
                                 META_STAGE_WATCH_AFTER_ACTOR_PAINT);
     }
 
@@ -244,7 +248,7 @@ meta_stage_paint (ClutterActor        *actor,
 
   if (view)
     {
-      notify_watchers_for_mode (stage, view, paint_context,
+      notify_watchers_for_mode (stage, view, paint_context, redraw_clip,
                                 META_STAGE_WATCH_AFTER_OVERLAY_PAINT);
     }
 }
@@ -259,7 +263,7 @@ meta_stage_paint_view (ClutterStage         *stage,
   CLUTTER_STAGE_CLASS (meta_stage_parent_class)->paint_view (stage, view,
                                                              redraw_clip);
 
-  notify_watchers_for_mode (meta_stage, view, NULL,
+  notify_watchers_for_mode (meta_stage, view, NULL, redraw_clip,
                             META_STAGE_WATCH_AFTER_PAINT);
 }
 
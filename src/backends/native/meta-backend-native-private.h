@@ -29,4 +29,6 @@
 
 MetaBarrierManagerNative *meta_backend_native_get_barrier_manager (MetaBackendNative *native);
 
+void meta_backend_native_update_pointer_prediction (MetaBackendNative *native);
+
 #endif /* META_BACKEND_NATIVE_PRIVATE_H */
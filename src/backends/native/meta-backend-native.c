@@ -53,6 +53,7 @@
 #include "backends/native/meta-cursor-renderer-native.h"
 #include "backends/native/meta-event-native.h"
 #include "backends/native/meta-input-settings-native.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms.h"
 #include "backends/native/meta-kms-device.h"
 #include "backends/native/meta-launcher.h"
@@ -336,6 +337,17 @@ relative_motion_filter (ClutterInputDevice *device,
   *dy = new_dy;
 }
 
+static void
+pointer_position_notify (float    x,
+                         float    y,
+                         gpointer user_data)
+{
+  MetaKmsCursorManager *cursor_manager = user_data;
+
+  meta_kms_cursor_manager_update_position (cursor_manager,
+                                           &GRAPHENE_POINT_INIT (x, y));
+}
+
 static ClutterBackend *
 meta_backend_native_create_clutter_backend (MetaBackend *backend)
 {
@@ -383,6 +395,8 @@ meta_backend_native_post_init (MetaBackend *backend)
   ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
   ClutterSeat *seat = clutter_backend_get_default_seat (clutter_backend);
   MetaSettings *settings = meta_backend_get_settings (backend);
+  MetaBackendNative *backend_native = META_BACKEND_NATIVE (backend);
+  MetaKmsCursorManager *cursor_manager;
 
   meta_seat_native_set_pointer_constrain_callback (META_SEAT_NATIVE (seat),
                                                    pointer_constrain_callback,
@@ -391,6 +405,14 @@ meta_backend_native_post_init (MetaBackend *backend)
                                                relative_motion_filter,
                                                meta_backend_get_monitor_manager (backend));
 
+  cursor_manager = meta_kms_get_cursor_manager (backend_native->kms);
+  if (meta_kms_cursor_manager_is_active (cursor_manager))
+    {
+      meta_seat_native_set_pointer_position_notify (META_SEAT_NATIVE (seat),
+                                                    pointer_position_notify,
+                                                    cursor_manager);
+    }
+
   META_BACKEND_CLASS (meta_backend_native_parent_class)->post_init (backend);
 
   if (meta_settings_is_experimental_feature_enabled (settings,
@@ -530,6 +552,13 @@ meta_backend_native_lock_layout_group (MetaBackend *backend,
   meta_backend_notify_keymap_layout_group_changed (backend, idx);
 }
 
+static void
+meta_backend_native_set_pointer_constraint (MetaBackend           *backend,
+                                            MetaPointerConstraint *constraint)
+{
+  meta_backend_native_update_pointer_prediction (META_BACKEND_NATIVE (backend));
+}
+
 static void
 meta_backend_native_set_numlock (MetaBackend *backend,
                                  gboolean     numlock_state)
@@ -750,6 +779,7 @@ meta_backend_native_class_init (MetaBackendNativeClass *klass)
   backend_class->lock_layout_group = meta_backend_native_lock_layout_group;
   backend_class->update_screen_size = meta_backend_native_update_screen_size;
   backend_class->set_numlock = meta_backend_native_set_numlock;
+  backend_class->set_pointer_constraint = meta_backend_native_set_pointer_constraint;
 }
 
 static void
@@ -791,6 +821,26 @@ meta_backend_native_get_barrier_manager (MetaBackendNative *native)
   return native->barrier_manager;
 }
 
+/*
+ * The input thread can't apply pointer barriers or constraints to the cursor
+ * position it predicts, so the cursor only follows the main thread while any
+ * is active.
+ */
+void
+meta_backend_native_update_pointer_prediction (MetaBackendNative *native)
+{
+  MetaBackend *backend = META_BACKEND (native);
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  ClutterSeat *seat = clutter_backend_get_default_seat (clutter_backend);
+  gboolean inhibited;
+
+  inhibited =
+    (meta_barrier_manager_native_has_barriers (native->barrier_manager) ||
+     meta_backend_get_client_pointer_constraint (backend));
+  meta_seat_native_set_pointer_prediction_inhibited (META_SEAT_NATIVE (seat),
+                                                     inhibited);
+}
+
 /**
  * meta_activate_session:
  *
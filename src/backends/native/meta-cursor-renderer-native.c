@@ -30,6 +30,7 @@
 #include <string.h>
 #include <gbm.h>
 #include <xf86drm.h>
+#include <xf86drmMode.h>
 #include <errno.h>
 
 #include "backends/meta-backend-private.h"
@@ -39,6 +40,8 @@
 #include "backends/meta-monitor-manager-private.h"
 #include "backends/meta-output.h"
 #include "backends/native/meta-crtc-kms.h"
+#include "backends/native/meta-gpu-kms.h"
+#include "backends/native/meta-kms-cursor-manager.h"
 #include "backends/native/meta-kms-device.h"
 #include "backends/native/meta-kms-update.h"
 #include "backends/native/meta-kms.h"
@@ -115,6 +118,12 @@ typedef struct _MetaCursorNativeGpuState
   struct gbm_bo *bos[HW_CURSOR_BUFFER_COUNT];
 } MetaCursorNativeGpuState;
 
+typedef struct _MetaCursorGbmBoFb
+{
+  int kms_fd;
+  uint32_t fb_id;
+} MetaCursorGbmBoFb;
+
 typedef struct _MetaCursorNativePrivate
 {
   GHashTable *gpu_states;
@@ -173,6 +182,17 @@ meta_create_cursor_renderer_native_gpu_data (MetaGpuKms *gpu_kms)
   return cursor_renderer_gpu_data;
 }
 
+static MetaKmsCursorManager *
+get_kms_cursor_manager (MetaCursorRendererNative *native)
+{
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  MetaBackendNative *backend_native = META_BACKEND_NATIVE (priv->backend);
+  MetaKms *kms = meta_backend_native_get_kms (backend_native);
+
+  return meta_kms_get_cursor_manager (kms);
+}
+
 static void
 meta_cursor_renderer_native_finalize (GObject *object)
 {
@@ -182,6 +202,12 @@ meta_cursor_renderer_native_finalize (GObject *object)
 
   g_clear_handle_id (&priv->animation_timeout_id, g_source_remove);
 
+  if (priv->backend)
+    {
+      meta_kms_cursor_manager_set_feedback_func (get_kms_cursor_manager (renderer),
+                                                 NULL, NULL);
+    }
+
   G_OBJECT_CLASS (meta_cursor_renderer_native_parent_class)->finalize (object);
 }
 
@@ -206,6 +232,55 @@ get_active_cursor_sprite_gbm_bo (MetaCursorNativeGpuState *cursor_gpu_state)
   return cursor_gpu_state->bos[cursor_gpu_state->active_bo];
 }
 
+static void
+cursor_gbm_bo_fb_free (struct gbm_bo *bo,
+                       void          *user_data)
+{
+  MetaCursorGbmBoFb *bo_fb = user_data;
+
+  drmModeRmFB (bo_fb->kms_fd, bo_fb->fb_id);
+  g_free (bo_fb);
+}
+
+/*
+ * Atomic commits need a framebuffer for the cursor plane, while the legacy
+ * cursor API takes the GEM handle of the buffer. The framebuffer is added once
+ * per buffer, and removed when the buffer is destroyed.
+ */
+static gboolean
+add_cursor_gbm_bo_fb (MetaGpuKms     *gpu_kms,
+                      struct gbm_bo  *bo,
+                      GError        **error)
+{
+  MetaGpuKmsFBArgs fb_args = { 0 };
+  MetaCursorGbmBoFb *bo_fb;
+  uint32_t fb_id;
+
+  fb_args.width = gbm_bo_get_width (bo);
+  fb_args.height = gbm_bo_get_height (bo);
+  fb_args.format = gbm_bo_get_format (bo);
+  fb_args.handles[0] = gbm_bo_get_handle (bo).u32;
+  fb_args.strides[0] = gbm_bo_get_stride (bo);
+
+  if (!meta_gpu_kms_add_fb (gpu_kms, FALSE, &fb_args, &fb_id, error))
+    return FALSE;
+
+  bo_fb = g_new0 (MetaCursorGbmBoFb, 1);
+  bo_fb->kms_fd = meta_gpu_kms_get_fd (gpu_kms);
+  bo_fb->fb_id = fb_id;
+  gbm_bo_set_user_data (bo, bo_fb, cursor_gbm_bo_fb_free);
+
+  return TRUE;
+}
+
+static uint32_t
+get_cursor_gbm_bo_fb_id (struct gbm_bo *bo)
+{
+  MetaCursorGbmBoFb *bo_fb = gbm_bo_get_user_data (bo);
+
+  return bo_fb->fb_id;
+}
+
 static void
 set_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite,
                                   MetaGpuKms       *gpu_kms,
@@ -213,8 +288,17 @@ set_pending_cursor_sprite_gbm_bo (MetaCursorSprite *cursor_sprite,
 {
   MetaCursorNativePrivate *cursor_priv;
   MetaCursorNativeGpuState *cursor_gpu_state;
+  g_autoptr (GError) error = NULL;
   guint pending_bo;
 
+  if (!add_cursor_gbm_bo_fb (gpu_kms, bo, &error))
+    {
+      meta_warning ("Failed to add HW cursor framebuffer: %s\n",
+                    error->message);
+      gbm_bo_destroy (bo);
+      return;
+    }
+
   cursor_priv = ensure_cursor_priv (cursor_sprite);
   cursor_gpu_state = ensure_cursor_gpu_state (cursor_priv, gpu_kms);
 
@@ -248,9 +332,15 @@ calculate_crtc_cursor_hotspot (MetaCursorSprite *cursor_sprite,
   *cursor_hotspot_y = (int) roundf (hot_y * scale);
 }
 
+/*
+ * Assigns the cursor plane in @kms_update, or, if @crtc_cursor is given,
+ * describes the cursor in it instead, leaving positioning to the KMS cursor
+ * manager.
+ */
 static void
 set_crtc_cursor (MetaCursorRendererNative *native,
                  MetaKmsUpdate            *kms_update,
+                 MetaKmsCrtcCursor        *crtc_cursor,
                  MetaCrtcKms              *crtc_kms,
                  int                       x,
                  int                       y,
@@ -293,6 +383,24 @@ set_crtc_cursor (MetaCursorRendererNative *native,
 
   cursor_width = cursor_renderer_gpu_data->cursor_width;
   cursor_height = cursor_renderer_gpu_data->cursor_height;
+
+  calculate_crtc_cursor_hotspot (cursor_sprite,
+                                 &cursor_hotspot_x,
+                                 &cursor_hotspot_y);
+
+  if (crtc_cursor)
+    {
+      crtc_cursor->crtc = kms_crtc;
+      crtc_cursor->plane = cursor_plane;
+      crtc_cursor->fb_id = get_cursor_gbm_bo_fb_id (bo);
+      crtc_cursor->bo_handle = handle.u32;
+      crtc_cursor->buffer_width = cursor_width;
+      crtc_cursor->buffer_height = cursor_height;
+      crtc_cursor->hotspot_x = cursor_hotspot_x;
+      crtc_cursor->hotspot_y = cursor_hotspot_y;
+      goto out;
+    }
+
   src_rect = (MetaFixed16Rectangle) {
     .x = meta_fixed_16_from_int (0),
     .y = meta_fixed_16_from_int (0),
@@ -314,18 +422,17 @@ set_crtc_cursor (MetaCursorRendererNative *native,
   plane_assignment = meta_kms_update_assign_plane (kms_update,
                                                    kms_crtc,
                                                    cursor_plane,
-                                                   handle.u32,
+                                                   get_cursor_gbm_bo_fb_id (bo),
                                                    src_rect,
                                                    dst_rect,
                                                    flags);
-
-  calculate_crtc_cursor_hotspot (cursor_sprite,
-                                 &cursor_hotspot_x,
-                                 &cursor_hotspot_y);
   meta_kms_plane_assignment_set_cursor_hotspot (plane_assignment,
                                                 cursor_hotspot_x,
                                                 cursor_hotspot_y);
+  meta_kms_plane_assignment_set_cursor_bo_handle (plane_assignment,
+                                                  handle.u32);
 
+out:
   meta_crtc_kms_set_cursor_renderer_private (crtc_kms, bo);
 
   if (cursor_gpu_state->pending_bo_state == META_CURSOR_GBM_BO_STATE_SET)
@@ -356,7 +463,8 @@ unset_crtc_cursor (MetaCursorRendererNative *native,
   kms_device = meta_kms_crtc_get_device (kms_crtc);
   cursor_plane = meta_kms_device_get_cursor_plane_for (kms_device, kms_crtc);
 
-  if (cursor_plane)
+  /* Without a KMS update, the KMS cursor manager turns the plane off */
+  if (cursor_plane && kms_update)
     meta_kms_update_unassign_plane (kms_update, kms_crtc, cursor_plane);
 
   meta_crtc_kms_set_cursor_renderer_private (crtc_kms, NULL);
@@ -382,9 +490,12 @@ typedef struct
   MetaCursorRendererNative *in_cursor_renderer_native;
   MetaLogicalMonitor *in_logical_monitor;
   graphene_rect_t in_local_cursor_rect;
+  graphene_point_t in_sprite_offset;
   MetaCursorSprite *in_cursor_sprite;
   MetaKmsUpdate *in_kms_update;
 
+  /* Set instead of in_kms_update when the KMS cursor manager is used */
+  GArray *out_crtc_cursors;
   gboolean out_painted;
 } UpdateCrtcCursorData;
 
@@ -447,10 +558,52 @@ update_monitor_crtc_cursor (MetaMonitor         *monitor,
 
   crtc = meta_output_get_assigned_crtc (monitor_crtc_mode->output);
 
-  if (priv->has_hw_cursor &&
-      graphene_rect_intersection (&scaled_crtc_rect,
-                                  &data->in_local_cursor_rect,
-                                  NULL))
+  /*
+   * The KMS cursor manager decides itself which CRTCs the cursor is on, as
+   * it may have moved since, so every CRTC gets the cursor described.
+   */
+  if (priv->has_hw_cursor && data->out_crtc_cursors)
+    {
+      MetaKmsCrtcCursor crtc_cursor = { 0 };
+      CoglTexture *texture;
+      float cursor_crtc_scale;
+
+      texture = meta_cursor_sprite_get_cogl_texture (data->in_cursor_sprite);
+      cursor_crtc_scale =
+        calculate_cursor_crtc_sprite_scale (data->in_cursor_sprite,
+                                            data->in_logical_monitor);
+
+      crtc_cursor.sprite_offset = data->in_sprite_offset;
+      crtc_cursor.sprite_size = data->in_local_cursor_rect.size;
+      crtc_cursor.sprite_width =
+        roundf (cogl_texture_get_width (texture) * cursor_crtc_scale);
+      crtc_cursor.sprite_height =
+        roundf (cogl_texture_get_height (texture) * cursor_crtc_scale);
+      crtc_cursor.crtc_rect = scaled_crtc_rect;
+      crtc_cursor.crtc_rect.origin.x += data->in_logical_monitor->rect.x;
+      crtc_cursor.crtc_rect.origin.y += data->in_logical_monitor->rect.y;
+      crtc_cursor.scale = scale;
+      crtc_cursor.transform = transform;
+      crtc_cursor.crtc_mode_width = crtc_mode_info->width;
+      crtc_cursor.crtc_mode_height = crtc_mode_info->height;
+
+      set_crtc_cursor (data->in_cursor_renderer_native,
+                       NULL,
+                       &crtc_cursor,
+                       META_CRTC_KMS (crtc),
+                       0, 0,
+                       data->in_cursor_sprite);
+      g_array_append_val (data->out_crtc_cursors, crtc_cursor);
+
+      if (graphene_rect_intersection (&scaled_crtc_rect,
+                                      &data->in_local_cursor_rect,
+                                      NULL))
+        data->out_painted = TRUE;
+    }
+  else if (priv->has_hw_cursor &&
+           graphene_rect_intersection (&scaled_crtc_rect,
+                                       &data->in_local_cursor_rect,
+                                       NULL))
     {
       MetaMonitorTransform inverted_transform;
       MetaRectangle cursor_rect;
@@ -488,6 +641,7 @@ update_monitor_crtc_cursor (MetaMonitor         *monitor,
 
       set_crtc_cursor (data->in_cursor_renderer_native,
                        data->in_kms_update,
+                       NULL,
                        META_CRTC_KMS (crtc),
                        cursor_rect.x,
                        cursor_rect.y,
@@ -505,7 +659,7 @@ update_monitor_crtc_cursor (MetaMonitor         *monitor,
   return TRUE;
 }
 
-static void
+static gboolean
 disable_hw_cursor_for_crtc (MetaKmsCrtc  *kms_crtc,
                             const GError *error)
 {
@@ -515,10 +669,52 @@ disable_hw_cursor_for_crtc (MetaKmsCrtc  *kms_crtc,
   MetaCursorRendererNativeGpuData *cursor_renderer_gpu_data =
     meta_cursor_renderer_native_gpu_data_from_gpu (gpu_kms);
 
+  if (cursor_renderer_gpu_data->hw_cursor_broken)
+    return FALSE;
+
   g_warning ("Failed to set hardware cursor (%s), "
              "using OpenGL from now on",
              error->message);
   cursor_renderer_gpu_data->hw_cursor_broken = TRUE;
+
+  return TRUE;
+}
+
+static void
+on_hw_cursor_update_feedback (MetaKmsFeedback *feedback,
+                              gpointer         user_data)
+{
+  MetaCursorRendererNative *native = user_data;
+  MetaCursorRendererNativePrivate *priv =
+    meta_cursor_renderer_native_get_instance_private (native);
+  gboolean needs_fallback = FALSE;
+  GList *l;
+
+  if (meta_kms_feedback_get_result (feedback) == META_KMS_FEEDBACK_PASSED)
+    return;
+
+  for (l = meta_kms_feedback_get_failed_planes (feedback); l; l = l->next)
+    {
+      MetaKmsPlaneFeedback *plane_feedback = l->data;
+
+      if (!g_error_matches (plane_feedback->error,
+                            G_IO_ERROR,
+                            G_IO_ERROR_PERMISSION_DENIED))
+        {
+          needs_fallback |= disable_hw_cursor_for_crtc (plane_feedback->crtc,
+                                                        plane_feedback->error);
+        }
+    }
+
+  priv->has_hw_cursor = FALSE;
+
+  /*
+   * When the update was processed in the KMS thread, the cursor was already
+   * assumed to be shown by the hardware, so it has to be updated again to be
+   * painted instead.
+   */
+  if (needs_fallback)
+    meta_cursor_renderer_force_update (META_CURSOR_RENDERER (native));
 }
 
 static void
@@ -533,15 +729,21 @@ update_hw_cursor (MetaCursorRendererNative *native,
   MetaKms *kms = meta_backend_native_get_kms (backend_native);
   MetaMonitorManager *monitor_manager =
     meta_backend_get_monitor_manager (backend);
-  MetaKmsUpdate *kms_update;
+  MetaKmsCursorManager *cursor_manager = meta_kms_get_cursor_manager (kms);
+  MetaKmsUpdate *kms_update = NULL;
+  g_autoptr (GArray) crtc_cursors = NULL;
   GList *logical_monitors;
   GList *l;
   graphene_rect_t rect;
+  graphene_point_t position;
   gboolean painted = FALSE;
-  g_autoptr (MetaKmsFeedback) feedback = NULL;
 
-  kms_update = meta_kms_ensure_pending_update (kms);
+  if (meta_kms_cursor_manager_is_active (cursor_manager))
+    crtc_cursors = g_array_new (FALSE, FALSE, sizeof (MetaKmsCrtcCursor));
+  else
+    kms_update = meta_kms_ensure_pending_update (kms);
 
+  position = meta_cursor_renderer_get_position (renderer);
   if (cursor_sprite)
     rect = meta_cursor_renderer_calculate_rect (renderer, cursor_sprite);
   else
@@ -566,8 +768,13 @@ update_hw_cursor (MetaCursorRendererNative *native,
           },
           .size = rect.size
         },
+        .in_sprite_offset = {
+          .x = rect.origin.x - position.x,
+          .y = rect.origin.y - position.y
+        },
         .in_cursor_sprite = cursor_sprite,
         .in_kms_update = kms_update,
+        .out_crtc_cursors = crtc_cursors,
       };
 
       monitors = meta_logical_monitor_get_monitors (logical_monitor);
@@ -586,26 +793,24 @@ update_hw_cursor (MetaCursorRendererNative *native,
       painted = painted || data.out_painted;
     }
 
-  feedback = meta_kms_post_pending_update_sync (kms);
-  if (meta_kms_feedback_get_result (feedback) != META_KMS_FEEDBACK_PASSED)
+  if (crtc_cursors)
     {
-      for (l = meta_kms_feedback_get_failed_planes (feedback); l; l = l->next)
-        {
-          MetaKmsPlaneFeedback *plane_feedback = l->data;
-
-          if (!g_error_matches (plane_feedback->error,
-                                G_IO_ERROR,
-                                G_IO_ERROR_PERMISSION_DENIED))
-            {
-              disable_hw_cursor_for_crtc (plane_feedback->crtc,
-                                          plane_feedback->error);
-            }
-        }
-
-      priv->has_hw_cursor = FALSE;
+      meta_kms_cursor_manager_set_crtc_cursors (cursor_manager,
+                                                (MetaKmsCrtcCursor *) crtc_cursors->data,
+                                                crtc_cursors->len,
+                                                &position,
+                                                priv->hw_state_invalidated);
+      priv->hw_state_invalidated = FALSE;
     }
+  else
+    {
+      priv->hw_state_invalidated = FALSE;
 
-  priv->hw_state_invalidated = FALSE;
+      meta_kms_post_pending_update (kms,
+                                    on_hw_cursor_update_feedback,
+                                    g_object_ref (native),
+                                    g_object_unref);
+    }
 
   if (painted)
     meta_cursor_renderer_emit_painted (renderer, cursor_sprite);
@@ -1746,6 +1951,10 @@ meta_cursor_renderer_native_new (MetaBackend *backend)
   priv->backend = backend;
   priv->hw_state_invalidated = TRUE;
 
+  meta_kms_cursor_manager_set_feedback_func (get_kms_cursor_manager (cursor_renderer_native),
+                                             on_hw_cursor_update_feedback,
+                                             cursor_renderer_native);
+
   init_hw_cursor_support (cursor_renderer_native);
 
   return cursor_renderer_native;
@@ -31,9 +31,23 @@
 #include "backends/native/meta-input-device-native.h"
 #include "backends/native/meta-input-device-tool-native.h"
 #include "backends/native/meta-input-settings-native.h"
+#include "backends/native/meta-seat-native.h"
 
 G_DEFINE_TYPE (MetaInputSettingsNative, meta_input_settings_native, META_TYPE_INPUT_SETTINGS)
 
+/* The input thread may be using libinput, lock it while configuring devices */
+static struct libinput_device *
+lock_libinput_device (ClutterInputDevice  *device,
+                      GRecMutexLocker    **locker)
+{
+  MetaSeatNative *seat;
+
+  seat = meta_input_device_native_get_seat (META_INPUT_DEVICE_NATIVE (device));
+  *locker = meta_seat_native_lock_libinput (seat);
+
+  return meta_input_device_native_get_libinput_device (device);
+}
+
 static void
 meta_input_settings_native_set_send_events (MetaInputSettings        *settings,
                                             ClutterInputDevice       *device,
@@ -41,6 +55,7 @@ meta_input_settings_native_set_send_events (MetaInputSettings        *settings,
 {
   enum libinput_config_send_events_mode libinput_mode;
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
   switch (mode)
     {
@@ -57,7 +72,7 @@ meta_input_settings_native_set_send_events (MetaInputSettings        *settings,
       g_assert_not_reached ();
     }
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
   libinput_device_config_send_events_set_mode (libinput_device, libinput_mode);
@@ -81,8 +96,9 @@ meta_input_settings_native_set_speed (MetaInputSettings  *settings,
                                       gdouble             speed)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
   libinput_device_config_accel_set_speed (libinput_device,
@@ -95,8 +111,9 @@ meta_input_settings_native_set_left_handed (MetaInputSettings  *settings,
                                             gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -110,8 +127,9 @@ meta_input_settings_native_set_tap_enabled (MetaInputSettings  *settings,
                                             gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -128,8 +146,9 @@ meta_input_settings_native_set_tap_and_drag_enabled (MetaInputSettings  *setting
                                                      gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -146,8 +165,9 @@ meta_input_settings_native_set_tap_and_drag_lock_enabled (MetaInputSettings  *se
                                                           gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -164,8 +184,9 @@ meta_input_settings_native_set_disable_while_typing (MetaInputSettings  *setting
                                                      gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
 
   if (!libinput_device)
     return;
@@ -183,8 +204,9 @@ meta_input_settings_native_set_invert_scroll (MetaInputSettings  *settings,
                                               gboolean            inverted)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -226,9 +248,10 @@ meta_input_settings_native_set_edge_scroll (MetaInputSettings            *settin
                                             gboolean                      edge_scrolling_enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
   enum libinput_config_scroll_method current, method;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
 
   method = edge_scrolling_enabled ? LIBINPUT_CONFIG_SCROLL_EDGE : LIBINPUT_CONFIG_SCROLL_NO_SCROLL;
   current = libinput_device_config_scroll_get_method (libinput_device);
@@ -243,9 +266,10 @@ meta_input_settings_native_set_two_finger_scroll (MetaInputSettings            *
                                                   gboolean                      two_finger_scroll_enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
   enum libinput_config_scroll_method current, method;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
 
   method = two_finger_scroll_enabled ? LIBINPUT_CONFIG_SCROLL_2FG : LIBINPUT_CONFIG_SCROLL_NO_SCROLL;
   current = libinput_device_config_scroll_get_method (libinput_device);
@@ -259,8 +283,9 @@ meta_input_settings_native_has_two_finger_scroll (MetaInputSettings  *settings,
                                                   ClutterInputDevice *device)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return FALSE;
 
@@ -273,10 +298,11 @@ meta_input_settings_native_set_scroll_button (MetaInputSettings  *settings,
                                               guint               button)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
   enum libinput_config_scroll_method method;
   guint evcode;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -323,8 +349,9 @@ meta_input_settings_native_set_click_method (MetaInputSettings           *settin
 {
   enum libinput_config_click_method click_method = 0;
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -357,8 +384,9 @@ meta_input_settings_native_set_tap_button_map (MetaInputSettings            *set
 {
   enum libinput_config_tap_button_map button_map = 0;
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -402,10 +430,11 @@ set_device_accel_profile (ClutterInputDevice         *device,
                           GDesktopPointerAccelProfile profile)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
   enum libinput_config_accel_profile libinput_profile;
   uint32_t profiles;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
 
   switch (profile)
     {
@@ -438,10 +467,11 @@ has_udev_property (ClutterInputDevice *device,
                    const char         *property)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
   struct udev_device *udev_device;
   struct udev_device *parent_udev_device;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return FALSE;
 
@@ -572,6 +602,7 @@ meta_input_settings_native_set_tablet_area (MetaInputSettings  *settings,
                                             gdouble             padding_bottom)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
   gfloat scale_x;
   gfloat scale_y;
   gfloat offset_x;
@@ -585,7 +616,7 @@ meta_input_settings_native_set_tablet_area (MetaInputSettings  *settings,
   gfloat matrix[6] = { scale_x, 0., offset_x,
                        0., scale_y, offset_y };
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device ||
       !libinput_device_config_calibration_has_matrix (libinput_device))
     return;
@@ -650,11 +681,12 @@ meta_input_settings_native_set_mouse_middle_click_emulation (MetaInputSettings
                                                              gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
   if (!is_mouse_device (device))
     return;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -668,11 +700,12 @@ meta_input_settings_native_set_touchpad_middle_click_emulation (MetaInputSetting
                                                                 gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
   if (!meta_input_settings_native_is_touchpad_device (settings, device))
     return;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
@@ -686,11 +719,12 @@ meta_input_settings_native_set_trackball_middle_click_emulation (MetaInputSettin
                                                                  gboolean            enabled)
 {
   struct libinput_device *libinput_device;
+  g_autoptr (GRecMutexLocker) locker = NULL;
 
   if (!meta_input_settings_native_is_trackball_device (settings, device))
     return;
 
-  libinput_device = meta_input_device_native_get_libinput_device (device);
+  libinput_device = lock_libinput_device (device, &locker);
   if (!libinput_device)
     return;
 
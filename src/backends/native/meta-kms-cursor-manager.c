@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2020 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * The cursor manager moves the hardware cursor planes from the impl context.
+ * The cursor renderer describes, from the main context, how the sprite is
+ * shown on each CRTC, while pointer positions are passed from wherever they
+ * are known first. When the impl context runs in its own thread, the cursor
+ * thus keeps following the pointer while the main context is busy.
+ */
+
+#include "config.h"
+
+#include "backends/native/meta-kms-cursor-manager.h"
+
+#include <math.h>
+
+#include "backends/native/meta-kms-crtc.h"
+#include "backends/native/meta-kms-device.h"
+#include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-private.h"
+#include "backends/native/meta-kms-update-private.h"
+#include "core/boxes-private.h"
+
+struct _MetaKmsCursorManager
+{
+  MetaKms *kms;
+
+  GMutex mutex;
+  GArray *crtc_cursors;
+  graphene_point_t position;
+  gboolean has_position;
+  gboolean invalidated;
+  gboolean is_update_queued;
+
+  MetaKmsFeedbackFunc feedback_func;
+  gpointer feedback_user_data;
+
+  /* Only accessed in the impl context; key: MetaKmsCrtc, value: FB id shown */
+  GHashTable *shown_fb_ids;
+};
+
+typedef struct _CursorFeedbackData
+{
+  MetaKmsCursorManager *cursor_manager;
+  MetaKmsFeedback *feedback;
+} CursorFeedbackData;
+
+static void
+cursor_feedback_data_free (CursorFeedbackData *data)
+{
+  meta_kms_feedback_free (data->feedback);
+  g_free (data);
+}
+
+static void
+invoke_feedback (MetaKms  *kms,
+                 gpointer  user_data)
+{
+  CursorFeedbackData *data = user_data;
+  MetaKmsCursorManager *cursor_manager = data->cursor_manager;
+
+  if (cursor_manager->feedback_func)
+    {
+      cursor_manager->feedback_func (data->feedback,
+                                     cursor_manager->feedback_user_data);
+    }
+}
+
+static gboolean
+calculate_cursor_rect (const MetaKmsCrtcCursor *crtc_cursor,
+                       const graphene_point_t  *position,
+                       MetaRectangle           *out_rect)
+{
+  graphene_rect_t sprite_rect;
+  MetaRectangle cursor_rect;
+
+  sprite_rect = (graphene_rect_t) {
+    .origin = {
+      .x = position->x + crtc_cursor->sprite_offset.x,
+      .y = position->y + crtc_cursor->sprite_offset.y,
+    },
+    .size = crtc_cursor->sprite_size,
+  };
+
+  if (!graphene_rect_intersection (&crtc_cursor->crtc_rect, &sprite_rect,
+                                   NULL))
+    return FALSE;
+
+  cursor_rect = (MetaRectangle) {
+    .x = floorf ((sprite_rect.origin.x - crtc_cursor->crtc_rect.origin.x) *
+                 crtc_cursor->scale),
+    .y = floorf ((sprite_rect.origin.y - crtc_cursor->crtc_rect.origin.y) *
+                 crtc_cursor->scale),
+    .width = crtc_cursor->sprite_width,
+    .height = crtc_cursor->sprite_height,
+  };
+
+  meta_rectangle_transform (&cursor_rect,
+                            meta_monitor_transform_invert (crtc_cursor->transform),
+                            crtc_cursor->crtc_mode_width,
+                            crtc_cursor->crtc_mode_height,
+                            out_rect);
+
+  return TRUE;
+}
+
+static void
+assign_cursor_plane (MetaKmsCursorManager    *cursor_manager,
+                     MetaKmsUpdate           *update,
+                     const MetaKmsCrtcCursor *crtc_cursor,
+                     const MetaRectangle     *cursor_rect)
+{
+  MetaKmsPlaneAssignment *plane_assignment;
+  MetaKmsAssignPlaneFlag flags;
+  MetaFixed16Rectangle src_rect;
+  MetaFixed16Rectangle dst_rect;
+  gpointer shown_fb_id;
+
+  src_rect = (MetaFixed16Rectangle) {
+    .x = meta_fixed_16_from_int (0),
+    .y = meta_fixed_16_from_int (0),
+    .width = meta_fixed_16_from_int (crtc_cursor->buffer_width),
+    .height = meta_fixed_16_from_int (crtc_cursor->buffer_height),
+  };
+  dst_rect = (MetaFixed16Rectangle) {
+    .x = meta_fixed_16_from_int (cursor_rect->x),
+    .y = meta_fixed_16_from_int (cursor_rect->y),
+    .width = meta_fixed_16_from_int (crtc_cursor->buffer_width),
+    .height = meta_fixed_16_from_int (crtc_cursor->buffer_height),
+  };
+
+  flags = META_KMS_ASSIGN_PLANE_FLAG_NONE;
+  if (g_hash_table_lookup_extended (cursor_manager->shown_fb_ids,
+                                    crtc_cursor->crtc,
+                                    NULL, &shown_fb_id) &&
+      GPOINTER_TO_UINT (shown_fb_id) == crtc_cursor->fb_id)
+    flags |= META_KMS_ASSIGN_PLANE_FLAG_FB_UNCHANGED;
+
+  plane_assignment = meta_kms_update_assign_plane (update,
+                                                   crtc_cursor->crtc,
+                                                   crtc_cursor->plane,
+                                                   crtc_cursor->fb_id,
+                                                   src_rect,
+                                                   dst_rect,
+                                                   flags);
+  meta_kms_plane_assignment_set_cursor_hotspot (plane_assignment,
+                                                crtc_cursor->hotspot_x,
+                                                crtc_cursor->hotspot_y);
+  meta_kms_plane_assignment_set_cursor_bo_handle (plane_assignment,
+                                                  crtc_cursor->bo_handle);
+
+  g_hash_table_insert (cursor_manager->shown_fb_ids,
+                       crtc_cursor->crtc,
+                       GUINT_TO_POINTER (crtc_cursor->fb_id));
+}
+
+static gboolean
+has_crtc_cursor (GArray      *crtc_cursors,
+                 MetaKmsCrtc *crtc)
+{
+  unsigned int i;
+
+  for (i = 0; i < crtc_cursors->len; i++)
+    {
+      if (g_array_index (crtc_cursors, MetaKmsCrtcCursor, i).crtc == crtc)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gpointer
+update_cursors_in_impl (MetaKmsImpl  *impl,
+                        gpointer      user_data,
+                        GError      **error)
+{
+  MetaKmsCursorManager *cursor_manager = user_data;
+  g_autoptr (GArray) crtc_cursors = NULL;
+  MetaKmsUpdate *update;
+  MetaKmsFeedback *feedback;
+  graphene_point_t position;
+  gboolean has_position;
+  GHashTableIter iter;
+  MetaKmsCrtc *crtc;
+  unsigned int i;
+
+  g_mutex_lock (&cursor_manager->mutex);
+  crtc_cursors = g_array_ref (cursor_manager->crtc_cursors);
+  position = cursor_manager->position;
+  has_position = cursor_manager->has_position;
+  if (cursor_manager->invalidated)
+    {
+      /* The CRTCs were reconfigured, so nothing is known to be shown */
+      g_hash_table_remove_all (cursor_manager->shown_fb_ids);
+      cursor_manager->invalidated = FALSE;
+    }
+  cursor_manager->is_update_queued = FALSE;
+  g_mutex_unlock (&cursor_manager->mutex);
+
+  if (!has_position)
+    return GINT_TO_POINTER (TRUE);
+
+  update = meta_kms_update_new ();
+
+  for (i = 0; i < crtc_cursors->len; i++)
+    {
+      MetaKmsCrtcCursor *crtc_cursor =
+        &g_array_index (crtc_cursors, MetaKmsCrtcCursor, i);
+      MetaRectangle cursor_rect;
+
+      if (crtc_cursor->fb_id &&
+          calculate_cursor_rect (crtc_cursor, &position, &cursor_rect))
+        {
+          assign_cursor_plane (cursor_manager, update,
+                               crtc_cursor, &cursor_rect);
+        }
+      else if (g_hash_table_remove (cursor_manager->shown_fb_ids,
+                                    crtc_cursor->crtc))
+        {
+          meta_kms_update_unassign_plane (update,
+                                          crtc_cursor->crtc,
+                                          crtc_cursor->plane);
+        }
+    }
+
+  g_hash_table_iter_init (&iter, cursor_manager->shown_fb_ids);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &crtc, NULL))
+    {
+      MetaKmsDevice *device;
+
+      if (has_crtc_cursor (crtc_cursors, crtc))
+        continue;
+
+      device = meta_kms_crtc_get_device (crtc);
+      meta_kms_update_unassign_plane (update, crtc,
+                                      meta_kms_device_get_cursor_plane_for (device,
+                                                                            crtc));
+      g_hash_table_iter_remove (&iter);
+    }
+
+  if (!meta_kms_update_get_plane_assignments (update))
+    {
+      meta_kms_update_free (update);
+      return GINT_TO_POINTER (TRUE);
+    }
+
+  meta_kms_update_seal (update);
+  feedback = meta_kms_impl_process_update (impl, update);
+  meta_kms_update_free (update);
+
+  if (meta_kms_feedback_get_result (feedback) == META_KMS_FEEDBACK_PASSED)
+    {
+      meta_kms_feedback_free (feedback);
+    }
+  else
+    {
+      CursorFeedbackData *data;
+      GList *l;
+
+      for (l = meta_kms_feedback_get_failed_planes (feedback); l; l = l->next)
+        {
+          MetaKmsPlaneFeedback *plane_feedback = l->data;
+
+          g_hash_table_remove (cursor_manager->shown_fb_ids,
+                               plane_feedback->crtc);
+        }
+
+      data = g_new0 (CursorFeedbackData, 1);
+      data->cursor_manager = cursor_manager;
+      data->feedback = feedback;
+      meta_kms_queue_callback (cursor_manager->kms,
+                               invoke_feedback,
+                               data,
+                               (GDestroyNotify) cursor_feedback_data_free);
+    }
+
+  return GINT_TO_POINTER (TRUE);
+}
+
+static void
+queue_update_locked (MetaKmsCursorManager *cursor_manager)
+{
+  if (cursor_manager->is_update_queued)
+    return;
+
+  cursor_manager->is_update_queued = TRUE;
+  meta_kms_run_impl_task_async (cursor_manager->kms,
+                                update_cursors_in_impl,
+                                cursor_manager,
+                                NULL);
+}
+
+/*
+ * Only used with a dedicated impl thread; otherwise the cursor renderer
+ * assigns the cursor planes itself, as moving them from the impl context
+ * would not make them any more independent of the main context.
+ */
+gboolean
+meta_kms_cursor_manager_is_active (MetaKmsCursorManager *cursor_manager)
+{
+  return meta_kms_is_impl_threaded (cursor_manager->kms);
+}
+
+void
+meta_kms_cursor_manager_set_feedback_func (MetaKmsCursorManager *cursor_manager,
+                                           MetaKmsFeedbackFunc   feedback_func,
+                                           gpointer              user_data)
+{
+  cursor_manager->feedback_func = feedback_func;
+  cursor_manager->feedback_user_data = user_data;
+}
+
+/**
+ * meta_kms_cursor_manager_set_crtc_cursors:
+ * @cursor_manager: A #MetaKmsCursorManager
+ * @crtc_cursors: (array length=n_crtc_cursors): The CRTCs to show the cursor on
+ * @n_crtc_cursors: The number of elements in @crtc_cursors
+ * @position: The pointer position the caller knew of
+ * @invalidated: Whether the CRTCs were reconfigured
+ *
+ * Replaces the cursors shown on the CRTCs. CRTCs not part of @crtc_cursors
+ * will have their cursor planes turned off. @position is only used until a
+ * position is passed via meta_kms_cursor_manager_update_position(), as the
+ * latter is expected to be more recent.
+ */
+void
+meta_kms_cursor_manager_set_crtc_cursors (MetaKmsCursorManager    *cursor_manager,
+                                          const MetaKmsCrtcCursor *crtc_cursors,
+                                          int                      n_crtc_cursors,
+                                          const graphene_point_t  *position,
+                                          gboolean                 invalidated)
+{
+  GArray *new_crtc_cursors;
+
+  new_crtc_cursors = g_array_sized_new (FALSE, FALSE,
+                                        sizeof (MetaKmsCrtcCursor),
+                                        n_crtc_cursors);
+  g_array_append_vals (new_crtc_cursors, crtc_cursors, n_crtc_cursors);
+
+  g_mutex_lock (&cursor_manager->mutex);
+  g_array_unref (cursor_manager->crtc_cursors);
+  cursor_manager->crtc_cursors = new_crtc_cursors;
+  if (!cursor_manager->has_position)
+    {
+      cursor_manager->position = *position;
+      cursor_manager->has_position = TRUE;
+    }
+  cursor_manager->invalidated |= invalidated;
+  queue_update_locked (cursor_manager);
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+/*
+ * May be called from any thread.
+ */
+void
+meta_kms_cursor_manager_update_position (MetaKmsCursorManager   *cursor_manager,
+                                         const graphene_point_t *position)
+{
+  g_mutex_lock (&cursor_manager->mutex);
+  cursor_manager->position = *position;
+  cursor_manager->has_position = TRUE;
+  if (cursor_manager->crtc_cursors->len > 0)
+    queue_update_locked (cursor_manager);
+  g_mutex_unlock (&cursor_manager->mutex);
+}
+
+MetaKmsCursorManager *
+meta_kms_cursor_manager_new (MetaKms *kms)
+{
+  MetaKmsCursorManager *cursor_manager;
+
+  cursor_manager = g_new0 (MetaKmsCursorManager, 1);
+  cursor_manager->kms = kms;
+  g_mutex_init (&cursor_manager->mutex);
+  cursor_manager->crtc_cursors = g_array_new (FALSE, FALSE,
+                                              sizeof (MetaKmsCrtcCursor));
+  cursor_manager->shown_fb_ids = g_hash_table_new (NULL, NULL);
+
+  return cursor_manager;
+}
+
+/*
+ * Must be called after the impl thread was stopped, so that no update is
+ * queued anymore.
+ */
+void
+meta_kms_cursor_manager_free (MetaKmsCursorManager *cursor_manager)
+{
+  g_hash_table_destroy (cursor_manager->shown_fb_ids);
+  g_array_unref (cursor_manager->crtc_cursors);
+  g_mutex_clear (&cursor_manager->mutex);
+  g_free (cursor_manager);
+}
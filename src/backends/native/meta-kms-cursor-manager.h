@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2020 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_KMS_CURSOR_MANAGER_H
+#define META_KMS_CURSOR_MANAGER_H
+
+#include <glib.h>
+#include <graphene.h>
+
+#include "backends/meta-monitor-transform.h"
+#include "backends/native/meta-kms.h"
+#include "backends/native/meta-kms-types.h"
+
+/*
+ * Describes how the cursor sprite is shown on one CRTC, independently of the
+ * pointer position, so that the impl context can move it on its own.
+ */
+typedef struct _MetaKmsCrtcCursor
+{
+  MetaKmsCrtc *crtc;
+  MetaKmsPlane *plane;
+
+  uint32_t fb_id;
+  uint32_t bo_handle;
+  int buffer_width;
+  int buffer_height;
+  int hotspot_x;
+  int hotspot_y;
+
+  /* Offset of the sprite from the pointer and its size, in stage coordinates */
+  graphene_point_t sprite_offset;
+  graphene_size_t sprite_size;
+
+  /* Size of the sprite on the CRTC, in CRTC pixels, before the transform */
+  int sprite_width;
+  int sprite_height;
+
+  /* Area and scale of the CRTC, in stage coordinates */
+  graphene_rect_t crtc_rect;
+  float scale;
+
+  MetaMonitorTransform transform;
+  int crtc_mode_width;
+  int crtc_mode_height;
+} MetaKmsCrtcCursor;
+
+MetaKmsCursorManager * meta_kms_cursor_manager_new (MetaKms *kms);
+
+void meta_kms_cursor_manager_free (MetaKmsCursorManager *cursor_manager);
+
+gboolean meta_kms_cursor_manager_is_active (MetaKmsCursorManager *cursor_manager);
+
+void meta_kms_cursor_manager_set_feedback_func (MetaKmsCursorManager *cursor_manager,
+                                                MetaKmsFeedbackFunc   feedback_func,
+                                                gpointer              user_data);
+
+void meta_kms_cursor_manager_set_crtc_cursors (MetaKmsCursorManager    *cursor_manager,
+                                               const MetaKmsCrtcCursor *crtc_cursors,
+                                               int                      n_crtc_cursors,
+                                               const graphene_point_t  *position,
+                                               gboolean                 invalidated);
+
+void meta_kms_cursor_manager_update_position (MetaKmsCursorManager   *cursor_manager,
+                                              const graphene_point_t *position);
+
+#endif /* META_KMS_CURSOR_MANAGER_H */
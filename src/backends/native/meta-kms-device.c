@@ -157,6 +157,49 @@ meta_kms_device_get_cursor_plane_for (MetaKmsDevice *device,
   return get_plane_with_type_for (device, crtc, META_KMS_PLANE_TYPE_CURSOR);
 }
 
+/*
+ * Returns a newly allocated list of the overlay planes usable with @crtc
+ * that are stacked above its primary plane and below its cursor plane,
+ * which must be freed with g_list_free().
+ */
+GList *
+meta_kms_device_get_overlay_planes_for (MetaKmsDevice *device,
+                                        MetaKmsCrtc   *crtc)
+{
+  MetaKmsPlane *primary_plane;
+  MetaKmsPlane *cursor_plane;
+  GList *overlay_planes = NULL;
+  GList *l;
+
+  primary_plane = meta_kms_device_get_primary_plane_for (device, crtc);
+  if (!primary_plane)
+    return NULL;
+
+  cursor_plane = meta_kms_device_get_cursor_plane_for (device, crtc);
+
+  for (l = meta_kms_device_get_planes (device); l; l = l->next)
+    {
+      MetaKmsPlane *plane = l->data;
+
+      if (meta_kms_plane_get_plane_type (plane) != META_KMS_PLANE_TYPE_OVERLAY)
+        continue;
+
+      if (!meta_kms_plane_is_usable_with (plane, crtc))
+        continue;
+
+      if (!meta_kms_plane_is_stacked_above (plane, primary_plane))
+        continue;
+
+      if (cursor_plane &&
+          !meta_kms_plane_is_stacked_above (cursor_plane, plane))
+        continue;
+
+      overlay_planes = g_list_prepend (overlay_planes, plane);
+    }
+
+  return g_list_reverse (overlay_planes);
+}
+
 void
 meta_kms_device_update_states_in_impl (MetaKmsDevice *device)
 {
@@ -0,0 +1,1684 @@
+/*
+ * Copyright (C) 2020 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include "backends/native/meta-kms-impl-atomic.h"
+
+#include <errno.h>
+#include <string.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "backends/native/meta-kms-connector.h"
+#include "backends/native/meta-kms-crtc.h"
+#include "backends/native/meta-kms-device-private.h"
+#include "backends/native/meta-kms-page-flip-private.h"
+#include "backends/native/meta-kms-plane.h"
+#include "backends/native/meta-kms-private.h"
+#include "backends/native/meta-kms-update-private.h"
+
+struct _MetaKmsImplAtomic
+{
+  MetaKmsImpl parent;
+
+  /*
+   * key: MetaKmsDevice, value: GHashTable with key: KMS object id, value:
+   * ObjectProps
+   */
+  GHashTable *device_props;
+
+  /*
+   * key: MetaKmsCrtc, value: GList of MetaKmsPageFlipData waiting for an
+   * event, in the order they were committed
+   */
+  GHashTable *page_flip_datas;
+
+  /*
+   * key: MetaKmsDevice, value: GQueue of PendingCommit waiting for a commit
+   * in flight, in the order they are to be posted
+   */
+  GHashTable *pending_commits;
+};
+
+G_DEFINE_TYPE (MetaKmsImplAtomic, meta_kms_impl_atomic,
+               META_TYPE_KMS_IMPL)
+
+typedef enum _AtomicProp
+{
+  ATOMIC_PROP_FB_ID,
+  ATOMIC_PROP_CRTC_ID,
+  ATOMIC_PROP_SRC_X,
+  ATOMIC_PROP_SRC_Y,
+  ATOMIC_PROP_SRC_W,
+  ATOMIC_PROP_SRC_H,
+  ATOMIC_PROP_CRTC_X,
+  ATOMIC_PROP_CRTC_Y,
+  ATOMIC_PROP_CRTC_W,
+  ATOMIC_PROP_CRTC_H,
+  ATOMIC_PROP_MODE_ID,
+  ATOMIC_PROP_ACTIVE,
+  ATOMIC_PROP_GAMMA_LUT,
+  ATOMIC_PROP_GAMMA_LUT_SIZE,
+  ATOMIC_PROP_DPMS,
+
+  N_ATOMIC_PROPS
+} AtomicProp;
+
+static const char *atomic_prop_names[N_ATOMIC_PROPS] = {
+  [ATOMIC_PROP_FB_ID] = "FB_ID",
+  [ATOMIC_PROP_CRTC_ID] = "CRTC_ID",
+  [ATOMIC_PROP_SRC_X] = "SRC_X",
+  [ATOMIC_PROP_SRC_Y] = "SRC_Y",
+  [ATOMIC_PROP_SRC_W] = "SRC_W",
+  [ATOMIC_PROP_SRC_H] = "SRC_H",
+  [ATOMIC_PROP_CRTC_X] = "CRTC_X",
+  [ATOMIC_PROP_CRTC_Y] = "CRTC_Y",
+  [ATOMIC_PROP_CRTC_W] = "CRTC_W",
+  [ATOMIC_PROP_CRTC_H] = "CRTC_H",
+  [ATOMIC_PROP_MODE_ID] = "MODE_ID",
+  [ATOMIC_PROP_ACTIVE] = "ACTIVE",
+  [ATOMIC_PROP_GAMMA_LUT] = "GAMMA_LUT",
+  [ATOMIC_PROP_GAMMA_LUT_SIZE] = "GAMMA_LUT_SIZE",
+  [ATOMIC_PROP_DPMS] = "DPMS",
+};
+
+/*
+ * Property ids of a KMS object, 0 where the object lacks the property.
+ * GAMMA_LUT_SIZE is immutable, so its value is cached along with the ids.
+ */
+typedef struct _ObjectProps
+{
+  uint32_t prop_ids[N_ATOMIC_PROPS];
+  uint64_t gamma_lut_size;
+} ObjectProps;
+
+typedef struct _AtomicRequest
+{
+  MetaKmsImplAtomic *impl_atomic;
+  MetaKmsDevice *device;
+  int fd;
+
+  drmModeAtomicReqPtr req;
+  GArray *blob_ids;
+
+  /* Applied with the legacy ioctls once the atomic commit succeeded */
+  GArray *legacy_properties;
+  GList *legacy_gammas;
+
+  gboolean needs_modeset;
+} AtomicRequest;
+
+typedef struct _LegacyProperty
+{
+  uint32_t object_id;
+  uint32_t object_type;
+  uint32_t prop_id;
+  uint64_t value;
+} LegacyProperty;
+
+typedef struct _LegacyGamma
+{
+  uint32_t crtc_id;
+  int size;
+  uint16_t *red;
+  uint16_t *green;
+  uint16_t *blue;
+} LegacyGamma;
+
+typedef struct _PendingCommit
+{
+  AtomicRequest request;
+  uint32_t flags;
+
+  /* Copies of the MetaKmsPageFlip's of the updates merged into the commit */
+  GList *page_flips;
+} PendingCommit;
+
+MetaKmsImplAtomic *
+meta_kms_impl_atomic_new (MetaKms  *kms,
+                          GError  **error)
+{
+  return g_object_new (META_TYPE_KMS_IMPL_ATOMIC,
+                       "kms", kms,
+                       NULL);
+}
+
+static ObjectProps *
+resolve_object_props (int      fd,
+                      uint32_t object_id,
+                      uint32_t object_type)
+{
+  drmModeObjectProperties *props;
+  ObjectProps *object_props;
+  unsigned int i;
+
+  object_props = g_new0 (ObjectProps, 1);
+
+  props = drmModeObjectGetProperties (fd, object_id, object_type);
+  if (!props)
+    return object_props;
+
+  for (i = 0; i < props->count_props; i++)
+    {
+      drmModePropertyPtr prop;
+      AtomicProp atomic_prop;
+
+      prop = drmModeGetProperty (fd, props->props[i]);
+      if (!prop)
+        continue;
+
+      for (atomic_prop = 0; atomic_prop < N_ATOMIC_PROPS; atomic_prop++)
+        {
+          if (strcmp (prop->name, atomic_prop_names[atomic_prop]) != 0)
+            continue;
+
+          object_props->prop_ids[atomic_prop] = prop->prop_id;
+          if (atomic_prop == ATOMIC_PROP_GAMMA_LUT_SIZE)
+            object_props->gamma_lut_size = props->prop_values[i];
+          break;
+        }
+
+      drmModeFreeProperty (prop);
+    }
+  drmModeFreeObjectProperties (props);
+
+  return object_props;
+}
+
+static GHashTable *
+ensure_device_props (MetaKmsImplAtomic *impl_atomic,
+                     MetaKmsDevice     *device)
+{
+  GHashTable *object_props_table;
+
+  object_props_table = g_hash_table_lookup (impl_atomic->device_props, device);
+  if (!object_props_table)
+    {
+      object_props_table = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+      g_hash_table_insert (impl_atomic->device_props,
+                           device, object_props_table);
+    }
+
+  return object_props_table;
+}
+
+static ObjectProps *
+ensure_object_props (MetaKmsImplAtomic *impl_atomic,
+                     MetaKmsDevice     *device,
+                     int                fd,
+                     uint32_t           object_id,
+                     uint32_t           object_type)
+{
+  GHashTable *object_props_table;
+  ObjectProps *object_props;
+
+  object_props_table = ensure_device_props (impl_atomic, device);
+  object_props = g_hash_table_lookup (object_props_table,
+                                      GUINT_TO_POINTER (object_id));
+  if (!object_props)
+    {
+      /* Objects appearing after the device was enabled, e.g. MST connectors */
+      object_props = resolve_object_props (fd, object_id, object_type);
+      g_hash_table_insert (object_props_table,
+                           GUINT_TO_POINTER (object_id),
+                           object_props);
+    }
+
+  return object_props;
+}
+
+static ObjectProps *
+get_object_props (AtomicRequest *request,
+                  uint32_t       object_id,
+                  uint32_t       object_type)
+{
+  return ensure_object_props (request->impl_atomic, request->device,
+                              request->fd, object_id, object_type);
+}
+
+static uint32_t
+find_property_id (AtomicRequest *request,
+                  uint32_t       object_id,
+                  uint32_t       object_type,
+                  AtomicProp     prop)
+{
+  ObjectProps *object_props;
+
+  object_props = get_object_props (request, object_id, object_type);
+  return object_props->prop_ids[prop];
+}
+
+static gboolean
+add_property (AtomicRequest  *request,
+              uint32_t        object_id,
+              uint32_t        object_type,
+              AtomicProp      prop,
+              uint64_t        value,
+              GError        **error)
+{
+  const char *prop_name = atomic_prop_names[prop];
+  uint32_t prop_id;
+  int ret;
+
+  prop_id = find_property_id (request, object_id, object_type, prop);
+  if (!prop_id)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   "KMS object %u has no property '%s'",
+                   object_id, prop_name);
+      return FALSE;
+    }
+
+  ret = drmModeAtomicAddProperty (request->req, object_id, prop_id, value);
+  if (ret < 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (-ret),
+                   "Failed to add property '%s' of object %u: %s",
+                   prop_name, object_id, g_strerror (-ret));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+add_property_by_id (AtomicRequest  *request,
+                    uint32_t        object_id,
+                    uint32_t        prop_id,
+                    uint64_t        value,
+                    GError        **error)
+{
+  int ret;
+
+  ret = drmModeAtomicAddProperty (request->req, object_id, prop_id, value);
+  if (ret < 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (-ret),
+                   "Failed to add property %u of object %u: %s",
+                   prop_id, object_id, g_strerror (-ret));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+create_blob (AtomicRequest  *request,
+             const void     *data,
+             size_t          size,
+             uint32_t       *out_blob_id,
+             GError        **error)
+{
+  uint32_t blob_id;
+  int ret;
+
+  ret = drmModeCreatePropertyBlob (request->fd, data, size, &blob_id);
+  if (ret != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (-ret),
+                   "Failed to create property blob: %s",
+                   g_strerror (-ret));
+      return FALSE;
+    }
+
+  g_array_append_val (request->blob_ids, blob_id);
+  *out_blob_id = blob_id;
+
+  return TRUE;
+}
+
+static void
+atomic_request_init (AtomicRequest     *request,
+                     MetaKmsImplAtomic *impl_atomic,
+                     MetaKmsDevice     *device)
+{
+  MetaKmsImplDevice *impl_device = meta_kms_device_get_impl_device (device);
+
+  *request = (AtomicRequest) {
+    .impl_atomic = impl_atomic,
+    .device = device,
+    .fd = meta_kms_impl_device_get_fd (impl_device),
+    .req = drmModeAtomicAlloc (),
+    .blob_ids = g_array_new (FALSE, FALSE, sizeof (uint32_t)),
+    .legacy_properties = g_array_new (FALSE, FALSE, sizeof (LegacyProperty)),
+  };
+}
+
+static void
+legacy_gamma_free (LegacyGamma *legacy_gamma)
+{
+  g_free (legacy_gamma->red);
+  g_free (legacy_gamma->green);
+  g_free (legacy_gamma->blue);
+  g_free (legacy_gamma);
+}
+
+static void
+atomic_request_clear (AtomicRequest *request)
+{
+  unsigned int i;
+
+  if (request->blob_ids)
+    {
+      for (i = 0; i < request->blob_ids->len; i++)
+        {
+          uint32_t blob_id = g_array_index (request->blob_ids, uint32_t, i);
+
+          drmModeDestroyPropertyBlob (request->fd, blob_id);
+        }
+    }
+
+  g_clear_pointer (&request->blob_ids, g_array_unref);
+  g_clear_pointer (&request->legacy_properties, g_array_unref);
+  g_list_free_full (g_steal_pointer (&request->legacy_gammas),
+                    (GDestroyNotify) legacy_gamma_free);
+  g_clear_pointer (&request->req, drmModeAtomicFree);
+}
+
+/*
+ * Applies what the atomic request couldn't carry. This is only done after the
+ * atomic commit itself succeeded, so that a failed or merely tested request
+ * has no side effects.
+ */
+static void
+apply_legacy_state (AtomicRequest *request)
+{
+  unsigned int i;
+  GList *l;
+
+  for (i = 0; i < request->legacy_properties->len; i++)
+    {
+      LegacyProperty *legacy_property =
+        &g_array_index (request->legacy_properties, LegacyProperty, i);
+      int ret;
+
+      ret = drmModeObjectSetProperty (request->fd,
+                                      legacy_property->object_id,
+                                      legacy_property->object_type,
+                                      legacy_property->prop_id,
+                                      legacy_property->value);
+      if (ret != 0)
+        {
+          g_warning ("Failed to set property %u of object %u: %s",
+                     legacy_property->prop_id,
+                     legacy_property->object_id,
+                     g_strerror (-ret));
+        }
+    }
+
+  for (l = request->legacy_gammas; l; l = l->next)
+    {
+      LegacyGamma *legacy_gamma = l->data;
+      int ret;
+
+      ret = drmModeCrtcSetGamma (request->fd, legacy_gamma->crtc_id,
+                                 legacy_gamma->size,
+                                 legacy_gamma->red,
+                                 legacy_gamma->green,
+                                 legacy_gamma->blue);
+      if (ret != 0)
+        {
+          g_warning ("drmModeCrtcSetGamma on CRTC %u failed: %s",
+                     legacy_gamma->crtc_id,
+                     g_strerror (-ret));
+        }
+    }
+}
+
+/*
+ * The kernel refuses atomic writes to the DPMS property; it is only settable
+ * via the legacy property ioctl, even when the atomic client cap is set.
+ */
+static gboolean
+is_legacy_only_property (AtomicRequest *request,
+                         uint32_t       connector_id,
+                         uint32_t       prop_id)
+{
+  return prop_id == find_property_id (request,
+                                      connector_id,
+                                      DRM_MODE_OBJECT_CONNECTOR,
+                                      ATOMIC_PROP_DPMS);
+}
+
+static gboolean
+process_connector_properties (AtomicRequest  *request,
+                              MetaKmsUpdate  *update,
+                              GError        **error)
+{
+  GList *l;
+
+  for (l = meta_kms_update_get_connector_properties (update); l; l = l->next)
+    {
+      MetaKmsConnectorProperty *connector_property = l->data;
+      MetaKmsConnector *connector = connector_property->connector;
+      uint32_t connector_id = meta_kms_connector_get_id (connector);
+
+      if (meta_kms_connector_get_device (connector) != request->device)
+        continue;
+
+      if (is_legacy_only_property (request, connector_id,
+                                   connector_property->prop_id))
+        {
+          LegacyProperty legacy_property = {
+            .object_id = connector_id,
+            .object_type = DRM_MODE_OBJECT_CONNECTOR,
+            .prop_id = connector_property->prop_id,
+            .value = connector_property->value,
+          };
+
+          g_array_append_val (request->legacy_properties, legacy_property);
+          continue;
+        }
+
+      if (!add_property_by_id (request,
+                               connector_id,
+                               connector_property->prop_id,
+                               connector_property->value,
+                               error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+is_connector_in_mode_set (MetaKmsConnector *connector,
+                          MetaKmsModeSet   *mode_set)
+{
+  return !!g_list_find (mode_set->connectors, connector);
+}
+
+static gboolean
+disable_planes_on_crtc (AtomicRequest  *request,
+                        MetaKmsCrtc    *crtc,
+                        GError        **error)
+{
+  MetaKmsImplDevice *impl_device =
+    meta_kms_device_get_impl_device (request->device);
+  g_autoptr (GList) planes = NULL;
+  GList *l;
+
+  planes = meta_kms_impl_device_copy_planes (impl_device);
+  for (l = planes; l; l = l->next)
+    {
+      MetaKmsPlane *plane = l->data;
+      uint32_t plane_id = meta_kms_plane_get_id (plane);
+      drmModePlane *drm_plane;
+      gboolean is_on_crtc;
+
+      drm_plane = drmModeGetPlane (request->fd, plane_id);
+      if (!drm_plane)
+        continue;
+
+      is_on_crtc = drm_plane->crtc_id == meta_kms_crtc_get_id (crtc);
+      drmModeFreePlane (drm_plane);
+
+      if (!is_on_crtc)
+        continue;
+
+      if (!add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                         ATOMIC_PROP_FB_ID, 0, error))
+        return FALSE;
+      if (!add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                         ATOMIC_PROP_CRTC_ID, 0, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+process_mode_set (AtomicRequest   *request,
+                  MetaKmsUpdate   *update,
+                  MetaKmsModeSet  *mode_set,
+                  GError         **error)
+{
+  MetaKmsCrtc *crtc = mode_set->crtc;
+  uint32_t crtc_id = meta_kms_crtc_get_id (crtc);
+  uint32_t mode_blob_id = 0;
+  GList *l;
+
+  if (mode_set->drm_mode)
+    {
+      if (!create_blob (request,
+                        mode_set->drm_mode, sizeof (*mode_set->drm_mode),
+                        &mode_blob_id,
+                        error))
+        return FALSE;
+    }
+  else
+    {
+      if (!disable_planes_on_crtc (request, crtc, error))
+        return FALSE;
+    }
+
+  if (!add_property (request, crtc_id, DRM_MODE_OBJECT_CRTC,
+                     ATOMIC_PROP_MODE_ID, mode_blob_id, error))
+    return FALSE;
+
+  if (!add_property (request, crtc_id, DRM_MODE_OBJECT_CRTC,
+                     ATOMIC_PROP_ACTIVE, !!mode_set->drm_mode, error))
+    return FALSE;
+
+  for (l = meta_kms_device_get_connectors (request->device); l; l = l->next)
+    {
+      MetaKmsConnector *connector = l->data;
+      const MetaKmsConnectorState *connector_state;
+      uint32_t connector_id = meta_kms_connector_get_id (connector);
+
+      if (is_connector_in_mode_set (connector, mode_set))
+        {
+          if (!add_property (request, connector_id,
+                             DRM_MODE_OBJECT_CONNECTOR,
+                             ATOMIC_PROP_CRTC_ID, crtc_id, error))
+            return FALSE;
+
+          continue;
+        }
+
+      connector_state = meta_kms_connector_get_current_state (connector);
+      if (!connector_state || connector_state->current_crtc_id != crtc_id)
+        continue;
+
+      if (!add_property (request, connector_id,
+                         DRM_MODE_OBJECT_CONNECTOR,
+                         ATOMIC_PROP_CRTC_ID, 0, error))
+        return FALSE;
+    }
+
+  request->needs_modeset = TRUE;
+
+  return TRUE;
+}
+
+static gboolean
+process_mode_sets (AtomicRequest  *request,
+                   MetaKmsUpdate  *update,
+                   GError        **error)
+{
+  GList *l;
+
+  for (l = meta_kms_update_get_mode_sets (update); l; l = l->next)
+    {
+      MetaKmsModeSet *mode_set = l->data;
+
+      if (meta_kms_crtc_get_device (mode_set->crtc) != request->device)
+        continue;
+
+      if (!process_mode_set (request, update, mode_set, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static uint16_t
+sample_gamma_ramp (const uint16_t *ramp,
+                   int             ramp_size,
+                   uint64_t        lut_index,
+                   uint64_t        lut_size)
+{
+  double position;
+  double fraction;
+  int i;
+
+  if (ramp_size == 1 || lut_size == 1)
+    return ramp[0];
+
+  position = (double) lut_index * (ramp_size - 1) / (lut_size - 1);
+  i = (int) position;
+  if (i >= ramp_size - 1)
+    return ramp[ramp_size - 1];
+
+  fraction = position - i;
+  return (uint16_t) (ramp[i] * (1.0 - fraction) +
+                     ramp[i + 1] * fraction + 0.5);
+}
+
+static gboolean
+process_crtc_gammas (AtomicRequest  *request,
+                     MetaKmsUpdate  *update,
+                     GError        **error)
+{
+  GList *l;
+
+  for (l = meta_kms_update_get_crtc_gammas (update); l; l = l->next)
+    {
+      MetaKmsCrtcGamma *gamma = l->data;
+      MetaKmsCrtc *crtc = gamma->crtc;
+      uint32_t crtc_id = meta_kms_crtc_get_id (crtc);
+      g_autofree struct drm_color_lut *lut = NULL;
+      ObjectProps *crtc_props;
+      uint64_t lut_size;
+      uint32_t lut_blob_id;
+      uint64_t i;
+
+      if (meta_kms_crtc_get_device (crtc) != request->device)
+        continue;
+
+      crtc_props = get_object_props (request, crtc_id, DRM_MODE_OBJECT_CRTC);
+      lut_size = crtc_props->gamma_lut_size;
+      if (!crtc_props->prop_ids[ATOMIC_PROP_GAMMA_LUT] || lut_size == 0)
+        {
+          LegacyGamma *legacy_gamma;
+
+          /* Drivers without color management still have the legacy ramps */
+          legacy_gamma = g_new0 (LegacyGamma, 1);
+          legacy_gamma->crtc_id = crtc_id;
+          legacy_gamma->size = gamma->size;
+          legacy_gamma->red = g_memdup (gamma->red,
+                                        gamma->size * sizeof (uint16_t));
+          legacy_gamma->green = g_memdup (gamma->green,
+                                          gamma->size * sizeof (uint16_t));
+          legacy_gamma->blue = g_memdup (gamma->blue,
+                                         gamma->size * sizeof (uint16_t));
+          request->legacy_gammas = g_list_append (request->legacy_gammas,
+                                                  legacy_gamma);
+          continue;
+        }
+
+      /*
+       * The ramps are sized after the legacy gamma size of the CRTC, which
+       * doesn't necessarily match the size of the LUT the kernel expects.
+       */
+      lut = g_new0 (struct drm_color_lut, lut_size);
+      for (i = 0; i < lut_size; i++)
+        {
+          lut[i].red = sample_gamma_ramp (gamma->red, gamma->size,
+                                          i, lut_size);
+          lut[i].green = sample_gamma_ramp (gamma->green, gamma->size,
+                                            i, lut_size);
+          lut[i].blue = sample_gamma_ramp (gamma->blue, gamma->size,
+                                           i, lut_size);
+        }
+
+      if (!create_blob (request,
+                        lut, lut_size * sizeof (struct drm_color_lut),
+                        &lut_blob_id,
+                        error))
+        return FALSE;
+
+      if (!add_property (request, crtc_id,
+                         DRM_MODE_OBJECT_CRTC,
+                         ATOMIC_PROP_GAMMA_LUT, lut_blob_id, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Cursor assignments also carry the GEM handle of their buffer for the legacy
+ * cursor API. That handle is not a framebuffer id, so without a framebuffer
+ * the assignment can't be committed; it must not turn the plane off either.
+ */
+gboolean
+meta_kms_impl_atomic_check_plane_assignment (MetaKmsPlaneAssignment  *plane_assignment,
+                                             GError                 **error)
+{
+  if (plane_assignment->fb_id == 0 && plane_assignment->cursor_bo_handle)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                           "Cursor plane assignment without a framebuffer");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+process_plane_assignment (AtomicRequest           *request,
+                          MetaKmsPlaneAssignment  *plane_assignment,
+                          GError                 **error)
+{
+  MetaKmsPlane *plane = plane_assignment->plane;
+  uint32_t plane_id = meta_kms_plane_get_id (plane);
+  uint32_t crtc_id;
+  GList *l;
+
+  if (plane_assignment->fb_id == 0)
+    {
+      if (!add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                         ATOMIC_PROP_FB_ID, 0, error))
+        return FALSE;
+
+      return add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                           ATOMIC_PROP_CRTC_ID, 0, error);
+    }
+
+  crtc_id = meta_kms_crtc_get_id (plane_assignment->crtc);
+
+  if (!add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_FB_ID, plane_assignment->fb_id, error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_CRTC_ID, crtc_id, error))
+    return FALSE;
+
+  /* SRC_* are 16.16 fixed point, CRTC_* are integers. */
+  if (!add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_SRC_X,
+                     plane_assignment->src_rect.x, error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_SRC_Y,
+                     plane_assignment->src_rect.y, error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_SRC_W,
+                     plane_assignment->src_rect.width, error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_SRC_H,
+                     plane_assignment->src_rect.height, error))
+    return FALSE;
+
+  if (!add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_CRTC_X,
+                     meta_fixed_16_to_int (plane_assignment->dst_rect.x),
+                     error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_CRTC_Y,
+                     meta_fixed_16_to_int (plane_assignment->dst_rect.y),
+                     error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_CRTC_W,
+                     meta_fixed_16_to_int (plane_assignment->dst_rect.width),
+                     error) ||
+      !add_property (request, plane_id, DRM_MODE_OBJECT_PLANE,
+                     ATOMIC_PROP_CRTC_H,
+                     meta_fixed_16_to_int (plane_assignment->dst_rect.height),
+                     error))
+    return FALSE;
+
+  for (l = plane_assignment->plane_properties; l; l = l->next)
+    {
+      MetaKmsProperty *prop = l->data;
+
+      if (!add_property_by_id (request, plane_id,
+                               prop->prop_id, prop->value,
+                               error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+process_plane_assignments (AtomicRequest  *request,
+                           MetaKmsUpdate  *update,
+                           GList          *skipped_planes,
+                           GError        **error)
+{
+  GList *l;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+
+      if (meta_kms_plane_get_device (plane_assignment->plane) !=
+          request->device)
+        continue;
+
+      if (g_list_find (skipped_planes, plane_assignment))
+        continue;
+
+      if (!process_plane_assignment (request, plane_assignment, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+build_request (AtomicRequest  *request,
+               MetaKmsUpdate  *update,
+               GList          *skipped_planes,
+               GError        **error)
+{
+  if (!process_connector_properties (request, update, error))
+    return FALSE;
+
+  if (!process_mode_sets (request, update, error))
+    return FALSE;
+
+  if (!process_crtc_gammas (request, update, error))
+    return FALSE;
+
+  if (!process_plane_assignments (request, update, skipped_planes, error))
+    return FALSE;
+
+  return TRUE;
+}
+
+static uint32_t
+get_commit_flags (AtomicRequest *request,
+                  gboolean       has_page_flips)
+{
+  uint32_t flags = 0;
+
+  /*
+   * Anything but mode sets, including cursor only updates, is committed
+   * without blocking. A page flip event is requested for those too, as it
+   * tells when the CRTCs are idle again, so that a commit that had to be
+   * queued meanwhile can be posted.
+   */
+  if (request->needs_modeset)
+    flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+  else
+    flags |= DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+
+  if (has_page_flips)
+    flags |= DRM_MODE_PAGE_FLIP_EVENT;
+
+  return flags;
+}
+
+static gboolean
+test_request (AtomicRequest *request,
+              gboolean       has_page_flips)
+{
+  uint32_t flags;
+
+  flags = get_commit_flags (request, has_page_flips);
+  flags &= ~DRM_MODE_PAGE_FLIP_EVENT;
+  flags |= DRM_MODE_ATOMIC_TEST_ONLY;
+
+  return drmModeAtomicCommit (request->fd, request->req, flags, NULL) == 0;
+}
+
+static GList *
+get_device_page_flips (MetaKmsUpdate *update,
+                       MetaKmsDevice *device)
+{
+  GList *page_flips = NULL;
+  GList *l;
+
+  for (l = meta_kms_update_get_page_flips (update); l; l = l->next)
+    {
+      MetaKmsPageFlip *page_flip = l->data;
+
+      if (meta_kms_crtc_get_device (page_flip->crtc) != device)
+        continue;
+
+      page_flips = g_list_prepend (page_flips, page_flip);
+    }
+
+  return g_list_reverse (page_flips);
+}
+
+static GList *
+get_optional_plane_assignments (MetaKmsUpdate *update,
+                                MetaKmsDevice *device)
+{
+  GList *plane_assignments = NULL;
+  GList *l;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      MetaKmsPlane *plane = plane_assignment->plane;
+
+      if (meta_kms_plane_get_device (plane) != device)
+        continue;
+
+      /* Turning a plane off can't make the configuration fail, and keeping
+       * it on would leave stale contents on screen */
+      if (plane_assignment->fb_id == 0)
+        continue;
+
+      switch (meta_kms_plane_get_plane_type (plane))
+        {
+        case META_KMS_PLANE_TYPE_PRIMARY:
+          continue;
+        case META_KMS_PLANE_TYPE_CURSOR:
+        case META_KMS_PLANE_TYPE_OVERLAY:
+          break;
+        }
+
+      plane_assignments = g_list_prepend (plane_assignments, plane_assignment);
+    }
+
+  return plane_assignments;
+}
+
+static GList *
+reject_invalid_plane_assignments (MetaKmsUpdate  *update,
+                                  MetaKmsDevice  *device,
+                                  GList         **failed_planes)
+{
+  GList *rejected_planes = NULL;
+  GList *l;
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      MetaKmsPlaneFeedback *plane_feedback;
+      GError *error = NULL;
+
+      if (meta_kms_plane_get_device (plane_assignment->plane) != device)
+        continue;
+
+      if (meta_kms_impl_atomic_check_plane_assignment (plane_assignment,
+                                                       &error))
+        continue;
+
+      plane_feedback =
+        meta_kms_plane_feedback_new_take_error (plane_assignment->plane,
+                                                plane_assignment->crtc,
+                                                error);
+      *failed_planes = g_list_prepend (*failed_planes, plane_feedback);
+      rejected_planes = g_list_prepend (rejected_planes, plane_assignment);
+    }
+
+  return rejected_planes;
+}
+
+static GList *
+generate_plane_feedbacks (GList        *plane_assignments,
+                          const GError *error)
+{
+  GList *plane_feedbacks = NULL;
+  GList *l;
+
+  for (l = plane_assignments; l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+      MetaKmsPlaneFeedback *plane_feedback;
+
+      plane_feedback =
+        meta_kms_plane_feedback_new_take_error (plane_assignment->plane,
+                                                plane_assignment->crtc,
+                                                g_error_copy (error));
+      plane_feedbacks = g_list_prepend (plane_feedbacks, plane_feedback);
+    }
+
+  return plane_feedbacks;
+}
+
+static void
+queue_page_flips (MetaKmsImplAtomic *impl_atomic,
+                  GList             *page_flips)
+{
+  MetaKmsImpl *impl = META_KMS_IMPL (impl_atomic);
+  GList *l;
+
+  for (l = page_flips; l; l = l->next)
+    {
+      MetaKmsPageFlip *page_flip = l->data;
+      MetaKmsPageFlipData *page_flip_data;
+      GList *page_flip_datas;
+
+      page_flip_data = meta_kms_page_flip_data_new (impl,
+                                                    page_flip->crtc,
+                                                    page_flip->feedback,
+                                                    page_flip->user_data);
+      meta_kms_page_flip_data_set_submitted_in_impl (page_flip_data);
+
+      if (page_flip->custom_page_flip_func)
+        {
+          int ret;
+
+          ret = page_flip->custom_page_flip_func (page_flip->custom_page_flip_user_data,
+                                                  meta_kms_page_flip_data_ref (page_flip_data));
+          if (ret != 0)
+            {
+              g_autoptr (GError) error = NULL;
+
+              meta_kms_page_flip_data_unref (page_flip_data);
+
+              g_set_error (&error, G_IO_ERROR, g_io_error_from_errno (-ret),
+                           "Custom page flip on CRTC %u failed: %s",
+                           meta_kms_crtc_get_id (page_flip->crtc),
+                           g_strerror (-ret));
+              meta_kms_page_flip_data_discard_in_impl (page_flip_data, error);
+            }
+
+          meta_kms_page_flip_data_unref (page_flip_data);
+          continue;
+        }
+
+      /*
+       * A merged commit can carry more than one page flip per CRTC; all of
+       * them complete with the same event.
+       */
+      page_flip_datas = g_hash_table_lookup (impl_atomic->page_flip_datas,
+                                             page_flip->crtc);
+      if (page_flip_datas)
+        {
+          page_flip_datas = g_list_append (page_flip_datas, page_flip_data);
+        }
+      else
+        {
+          g_hash_table_insert (impl_atomic->page_flip_datas,
+                               page_flip->crtc,
+                               g_list_append (NULL, page_flip_data));
+        }
+    }
+}
+
+static void
+page_flip_datas_free (GList *page_flip_datas)
+{
+  g_list_free_full (page_flip_datas,
+                    (GDestroyNotify) meta_kms_page_flip_data_unref);
+}
+
+static void
+discard_page_flips (MetaKmsImpl  *impl,
+                    GList        *page_flips,
+                    const GError *error)
+{
+  GList *l;
+
+  for (l = page_flips; l; l = l->next)
+    {
+      MetaKmsPageFlip *page_flip = l->data;
+      MetaKmsPageFlipData *page_flip_data;
+
+      if (page_flip->flags & META_KMS_PAGE_FLIP_FLAG_NO_DISCARD_FEEDBACK)
+        continue;
+
+      page_flip_data = meta_kms_page_flip_data_new (impl,
+                                                    page_flip->crtc,
+                                                    page_flip->feedback,
+                                                    page_flip->user_data);
+      meta_kms_page_flip_data_discard_in_impl (page_flip_data, error);
+      meta_kms_page_flip_data_unref (page_flip_data);
+    }
+}
+
+static GList *
+copy_page_flips (GList *page_flips)
+{
+  GList *copies = NULL;
+  GList *l;
+
+  for (l = page_flips; l; l = l->next)
+    {
+      copies = g_list_prepend (copies,
+                               g_memdup (l->data, sizeof (MetaKmsPageFlip)));
+    }
+
+  return g_list_reverse (copies);
+}
+
+static PendingCommit *
+pending_commit_new (AtomicRequest *request,
+                    uint32_t       flags,
+                    GList         *page_flips)
+{
+  PendingCommit *pending_commit;
+
+  pending_commit = g_new0 (PendingCommit, 1);
+  pending_commit->request = *request;
+  pending_commit->flags = flags;
+  pending_commit->page_flips = copy_page_flips (page_flips);
+
+  *request = (AtomicRequest) { 0 };
+
+  return pending_commit;
+}
+
+static void
+pending_commit_free (PendingCommit *pending_commit)
+{
+  atomic_request_clear (&pending_commit->request);
+  g_list_free_full (pending_commit->page_flips, g_free);
+  g_free (pending_commit);
+}
+
+/*
+ * Merges a newer request into a commit that is still waiting to be posted.
+ * Properties set by both end up with the value of the newer request. Each
+ * request passed a test commit on its own, which says nothing about their
+ * combination, so the merged request is tested again; if that fails, nothing
+ * is merged and FALSE is returned.
+ */
+static gboolean
+pending_commit_try_merge (PendingCommit *pending_commit,
+                          AtomicRequest *request,
+                          uint32_t       flags,
+                          GList         *page_flips)
+{
+  drmModeAtomicReqPtr merged_req;
+  uint32_t merged_flags;
+  uint32_t test_flags;
+
+  merged_req = drmModeAtomicDuplicate (pending_commit->request.req);
+  if (!merged_req)
+    return FALSE;
+
+  if (drmModeAtomicMerge (merged_req, request->req) != 0)
+    {
+      drmModeAtomicFree (merged_req);
+      return FALSE;
+    }
+
+  merged_flags = pending_commit->flags | flags;
+  if (flags & DRM_MODE_ATOMIC_ALLOW_MODESET)
+    merged_flags &= ~DRM_MODE_ATOMIC_NONBLOCK;
+
+  test_flags = merged_flags;
+  test_flags &= ~DRM_MODE_PAGE_FLIP_EVENT;
+  test_flags |= DRM_MODE_ATOMIC_TEST_ONLY;
+  if (drmModeAtomicCommit (request->fd, merged_req, test_flags, NULL) != 0)
+    {
+      drmModeAtomicFree (merged_req);
+      return FALSE;
+    }
+
+  drmModeAtomicFree (pending_commit->request.req);
+  pending_commit->request.req = merged_req;
+
+  g_array_append_vals (pending_commit->request.blob_ids,
+                       request->blob_ids->data,
+                       request->blob_ids->len);
+  g_array_set_size (request->blob_ids, 0);
+  g_array_append_vals (pending_commit->request.legacy_properties,
+                       request->legacy_properties->data,
+                       request->legacy_properties->len);
+  pending_commit->request.legacy_gammas =
+    g_list_concat (pending_commit->request.legacy_gammas,
+                   g_steal_pointer (&request->legacy_gammas));
+  if (request->needs_modeset)
+    pending_commit->request.needs_modeset = TRUE;
+  atomic_request_clear (request);
+
+  pending_commit->flags = merged_flags;
+  pending_commit->page_flips = g_list_concat (pending_commit->page_flips,
+                                              copy_page_flips (page_flips));
+
+  return TRUE;
+}
+
+static GQueue *
+ensure_pending_commits (MetaKmsImplAtomic *impl_atomic,
+                        MetaKmsDevice     *device)
+{
+  GQueue *pending_commits;
+
+  pending_commits = g_hash_table_lookup (impl_atomic->pending_commits, device);
+  if (!pending_commits)
+    {
+      pending_commits = g_queue_new ();
+      g_hash_table_insert (impl_atomic->pending_commits,
+                           device, pending_commits);
+    }
+
+  return pending_commits;
+}
+
+static void
+pending_commits_free (GQueue *pending_commits)
+{
+  g_queue_free_full (pending_commits, (GDestroyNotify) pending_commit_free);
+}
+
+/*
+ * Posts the commit, or, if a previous non-blocking commit is still in flight
+ * on one of its CRTCs, puts it back at the head of the queue of the device
+ * until the page flip event of that one arrives. Takes ownership of the
+ * pending commit.
+ */
+static gboolean
+post_pending_commit (MetaKmsImplAtomic  *impl_atomic,
+                     PendingCommit      *pending_commit,
+                     GError            **error)
+{
+  MetaKmsImpl *impl = META_KMS_IMPL (impl_atomic);
+  AtomicRequest *request = &pending_commit->request;
+  MetaKmsDevice *device = request->device;
+  MetaKmsImplDevice *impl_device = meta_kms_device_get_impl_device (device);
+  int ret;
+
+  ret = drmModeAtomicCommit (request->fd, request->req,
+                             pending_commit->flags, impl_device);
+  if (ret == -EBUSY && pending_commit->flags & DRM_MODE_ATOMIC_NONBLOCK)
+    {
+      g_queue_push_head (ensure_pending_commits (impl_atomic, device),
+                         pending_commit);
+      return TRUE;
+    }
+
+  if (ret != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (-ret),
+                   "Atomic commit on %s failed: %s",
+                   meta_kms_device_get_path (device),
+                   g_strerror (-ret));
+      discard_page_flips (impl, pending_commit->page_flips, *error);
+      pending_commit_free (pending_commit);
+      return FALSE;
+    }
+
+  apply_legacy_state (request);
+  queue_page_flips (impl_atomic, pending_commit->page_flips);
+  pending_commit_free (pending_commit);
+
+  return TRUE;
+}
+
+static void
+flush_pending_commits (MetaKmsImplAtomic *impl_atomic,
+                       MetaKmsDevice     *device)
+{
+  GQueue *pending_commits;
+  PendingCommit *pending_commit;
+
+  pending_commits = g_hash_table_lookup (impl_atomic->pending_commits, device);
+  if (!pending_commits)
+    return;
+
+  while ((pending_commit = g_queue_pop_head (pending_commits)))
+    {
+      g_autoptr (GError) error = NULL;
+
+      if (!post_pending_commit (impl_atomic, pending_commit, &error))
+        {
+          g_warning ("Failed to post queued KMS update: %s", error->message);
+          continue;
+        }
+
+      /* Still busy; it was put back, and the rest has to wait behind it */
+      if (g_queue_peek_head (pending_commits) == pending_commit)
+        break;
+    }
+}
+
+static gboolean
+process_update_for_device (MetaKmsImplAtomic  *impl_atomic,
+                           MetaKmsUpdate      *update,
+                           MetaKmsDevice      *device,
+                           GList             **failed_planes,
+                           GError            **error)
+{
+  MetaKmsImpl *impl = META_KMS_IMPL (impl_atomic);
+  AtomicRequest request;
+  GQueue *pending_commits;
+  PendingCommit *pending_commit;
+  g_autoptr (GList) page_flips = NULL;
+  g_autoptr (GList) rejected_planes = NULL;
+  g_autoptr (GList) skipped_planes = NULL;
+  gboolean has_page_flips;
+  uint32_t flags;
+
+  page_flips = get_device_page_flips (update, device);
+  has_page_flips = page_flips != NULL;
+
+  rejected_planes = reject_invalid_plane_assignments (update, device,
+                                                      failed_planes);
+
+  atomic_request_init (&request, impl_atomic, device);
+  if (!build_request (&request, update, rejected_planes, error))
+    goto err;
+
+  /*
+   * Probe the full configuration first; if the driver can't take it,
+   * retry without the cursor and overlay planes, and let the users of those
+   * fall back to composition. The skipped planes are reported as failed
+   * whether or not the retry passes, since they won't be committed either
+   * way.
+   */
+  if (!test_request (&request, has_page_flips))
+    {
+      skipped_planes = get_optional_plane_assignments (update, device);
+      if (skipped_planes)
+        {
+          g_autoptr (GError) plane_error = NULL;
+
+          plane_error = g_error_new_literal (G_IO_ERROR,
+                                             G_IO_ERROR_FAILED,
+                                             "Plane configuration rejected "
+                                             "by atomic test commit");
+          *failed_planes =
+            g_list_concat (*failed_planes,
+                           generate_plane_feedbacks (skipped_planes,
+                                                     plane_error));
+          skipped_planes = g_list_concat (skipped_planes,
+                                          g_list_copy (rejected_planes));
+
+          atomic_request_clear (&request);
+          atomic_request_init (&request, impl_atomic, device);
+          if (!build_request (&request, update, skipped_planes, error))
+            goto err;
+        }
+    }
+
+  flags = get_commit_flags (&request, has_page_flips);
+
+  /*
+   * If earlier updates are still waiting for a commit in flight, e.g. a
+   * cursor move, this one is merged into the last of them when the
+   * combination passes a test commit, or queued behind them otherwise, so
+   * that they are posted in order.
+   */
+  pending_commits = g_hash_table_lookup (impl_atomic->pending_commits, device);
+  if (pending_commits && !g_queue_is_empty (pending_commits))
+    {
+      if (!pending_commit_try_merge (g_queue_peek_tail (pending_commits),
+                                     &request, flags, page_flips))
+        {
+          g_queue_push_tail (pending_commits,
+                             pending_commit_new (&request, flags, page_flips));
+        }
+
+      flush_pending_commits (impl_atomic, device);
+      return TRUE;
+    }
+
+  pending_commit = pending_commit_new (&request, flags, page_flips);
+  return post_pending_commit (impl_atomic, pending_commit, error);
+
+err:
+  atomic_request_clear (&request);
+  discard_page_flips (impl, page_flips, *error);
+  return FALSE;
+}
+
+static void
+maybe_add_device (GList         **devices,
+                  MetaKmsDevice  *device)
+{
+  if (!g_list_find (*devices, device))
+    *devices = g_list_append (*devices, device);
+}
+
+static GList *
+get_update_devices (MetaKmsUpdate *update)
+{
+  GList *devices = NULL;
+  GList *l;
+
+  for (l = meta_kms_update_get_connector_properties (update); l; l = l->next)
+    {
+      MetaKmsConnectorProperty *connector_property = l->data;
+
+      maybe_add_device (&devices,
+                        meta_kms_connector_get_device (connector_property->connector));
+    }
+
+  for (l = meta_kms_update_get_mode_sets (update); l; l = l->next)
+    {
+      MetaKmsModeSet *mode_set = l->data;
+
+      maybe_add_device (&devices, meta_kms_crtc_get_device (mode_set->crtc));
+    }
+
+  for (l = meta_kms_update_get_crtc_gammas (update); l; l = l->next)
+    {
+      MetaKmsCrtcGamma *gamma = l->data;
+
+      maybe_add_device (&devices, meta_kms_crtc_get_device (gamma->crtc));
+    }
+
+  for (l = meta_kms_update_get_plane_assignments (update); l; l = l->next)
+    {
+      MetaKmsPlaneAssignment *plane_assignment = l->data;
+
+      maybe_add_device (&devices,
+                        meta_kms_plane_get_device (plane_assignment->plane));
+    }
+
+  for (l = meta_kms_update_get_page_flips (update); l; l = l->next)
+    {
+      MetaKmsPageFlip *page_flip = l->data;
+
+      maybe_add_device (&devices, meta_kms_crtc_get_device (page_flip->crtc));
+    }
+
+  return devices;
+}
+
+static MetaKmsFeedback *
+meta_kms_impl_atomic_process_update (MetaKmsImpl   *impl,
+                                     MetaKmsUpdate *update)
+{
+  MetaKmsImplAtomic *impl_atomic = META_KMS_IMPL_ATOMIC (impl);
+  g_autoptr (GList) devices = NULL;
+  GList *failed_planes = NULL;
+  GError *error = NULL;
+  GList *l;
+
+  meta_assert_in_kms_impl (meta_kms_impl_get_kms (impl));
+
+  devices = get_update_devices (update);
+  for (l = devices; l; l = l->next)
+    {
+      MetaKmsDevice *device = l->data;
+
+      if (!process_update_for_device (impl_atomic, update, device,
+                                      &failed_planes, &error))
+        break;
+    }
+
+  if (error)
+    {
+      for (l = l->next; l; l = l->next)
+        {
+          g_autoptr (GList) page_flips = NULL;
+
+          page_flips = get_device_page_flips (update, l->data);
+          discard_page_flips (impl, page_flips, error);
+        }
+
+      return meta_kms_feedback_new_failed (failed_planes, error);
+    }
+
+  if (failed_planes)
+    {
+      g_set_error (&error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to assign one or more planes");
+      return meta_kms_feedback_new_failed (failed_planes, error);
+    }
+
+  return meta_kms_feedback_new_passed ();
+}
+
+static void
+atomic_page_flip_handler (int           fd,
+                          unsigned int  sequence,
+                          unsigned int  sec,
+                          unsigned int  usec,
+                          unsigned int  crtc_id,
+                          void         *user_data)
+{
+  MetaKmsImplDevice *impl_device = user_data;
+  MetaKmsImpl *impl = meta_kms_impl_device_get_impl (impl_device);
+  MetaKmsImplAtomic *impl_atomic = META_KMS_IMPL_ATOMIC (impl);
+  MetaKmsCrtc *crtc;
+  GList *page_flip_datas;
+  GList *l;
+
+  crtc = meta_kms_impl_device_find_crtc (impl_device, crtc_id);
+  if (!crtc)
+    return;
+
+  if (g_hash_table_steal_extended (impl_atomic->page_flip_datas, crtc,
+                                   NULL, (gpointer *) &page_flip_datas))
+    {
+      for (l = page_flip_datas; l; l = l->next)
+        {
+          MetaKmsPageFlipData *page_flip_data = l->data;
+
+          meta_kms_page_flip_data_set_timings_in_impl (page_flip_data,
+                                                       sequence, sec, usec);
+          meta_kms_impl_handle_page_flip_callback (impl, page_flip_data);
+        }
+      g_list_free (page_flip_datas);
+    }
+
+  /* The CRTC is idle again, so what had to wait for it can be posted now */
+  flush_pending_commits (impl_atomic,
+                         meta_kms_impl_device_get_device (impl_device));
+}
+
+static void
+meta_kms_impl_atomic_setup_drm_event_context (MetaKmsImpl     *impl,
+                                              drmEventContext *drm_event_context)
+{
+  drm_event_context->version = 3;
+  drm_event_context->page_flip_handler = NULL;
+  drm_event_context->page_flip_handler2 = atomic_page_flip_handler;
+}
+
+static void
+meta_kms_impl_atomic_handle_page_flip_callback (MetaKmsImpl         *impl,
+                                                MetaKmsPageFlipData *page_flip_data)
+{
+  meta_kms_page_flip_data_flipped_in_impl (page_flip_data);
+  meta_kms_page_flip_data_unref (page_flip_data);
+}
+
+static void
+meta_kms_impl_atomic_discard_pending_page_flips (MetaKmsImpl *impl)
+{
+  MetaKmsImplAtomic *impl_atomic = META_KMS_IMPL_ATOMIC (impl);
+  GHashTableIter iter;
+  GQueue *pending_commits;
+
+  g_hash_table_iter_init (&iter, impl_atomic->pending_commits);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &pending_commits))
+    {
+      GList *l;
+
+      for (l = pending_commits->head; l; l = l->next)
+        {
+          PendingCommit *pending_commit = l->data;
+
+          discard_page_flips (impl, pending_commit->page_flips, NULL);
+        }
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
+static void
+meta_kms_impl_atomic_dispatch_idle (MetaKmsImpl *impl)
+{
+  MetaKmsImplAtomic *impl_atomic = META_KMS_IMPL_ATOMIC (impl);
+  g_autoptr (GList) devices = NULL;
+  GList *l;
+
+  devices = g_hash_table_get_keys (impl_atomic->pending_commits);
+  for (l = devices; l; l = l->next)
+    flush_pending_commits (impl_atomic, l->data);
+}
+
+gboolean
+meta_kms_impl_atomic_enable_device (MetaKmsImplAtomic  *impl_atomic,
+                                    MetaKmsDevice      *device,
+                                    GError            **error)
+{
+  MetaKmsImplDevice *impl_device = meta_kms_device_get_impl_device (device);
+  g_autoptr (GList) connectors = NULL;
+  g_autoptr (GList) crtcs = NULL;
+  g_autoptr (GList) planes = NULL;
+  GList *l;
+  int fd;
+  int ret;
+
+  meta_assert_in_kms_impl (meta_kms_impl_get_kms (META_KMS_IMPL (impl_atomic)));
+
+  fd = meta_kms_impl_device_get_fd (impl_device);
+  ret = drmSetClientCap (fd, DRM_CLIENT_CAP_ATOMIC, 1);
+  if (ret != 0)
+    {
+      int errsv = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                   "Failed to enable atomic modesetting on %s: %s",
+                   meta_kms_device_get_path (device),
+                   g_strerror (errsv));
+      return FALSE;
+    }
+
+  /*
+   * Atomic properties are only exposed once the client cap is set. Resolve
+   * them now, so that building a commit never has to query the kernel.
+   */
+  connectors = meta_kms_impl_device_copy_connectors (impl_device);
+  for (l = connectors; l; l = l->next)
+    {
+      ensure_object_props (impl_atomic, device, fd,
+                           meta_kms_connector_get_id (l->data),
+                           DRM_MODE_OBJECT_CONNECTOR);
+    }
+
+  crtcs = meta_kms_impl_device_copy_crtcs (impl_device);
+  for (l = crtcs; l; l = l->next)
+    {
+      ensure_object_props (impl_atomic, device, fd,
+                           meta_kms_crtc_get_id (l->data),
+                           DRM_MODE_OBJECT_CRTC);
+    }
+
+  planes = meta_kms_impl_device_copy_planes (impl_device);
+  for (l = planes; l; l = l->next)
+    {
+      ensure_object_props (impl_atomic, device, fd,
+                           meta_kms_plane_get_id (l->data),
+                           DRM_MODE_OBJECT_PLANE);
+    }
+
+  return TRUE;
+}
+
+static void
+meta_kms_impl_atomic_finalize (GObject *object)
+{
+  MetaKmsImplAtomic *impl_atomic = META_KMS_IMPL_ATOMIC (object);
+
+  g_hash_table_destroy (impl_atomic->pending_commits);
+  g_hash_table_destroy (impl_atomic->page_flip_datas);
+  g_hash_table_destroy (impl_atomic->device_props);
+
+  G_OBJECT_CLASS (meta_kms_impl_atomic_parent_class)->finalize (object);
+}
+
+static void
+meta_kms_impl_atomic_init (MetaKmsImplAtomic *impl_atomic)
+{
+  impl_atomic->device_props =
+    g_hash_table_new_full (NULL,
+                           NULL,
+                           NULL,
+                           (GDestroyNotify) g_hash_table_destroy);
+  impl_atomic->page_flip_datas =
+    g_hash_table_new_full (NULL,
+                           NULL,
+                           NULL,
+                           (GDestroyNotify) page_flip_datas_free);
+  impl_atomic->pending_commits =
+    g_hash_table_new_full (NULL,
+                           NULL,
+                           NULL,
+                           (GDestroyNotify) pending_commits_free);
+}
+
+static void
+meta_kms_impl_atomic_class_init (MetaKmsImplAtomicClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  MetaKmsImplClass *impl_class = META_KMS_IMPL_CLASS (klass);
+
+  object_class->finalize = meta_kms_impl_atomic_finalize;
+
+  impl_class->process_update = meta_kms_impl_atomic_process_update;
+  impl_class->handle_page_flip_callback = meta_kms_impl_atomic_handle_page_flip_callback;
+  impl_class->discard_pending_page_flips = meta_kms_impl_atomic_discard_pending_page_flips;
+  impl_class->dispatch_idle = meta_kms_impl_atomic_dispatch_idle;
+  impl_class->setup_drm_event_context = meta_kms_impl_atomic_setup_drm_event_context;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2020 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_KMS_IMPL_ATOMIC_H
+#define META_KMS_IMPL_ATOMIC_H
+
+#include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
+
+#define META_TYPE_KMS_IMPL_ATOMIC meta_kms_impl_atomic_get_type ()
+G_DECLARE_FINAL_TYPE (MetaKmsImplAtomic, meta_kms_impl_atomic,
+                      META, KMS_IMPL_ATOMIC, MetaKmsImpl)
+
+MetaKmsImplAtomic * meta_kms_impl_atomic_new (MetaKms  *kms,
+                                              GError  **error);
+
+gboolean meta_kms_impl_atomic_enable_device (MetaKmsImplAtomic  *impl_atomic,
+                                             MetaKmsDevice      *device,
+                                             GError            **error);
+
+META_EXPORT_TEST
+gboolean meta_kms_impl_atomic_check_plane_assignment (MetaKmsPlaneAssignment  *plane_assignment,
+                                                      GError                 **error);
+
+#endif /* META_KMS_IMPL_ATOMIC_H */
@@ -63,6 +63,29 @@ meta_kms_impl_device_get_device (MetaKmsImplDevice *impl_device)
   return impl_device->device;
 }
 
+MetaKmsImpl *
+meta_kms_impl_device_get_impl (MetaKmsImplDevice *impl_device)
+{
+  return impl_device->impl;
+}
+
+MetaKmsCrtc *
+meta_kms_impl_device_find_crtc (MetaKmsImplDevice *impl_device,
+                                uint32_t           crtc_id)
+{
+  GList *l;
+
+  for (l = impl_device->crtcs; l; l = l->next)
+    {
+      MetaKmsCrtc *crtc = l->data;
+
+      if (meta_kms_crtc_get_id (crtc) == crtc_id)
+        return crtc;
+    }
+
+  return NULL;
+}
+
 GList *
 meta_kms_impl_device_copy_connectors (MetaKmsImplDevice *impl_device)
 {
@@ -127,6 +150,8 @@ meta_kms_impl_device_dispatch (MetaKmsImplDevice  *impl_device,
   drm_event_context = (drmEventContext) { 0 };
   drm_event_context.version = 2;
   drm_event_context.page_flip_handler = page_flip_handler;
+  meta_kms_impl_setup_drm_event_context (impl_device->impl,
+                                         &drm_event_context);
 
   while (TRUE)
     {
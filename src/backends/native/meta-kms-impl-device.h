@@ -42,6 +42,11 @@ G_DECLARE_FINAL_TYPE (MetaKmsImplDevice, meta_kms_impl_device,
 
 MetaKmsDevice * meta_kms_impl_device_get_device (MetaKmsImplDevice *impl_device);
 
+MetaKmsImpl * meta_kms_impl_device_get_impl (MetaKmsImplDevice *impl_device);
+
+MetaKmsCrtc * meta_kms_impl_device_find_crtc (MetaKmsImplDevice *impl_device,
+                                              uint32_t           crtc_id);
+
 GList * meta_kms_impl_device_copy_connectors (MetaKmsImplDevice *impl_device);
 
 GList * meta_kms_impl_device_copy_crtcs (MetaKmsImplDevice *impl_device);
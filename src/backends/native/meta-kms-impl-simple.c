@@ -427,6 +427,10 @@ retry_page_flips (gpointer user_data)
 
           meta_kms_page_flip_data_discard_in_impl (page_flip_data, error);
         }
+      else
+        {
+          meta_kms_page_flip_data_set_submitted_in_impl (page_flip_data);
+        }
 
       retry_page_flip_data_free (retry_page_flip_data);
 
@@ -677,7 +681,9 @@ process_page_flip (MetaKmsImpl    *impl,
                              meta_kms_page_flip_data_ref (page_flip_data));
     }
 
-  if (ret != 0)
+  if (ret == 0)
+    meta_kms_page_flip_data_set_submitted_in_impl (page_flip_data);
+  else
     meta_kms_page_flip_data_unref (page_flip_data);
 
   if (ret == -EBUSY)
@@ -796,13 +802,21 @@ process_cursor_plane_assignment (MetaKmsImpl             *impl,
       int width, height;
       int ret = -1;
 
+      /* The legacy cursor API takes the GEM handle, not the framebuffer */
+      if (plane_assignment->fb_id && !plane_assignment->cursor_bo_handle)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                       "Cursor plane assignment without a buffer handle");
+          return FALSE;
+        }
+
       width = meta_fixed_16_to_int (plane_assignment->dst_rect.width);
       height = meta_fixed_16_to_int (plane_assignment->dst_rect.height);
 
       if (plane_assignment->cursor_hotspot.is_valid)
         {
           ret = drmModeSetCursor2 (fd, meta_kms_crtc_get_id (plane_assignment->crtc),
-                                   plane_assignment->fb_id,
+                                   plane_assignment->cursor_bo_handle,
                                    width, height,
                                    plane_assignment->cursor_hotspot.x,
                                    plane_assignment->cursor_hotspot.y);
@@ -811,7 +825,7 @@ process_cursor_plane_assignment (MetaKmsImpl             *impl,
       if (ret != 0)
         {
           ret = drmModeSetCursor (fd, meta_kms_crtc_get_id (plane_assignment->crtc),
-                                  plane_assignment->fb_id,
+                                  plane_assignment->cursor_bo_handle,
                                   width, height);
         }
 
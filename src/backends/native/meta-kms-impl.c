@@ -75,7 +75,20 @@ void
 meta_kms_impl_notify_device_created (MetaKmsImpl   *impl,
                                      MetaKmsDevice *device)
 {
-  META_KMS_IMPL_GET_CLASS (impl)->notify_device_created (impl, device);
+  MetaKmsImplClass *klass = META_KMS_IMPL_GET_CLASS (impl);
+
+  if (klass->notify_device_created)
+    klass->notify_device_created (impl, device);
+}
+
+void
+meta_kms_impl_setup_drm_event_context (MetaKmsImpl     *impl,
+                                       drmEventContext *drm_event_context)
+{
+  MetaKmsImplClass *klass = META_KMS_IMPL_GET_CLASS (impl);
+
+  if (klass->setup_drm_event_context)
+    klass->setup_drm_event_context (impl, drm_event_context);
 }
 
 static void
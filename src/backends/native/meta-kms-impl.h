@@ -21,6 +21,8 @@
 #ifndef META_KMS_IMPL_H
 #define META_KMS_IMPL_H
 
+#include <xf86drm.h>
+
 #include "backends/native/meta-kms-impl-device.h"
 #include "backends/native/meta-kms-page-flip-private.h"
 #include "backends/native/meta-kms.h"
@@ -41,6 +43,8 @@ struct _MetaKmsImplClass
   void (* dispatch_idle) (MetaKmsImpl *impl);
   void (* notify_device_created) (MetaKmsImpl   *impl,
                                   MetaKmsDevice *impl_device);
+  void (* setup_drm_event_context) (MetaKmsImpl     *impl,
+                                    drmEventContext *drm_event_context);
 };
 
 MetaKms * meta_kms_impl_get_kms (MetaKmsImpl *impl);
@@ -58,4 +62,7 @@ void meta_kms_impl_dispatch_idle (MetaKmsImpl *impl);
 void meta_kms_impl_notify_device_created (MetaKmsImpl   *impl,
                                           MetaKmsDevice *impl_device);
 
+void meta_kms_impl_setup_drm_event_context (MetaKmsImpl     *impl,
+                                            drmEventContext *drm_event_context);
+
 #endif /* META_KMS_IMPL_H */
@@ -44,6 +44,8 @@ void meta_kms_page_flip_data_set_timings_in_impl (MetaKmsPageFlipData *page_flip
                                                   unsigned int         sec,
                                                   unsigned int         usec);
 
+void meta_kms_page_flip_data_set_submitted_in_impl (MetaKmsPageFlipData *page_flip_data);
+
 void meta_kms_page_flip_data_flipped_in_impl (MetaKmsPageFlipData *page_flip_data);
 
 void meta_kms_page_flip_data_mode_set_fallback_in_impl (MetaKmsPageFlipData *page_flip_data);
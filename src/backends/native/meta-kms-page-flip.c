@@ -27,7 +27,7 @@
 
 struct _MetaKmsPageFlipData
 {
-  int ref_count;
+  gatomicrefcount ref_count;
 
   MetaKmsImpl *impl;
   MetaKmsCrtc *crtc;
@@ -39,6 +39,8 @@ struct _MetaKmsPageFlipData
   unsigned int sec;
   unsigned int usec;
 
+  int64_t submitted_time_us;
+
   GError *error;
 };
 
@@ -52,12 +54,12 @@ meta_kms_page_flip_data_new (MetaKmsImpl                   *impl,
 
   page_flip_data = g_new0 (MetaKmsPageFlipData , 1);
   *page_flip_data = (MetaKmsPageFlipData) {
-    .ref_count = 1,
     .impl = impl,
     .crtc = crtc,
     .feedback = feedback,
     .user_data = user_data,
   };
+  g_atomic_ref_count_init (&page_flip_data->ref_count);
 
   return page_flip_data;
 }
@@ -65,7 +67,7 @@ meta_kms_page_flip_data_new (MetaKmsImpl                   *impl,
 MetaKmsPageFlipData *
 meta_kms_page_flip_data_ref (MetaKmsPageFlipData *page_flip_data)
 {
-  page_flip_data->ref_count++;
+  g_atomic_ref_count_inc (&page_flip_data->ref_count);
 
   return page_flip_data;
 }
@@ -73,9 +75,7 @@ meta_kms_page_flip_data_ref (MetaKmsPageFlipData *page_flip_data)
 void
 meta_kms_page_flip_data_unref (MetaKmsPageFlipData *page_flip_data)
 {
-  page_flip_data->ref_count--;
-
-  if (page_flip_data->ref_count == 0)
+  if (g_atomic_ref_count_dec (&page_flip_data->ref_count))
     {
       g_clear_error (&page_flip_data->error);
       g_free (page_flip_data);
@@ -100,6 +100,7 @@ meta_kms_page_flip_data_flipped (MetaKms  *kms,
                                      page_flip_data->sequence,
                                      page_flip_data->sec,
                                      page_flip_data->usec,
+                                     page_flip_data->submitted_time_us,
                                      page_flip_data->user_data);
 }
 
@@ -118,6 +119,16 @@ meta_kms_page_flip_data_set_timings_in_impl (MetaKmsPageFlipData *page_flip_data
   page_flip_data->usec = usec;
 }
 
+void
+meta_kms_page_flip_data_set_submitted_in_impl (MetaKmsPageFlipData *page_flip_data)
+{
+  MetaKms *kms = meta_kms_impl_get_kms (page_flip_data->impl);
+
+  meta_assert_in_kms_impl (kms);
+
+  page_flip_data->submitted_time_us = g_get_monotonic_time ();
+}
+
 void
 meta_kms_page_flip_data_flipped_in_impl (MetaKmsPageFlipData *page_flip_data)
 {
@@ -45,6 +45,9 @@ struct _MetaKmsPlane
   uint32_t rotation_map[META_MONITOR_N_TRANSFORMS];
   uint32_t all_hw_transforms;
 
+  gboolean has_zpos;
+  uint64_t zpos;
+
   /*
    * primary plane's supported formats and maybe modifiers
    * key: GUINT_TO_POINTER (format)
@@ -155,6 +158,40 @@ meta_kms_plane_is_format_supported (MetaKmsPlane *plane,
                                        NULL, NULL);
 }
 
+static int
+get_default_stacking (MetaKmsPlaneType type)
+{
+  switch (type)
+    {
+    case META_KMS_PLANE_TYPE_PRIMARY:
+      return 0;
+    case META_KMS_PLANE_TYPE_OVERLAY:
+      return 1;
+    case META_KMS_PLANE_TYPE_CURSOR:
+      return 2;
+    }
+
+  g_assert_not_reached ();
+}
+
+/*
+ * Returns TRUE if @plane is known to be stacked above @other_plane. Without
+ * zpos properties, the primary plane is expected at the bottom and the
+ * cursor plane at the top, as on most drivers.
+ */
+gboolean
+meta_kms_plane_is_stacked_above (MetaKmsPlane *plane,
+                                 MetaKmsPlane *other_plane)
+{
+  if (plane->has_zpos && other_plane->has_zpos)
+    return plane->zpos > other_plane->zpos;
+  else if (plane->has_zpos || other_plane->has_zpos)
+    return FALSE;
+
+  return (get_default_stacking (plane->type) >
+          get_default_stacking (other_plane->type));
+}
+
 gboolean
 meta_kms_plane_is_usable_with (MetaKmsPlane *plane,
                                MetaKmsCrtc  *crtc)
@@ -208,6 +245,24 @@ init_rotations (MetaKmsPlane            *plane,
     }
 }
 
+static void
+init_zpos (MetaKmsPlane            *plane,
+           MetaKmsImplDevice       *impl_device,
+           drmModeObjectProperties *drm_plane_props)
+{
+  drmModePropertyPtr prop;
+  int idx;
+
+  prop = meta_kms_impl_device_find_property (impl_device, drm_plane_props,
+                                             "zpos", &idx);
+  if (prop)
+    {
+      plane->has_zpos = TRUE;
+      plane->zpos = drm_plane_props->prop_values[idx];
+      drmModeFreeProperty (prop);
+    }
+}
+
 static inline uint32_t *
 drm_formats_ptr (struct drm_format_modifier_blob *blob)
 {
@@ -378,6 +433,7 @@ meta_kms_plane_new (MetaKmsPlaneType         type,
   plane->device = meta_kms_impl_device_get_device (impl_device);
 
   init_rotations (plane, impl_device, drm_plane_props);
+  init_zpos (plane, impl_device, drm_plane_props);
   init_formats (plane, impl_device, drm_plane, drm_plane_props);
 
   return plane;
@@ -55,6 +55,9 @@ GArray * meta_kms_plane_copy_drm_format_list (MetaKmsPlane *plane);
 gboolean meta_kms_plane_is_format_supported (MetaKmsPlane *plane,
                                              uint32_t      format);
 
+gboolean meta_kms_plane_is_stacked_above (MetaKmsPlane *plane,
+                                          MetaKmsPlane *other_plane);
+
 gboolean meta_kms_plane_is_usable_with (MetaKmsPlane *plane,
                                         MetaKmsCrtc  *crtc);
 
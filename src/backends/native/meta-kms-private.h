@@ -51,10 +51,17 @@ GSource * meta_kms_register_fd_in_impl (MetaKms             *kms,
                                         MetaKmsImplTaskFunc  dispatch,
                                         gpointer             user_data);
 
+void meta_kms_run_impl_task_async (MetaKms             *kms,
+                                   MetaKmsImplTaskFunc  func,
+                                   gpointer             user_data,
+                                   GDestroyNotify       user_data_destroy);
+
 gboolean meta_kms_in_impl_task (MetaKms *kms);
 
 gboolean meta_kms_is_waiting_for_impl_task (MetaKms *kms);
 
+gboolean meta_kms_is_impl_threaded (MetaKms *kms);
+
 #define meta_assert_in_kms_impl(kms) \
   g_assert (meta_kms_in_impl_task (kms))
 #define meta_assert_not_in_kms_impl(kms) \
@@ -37,6 +37,8 @@ typedef struct _MetaKmsFeedback MetaKmsFeedback;
 
 typedef struct _MetaKmsPageFlipFeedback MetaKmsPageFlipFeedback;
 
+typedef struct _MetaKmsCursorManager MetaKmsCursorManager;
+
 typedef struct _MetaKmsImpl MetaKmsImpl;
 typedef struct _MetaKmsImplDevice MetaKmsImplDevice;
 
@@ -57,6 +57,9 @@ typedef struct _MetaKmsPlaneAssignment
     int x;
     int y;
   } cursor_hotspot;
+
+  /* GEM handle of the cursor buffer, only used by drmModeSetCursor2 () */
+  uint32_t cursor_bo_handle;
 } MetaKmsPlaneAssignment;
 
 typedef struct _MetaKmsModeSet
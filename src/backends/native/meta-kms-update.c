@@ -352,6 +352,13 @@ meta_kms_plane_assignment_set_cursor_hotspot (MetaKmsPlaneAssignment *plane_assi
   plane_assignment->cursor_hotspot.y = y;
 }
 
+void
+meta_kms_plane_assignment_set_cursor_bo_handle (MetaKmsPlaneAssignment *plane_assignment,
+                                                uint32_t                bo_handle)
+{
+  plane_assignment->cursor_bo_handle = bo_handle;
+}
+
 MetaKmsPlaneAssignment *
 meta_kms_update_get_primary_plane_assignment (MetaKmsUpdate *update,
                                               MetaKmsCrtc   *crtc)
@@ -27,6 +27,7 @@
 
 #include "backends/meta-monitor-transform.h"
 #include "backends/native/meta-kms-types.h"
+#include "core/util-private.h"
 #include "meta/boxes.h"
 
 typedef enum _MetaKmsFeedbackResult
@@ -53,6 +54,7 @@ struct _MetaKmsPageFlipFeedback
                     unsigned int  sequence,
                     unsigned int  tv_sec,
                     unsigned int  tv_usec,
+                    int64_t       submitted_time_us,
                     gpointer      user_data);
 
   void (* mode_set_fallback) (MetaKmsCrtc *crtc,
@@ -81,8 +83,10 @@ GList * meta_kms_feedback_get_failed_planes (MetaKmsFeedback *feedback);
 
 const GError * meta_kms_feedback_get_error (MetaKmsFeedback *feedback);
 
+META_EXPORT_TEST
 MetaKmsUpdate * meta_kms_update_new (void);
 
+META_EXPORT_TEST
 void meta_kms_update_free (MetaKmsUpdate *update);
 
 void meta_kms_update_mode_set (MetaKmsUpdate         *update,
@@ -90,6 +94,7 @@ void meta_kms_update_mode_set (MetaKmsUpdate         *update,
                                GList                 *connectors,
                                const drmModeModeInfo *drm_mode);
 
+META_EXPORT_TEST
 MetaKmsPlaneAssignment * meta_kms_update_assign_plane (MetaKmsUpdate          *update,
                                                        MetaKmsCrtc            *crtc,
                                                        MetaKmsPlane           *plane,
@@ -98,6 +103,7 @@ MetaKmsPlaneAssignment * meta_kms_update_assign_plane (MetaKmsUpdate          *u
                                                        MetaFixed16Rectangle    dst_rect,
                                                        MetaKmsAssignPlaneFlag  flags);
 
+META_EXPORT_TEST
 MetaKmsPlaneAssignment * meta_kms_update_unassign_plane (MetaKmsUpdate *update,
                                                          MetaKmsCrtc   *crtc,
                                                          MetaKmsPlane  *plane);
@@ -119,6 +125,10 @@ void meta_kms_plane_assignment_set_cursor_hotspot (MetaKmsPlaneAssignment *plane
                                                    int                     x,
                                                    int                     y);
 
+META_EXPORT_TEST
+void meta_kms_plane_assignment_set_cursor_bo_handle (MetaKmsPlaneAssignment *plane_assignment,
+                                                     uint32_t                bo_handle);
+
 static inline MetaFixed16
 meta_fixed_16_from_int (int16_t d)
 {
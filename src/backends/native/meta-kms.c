@@ -22,9 +22,14 @@
 
 #include "backends/native/meta-kms-private.h"
 
+#include <pthread.h>
+#include <sched.h>
+
 #include "backends/native/meta-backend-native.h"
 #include "backends/native/meta-kms-device-private.h"
 #include "backends/native/meta-kms-impl.h"
+#include "backends/native/meta-kms-cursor-manager.h"
+#include "backends/native/meta-kms-impl-atomic.h"
 #include "backends/native/meta-kms-impl-simple.h"
 #include "backends/native/meta-kms-update-private.h"
 #include "backends/native/meta-udev.h"
@@ -44,9 +49,16 @@
  * runs in. It uses the main GLib main loop and main context and always runs in
  * the main thread.
  *
- * The impl context is where all underlying API is being executed. While in the
- * current state, it always runs in the main thread, the aim is to be able to
- * execute the impl context in a dedicated thread.
+ * The impl context is where all underlying API is being executed. By default
+ * it runs in the main thread, but it can be executed in a dedicated thread
+ * with its own GMainContext by setting the environment variable
+ * MUTTER_DEBUG_ENABLE_KMS_THREAD=1. In that case page flip events are
+ * dispatched in the KMS thread, so that a busy main thread doesn't delay them,
+ * and impl tasks posted from the main context are run synchronously in the KMS
+ * thread. Updates posted with meta_kms_post_pending_update(), such as page
+ * flips and cursor updates, are handed over to the KMS thread through a
+ * lock-free stack, without waiting for them to be processed; their feedback is
+ * passed back to the main context later. The KMS thread is given real-time scheduling priority if permitted.
  *
  * The public facing MetaKms API is always assumed to be executed from the main
  * context.
@@ -98,7 +110,7 @@
  *
  * The KMS backend implementation, running in the impl context. #MetaKmsImpl
  * itself is an abstract object, with potentially multiple implementations.
- * Currently only #MetaKmsImplSimple exists.
+ * Currently #MetaKmsImplSimple and #MetaKmsImplAtomic exist.
  *
  * #MetaKmsImplSimple:
  *
@@ -106,6 +118,16 @@
  * interacted with using the transactional API, the #MetaKmsUpdate is processed
  * non-atomically.
  *
+ * #MetaKmsImplAtomic:
+ *
+ * A KMS backend implementation using the atomic modesetting API. Each
+ * #MetaKmsUpdate is turned into one atomic commit per device, covering mode
+ * sets, connector properties, gamma and all plane assignments, after first
+ * being validated with a test-only commit. It is currently opt-in, enabled by
+ * setting the environment variable MUTTER_DEBUG_ENABLE_ATOMIC_KMS=1. If the
+ * atomic client capability can't be enabled on the first device, the
+ * #MetaKmsImplSimple is used instead.
+ *
  * #MetaKmsImplDevice:
  *
  * An object linked to a #MetaKmsDevice, but where it is executed in the impl
@@ -136,12 +158,55 @@ typedef struct _MetaKmsCallbackData
   GDestroyNotify user_data_destroy;
 } MetaKmsCallbackData;
 
+typedef struct _MetaKmsImplTask
+{
+  MetaKms *kms;
+
+  MetaKmsImplTaskFunc func;
+  gpointer user_data;
+  GError **error;
+
+  gpointer retval;
+  gboolean is_done;
+} MetaKmsImplTask;
+
+typedef struct _MetaKmsImplAsyncTask
+{
+  MetaKms *kms;
+
+  MetaKmsImplTaskFunc func;
+  gpointer user_data;
+  GDestroyNotify user_data_destroy;
+} MetaKmsImplAsyncTask;
+
+typedef struct _MetaKmsPostUpdateData MetaKmsPostUpdateData;
+
+struct _MetaKmsPostUpdateData
+{
+  MetaKmsPostUpdateData *next;
+
+  MetaKms *kms;
+
+  MetaKmsUpdate *update;
+  MetaKmsFeedback *feedback;
+
+  MetaKmsFeedbackFunc feedback_func;
+  gpointer user_data;
+  GDestroyNotify user_data_destroy;
+};
+
 typedef struct _MetaKmsSimpleImplSource
 {
   GSource source;
   MetaKms *kms;
 } MetaKmsSimpleImplSource;
 
+typedef struct _MetaKmsPostedUpdateSource
+{
+  GSource source;
+  MetaKms *kms;
+} MetaKmsPostedUpdateSource;
+
 typedef struct _MetaKmsFdImplSource
 {
   GSource source;
@@ -164,12 +229,30 @@ struct _MetaKms
 
   MetaKmsImpl *impl;
   gboolean in_impl_task;
-  gboolean waiting_for_impl_task;
+  /* Read from the impl thread, so only accessed atomically */
+  int waiting_for_impl_task;
+
+  GThread *impl_thread;
+  GMainContext *impl_main_context;
+  GMainLoop *impl_main_loop;
+
+  GMutex impl_task_mutex;
+  GCond impl_task_cond;
+
+  /*
+   * Stack of MetaKmsPostUpdateData posted to the impl thread, last in first;
+   * only accessed atomically.
+   */
+  gpointer posted_updates;
+  GSource *posted_update_source;
 
   GList *devices;
 
   MetaKmsUpdate *pending_update;
 
+  MetaKmsCursorManager *cursor_manager;
+
+  GMutex callbacks_mutex;
   GList *pending_callbacks;
   guint callback_source_id;
 };
@@ -202,6 +285,10 @@ meta_kms_predict_states_in_impl (MetaKms       *kms,
                   update);
 }
 
+/*
+ * Only used for updates posted synchronously; the main context is blocked
+ * waiting for the task, so it can't read the states while they are predicted.
+ */
 static gpointer
 meta_kms_process_update_in_impl (MetaKmsImpl  *impl,
                                  gpointer      user_data,
@@ -238,6 +325,245 @@ meta_kms_post_pending_update_sync (MetaKms *kms)
                                     g_steal_pointer (&kms->pending_update));
 }
 
+static void
+post_update_data_free (MetaKmsPostUpdateData *data)
+{
+  g_clear_pointer (&data->update, meta_kms_update_free);
+  g_clear_pointer (&data->feedback, meta_kms_feedback_free);
+  if (data->user_data_destroy)
+    data->user_data_destroy (data->user_data);
+  g_free (data);
+}
+
+static void
+invoke_post_update_feedback (MetaKms  *kms,
+                             gpointer  user_data)
+{
+  MetaKmsPostUpdateData *data = user_data;
+
+  data->feedback_func (data->feedback, data->user_data);
+}
+
+static void
+process_posted_update_in_thread (MetaKmsPostUpdateData *data)
+{
+  MetaKms *kms = data->kms;
+
+  /*
+   * The states are not predicted here, as the main context may be reading
+   * them meanwhile. Nothing would change anyway: states are only predicted
+   * from mode sets and gamma, which are never posted asynchronously.
+   */
+  data->feedback = meta_kms_impl_process_update (kms->impl, data->update);
+  g_clear_pointer (&data->update, meta_kms_update_free);
+
+  meta_kms_queue_callback (kms,
+                           invoke_post_update_feedback,
+                           data,
+                           (GDestroyNotify) post_update_data_free);
+}
+
+static MetaKmsPostUpdateData *
+take_posted_updates (MetaKms *kms)
+{
+  MetaKmsPostUpdateData *data;
+  MetaKmsPostUpdateData *posted_updates = NULL;
+
+  do
+    data = g_atomic_pointer_get (&kms->posted_updates);
+  while (!g_atomic_pointer_compare_and_exchange (&kms->posted_updates,
+                                                 data, NULL));
+
+  /* The stack is last in, first out; reverse it into posting order */
+  while (data)
+    {
+      MetaKmsPostUpdateData *next = data->next;
+
+      data->next = posted_updates;
+      posted_updates = data;
+      data = next;
+    }
+
+  return posted_updates;
+}
+
+static gboolean
+posted_update_source_prepare (GSource *source,
+                              int     *timeout)
+{
+  MetaKmsPostedUpdateSource *posted_update_source =
+    (MetaKmsPostedUpdateSource *) source;
+
+  *timeout = -1;
+
+  return g_atomic_pointer_get (&posted_update_source->kms->posted_updates) != NULL;
+}
+
+static gboolean
+posted_update_source_check (GSource *source)
+{
+  MetaKmsPostedUpdateSource *posted_update_source =
+    (MetaKmsPostedUpdateSource *) source;
+
+  return g_atomic_pointer_get (&posted_update_source->kms->posted_updates) != NULL;
+}
+
+static gboolean
+posted_update_source_dispatch (GSource     *source,
+                               GSourceFunc  callback,
+                               gpointer     user_data)
+{
+  MetaKmsPostedUpdateSource *posted_update_source =
+    (MetaKmsPostedUpdateSource *) source;
+  MetaKmsPostUpdateData *data;
+
+  data = take_posted_updates (posted_update_source->kms);
+  while (data)
+    {
+      MetaKmsPostUpdateData *next = data->next;
+
+      process_posted_update_in_thread (data);
+      data = next;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs posted_update_source_funcs = {
+  .prepare = posted_update_source_prepare,
+  .check = posted_update_source_check,
+  .dispatch = posted_update_source_dispatch,
+};
+
+static GSource *
+create_posted_update_source (MetaKms *kms)
+{
+  GSource *source;
+  MetaKmsPostedUpdateSource *posted_update_source;
+
+  source = g_source_new (&posted_update_source_funcs,
+                         sizeof (MetaKmsPostedUpdateSource));
+  posted_update_source = (MetaKmsPostedUpdateSource *) source;
+  posted_update_source->kms = kms;
+
+  g_source_set_name (source, "[mutter] KMS posted updates");
+  g_source_set_priority (source, G_PRIORITY_HIGH);
+  g_source_attach (source, kms->impl_main_context);
+
+  return source;
+}
+
+/*
+ * Hands the update over to the impl thread without taking any lock; the impl
+ * context only needs waking up when the stack was empty, as it takes all
+ * posted updates at once otherwise.
+ */
+static void
+post_update_to_thread (MetaKms               *kms,
+                       MetaKmsPostUpdateData *data)
+{
+  do
+    data->next = g_atomic_pointer_get (&kms->posted_updates);
+  while (!g_atomic_pointer_compare_and_exchange (&kms->posted_updates,
+                                                 data->next,
+                                                 data));
+
+  if (!data->next)
+    g_main_context_wakeup (kms->impl_main_context);
+}
+
+static gboolean
+has_custom_page_flips (MetaKmsUpdate *update)
+{
+  GList *l;
+
+  for (l = meta_kms_update_get_page_flips (update); l; l = l->next)
+    {
+      MetaKmsPageFlip *page_flip = l->data;
+
+      if (page_flip->custom_page_flip_func)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+can_post_update_async (MetaKms       *kms,
+                       MetaKmsUpdate *update)
+{
+  if (!kms->impl_thread)
+    return FALSE;
+
+  /*
+   * Custom page flips acquire EGLStream frames via the EGL context of the
+   * main context, which must not be used from another thread.
+   */
+  if (has_custom_page_flips (update))
+    return FALSE;
+
+  /*
+   * Processing these updates changes the states of the KMS objects, which
+   * are read from the main context, so the main context must wait for it.
+   */
+  return (!meta_kms_update_get_mode_sets (update) &&
+          !meta_kms_update_get_crtc_gammas (update) &&
+          !meta_kms_update_get_connector_properties (update));
+}
+
+/**
+ * meta_kms_post_pending_update:
+ * @kms: A #MetaKms
+ * @feedback_func: Function called with the feedback of the update
+ * @user_data: User data passed to @feedback_func
+ * @user_data_destroy: Destroy notify for @user_data
+ *
+ * Posts the pending update without waiting for it to be processed if the
+ * impl context runs in a dedicated thread. @feedback_func is called from the
+ * main context once the update has been processed, which may be before this
+ * function returns.
+ */
+void
+meta_kms_post_pending_update (MetaKms             *kms,
+                              MetaKmsFeedbackFunc  feedback_func,
+                              gpointer             user_data,
+                              GDestroyNotify       user_data_destroy)
+{
+  MetaKmsUpdate *update = g_steal_pointer (&kms->pending_update);
+  MetaKmsPostUpdateData *data;
+
+  if (!update)
+    {
+      if (user_data_destroy)
+        user_data_destroy (user_data);
+      return;
+    }
+
+  if (!can_post_update_async (kms, update))
+    {
+      g_autoptr (MetaKmsFeedback) feedback = NULL;
+
+      feedback = meta_kms_post_update_sync (kms, update);
+      feedback_func (feedback, user_data);
+      if (user_data_destroy)
+        user_data_destroy (user_data);
+      return;
+    }
+
+  meta_kms_update_seal (update);
+
+  data = g_new0 (MetaKmsPostUpdateData, 1);
+  *data = (MetaKmsPostUpdateData) {
+    .kms = kms,
+    .update = update,
+    .feedback_func = feedback_func,
+    .user_data = user_data,
+    .user_data_destroy = user_data_destroy,
+  };
+
+  post_update_to_thread (kms, data);
+}
+
 static gpointer
 meta_kms_discard_pending_page_flips_in_impl (MetaKmsImpl  *impl,
                                              gpointer      user_data,
@@ -267,12 +593,18 @@ meta_kms_callback_data_free (MetaKmsCallbackData *callback_data)
 static int
 flush_callbacks (MetaKms *kms)
 {
+  GList *callbacks;
   GList *l;
   int callback_count = 0;
 
   meta_assert_not_in_kms_impl (kms);
 
-  for (l = kms->pending_callbacks; l; l = l->next)
+  g_mutex_lock (&kms->callbacks_mutex);
+  callbacks = g_steal_pointer (&kms->pending_callbacks);
+  kms->callback_source_id = 0;
+  g_mutex_unlock (&kms->callbacks_mutex);
+
+  for (l = callbacks; l; l = l->next)
     {
       MetaKmsCallbackData *callback_data = l->data;
 
@@ -281,8 +613,7 @@ flush_callbacks (MetaKms *kms)
       callback_count++;
     }
 
-  g_list_free (kms->pending_callbacks);
-  kms->pending_callbacks = NULL;
+  g_list_free (callbacks);
 
   return callback_count;
 }
@@ -294,7 +625,6 @@ callback_idle (gpointer user_data)
 
   flush_callbacks (kms);
 
-  kms->callback_source_id = 0;
   return G_SOURCE_REMOVE;
 }
 
@@ -312,10 +642,127 @@ meta_kms_queue_callback (MetaKms         *kms,
     .user_data = user_data,
     .user_data_destroy = user_data_destroy,
   };
+
+  g_mutex_lock (&kms->callbacks_mutex);
   kms->pending_callbacks = g_list_append (kms->pending_callbacks,
                                           callback_data);
   if (!kms->callback_source_id)
-    kms->callback_source_id = g_idle_add (callback_idle, kms);
+    {
+      GSource *source;
+
+      /*
+       * When queued from the KMS thread, e.g. page flip feedback, the
+       * callbacks are dispatched ahead of other work of the main context.
+       */
+      source = g_idle_source_new ();
+      if (kms->impl_thread)
+        g_source_set_priority (source, G_PRIORITY_HIGH);
+      g_source_set_callback (source, callback_idle, kms, NULL);
+      kms->callback_source_id = g_source_attach (source, NULL);
+      g_source_unref (source);
+    }
+  g_mutex_unlock (&kms->callbacks_mutex);
+}
+
+static gboolean
+impl_task_dispatch_in_thread (gpointer user_data)
+{
+  MetaKmsImplTask *task = user_data;
+  MetaKms *kms = task->kms;
+  gpointer retval;
+
+  retval = task->func (kms->impl, task->user_data, task->error);
+
+  g_mutex_lock (&kms->impl_task_mutex);
+  task->retval = retval;
+  task->is_done = TRUE;
+  g_cond_broadcast (&kms->impl_task_cond);
+  g_mutex_unlock (&kms->impl_task_mutex);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+run_impl_task_sync_in_thread (MetaKms             *kms,
+                              MetaKmsImplTaskFunc  func,
+                              gpointer             user_data,
+                              GError             **error)
+{
+  MetaKmsImplTask task;
+
+  task = (MetaKmsImplTask) {
+    .kms = kms,
+    .func = func,
+    .user_data = user_data,
+    .error = error,
+  };
+
+  g_atomic_int_set (&kms->waiting_for_impl_task, TRUE);
+
+  g_main_context_invoke_full (kms->impl_main_context,
+                              G_PRIORITY_HIGH,
+                              impl_task_dispatch_in_thread,
+                              &task,
+                              NULL);
+
+  g_mutex_lock (&kms->impl_task_mutex);
+  while (!task.is_done)
+    g_cond_wait (&kms->impl_task_cond, &kms->impl_task_mutex);
+  g_mutex_unlock (&kms->impl_task_mutex);
+
+  g_atomic_int_set (&kms->waiting_for_impl_task, FALSE);
+
+  return task.retval;
+}
+
+static gboolean
+impl_async_task_dispatch_in_thread (gpointer user_data)
+{
+  MetaKmsImplAsyncTask *task = user_data;
+  MetaKms *kms = task->kms;
+  g_autoptr (GError) error = NULL;
+
+  if (!task->func (kms->impl, task->user_data, &error) && error)
+    g_warning ("Failed to run KMS impl task: %s", error->message);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+impl_async_task_free (MetaKmsImplAsyncTask *task)
+{
+  if (task->user_data_destroy)
+    task->user_data_destroy (task->user_data);
+  g_free (task);
+}
+
+/*
+ * Runs @func in the impl thread without waiting for it; only valid when the
+ * impl context runs in a dedicated thread.
+ */
+void
+meta_kms_run_impl_task_async (MetaKms             *kms,
+                              MetaKmsImplTaskFunc  func,
+                              gpointer             user_data,
+                              GDestroyNotify       user_data_destroy)
+{
+  MetaKmsImplAsyncTask *task;
+
+  g_return_if_fail (kms->impl_thread);
+
+  task = g_new0 (MetaKmsImplAsyncTask, 1);
+  *task = (MetaKmsImplAsyncTask) {
+    .kms = kms,
+    .func = func,
+    .user_data = user_data,
+    .user_data_destroy = user_data_destroy,
+  };
+
+  g_main_context_invoke_full (kms->impl_main_context,
+                              G_PRIORITY_HIGH,
+                              impl_async_task_dispatch_in_thread,
+                              task,
+                              (GDestroyNotify) impl_async_task_free);
 }
 
 gpointer
@@ -326,10 +773,18 @@ meta_kms_run_impl_task_sync (MetaKms              *kms,
 {
   gpointer ret;
 
+  if (kms->impl_thread)
+    {
+      if (meta_kms_in_impl_task (kms))
+        return func (kms->impl, user_data, error);
+      else
+        return run_impl_task_sync_in_thread (kms, func, user_data, error);
+    }
+
   kms->in_impl_task = TRUE;
-  kms->waiting_for_impl_task = TRUE;
+  g_atomic_int_set (&kms->waiting_for_impl_task, TRUE);
   ret = func (kms->impl, user_data, error);
-  kms->waiting_for_impl_task = FALSE;
+  g_atomic_int_set (&kms->waiting_for_impl_task, FALSE);
   kms->in_impl_task = FALSE;
 
   return ret;
@@ -445,13 +900,22 @@ meta_kms_register_fd_in_impl (MetaKms             *kms,
 gboolean
 meta_kms_in_impl_task (MetaKms *kms)
 {
+  if (kms->impl_thread)
+    return g_thread_self () == kms->impl_thread;
+
   return kms->in_impl_task;
 }
 
 gboolean
 meta_kms_is_waiting_for_impl_task (MetaKms *kms)
 {
-  return kms->waiting_for_impl_task;
+  return g_atomic_int_get (&kms->waiting_for_impl_task);
+}
+
+gboolean
+meta_kms_is_impl_threaded (MetaKms *kms)
+{
+  return !!kms->impl_thread;
 }
 
 static void
@@ -521,6 +985,18 @@ meta_kms_get_backend (MetaKms *kms)
   return kms->backend;
 }
 
+gboolean
+meta_kms_is_atomic (MetaKms *kms)
+{
+  return META_IS_KMS_IMPL_ATOMIC (kms->impl);
+}
+
+MetaKmsCursorManager *
+meta_kms_get_cursor_manager (MetaKms *kms)
+{
+  return kms->cursor_manager;
+}
+
 static gpointer
 notify_device_created_in_impl (MetaKmsImpl  *impl,
                                gpointer      user_data,
@@ -533,6 +1009,37 @@ notify_device_created_in_impl (MetaKmsImpl  *impl,
   return GINT_TO_POINTER (TRUE);
 }
 
+static gpointer
+enable_atomic_device_in_impl (MetaKmsImpl  *impl,
+                              gpointer      user_data,
+                              GError      **error)
+{
+  MetaKmsDevice *device = user_data;
+  gboolean ret;
+
+  ret = meta_kms_impl_atomic_enable_device (META_KMS_IMPL_ATOMIC (impl),
+                                            device, error);
+  return GINT_TO_POINTER (ret);
+}
+
+static gpointer
+fall_back_to_simple_impl_in_impl (MetaKmsImpl  *impl,
+                                  gpointer      user_data,
+                                  GError      **error)
+{
+  MetaKms *kms = meta_kms_impl_get_kms (impl);
+  MetaKmsImplSimple *impl_simple;
+
+  impl_simple = meta_kms_impl_simple_new (kms, error);
+  if (!impl_simple)
+    return GINT_TO_POINTER (FALSE);
+
+  g_object_unref (kms->impl);
+  kms->impl = META_KMS_IMPL (impl_simple);
+
+  return GINT_TO_POINTER (TRUE);
+}
+
 MetaKmsDevice *
 meta_kms_create_device (MetaKms            *kms,
                         const char         *path,
@@ -545,6 +1052,39 @@ meta_kms_create_device (MetaKms            *kms,
   if (!device)
     return NULL;
 
+  if (META_IS_KMS_IMPL_ATOMIC (kms->impl))
+    {
+      g_autoptr (GError) atomic_error = NULL;
+
+      if (!meta_kms_run_impl_task_sync (kms, enable_atomic_device_in_impl,
+                                        device, &atomic_error))
+        {
+          g_object_unref (device);
+
+          /*
+           * Atomic and non-atomic devices can't be mixed, so only the first
+           * device can make everything fall back to the simple impl.
+           */
+          if (kms->devices)
+            {
+              g_propagate_error (error, g_steal_pointer (&atomic_error));
+              return NULL;
+            }
+
+          g_warning ("%s, falling back to non-atomic modesetting",
+                     atomic_error->message);
+
+          if (!meta_kms_run_impl_task_sync (kms,
+                                            fall_back_to_simple_impl_in_impl,
+                                            NULL, error))
+            return NULL;
+
+          device = meta_kms_device_new (kms, path, flags, error);
+          if (!device)
+            return NULL;
+        }
+    }
+
   meta_kms_run_impl_task_sync (kms, notify_device_created_in_impl,
                                device, NULL);
 
@@ -553,6 +1093,83 @@ meta_kms_create_device (MetaKms            *kms,
   return device;
 }
 
+static void
+try_make_thread_realtime (void)
+{
+  struct sched_param sched_param = { 0 };
+  int ret;
+
+  sched_param.sched_priority = sched_get_priority_min (SCHED_RR);
+  ret = pthread_setschedparam (pthread_self (), SCHED_RR, &sched_param);
+  if (ret != 0)
+    {
+      g_debug ("Failed to make KMS thread real-time: %s",
+               g_strerror (ret));
+    }
+}
+
+static gpointer
+impl_thread_func (gpointer user_data)
+{
+  MetaKms *kms = user_data;
+
+  g_main_context_push_thread_default (kms->impl_main_context);
+
+  try_make_thread_realtime ();
+
+  g_main_loop_run (kms->impl_main_loop);
+
+  g_main_context_pop_thread_default (kms->impl_main_context);
+
+  return NULL;
+}
+
+static void
+start_impl_thread (MetaKms *kms)
+{
+  kms->impl_main_context = g_main_context_new ();
+  kms->impl_main_loop = g_main_loop_new (kms->impl_main_context, FALSE);
+  kms->posted_update_source = create_posted_update_source (kms);
+  kms->impl_thread = g_thread_new ("KMS thread", impl_thread_func, kms);
+}
+
+static gboolean
+quit_impl_main_loop (gpointer user_data)
+{
+  MetaKms *kms = user_data;
+
+  g_main_loop_quit (kms->impl_main_loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+stop_impl_thread (MetaKms *kms)
+{
+  MetaKmsPostUpdateData *data;
+
+  if (!kms->impl_thread)
+    return;
+
+  g_main_context_invoke (kms->impl_main_context, quit_impl_main_loop, kms);
+  g_clear_pointer (&kms->impl_thread, g_thread_join);
+
+  /* Posted too late to be processed */
+  data = take_posted_updates (kms);
+  while (data)
+    {
+      MetaKmsPostUpdateData *next = data->next;
+
+      post_update_data_free (data);
+      data = next;
+    }
+
+  g_source_destroy (kms->posted_update_source);
+  g_clear_pointer (&kms->posted_update_source, g_source_unref);
+  g_clear_pointer (&kms->impl_main_loop, g_main_loop_unref);
+  g_clear_pointer (&kms->impl_main_context, g_main_context_unref);
+}
+
 MetaKms *
 meta_kms_new (MetaBackend  *backend,
               GError      **error)
@@ -563,13 +1180,21 @@ meta_kms_new (MetaBackend  *backend,
 
   kms = g_object_new (META_TYPE_KMS, NULL);
   kms->backend = backend;
-  kms->impl = META_KMS_IMPL (meta_kms_impl_simple_new (kms, error));
+  if (g_strcmp0 (g_getenv ("MUTTER_DEBUG_ENABLE_ATOMIC_KMS"), "1") == 0)
+    kms->impl = META_KMS_IMPL (meta_kms_impl_atomic_new (kms, error));
+  else
+    kms->impl = META_KMS_IMPL (meta_kms_impl_simple_new (kms, error));
   if (!kms->impl)
     {
       g_object_unref (kms);
       return NULL;
     }
 
+  if (g_strcmp0 (g_getenv ("MUTTER_DEBUG_ENABLE_KMS_THREAD"), "1") == 0)
+    start_impl_thread (kms);
+
+  kms->cursor_manager = meta_kms_cursor_manager_new (kms);
+
   kms->hotplug_handler_id =
     g_signal_connect (udev, "hotplug", G_CALLBACK (on_udev_hotplug), kms);
   kms->removed_handler_id =
@@ -587,13 +1212,21 @@ meta_kms_finalize (GObject *object)
   MetaUdev *udev = meta_backend_native_get_udev (backend_native);
   GList *l;
 
+  stop_impl_thread (kms);
+
+  g_list_free_full (kms->devices, g_object_unref);
+
+  g_clear_pointer (&kms->cursor_manager, meta_kms_cursor_manager_free);
+
   for (l = kms->pending_callbacks; l; l = l->next)
     meta_kms_callback_data_free (l->data);
   g_list_free (kms->pending_callbacks);
 
   g_clear_handle_id (&kms->callback_source_id, g_source_remove);
 
-  g_list_free_full (kms->devices, g_object_unref);
+  g_mutex_clear (&kms->callbacks_mutex);
+  g_cond_clear (&kms->impl_task_cond);
+  g_mutex_clear (&kms->impl_task_mutex);
 
   g_clear_signal_handler (&kms->hotplug_handler_id, udev);
   g_clear_signal_handler (&kms->removed_handler_id, udev);
@@ -604,6 +1237,9 @@ meta_kms_finalize (GObject *object)
 static void
 meta_kms_init (MetaKms *kms)
 {
+  g_mutex_init (&kms->impl_task_mutex);
+  g_cond_init (&kms->impl_task_cond);
+  g_mutex_init (&kms->callbacks_mutex);
 }
 
 static void
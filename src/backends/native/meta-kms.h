@@ -28,16 +28,28 @@
 #define META_TYPE_KMS (meta_kms_get_type ())
 G_DECLARE_FINAL_TYPE (MetaKms, meta_kms, META, KMS, GObject)
 
+typedef void (* MetaKmsFeedbackFunc) (MetaKmsFeedback *feedback,
+                                      gpointer         user_data);
+
 MetaKmsUpdate * meta_kms_ensure_pending_update (MetaKms *kms);
 
 MetaKmsUpdate * meta_kms_get_pending_update (MetaKms *kms);
 
 MetaKmsFeedback * meta_kms_post_pending_update_sync (MetaKms *kms);
 
+void meta_kms_post_pending_update (MetaKms             *kms,
+                                   MetaKmsFeedbackFunc  feedback_func,
+                                   gpointer             user_data,
+                                   GDestroyNotify       user_data_destroy);
+
 void meta_kms_discard_pending_page_flips (MetaKms *kms);
 
 MetaBackend * meta_kms_get_backend (MetaKms *kms);
 
+gboolean meta_kms_is_atomic (MetaKms *kms);
+
+MetaKmsCursorManager * meta_kms_get_cursor_manager (MetaKms *kms);
+
 MetaKmsDevice * meta_kms_create_device (MetaKms            *kms,
                                         const char         *path,
                                         MetaKmsDeviceFlag   flags,
@@ -46,13 +46,15 @@
 #endif
 
 static void
-paint_egl_image (MetaGles3   *gles3,
-                 EGLImageKHR  egl_image,
-                 int          width,
-                 int          height)
+paint_egl_image (MetaGles3            *gles3,
+                 EGLImageKHR           egl_image,
+                 int                   width,
+                 int                   height,
+                 const cairo_region_t *region)
 {
   GLuint texture;
   GLuint framebuffer;
+  int n_rects, i;
 
   meta_gles3_clear_error (gles3);
 
@@ -78,10 +80,35 @@ paint_egl_image (MetaGles3   *gles3,
                                          GL_TEXTURE_2D, texture, 0));
 
   GLBAS (gles3, glBindFramebuffer, (GL_READ_FRAMEBUFFER, framebuffer));
-  GLBAS (gles3, glBlitFramebuffer, (0, height, width, 0,
-                                    0, 0, width, height,
-                                    GL_COLOR_BUFFER_BIT,
-                                    GL_NEAREST));
+
+  if (!region)
+    {
+      GLBAS (gles3, glBlitFramebuffer, (0, height, width, 0,
+                                        0, 0, width, height,
+                                        GL_COLOR_BUFFER_BIT,
+                                        GL_NEAREST));
+    }
+  else
+    {
+      /* The region is in top-left origin coordinates of the image */
+      n_rects = cairo_region_num_rectangles (region);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          int y1, y2;
+
+          cairo_region_get_rectangle (region, i, &rect);
+          y1 = rect.y;
+          y2 = rect.y + rect.height;
+
+          GLBAS (gles3, glBlitFramebuffer, (rect.x, y2,
+                                            rect.x + rect.width, y1,
+                                            rect.x, height - y2,
+                                            rect.x + rect.width, height - y1,
+                                            GL_COLOR_BUFFER_BIT,
+                                            GL_NEAREST));
+        }
+    }
 
   GLBAS (gles3, glDeleteTextures, (1, &texture));
   GLBAS (gles3, glDeleteFramebuffers, (1, &framebuffer));
@@ -94,6 +121,7 @@ meta_renderer_native_gles3_blit_shared_bo (MetaEgl        *egl,
                                            EGLContext      egl_context,
                                            EGLSurface      egl_surface,
                                            struct gbm_bo  *shared_bo,
+                                           cairo_region_t *region,
                                            GError        **error)
 {
   int shared_bo_fd;
@@ -152,7 +180,7 @@ meta_renderer_native_gles3_blit_shared_bo (MetaEgl        *egl,
   if (!egl_image)
     return FALSE;
 
-  paint_egl_image (gles3, egl_image, width, height);
+  paint_egl_image (gles3, egl_image, width, height, region);
 
   meta_egl_destroy_image (egl, egl_display, egl_image, NULL);
 
@@ -43,6 +43,7 @@
 #include <gbm.h>
 #include <gio/gio.h>
 #include <glib-object.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -64,6 +65,8 @@
 #include "backends/native/meta-drm-buffer-import.h"
 #include "backends/native/meta-drm-buffer.h"
 #include "backends/native/meta-gpu-kms.h"
+#include "backends/native/meta-kms-device.h"
+#include "backends/native/meta-kms-plane.h"
 #include "backends/native/meta-kms-update.h"
 #include "backends/native/meta-kms-utils.h"
 #include "backends/native/meta-kms.h"
@@ -122,6 +125,7 @@ typedef struct _MetaRendererNativeGpuData
     MetaSharedFramebufferCopyMode copy_mode;
     gboolean is_hardware_rendering;
     gboolean has_EGL_EXT_image_dma_buf_import_modifiers;
+    gboolean has_EGL_EXT_buffer_age;
 
     /* For GPU blit mode */
     EGLContext egl_context;
@@ -152,7 +156,27 @@ typedef enum _MetaSharedFramebufferImportStatus
   META_SHARED_FRAMEBUFFER_IMPORT_STATUS_OK
 } MetaSharedFramebufferImportStatus;
 
-typedef struct _MetaOnscreenNativeSecondaryGpuState
+#define SECONDARY_GPU_DAMAGE_HISTORY_LENGTH 4
+
+/* Overlay configurations the driver rejected, kept so that they are not
+ * retried every frame */
+#define MAX_FAILED_OVERLAY_CONFIGS 16
+
+typedef struct _MetaOnscreenNativeSecondaryGpuState MetaOnscreenNativeSecondaryGpuState;
+
+typedef struct _MetaCpuReadback
+{
+  MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state;
+  CoglOnscreen *onscreen;
+
+  CoglPixelBuffer *pixel_buffer;
+  CoglFenceClosure *fence_closure;
+
+  MetaDumbBuffer *dumb_fb;
+  cairo_region_t *region;
+} MetaCpuReadback;
+
+struct _MetaOnscreenNativeSecondaryGpuState
 {
   MetaGpuKms *gpu_kms;
   MetaRendererNativeGpuData *renderer_gpu_data;
@@ -165,15 +189,59 @@ typedef struct _MetaOnscreenNativeSecondaryGpuState
     MetaDrmBuffer *next_fb;
   } gbm;
 
+  struct {
+    /*
+     * Damage of the most recent frames copied to egl_surface, used together
+     * with the buffer age to only blit what changed. NULL means unknown.
+     */
+    cairo_region_t *damage_history[SECONDARY_GPU_DAMAGE_HISTORY_LENGTH];
+    int damage_history_index;
+  } gpu;
+
   struct {
     MetaDumbBuffer *dumb_fb;
     MetaDumbBuffer dumb_fbs[2];
+
+    /* What each dumb buffer is missing compared to the onscreen */
+    cairo_region_t *dumb_fb_damage[2];
+
+    gboolean is_pipelined;
+    MetaCpuReadback readbacks[2];
+    int next_readback;
+    MetaCpuReadback *pending_readback;
+    guint follow_up_id;
+    gboolean needs_sync_copy;
   } cpu;
 
   gboolean noted_primary_gpu_copy_ok;
   gboolean noted_primary_gpu_copy_failed;
   MetaSharedFramebufferImportStatus import_status;
-} MetaOnscreenNativeSecondaryGpuState;
+};
+
+typedef struct _MetaOnscreenNativeOverlay
+{
+  MetaKmsPlane *kms_plane;
+  MetaDrmBuffer *buffer;
+
+  int src_width;
+  int src_height;
+
+  /* In CRTC coordinates */
+  MetaRectangle dst_rect;
+
+  /* In stage coordinates, to repaint the area if scanning out fails */
+  MetaRectangle stage_rect;
+} MetaOnscreenNativeOverlay;
+
+typedef struct _MetaOverlayConfig
+{
+  uint32_t drm_format;
+  uint64_t drm_modifier;
+  int src_width;
+  int src_height;
+  int dst_width;
+  int dst_height;
+} MetaOverlayConfig;
 
 typedef struct _MetaOnscreenNative
 {
@@ -190,6 +258,14 @@ typedef struct _MetaOnscreenNative
     MetaDrmBuffer *next_fb;
   } gbm;
 
+  /* Client buffers scanned out from overlay planes, MetaOnscreenNativeOverlay */
+  struct {
+    GList *current;
+    GList *next;
+
+    GArray *failed_configs;
+  } overlays;
+
 #ifdef HAVE_EGL_DEVICE
   struct {
     EGLStreamKHR stream;
@@ -496,14 +572,55 @@ init_secondary_gpu_state_gpu_copy_mode (MetaRendererNative         *renderer_nat
   return TRUE;
 }
 
+static void
+cancel_cpu_readback (MetaCpuReadback *readback)
+{
+  if (readback->fence_closure)
+    {
+      cogl_framebuffer_cancel_fence_callback (COGL_FRAMEBUFFER (readback->onscreen),
+                                              readback->fence_closure);
+      readback->fence_closure = NULL;
+    }
+
+  g_clear_pointer (&readback->region, cairo_region_destroy);
+  readback->dumb_fb = NULL;
+}
+
 static void
 secondary_gpu_release_dumb (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state)
 {
   MetaGpuKms *gpu_kms = secondary_gpu_state->gpu_kms;
   unsigned i;
 
+  g_clear_handle_id (&secondary_gpu_state->cpu.follow_up_id, g_source_remove);
+  secondary_gpu_state->cpu.pending_readback = NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.readbacks); i++)
+    {
+      MetaCpuReadback *readback = &secondary_gpu_state->cpu.readbacks[i];
+
+      cancel_cpu_readback (readback);
+      g_clear_pointer (&readback->pixel_buffer, cogl_object_unref);
+    }
+
   for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.dumb_fbs); i++)
-    release_dumb_fb (&secondary_gpu_state->cpu.dumb_fbs[i], gpu_kms);
+    {
+      release_dumb_fb (&secondary_gpu_state->cpu.dumb_fbs[i], gpu_kms);
+      g_clear_pointer (&secondary_gpu_state->cpu.dumb_fb_damage[i],
+                       cairo_region_destroy);
+    }
+}
+
+static void
+clear_secondary_gpu_damage_history (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state)
+{
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->gpu.damage_history); i++)
+    {
+      g_clear_pointer (&secondary_gpu_state->gpu.damage_history[i],
+                       cairo_region_destroy);
+    }
 }
 
 static void
@@ -527,6 +644,7 @@ secondary_gpu_state_free (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_sta
   g_clear_object (&secondary_gpu_state->gbm.next_fb);
   g_clear_pointer (&secondary_gpu_state->gbm.surface, gbm_surface_destroy);
 
+  clear_secondary_gpu_damage_history (secondary_gpu_state);
   secondary_gpu_release_dumb (secondary_gpu_state);
 
   g_free (secondary_gpu_state);
@@ -600,6 +718,7 @@ init_secondary_gpu_state_cpu_copy_mode (MetaRendererNative         *renderer_nat
                                         GError                    **error)
 {
   CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  CoglContext *cogl_context = framebuffer->context;
   CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
   MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
   MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state;
@@ -607,6 +726,7 @@ init_secondary_gpu_state_cpu_copy_mode (MetaRendererNative         *renderer_nat
   int width, height;
   unsigned int i;
   uint32_t drm_format;
+  CoglPixelFormat cogl_format;
   MetaDrmFormatBuf tmp;
 
   drm_format = pick_secondary_gpu_framebuffer_format_for_cpu (onscreen);
@@ -645,8 +765,36 @@ init_secondary_gpu_state_cpu_copy_mode (MetaRendererNative         *renderer_nat
           secondary_gpu_state_free (secondary_gpu_state);
           return FALSE;
         }
+
+      secondary_gpu_state->cpu.dumb_fb_damage[i] =
+        cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+                                         .width = width,
+                                         .height = height,
+                                       });
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.readbacks); i++)
+    {
+      MetaCpuReadback *readback = &secondary_gpu_state->cpu.readbacks[i];
+
+      readback->secondary_gpu_state = secondary_gpu_state;
+      readback->onscreen = onscreen;
     }
 
+  /*
+   * Reading back into pixel buffers lets the GPU finish in the background,
+   * with the result being copied into the dumb buffer one frame later.
+   * This only works if GL can flip and convert the pixels by itself;
+   * otherwise Cogl maps the pixel buffer right away to do it on the CPU,
+   * which waits for the GPU anyway.
+   */
+  meta_cogl_pixel_format_from_drm_format (drm_format, &cogl_format, NULL);
+  secondary_gpu_state->cpu.is_pipelined =
+    (cogl_has_feature (cogl_context, COGL_FEATURE_ID_FENCE) &&
+     cogl_has_feature (cogl_context, COGL_FEATURE_ID_MAP_BUFFER_FOR_READ) &&
+     cogl_context_format_supports_async_read (cogl_context, cogl_format) &&
+     !g_getenv ("MUTTER_DEBUG_DISABLE_PIPELINED_CPU_COPY"));
+
   /*
    * This function initializes everything needed for
    * META_SHARED_FRAMEBUFFER_COPY_MODE_ZERO as well.
@@ -722,6 +870,30 @@ free_current_secondary_bo (CoglOnscreen *onscreen)
   g_clear_object (&secondary_gpu_state->gbm.current_fb);
 }
 
+static void
+overlay_free (MetaOnscreenNativeOverlay *overlay)
+{
+  g_object_unref (overlay->buffer);
+  g_free (overlay);
+}
+
+static MetaOnscreenNativeOverlay *
+find_overlay_for_plane (GList        *overlays,
+                        MetaKmsPlane *kms_plane)
+{
+  GList *l;
+
+  for (l = overlays; l; l = l->next)
+    {
+      MetaOnscreenNativeOverlay *overlay = l->data;
+
+      if (overlay->kms_plane == kms_plane)
+        return overlay;
+    }
+
+  return NULL;
+}
+
 static void
 free_current_bo (CoglOnscreen *onscreen)
 {
@@ -1016,13 +1188,20 @@ meta_onscreen_native_swap_drm_fb (CoglOnscreen *onscreen)
   g_set_object (&onscreen_native->gbm.current_fb, onscreen_native->gbm.next_fb);
   g_clear_object (&onscreen_native->gbm.next_fb);
 
+  g_list_free_full (onscreen_native->overlays.current,
+                    (GDestroyNotify) overlay_free);
+  onscreen_native->overlays.current =
+    g_steal_pointer (&onscreen_native->overlays.next);
+
   swap_secondary_drm_fb (onscreen);
 }
 
 static void
-maybe_update_frame_info (MetaCrtc      *crtc,
-                         CoglFrameInfo *frame_info,
-                         int64_t        time_ns)
+maybe_update_frame_info (MetaCrtc          *crtc,
+                         CoglFrameInfo     *frame_info,
+                         int64_t            time_ns,
+                         unsigned int       sequence,
+                         CoglFrameInfoFlag  flags)
 {
   const MetaCrtcConfig *crtc_config;
   const MetaCrtcModeInfo *crtc_mode_info;
@@ -1040,13 +1219,17 @@ maybe_update_frame_info (MetaCrtc      *crtc,
     {
       frame_info->presentation_time = time_ns;
       frame_info->refresh_rate = refresh_rate;
+      frame_info->sequence = sequence;
+      frame_info->flags |= flags;
     }
 }
 
 static void
-notify_view_crtc_presented (MetaRendererView *view,
-                            MetaKmsCrtc      *kms_crtc,
-                            int64_t           time_ns)
+notify_view_crtc_presented (MetaRendererView  *view,
+                            MetaKmsCrtc       *kms_crtc,
+                            int64_t            time_ns,
+                            unsigned int       sequence,
+                            CoglFrameInfoFlag  flags)
 {
   ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (view);
   CoglFramebuffer *framebuffer =
@@ -1062,7 +1245,7 @@ notify_view_crtc_presented (MetaRendererView *view,
   frame_info = g_queue_peek_tail (&onscreen->pending_frame_infos);
 
   crtc = META_CRTC (meta_crtc_kms_from_kms_crtc (kms_crtc));
-  maybe_update_frame_info (crtc, frame_info, time_ns);
+  maybe_update_frame_info (crtc, frame_info, time_ns, sequence, flags);
 
   meta_onscreen_native_queue_swap_notify (onscreen);
 
@@ -1095,18 +1278,31 @@ page_flip_feedback_flipped (MetaKmsCrtc  *kms_crtc,
                             unsigned int  sequence,
                             unsigned int  tv_sec,
                             unsigned int  tv_usec,
+                            int64_t       submitted_time_us,
                             gpointer      user_data)
 {
   MetaRendererView *view = user_data;
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (view);
+  CoglFramebuffer *framebuffer =
+    clutter_stage_view_get_onscreen (stage_view);
+  CoglOnscreen *onscreen = COGL_ONSCREEN (framebuffer);
+  CoglFrameInfo *frame_info;
   struct timeval page_flip_time;
 
+  frame_info = g_queue_peek_tail (&onscreen->pending_frame_infos);
+  frame_info->flip_submitted_time_us = MAX (frame_info->flip_submitted_time_us,
+                                            submitted_time_us);
+
   page_flip_time = (struct timeval) {
     .tv_sec = tv_sec,
     .tv_usec = tv_usec,
   };
 
   notify_view_crtc_presented (view, kms_crtc,
-                              timeval_to_nanoseconds (&page_flip_time));
+                              timeval_to_nanoseconds (&page_flip_time),
+                              sequence,
+                              COGL_FRAME_INFO_FLAG_HW_CLOCK |
+                              COGL_FRAME_INFO_FLAG_VSYNC);
 
   g_object_unref (view);
 }
@@ -1129,7 +1325,8 @@ page_flip_feedback_mode_set_fallback (MetaKmsCrtc *kms_crtc,
   gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
   now_ns = meta_gpu_kms_get_current_time_ns (gpu_kms);
 
-  notify_view_crtc_presented (view, kms_crtc, now_ns);
+  notify_view_crtc_presented (view, kms_crtc, now_ns,
+                              0, COGL_FRAME_INFO_FLAG_NONE);
 
   g_object_unref (view);
 }
@@ -1156,7 +1353,8 @@ page_flip_feedback_discarded (MetaKmsCrtc  *kms_crtc,
   gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
   now_ns = meta_gpu_kms_get_current_time_ns (gpu_kms);
 
-  notify_view_crtc_presented (view, kms_crtc, now_ns);
+  notify_view_crtc_presented (view, kms_crtc, now_ns,
+                              0, COGL_FRAME_INFO_FLAG_NONE);
 
   g_object_unref (view);
 }
@@ -1250,6 +1448,57 @@ queue_dummy_power_save_page_flip (CoglOnscreen *onscreen)
                     cogl_object_ref (onscreen));
 }
 
+static void
+assign_overlay_planes (CoglOnscreen  *onscreen,
+                       MetaCrtcKms   *crtc_kms,
+                       MetaKmsUpdate *kms_update)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  MetaKmsCrtc *kms_crtc = meta_crtc_kms_get_kms_crtc (crtc_kms);
+  GList *l;
+
+  /* Planes are left as they are unless told otherwise, so turn off the
+   * ones no longer used */
+  for (l = onscreen_native->overlays.current; l; l = l->next)
+    {
+      MetaOnscreenNativeOverlay *overlay = l->data;
+
+      if (!find_overlay_for_plane (onscreen_native->overlays.next,
+                                   overlay->kms_plane))
+        meta_kms_update_unassign_plane (kms_update, kms_crtc,
+                                        overlay->kms_plane);
+    }
+
+  for (l = onscreen_native->overlays.next; l; l = l->next)
+    {
+      MetaOnscreenNativeOverlay *overlay = l->data;
+      MetaFixed16Rectangle src_rect;
+      MetaFixed16Rectangle dst_rect;
+
+      src_rect = (MetaFixed16Rectangle) {
+        .x = meta_fixed_16_from_int (0),
+        .y = meta_fixed_16_from_int (0),
+        .width = meta_fixed_16_from_int (overlay->src_width),
+        .height = meta_fixed_16_from_int (overlay->src_height),
+      };
+      dst_rect = (MetaFixed16Rectangle) {
+        .x = meta_fixed_16_from_int (overlay->dst_rect.x),
+        .y = meta_fixed_16_from_int (overlay->dst_rect.y),
+        .width = meta_fixed_16_from_int (overlay->dst_rect.width),
+        .height = meta_fixed_16_from_int (overlay->dst_rect.height),
+      };
+
+      meta_kms_update_assign_plane (kms_update,
+                                    kms_crtc,
+                                    overlay->kms_plane,
+                                    meta_drm_buffer_get_fb_id (overlay->buffer),
+                                    src_rect,
+                                    dst_rect,
+                                    META_KMS_ASSIGN_PLANE_FLAG_NONE);
+    }
+}
+
 static void
 meta_onscreen_native_flip_crtc (CoglOnscreen        *onscreen,
                                 MetaRendererView    *view,
@@ -1287,6 +1536,7 @@ meta_onscreen_native_flip_crtc (CoglOnscreen        *onscreen,
         }
 
       meta_crtc_kms_assign_primary_plane (crtc_kms, fb_id, kms_update);
+      assign_overlay_planes (onscreen, crtc_kms, kms_update);
       meta_crtc_kms_page_flip (crtc_kms,
                                &page_flip_feedback,
                                flags,
@@ -1438,10 +1688,115 @@ import_shared_framebuffer (CoglOnscreen                        *onscreen,
   return TRUE;
 }
 
+static cairo_region_t *
+get_swap_damage (CoglFramebuffer *framebuffer,
+                 const int       *rectangles,
+                 int              n_rectangles)
+{
+  cairo_rectangle_int_t fb_rect;
+  cairo_region_t *damage;
+  int i;
+
+  fb_rect = (cairo_rectangle_int_t) {
+    .width = cogl_framebuffer_get_width (framebuffer),
+    .height = cogl_framebuffer_get_height (framebuffer),
+  };
+
+  if (n_rectangles == 0)
+    return cairo_region_create_rectangle (&fb_rect);
+
+  damage = cairo_region_create ();
+  for (i = 0; i < n_rectangles; i++)
+    {
+      const int *rect = rectangles + 4 * i;
+
+      cairo_region_union_rectangle (damage, &(cairo_rectangle_int_t) {
+                                      .x = rect[0],
+                                      .y = rect[1],
+                                      .width = rect[2],
+                                      .height = rect[3],
+                                    });
+    }
+  cairo_region_intersect_rectangle (damage, &fb_rect);
+
+  return damage;
+}
+
+static void
+add_secondary_gpu_damage_history (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                                  cairo_region_t                      *damage)
+{
+  int history_index;
+
+  history_index = ((secondary_gpu_state->gpu.damage_history_index + 1) %
+                   SECONDARY_GPU_DAMAGE_HISTORY_LENGTH);
+  g_clear_pointer (&secondary_gpu_state->gpu.damage_history[history_index],
+                   cairo_region_destroy);
+  secondary_gpu_state->gpu.damage_history[history_index] = damage;
+  secondary_gpu_state->gpu.damage_history_index = history_index;
+}
+
+/*
+ * Returns what has to be blitted for the back buffer of the secondary GPU
+ * surface to match the onscreen again, or NULL if everything has to.
+ */
+static cairo_region_t *
+get_secondary_gpu_copy_region (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                               MetaRendererNativeGpuData           *renderer_gpu_data,
+                               const cairo_region_t                *damage)
+{
+  MetaRendererNative *renderer_native = renderer_gpu_data->renderer_native;
+  MetaEgl *egl = meta_renderer_native_get_egl (renderer_native);
+  g_autoptr (GError) error = NULL;
+  cairo_region_t *region;
+  EGLint buffer_age;
+  int i;
+
+  if (!renderer_gpu_data->secondary.has_EGL_EXT_buffer_age)
+    return NULL;
+
+  if (!meta_egl_query_surface (egl,
+                               renderer_gpu_data->egl_display,
+                               secondary_gpu_state->egl_surface,
+                               EGL_BUFFER_AGE_EXT,
+                               &buffer_age,
+                               &error))
+    {
+      g_warning ("Failed to query buffer age: %s", error->message);
+      return NULL;
+    }
+
+  if (buffer_age <= 0 || buffer_age > SECONDARY_GPU_DAMAGE_HISTORY_LENGTH)
+    return NULL;
+
+  region = cairo_region_copy (damage);
+  for (i = 0; i < buffer_age - 1; i++)
+    {
+      int history_index;
+      cairo_region_t *old_damage;
+
+      history_index = ((secondary_gpu_state->gpu.damage_history_index - i +
+                        SECONDARY_GPU_DAMAGE_HISTORY_LENGTH) %
+                       SECONDARY_GPU_DAMAGE_HISTORY_LENGTH);
+      old_damage = secondary_gpu_state->gpu.damage_history[history_index];
+      if (!old_damage)
+        {
+          cairo_region_destroy (region);
+          return NULL;
+        }
+
+      cairo_region_union (region, old_damage);
+    }
+
+  return region;
+}
+
 static void
 copy_shared_framebuffer_gpu (CoglOnscreen                        *onscreen,
                              MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
                              MetaRendererNativeGpuData           *renderer_gpu_data,
+                             const int                           *rectangles,
+                             int                                  n_rectangles,
                              gboolean                            *egl_context_changed)
 {
   CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
@@ -1451,6 +1806,8 @@ copy_shared_framebuffer_gpu (CoglOnscreen                        *onscreen,
   GError *error = NULL;
   MetaDrmBufferGbm *buffer_gbm;
   struct gbm_bo *bo;
+  cairo_region_t *damage;
+  cairo_region_t *copy_region;
 
   COGL_TRACE_BEGIN_SCOPED (CopySharedFramebufferSecondaryGpu,
                            "FB Copy (secondary GPU)");
@@ -1467,11 +1824,18 @@ copy_shared_framebuffer_gpu (CoglOnscreen                        *onscreen,
     {
       g_warning ("Failed to make current: %s", error->message);
       g_error_free (error);
+      clear_secondary_gpu_damage_history (secondary_gpu_state);
       return;
     }
 
   *egl_context_changed = TRUE;
 
+  damage = get_swap_damage (COGL_FRAMEBUFFER (onscreen),
+                            rectangles, n_rectangles);
+  copy_region = get_secondary_gpu_copy_region (secondary_gpu_state,
+                                               renderer_gpu_data,
+                                               damage);
+
   buffer_gbm = META_DRM_BUFFER_GBM (onscreen_native->gbm.next_fb);
   bo =  meta_drm_buffer_gbm_get_bo (buffer_gbm);
   if (!meta_renderer_native_gles3_blit_shared_bo (egl,
@@ -1480,13 +1844,19 @@ copy_shared_framebuffer_gpu (CoglOnscreen                        *onscreen,
                                                   renderer_gpu_data->secondary.egl_context,
                                                   secondary_gpu_state->egl_surface,
                                                   bo,
+                                                  copy_region,
                                                   &error))
     {
       g_warning ("Failed to blit shared framebuffer: %s", error->message);
       g_error_free (error);
+      g_clear_pointer (&copy_region, cairo_region_destroy);
+      cairo_region_destroy (damage);
+      clear_secondary_gpu_damage_history (secondary_gpu_state);
       return;
     }
 
+  g_clear_pointer (&copy_region, cairo_region_destroy);
+
   if (!meta_egl_swap_buffers (egl,
                               renderer_gpu_data->egl_display,
                               secondary_gpu_state->egl_surface,
@@ -1494,9 +1864,13 @@ copy_shared_framebuffer_gpu (CoglOnscreen                        *onscreen,
     {
       g_warning ("Failed to swap buffers: %s", error->message);
       g_error_free (error);
+      cairo_region_destroy (damage);
+      clear_secondary_gpu_damage_history (secondary_gpu_state);
       return;
     }
 
+  add_secondary_gpu_damage_history (secondary_gpu_state, damage);
+
   buffer_gbm =
     meta_drm_buffer_gbm_new_lock_front (secondary_gpu_state->gpu_kms,
                                         secondary_gpu_state->gbm.surface,
@@ -1612,9 +1986,92 @@ create_dma_buf_framebuffer (MetaRendererNative  *renderer_native,
   return COGL_FRAMEBUFFER (cogl_fbo);
 }
 
+static cairo_region_t *
+get_swap_damage_rows (CoglFramebuffer *framebuffer,
+                      const int       *rectangles,
+                      int              n_rectangles)
+{
+  int width = cogl_framebuffer_get_width (framebuffer);
+  int height = cogl_framebuffer_get_height (framebuffer);
+  cairo_rectangle_int_t fb_rect;
+  cairo_region_t *damage;
+  int i;
+
+  fb_rect = (cairo_rectangle_int_t) {
+    .width = width,
+    .height = height,
+  };
+
+  if (n_rectangles == 0)
+    return cairo_region_create_rectangle (&fb_rect);
+
+  /*
+   * Copy whole rows, so that each damaged band is contiguous in memory and
+   * can be read back without going through an intermediate buffer.
+   */
+  damage = cairo_region_create ();
+  for (i = 0; i < n_rectangles; i++)
+    {
+      const int *rect = rectangles + 4 * i;
+
+      cairo_region_union_rectangle (damage, &(cairo_rectangle_int_t) {
+                                      .y = rect[1],
+                                      .width = width,
+                                      .height = rect[3],
+                                    });
+    }
+  cairo_region_intersect_rectangle (damage, &fb_rect);
+
+  return damage;
+}
+
+static void
+add_dumb_fb_damage (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                    const cairo_region_t                *damage)
+{
+  unsigned int i;
+
+  for (i = 0; i < G_N_ELEMENTS (secondary_gpu_state->cpu.dumb_fb_damage); i++)
+    cairo_region_union (secondary_gpu_state->cpu.dumb_fb_damage[i], damage);
+}
+
+static cairo_region_t *
+get_dumb_fb_damage (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                    MetaDumbBuffer                      *dumb_fb)
+{
+  return secondary_gpu_state->cpu.dumb_fb_damage[dumb_fb -
+                                                 secondary_gpu_state->cpu.dumb_fbs];
+}
+
+static void
+reset_dumb_fb_damage (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                      MetaDumbBuffer                      *dumb_fb)
+{
+  cairo_region_t **damage;
+
+  damage = &secondary_gpu_state->cpu.dumb_fb_damage[dumb_fb -
+                                                    secondary_gpu_state->cpu.dumb_fbs];
+  cairo_region_destroy (*damage);
+  *damage = cairo_region_create ();
+}
+
+static void
+cancel_cpu_copy (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state)
+{
+  MetaCpuReadback *readback;
+
+  g_clear_handle_id (&secondary_gpu_state->cpu.follow_up_id, g_source_remove);
+
+  readback = g_steal_pointer (&secondary_gpu_state->cpu.pending_readback);
+  if (readback)
+    cancel_cpu_readback (readback);
+}
+
 static gboolean
 copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscreen,
-                                     MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state)
+                                     MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                                     const int                           *rectangles,
+                                     int                                  n_rectangles)
 {
   CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
   CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
@@ -1627,6 +2084,9 @@ copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscre
   int dmabuf_fd;
   g_autoptr (GError) error = NULL;
   CoglPixelFormat cogl_format;
+  cairo_region_t *damage;
+  cairo_region_t *copy_region;
+  int n_rects, i;
   int ret;
 
   COGL_TRACE_BEGIN_SCOPED (CopySharedFramebufferPrimaryGpu,
@@ -1669,18 +2129,45 @@ copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscre
       return FALSE;
     }
 
-  if (!cogl_blit_framebuffer (framebuffer, COGL_FRAMEBUFFER (dmabuf_fb),
-                              0, 0, 0, 0,
-                              dumb_fb->width,
-                              dumb_fb->height,
-                              &error))
+  /*
+   * Only blit what changed since this dumb buffer was last written to,
+   * which is the damage of this frame plus whatever it is missing from
+   * the frames that went into the other one.
+   */
+  damage = get_swap_damage (framebuffer, rectangles, n_rectangles);
+  copy_region = cairo_region_copy (get_dumb_fb_damage (secondary_gpu_state,
+                                                       dumb_fb));
+  cairo_region_union (copy_region, damage);
+
+  n_rects = cairo_region_num_rectangles (copy_region);
+  for (i = 0; i < n_rects; i++)
     {
-      cogl_object_unref (dmabuf_fb);
-      return FALSE;
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (copy_region, i, &rect);
+      if (!cogl_blit_framebuffer (framebuffer, COGL_FRAMEBUFFER (dmabuf_fb),
+                                  rect.x, rect.y,
+                                  rect.x, rect.y,
+                                  rect.width, rect.height,
+                                  &error))
+        {
+          cairo_region_destroy (copy_region);
+          cairo_region_destroy (damage);
+          cogl_object_unref (dmabuf_fb);
+          return FALSE;
+        }
     }
 
+  cairo_region_destroy (copy_region);
   cogl_object_unref (dmabuf_fb);
 
+  /* Anything read back on the CPU for the previous frame is stale now */
+  cancel_cpu_copy (secondary_gpu_state);
+
+  add_dumb_fb_damage (secondary_gpu_state, damage);
+  reset_dumb_fb_damage (secondary_gpu_state, dumb_fb);
+  cairo_region_destroy (damage);
+
   g_clear_object (&secondary_gpu_state->gbm.next_fb);
   buffer_dumb = meta_drm_buffer_dumb_new (dumb_fb->fb_id);
   secondary_gpu_state->gbm.next_fb = META_DRM_BUFFER (buffer_dumb);
@@ -1689,56 +2176,340 @@ copy_shared_framebuffer_primary_gpu (CoglOnscreen                        *onscre
   return TRUE;
 }
 
+static gboolean
+cpu_copy_follow_up_cb (gpointer user_data)
+{
+  CoglOnscreen *onscreen = user_data;
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state =
+    onscreen_native->secondary_gpu_state;
+  MetaRenderer *renderer = META_RENDERER (onscreen_native->renderer_native);
+  MetaBackend *backend = meta_renderer_get_backend (renderer);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  MetaRectangle view_layout;
+
+  secondary_gpu_state->cpu.follow_up_id = 0;
+
+  /*
+   * No new frame came along to present the last read back one, so draw a
+   * frame that copies synchronously instead.
+   */
+  secondary_gpu_state->cpu.needs_sync_copy = TRUE;
+
+  clutter_stage_view_get_layout (CLUTTER_STAGE_VIEW (onscreen_native->view),
+                                 &view_layout);
+  clutter_actor_queue_redraw_with_clip (stage, &(cairo_rectangle_int_t) {
+                                          .x = view_layout.x,
+                                          .y = view_layout.y,
+                                          .width = 1,
+                                          .height = 1,
+                                        });
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
-copy_shared_framebuffer_cpu (CoglOnscreen                        *onscreen,
-                             MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
-                             MetaRendererNativeGpuData           *renderer_gpu_data)
+schedule_cpu_copy_follow_up (CoglOnscreen *onscreen)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state =
+    onscreen_native->secondary_gpu_state;
+  ClutterFrameClock *frame_clock;
+  float refresh_rate;
+  unsigned int timeout_ms;
+
+  if (secondary_gpu_state->cpu.follow_up_id || !onscreen_native->view)
+    return;
+
+  frame_clock =
+    clutter_stage_view_get_frame_clock (CLUTTER_STAGE_VIEW (onscreen_native->view));
+  refresh_rate = clutter_frame_clock_get_refresh_rate (frame_clock);
+  if (refresh_rate <= 0.0f)
+    refresh_rate = 60.0f;
+
+  /* Give the next regular frame a chance to pick up the result first */
+  timeout_ms = (unsigned int) ceilf (2000.0f / refresh_rate);
+  secondary_gpu_state->cpu.follow_up_id = g_timeout_add (timeout_ms,
+                                                         cpu_copy_follow_up_cb,
+                                                         onscreen);
+}
+
+static void
+on_cpu_readback_finished (CoglFence *fence,
+                          void      *user_data)
+{
+  MetaCpuReadback *readback = user_data;
+
+  readback->fence_closure = NULL;
+  schedule_cpu_copy_follow_up (readback->onscreen);
+}
+
+static gboolean
+finish_cpu_readback (MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                     MetaCpuReadback                     *readback)
+{
+  MetaDumbBuffer *dumb_fb = readback->dumb_fb;
+  CoglBuffer *buffer = COGL_BUFFER (readback->pixel_buffer);
+  CoglPixelFormat cogl_format;
+  const uint8_t *data;
+  int bpp, stride;
+  int n_rects, i;
+  g_autoptr (GError) error = NULL;
+
+  COGL_TRACE_BEGIN_SCOPED (FinishCpuReadback,
+                           "FB Copy (CPU, finish readback)");
+
+  if (readback->fence_closure)
+    {
+      cogl_framebuffer_cancel_fence_callback (COGL_FRAMEBUFFER (readback->onscreen),
+                                              readback->fence_closure);
+      readback->fence_closure = NULL;
+    }
+
+  meta_cogl_pixel_format_from_drm_format (dumb_fb->drm_format,
+                                          &cogl_format,
+                                          NULL);
+  bpp = cogl_pixel_format_get_bytes_per_pixel (cogl_format, 0);
+  stride = dumb_fb->width * bpp;
+
+  data = cogl_buffer_map_range (buffer,
+                                0, cogl_buffer_get_size (buffer),
+                                COGL_BUFFER_ACCESS_READ,
+                                0,
+                                &error);
+  if (!data)
+    {
+      g_warning ("Failed to map CPU copy readback buffer: %s",
+                 error->message);
+      cancel_cpu_readback (readback);
+      return FALSE;
+    }
+
+  n_rects = cairo_region_num_rectangles (readback->region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int y;
+
+      cairo_region_get_rectangle (readback->region, i, &rect);
+
+      for (y = rect.y; y < rect.y + rect.height; y++)
+        {
+          memcpy ((uint8_t *) dumb_fb->map + (y * dumb_fb->stride_bytes) +
+                  (rect.x * bpp),
+                  data + (y * stride) + (rect.x * bpp),
+                  rect.width * bpp);
+        }
+    }
+
+  cogl_buffer_unmap (buffer);
+
+  cairo_region_subtract (get_dumb_fb_damage (secondary_gpu_state, dumb_fb),
+                         readback->region);
+  g_clear_pointer (&readback->region, cairo_region_destroy);
+
+  return TRUE;
+}
+
+static gboolean
+start_cpu_readback (CoglOnscreen                        *onscreen,
+                    MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state)
 {
   CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
   CoglContext *cogl_context = framebuffer->context;
+  MetaCpuReadback *readback;
   MetaDumbBuffer *dumb_fb;
-  CoglBitmap *dumb_bitmap;
+  cairo_region_t *damage;
   CoglPixelFormat cogl_format;
-  gboolean ret;
-  MetaDrmBufferDumb *buffer_dumb;
+  int bpp, stride;
+  int n_rects, i;
 
-  COGL_TRACE_BEGIN_SCOPED (CopySharedFramebufferCpu,
-                           "FB Copy (CPU)");
+  COGL_TRACE_BEGIN_SCOPED (StartCpuReadback,
+                           "FB Copy (CPU, start readback)");
 
   dumb_fb = secondary_gpu_get_next_dumb_buffer (secondary_gpu_state);
+  damage = get_dumb_fb_damage (secondary_gpu_state, dumb_fb);
+  if (cairo_region_is_empty (damage))
+    return TRUE;
 
-  g_assert (cogl_framebuffer_get_width (framebuffer) == dumb_fb->width);
-  g_assert (cogl_framebuffer_get_height (framebuffer) == dumb_fb->height);
+  readback = &secondary_gpu_state->cpu.readbacks[secondary_gpu_state->cpu.next_readback];
+  secondary_gpu_state->cpu.next_readback =
+    (secondary_gpu_state->cpu.next_readback + 1) %
+    G_N_ELEMENTS (secondary_gpu_state->cpu.readbacks);
+
+  meta_cogl_pixel_format_from_drm_format (dumb_fb->drm_format,
+                                          &cogl_format,
+                                          NULL);
+  bpp = cogl_pixel_format_get_bytes_per_pixel (cogl_format, 0);
+  stride = dumb_fb->width * bpp;
+
+  if (!readback->pixel_buffer)
+    {
+      readback->pixel_buffer = cogl_pixel_buffer_new (cogl_context,
+                                                      stride * dumb_fb->height,
+                                                      NULL);
+    }
+
+  n_rects = cairo_region_num_rectangles (damage);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      CoglBitmap *bitmap;
+      gboolean ret;
+
+      cairo_region_get_rectangle (damage, i, &rect);
+
+      bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (readback->pixel_buffer),
+                                            cogl_format,
+                                            rect.width, rect.height,
+                                            stride,
+                                            (rect.y * stride) + (rect.x * bpp));
+      ret = cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
+                                                      rect.x, rect.y,
+                                                      COGL_READ_PIXELS_COLOR_BUFFER,
+                                                      bitmap);
+      cogl_object_unref (bitmap);
+
+      if (!ret)
+        return FALSE;
+    }
+
+  readback->dumb_fb = dumb_fb;
+  readback->region = cairo_region_copy (damage);
+  readback->fence_closure =
+    cogl_framebuffer_add_fence_callback (framebuffer,
+                                         on_cpu_readback_finished,
+                                         readback);
+  if (!readback->fence_closure)
+    schedule_cpu_copy_follow_up (onscreen);
+
+  secondary_gpu_state->cpu.pending_readback = readback;
+
+  return TRUE;
+}
+
+static gboolean
+read_dumb_fb_damage (CoglFramebuffer                     *framebuffer,
+                     MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                     MetaDumbBuffer                      *dumb_fb)
+{
+  CoglContext *cogl_context = framebuffer->context;
+  cairo_region_t *damage;
+  CoglPixelFormat cogl_format;
+  int bpp;
+  int n_rects, i;
+  gboolean ret;
 
   ret = meta_cogl_pixel_format_from_drm_format (dumb_fb->drm_format,
                                                 &cogl_format,
                                                 NULL);
   g_assert (ret);
 
-  dumb_bitmap = cogl_bitmap_new_for_data (cogl_context,
-                                          dumb_fb->width,
-                                          dumb_fb->height,
-                                          cogl_format,
-                                          dumb_fb->stride_bytes,
-                                          dumb_fb->map);
+  bpp = cogl_pixel_format_get_bytes_per_pixel (cogl_format, 0);
+
+  damage = get_dumb_fb_damage (secondary_gpu_state, dumb_fb);
+  n_rects = cairo_region_num_rectangles (damage);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      CoglBitmap *dumb_bitmap;
+
+      cairo_region_get_rectangle (damage, i, &rect);
+
+      dumb_bitmap = cogl_bitmap_new_for_data (cogl_context,
+                                              rect.width,
+                                              rect.height,
+                                              cogl_format,
+                                              dumb_fb->stride_bytes,
+                                              (uint8_t *) dumb_fb->map +
+                                              (rect.y * dumb_fb->stride_bytes) +
+                                              (rect.x * bpp));
+      ret = cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
+                                                      rect.x, rect.y,
+                                                      COGL_READ_PIXELS_COLOR_BUFFER,
+                                                      dumb_bitmap);
+      cogl_object_unref (dumb_bitmap);
+
+      if (!ret)
+        return FALSE;
+    }
+
+  reset_dumb_fb_damage (secondary_gpu_state, dumb_fb);
 
-  if (!cogl_framebuffer_read_pixels_into_bitmap (framebuffer,
-                                                 0 /* x */,
-                                                 0 /* y */,
-                                                 COGL_READ_PIXELS_COLOR_BUFFER,
-                                                 dumb_bitmap))
-    g_warning ("Failed to CPU-copy to a secondary GPU output");
+  return TRUE;
+}
 
-  cogl_object_unref (dumb_bitmap);
+static void
+copy_shared_framebuffer_cpu (CoglOnscreen                        *onscreen,
+                             MetaOnscreenNativeSecondaryGpuState *secondary_gpu_state,
+                             MetaRendererNativeGpuData           *renderer_gpu_data,
+                             const int                           *rectangles,
+                             int                                  n_rectangles)
+{
+  CoglFramebuffer *framebuffer = COGL_FRAMEBUFFER (onscreen);
+  MetaDumbBuffer *dumb_fb = NULL;
+  MetaCpuReadback *readback;
+  cairo_region_t *damage;
+  gboolean sync_copy;
+  MetaDrmBufferDumb *buffer_dumb;
+
+  COGL_TRACE_BEGIN_SCOPED (CopySharedFramebufferCpu,
+                           "FB Copy (CPU)");
+
+  g_clear_handle_id (&secondary_gpu_state->cpu.follow_up_id, g_source_remove);
+
+  /* Land the previous frame first, its damage is older than this one's */
+  readback = g_steal_pointer (&secondary_gpu_state->cpu.pending_readback);
+  if (readback && finish_cpu_readback (secondary_gpu_state, readback))
+    dumb_fb = readback->dumb_fb;
+
+  damage = get_swap_damage_rows (framebuffer, rectangles, n_rectangles);
+  add_dumb_fb_damage (secondary_gpu_state, damage);
+  cairo_region_destroy (damage);
+
+  sync_copy = (!secondary_gpu_state->cpu.is_pipelined ||
+               secondary_gpu_state->cpu.needs_sync_copy ||
+               (!dumb_fb && !secondary_gpu_state->cpu.dumb_fb));
+  secondary_gpu_state->cpu.needs_sync_copy = FALSE;
+
+  if (sync_copy)
+    {
+      if (!dumb_fb)
+        dumb_fb = secondary_gpu_get_next_dumb_buffer (secondary_gpu_state);
+
+      g_assert (cogl_framebuffer_get_width (framebuffer) == dumb_fb->width);
+      g_assert (cogl_framebuffer_get_height (framebuffer) == dumb_fb->height);
+
+      if (!read_dumb_fb_damage (framebuffer, secondary_gpu_state, dumb_fb))
+        g_warning ("Failed to CPU-copy to a secondary GPU output");
+    }
+  else if (!dumb_fb)
+    {
+      /* Nothing new landed yet, keep showing what we have */
+      dumb_fb = secondary_gpu_state->cpu.dumb_fb;
+    }
 
   g_clear_object (&secondary_gpu_state->gbm.next_fb);
   buffer_dumb = meta_drm_buffer_dumb_new (dumb_fb->fb_id);
   secondary_gpu_state->gbm.next_fb = META_DRM_BUFFER (buffer_dumb);
   secondary_gpu_state->cpu.dumb_fb = dumb_fb;
+
+  if (!sync_copy && !start_cpu_readback (onscreen, secondary_gpu_state))
+    {
+      g_warning ("Failed to read back for a secondary GPU output, "
+                 "falling back to synchronous copies");
+      secondary_gpu_state->cpu.is_pipelined = FALSE;
+      secondary_gpu_state->cpu.needs_sync_copy = TRUE;
+      schedule_cpu_copy_follow_up (onscreen);
+    }
 }
 
 static void
-update_secondary_gpu_state_pre_swap_buffers (CoglOnscreen *onscreen)
+update_secondary_gpu_state_pre_swap_buffers (CoglOnscreen *onscreen,
+                                             const int    *rectangles,
+                                             int           n_rectangles)
 {
   CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
   MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
@@ -1767,7 +2538,9 @@ update_secondary_gpu_state_pre_swap_buffers (CoglOnscreen *onscreen)
           G_GNUC_FALLTHROUGH;
         case META_SHARED_FRAMEBUFFER_COPY_MODE_PRIMARY:
           if (!copy_shared_framebuffer_primary_gpu (onscreen,
-                                                    secondary_gpu_state))
+                                                    secondary_gpu_state,
+                                                    rectangles,
+                                                    n_rectangles))
             {
               if (!secondary_gpu_state->noted_primary_gpu_copy_failed)
                 {
@@ -1778,13 +2551,18 @@ update_secondary_gpu_state_pre_swap_buffers (CoglOnscreen *onscreen)
 
               copy_shared_framebuffer_cpu (onscreen,
                                            secondary_gpu_state,
-                                           renderer_gpu_data);
+                                           renderer_gpu_data,
+                                           rectangles,
+                                           n_rectangles);
             }
-          else if (!secondary_gpu_state->noted_primary_gpu_copy_ok)
+          else
             {
-              g_debug ("Using primary GPU to copy for %s succeeded once.",
-                       meta_gpu_kms_get_file_path (secondary_gpu_state->gpu_kms));
-              secondary_gpu_state->noted_primary_gpu_copy_ok = TRUE;
+              if (!secondary_gpu_state->noted_primary_gpu_copy_ok)
+                {
+                  g_debug ("Using primary GPU to copy for %s succeeded once.",
+                           meta_gpu_kms_get_file_path (secondary_gpu_state->gpu_kms));
+                  secondary_gpu_state->noted_primary_gpu_copy_ok = TRUE;
+                }
             }
           break;
         }
@@ -1793,6 +2571,8 @@ update_secondary_gpu_state_pre_swap_buffers (CoglOnscreen *onscreen)
 
 static void
 update_secondary_gpu_state_post_swap_buffers (CoglOnscreen *onscreen,
+                                              const int    *rectangles,
+                                              int           n_rectangles,
                                               gboolean     *egl_context_changed)
 {
   CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
@@ -1823,6 +2603,8 @@ retry:
           copy_shared_framebuffer_gpu (onscreen,
                                        secondary_gpu_state,
                                        renderer_gpu_data,
+                                       rectangles,
+                                       n_rectangles,
                                        egl_context_changed);
           break;
         case META_SHARED_FRAMEBUFFER_COPY_MODE_PRIMARY:
@@ -1860,6 +2642,163 @@ ensure_crtc_modes (CoglOnscreen  *onscreen,
     }
 }
 
+static gboolean
+overlay_config_equal (const MetaOverlayConfig *config,
+                      const MetaOverlayConfig *other_config)
+{
+  return (config->drm_format == other_config->drm_format &&
+          config->drm_modifier == other_config->drm_modifier &&
+          config->src_width == other_config->src_width &&
+          config->src_height == other_config->src_height &&
+          config->dst_width == other_config->dst_width &&
+          config->dst_height == other_config->dst_height);
+}
+
+static void
+get_overlay_config (MetaDrmBuffer     *buffer,
+                    int                dst_width,
+                    int                dst_height,
+                    MetaOverlayConfig *config)
+{
+  struct gbm_bo *gbm_bo;
+
+  gbm_bo = meta_drm_buffer_gbm_get_bo (META_DRM_BUFFER_GBM (buffer));
+
+  *config = (MetaOverlayConfig) {
+    .drm_format = gbm_bo_get_format (gbm_bo),
+    .drm_modifier = gbm_bo_get_modifier (gbm_bo),
+    .src_width = gbm_bo_get_width (gbm_bo),
+    .src_height = gbm_bo_get_height (gbm_bo),
+    .dst_width = dst_width,
+    .dst_height = dst_height,
+  };
+}
+
+static gboolean
+has_overlay_config_failed (MetaOnscreenNative      *onscreen_native,
+                           const MetaOverlayConfig *config)
+{
+  GArray *failed_configs = onscreen_native->overlays.failed_configs;
+  unsigned int i;
+
+  if (!failed_configs)
+    return FALSE;
+
+  for (i = 0; i < failed_configs->len; i++)
+    {
+      if (overlay_config_equal (&g_array_index (failed_configs,
+                                                MetaOverlayConfig, i),
+                                config))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+add_failed_overlay_config (MetaOnscreenNative      *onscreen_native,
+                           const MetaOverlayConfig *config)
+{
+  GArray *failed_configs = onscreen_native->overlays.failed_configs;
+
+  if (!failed_configs)
+    {
+      failed_configs = g_array_new (FALSE, FALSE, sizeof (MetaOverlayConfig));
+      onscreen_native->overlays.failed_configs = failed_configs;
+    }
+
+  if (failed_configs->len == MAX_FAILED_OVERLAY_CONFIGS)
+    g_array_remove_index (failed_configs, 0);
+
+  g_array_append_vals (failed_configs, config, 1);
+}
+
+/*
+ * Overlay plane assignments are tested by the KMS backend, and dropped from
+ * the update when the driver rejects them. The contents of the affected
+ * surfaces were not painted, so repaint them, and don't try the same
+ * configuration again. The update is posted asynchronously, so the frame
+ * may have been presented already. Returns TRUE if the failed planes were
+ * all overlays handled here.
+ */
+static gboolean
+handle_failed_overlays (CoglOnscreen    *onscreen,
+                        MetaKmsFeedback *kms_feedback)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  MetaRenderer *renderer = META_RENDERER (onscreen_native->renderer_native);
+  MetaBackend *backend = meta_renderer_get_backend (renderer);
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  GList *failed_planes;
+  gboolean handled_all = TRUE;
+  GList *l;
+
+  failed_planes = meta_kms_feedback_get_failed_planes (kms_feedback);
+  if (!failed_planes)
+    return FALSE;
+
+  for (l = failed_planes; l; l = l->next)
+    {
+      MetaKmsPlaneFeedback *plane_feedback = l->data;
+      MetaOnscreenNativeOverlay *overlay;
+      GList **overlays;
+      MetaOverlayConfig config;
+
+      overlays = &onscreen_native->overlays.next;
+      overlay = find_overlay_for_plane (*overlays, plane_feedback->plane);
+      if (!overlay)
+        {
+          overlays = &onscreen_native->overlays.current;
+          overlay = find_overlay_for_plane (*overlays, plane_feedback->plane);
+        }
+      if (!overlay)
+        {
+          handled_all = FALSE;
+          continue;
+        }
+
+      if (!g_error_matches (plane_feedback->error,
+                            G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED))
+        {
+          g_debug ("Failed to scan out buffer from overlay plane %u: %s",
+                   meta_kms_plane_get_id (overlay->kms_plane),
+                   plane_feedback->error->message);
+
+          get_overlay_config (overlay->buffer,
+                              overlay->dst_rect.width,
+                              overlay->dst_rect.height,
+                              &config);
+          add_failed_overlay_config (onscreen_native, &config);
+        }
+
+      clutter_actor_queue_redraw_with_clip (stage, &overlay->stage_rect);
+
+      *overlays = g_list_remove (*overlays, overlay);
+      overlay_free (overlay);
+    }
+
+  return handled_all;
+}
+
+static void
+on_swap_buffers_update_feedback (MetaKmsFeedback *kms_feedback,
+                                 gpointer         user_data)
+{
+  CoglOnscreen *onscreen = user_data;
+  const GError *error;
+
+  if (meta_kms_feedback_get_result (kms_feedback) == META_KMS_FEEDBACK_PASSED)
+    return;
+
+  if (handle_failed_overlays (onscreen, kms_feedback))
+    return;
+
+  error = meta_kms_feedback_get_error (kms_feedback);
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED))
+    g_warning ("Failed to post KMS update: %s", error->message);
+}
+
 static void
 meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
                                                const int     *rectangles,
@@ -1883,14 +2822,15 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
   MetaKmsUpdate *kms_update;
   g_autoptr (GError) error = NULL;
   MetaDrmBufferGbm *buffer_gbm;
-  g_autoptr (MetaKmsFeedback) kms_feedback = NULL;
 
   COGL_TRACE_BEGIN_SCOPED (MetaRendererNativeSwapBuffers,
                            "Onscreen (swap-buffers)");
 
   kms_update = meta_kms_ensure_pending_update (kms);
 
-  update_secondary_gpu_state_pre_swap_buffers (onscreen);
+  update_secondary_gpu_state_pre_swap_buffers (onscreen,
+                                               rectangles,
+                                               n_rectangles);
 
   parent_vtable->onscreen_swap_buffers_with_damage (onscreen,
                                                     rectangles,
@@ -1926,7 +2866,10 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
 #endif
     }
 
-  update_secondary_gpu_state_post_swap_buffers (onscreen, &egl_context_changed);
+  update_secondary_gpu_state_post_swap_buffers (onscreen,
+                                                rectangles,
+                                                n_rectangles,
+                                                &egl_context_changed);
 
   ensure_crtc_modes (onscreen, kms_update);
   meta_onscreen_native_flip_crtcs (onscreen,
@@ -1944,14 +2887,13 @@ meta_onscreen_native_swap_buffers_with_damage (CoglOnscreen  *onscreen,
 
   COGL_TRACE_BEGIN (MetaRendererNativePostKmsUpdate,
                     "Onscreen (post pending update)");
-  kms_feedback = meta_kms_post_pending_update_sync (kms);
-  if (meta_kms_feedback_get_result (kms_feedback) != META_KMS_FEEDBACK_PASSED)
-    {
-      const GError *error = meta_kms_feedback_get_error (kms_feedback);
+  meta_kms_post_pending_update (kms,
+                                on_swap_buffers_update_feedback,
+                                cogl_object_ref (onscreen),
+                                (GDestroyNotify) cogl_object_unref);
 
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED))
-        g_warning ("Failed to post KMS update: %s", error->message);
-    }
+  if (onscreen_native->overlays.next)
+    frame_info->flags |= COGL_FRAME_INFO_FLAG_ZERO_COPY;
   COGL_TRACE_END (MetaRendererNativePostKmsUpdate);
 }
 
@@ -2078,6 +3020,222 @@ meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscreen,
   return TRUE;
 }
 
+static gboolean
+is_plane_format_compatible (MetaKmsPlane *kms_plane,
+                            uint32_t      drm_format,
+                            uint64_t      drm_modifier)
+{
+  GArray *modifiers;
+  unsigned int i;
+
+  if (!meta_kms_plane_is_format_supported (kms_plane, drm_format))
+    return FALSE;
+
+  if (drm_modifier == DRM_FORMAT_MOD_INVALID)
+    return TRUE;
+
+  modifiers = meta_kms_plane_get_modifiers_for_format (kms_plane, drm_format);
+  if (!modifiers)
+    return drm_modifier == DRM_FORMAT_MOD_LINEAR;
+
+  for (i = 0; i < modifiers->len; i++)
+    {
+      if (g_array_index (modifiers, uint64_t, i) == drm_modifier)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static GList *
+get_overlay_planes (MetaOnscreenNative *onscreen_native)
+{
+  MetaCrtcKms *crtc_kms = META_CRTC_KMS (onscreen_native->crtc);
+  MetaKmsCrtc *kms_crtc = meta_crtc_kms_get_kms_crtc (crtc_kms);
+  MetaKmsDevice *kms_device = meta_kms_crtc_get_device (kms_crtc);
+
+  return meta_kms_device_get_overlay_planes_for (kms_device, kms_crtc);
+}
+
+static gboolean
+is_overlay_plane_in_use (MetaRendererNative *renderer_native,
+                         MetaKmsPlane       *kms_plane)
+{
+  MetaRenderer *renderer = META_RENDERER (renderer_native);
+  GList *l;
+
+  /* Overlay planes can often be used with more than one CRTC */
+  for (l = meta_renderer_get_views (renderer); l; l = l->next)
+    {
+      ClutterStageView *stage_view = l->data;
+      CoglFramebuffer *framebuffer =
+        clutter_stage_view_get_onscreen (stage_view);
+      CoglOnscreen *onscreen = COGL_ONSCREEN (framebuffer);
+      CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+      MetaOnscreenNative *onscreen_native;
+
+      if (!onscreen_egl)
+        continue;
+
+      onscreen_native = onscreen_egl->platform;
+      if (find_overlay_for_plane (onscreen_native->overlays.current,
+                                  kms_plane) ||
+          find_overlay_for_plane (onscreen_native->overlays.next,
+                                  kms_plane))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Returns TRUE if client buffers can be scanned out from overlay planes
+ * stacked above the composited output of @onscreen. Only the atomic KMS
+ * backend can check overlay plane configurations before committing them.
+ */
+gboolean
+meta_onscreen_native_can_use_overlays (CoglOnscreen *onscreen)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  MetaRenderer *renderer = META_RENDERER (onscreen_native->renderer_native);
+  MetaBackend *backend = meta_renderer_get_backend (renderer);
+  MetaKms *kms = meta_backend_native_get_kms (META_BACKEND_NATIVE (backend));
+  const MetaCrtcConfig *crtc_config;
+  g_autoptr (GList) overlay_planes = NULL;
+
+  if (!meta_kms_is_atomic (kms))
+    return FALSE;
+
+  crtc_config = meta_crtc_get_config (onscreen_native->crtc);
+  if (!crtc_config ||
+      crtc_config->transform != META_MONITOR_TRANSFORM_NORMAL)
+    return FALSE;
+
+  if (onscreen_native->secondary_gpu_state)
+    return FALSE;
+
+  if (!onscreen_native->gbm.surface)
+    return FALSE;
+
+  overlay_planes = get_overlay_planes (onscreen_native);
+
+  return overlay_planes != NULL;
+}
+
+gboolean
+meta_onscreen_native_is_buffer_overlay_compatible (CoglOnscreen *onscreen,
+                                                   uint32_t      drm_format,
+                                                   uint64_t      drm_modifier)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  g_autoptr (GList) overlay_planes = NULL;
+  GList *l;
+
+  if (!meta_onscreen_native_can_use_overlays (onscreen))
+    return FALSE;
+
+  overlay_planes = get_overlay_planes (onscreen_native);
+  for (l = overlay_planes; l; l = l->next)
+    {
+      if (is_plane_format_compatible (l->data, drm_format, drm_modifier))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Scans out @scanout from a free overlay plane in the next frame, covering
+ * @stage_rect. Returns FALSE if no overlay plane can take the buffer, in
+ * which case it must be composited. Assignments only last for one frame.
+ */
+gboolean
+meta_onscreen_native_assign_overlay (CoglOnscreen        *onscreen,
+                                     CoglScanout         *scanout,
+                                     const MetaRectangle *stage_rect)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  MetaRendererNative *renderer_native = onscreen_native->renderer_native;
+  ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (onscreen_native->view);
+  g_autoptr (GList) overlay_planes = NULL;
+  MetaDrmBuffer *buffer;
+  MetaRectangle view_layout;
+  MetaRectangle dst_rect;
+  MetaOverlayConfig config;
+  MetaOnscreenNativeOverlay *overlay;
+  float scale;
+  GList *l;
+
+  if (!META_IS_DRM_BUFFER_GBM (scanout))
+    return FALSE;
+
+  buffer = META_DRM_BUFFER (scanout);
+
+  clutter_stage_view_get_layout (stage_view, &view_layout);
+  scale = clutter_stage_view_get_scale (stage_view);
+  dst_rect = (MetaRectangle) {
+    .x = roundf ((stage_rect->x - view_layout.x) * scale),
+    .y = roundf ((stage_rect->y - view_layout.y) * scale),
+    .width = roundf (stage_rect->width * scale),
+    .height = roundf (stage_rect->height * scale),
+  };
+
+  get_overlay_config (buffer, dst_rect.width, dst_rect.height, &config);
+  if (has_overlay_config_failed (onscreen_native, &config))
+    return FALSE;
+
+  overlay_planes = get_overlay_planes (onscreen_native);
+  for (l = overlay_planes; l; l = l->next)
+    {
+      MetaKmsPlane *kms_plane = l->data;
+
+      if (!is_plane_format_compatible (kms_plane,
+                                       config.drm_format,
+                                       config.drm_modifier))
+        continue;
+
+      if (find_overlay_for_plane (onscreen_native->overlays.next, kms_plane))
+        continue;
+
+      /* Planes already on screen for this CRTC can be kept for the next
+       * frame, others may be in use by other CRTCs */
+      if (!find_overlay_for_plane (onscreen_native->overlays.current,
+                                   kms_plane) &&
+          is_overlay_plane_in_use (renderer_native, kms_plane))
+        continue;
+
+      overlay = g_new0 (MetaOnscreenNativeOverlay, 1);
+      *overlay = (MetaOnscreenNativeOverlay) {
+        .kms_plane = kms_plane,
+        .buffer = g_object_ref (buffer),
+        .src_width = config.src_width,
+        .src_height = config.src_height,
+        .dst_rect = dst_rect,
+        .stage_rect = *stage_rect,
+      };
+      onscreen_native->overlays.next =
+        g_list_append (onscreen_native->overlays.next, overlay);
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+void
+meta_onscreen_native_clear_overlays (CoglOnscreen *onscreen)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+
+  g_list_free_full (onscreen_native->overlays.next,
+                    (GDestroyNotify) overlay_free);
+  onscreen_native->overlays.next = NULL;
+}
+
 static gboolean
 meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
                                      CoglScanout    *scanout,
@@ -2128,6 +3286,8 @@ meta_onscreen_native_direct_scanout (CoglOnscreen   *onscreen,
       return FALSE;
     }
 
+  frame_info->flags |= COGL_FRAME_INFO_FLAG_ZERO_COPY;
+
   return TRUE;
 }
 
@@ -2668,6 +3828,13 @@ meta_renderer_native_release_onscreen (CoglOnscreen *onscreen)
 
       free_current_bo (onscreen);
 
+      g_list_free_full (onscreen_native->overlays.current,
+                        (GDestroyNotify) overlay_free);
+      g_list_free_full (onscreen_native->overlays.next,
+                        (GDestroyNotify) overlay_free);
+      g_clear_pointer (&onscreen_native->overlays.failed_configs,
+                       g_array_unref);
+
       destroy_egl_surface (onscreen);
 
       if (onscreen_native->gbm.surface)
@@ -3273,6 +4440,10 @@ init_secondary_gpu_data_gpu (MetaRendererNativeGpuData *renderer_gpu_data,
     meta_egl_has_extensions (egl, egl_display, NULL,
                              "EGL_EXT_image_dma_buf_import_modifiers",
                              NULL);
+  renderer_gpu_data->secondary.has_EGL_EXT_buffer_age =
+    meta_egl_has_extensions (egl, egl_display, NULL,
+                             "EGL_EXT_buffer_age",
+                             NULL);
 
   return TRUE;
 
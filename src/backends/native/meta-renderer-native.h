@@ -60,4 +60,16 @@ gboolean meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscre
                                                             uint64_t      drm_modifier,
                                                             uint32_t      stride);
 
+gboolean meta_onscreen_native_can_use_overlays (CoglOnscreen *onscreen);
+
+gboolean meta_onscreen_native_is_buffer_overlay_compatible (CoglOnscreen *onscreen,
+                                                            uint32_t      drm_format,
+                                                            uint64_t      drm_modifier);
+
+gboolean meta_onscreen_native_assign_overlay (CoglOnscreen        *onscreen,
+                                              CoglScanout         *scanout,
+                                              const MetaRectangle *stage_rect);
+
+void meta_onscreen_native_clear_overlays (CoglOnscreen *onscreen);
+
 #endif /* META_RENDERER_NATIVE_H */
@@ -28,6 +28,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <glib-unix.h>
 #include <libinput.h>
 #include <linux/input.h>
 #include <math.h>
@@ -79,9 +80,23 @@ struct _MetaEventSource
   GSource source;
 
   MetaSeatNative *seat;
-  GPollFD event_poll_fd;
 };
 
+typedef struct _MetaQueuedEvent
+{
+  struct libinput_event *event;
+  struct _MetaQueuedEvent *next;
+} MetaQueuedEvent;
+
+typedef struct _MetaDeviceRequest
+{
+  /* NULL when closing fd */
+  const char *path;
+  int flags;
+  int fd;
+  gboolean done;
+} MetaDeviceRequest;
+
 static MetaOpenDeviceCallback  device_open_callback;
 static MetaCloseDeviceCallback device_close_callback;
 static gpointer                device_callback_data;
@@ -117,6 +132,12 @@ GParamSpec *props[N_PROPS] = { NULL };
 G_DEFINE_TYPE (MetaSeatNative, meta_seat_native, CLUTTER_TYPE_SEAT)
 
 static void process_events (MetaSeatNative *seat);
+static void process_event (MetaSeatNative        *seat,
+                           struct libinput_event *event);
+static struct libinput_event * pop_libinput_event (MetaSeatNative *seat);
+static void lock_libinput (MetaSeatNative *seat);
+static void handle_device_request (MetaSeatNative *seat);
+static void handle_device_request_locked (MetaSeatNative *seat);
 
 void
 meta_seat_native_set_libinput_seat (MetaSeatNative       *seat,
@@ -148,11 +169,38 @@ meta_seat_native_sync_leds (MetaSeatNative *seat)
   if (scroll_lock)
     leds |= LIBINPUT_LED_SCROLL_LOCK;
 
+  lock_libinput (seat);
   for (iter = seat->devices; iter; iter = iter->next)
     {
       device_evdev = iter->data;
       meta_input_device_native_update_leds (device_evdev, leds);
     }
+  g_rec_mutex_unlock (&seat->libinput_mutex);
+}
+
+/**
+ * meta_seat_native_lock_libinput: (skip)
+ * @seat: the #MetaSeatNative
+ *
+ * Locks the libinput context of @seat, so that it can be used from the main
+ * thread while the input thread is running, e.g. to configure devices.
+ *
+ * Returns: a locker to free once done with libinput
+ */
+GRecMutexLocker *
+meta_seat_native_lock_libinput (MetaSeatNative *seat)
+{
+  GRecMutexLocker *locker;
+
+  lock_libinput (seat);
+
+  /* Already held, so this only locks recursively; the locker then owns the
+   * lock taken above.
+   */
+  locker = g_rec_mutex_locker_new (&seat->libinput_mutex);
+  g_rec_mutex_unlock (&seat->libinput_mutex);
+
+  return locker;
 }
 
 static void
@@ -227,8 +275,10 @@ meta_seat_native_clear_repeat_timer (MetaSeatNative *seat)
 static void
 dispatch_libinput (MetaSeatNative *seat)
 {
+  lock_libinput (seat);
   libinput_dispatch (seat->libinput);
   process_events (seat);
+  g_rec_mutex_unlock (&seat->libinput_mutex);
 }
 
 static gboolean
@@ -395,6 +445,130 @@ meta_seat_native_notify_key (MetaSeatNative     *seat,
     }
 }
 
+static gboolean
+is_pointer_motion_event (struct libinput_event *event)
+{
+  switch (libinput_event_get_type (event))
+    {
+    case LIBINPUT_EVENT_POINTER_MOTION:
+    case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * Called from the input thread for every event it reads, before the event is
+ * queued for the main thread. The relative motion filter is not applied; the
+ * main thread corrects the cursor once it has handled the motion. Pointer
+ * barriers and constraints can't be applied here either, so nothing is
+ * predicted while any is active, and the cursor only follows the main thread.
+ */
+static void
+predict_pointer_position (MetaSeatNative        *seat,
+                          struct libinput_event *event)
+{
+  struct libinput_event_pointer *pointer_event;
+  graphene_point_t position;
+
+  if (!is_pointer_motion_event (event))
+    return;
+
+  pointer_event = libinput_event_get_pointer_event (event);
+
+  g_mutex_lock (&seat->pointer_prediction_mutex);
+
+  seat->n_pending_motions++;
+
+  if (!seat->pointer_position_notify ||
+      seat->pointer_prediction_inhibited ||
+      seat->pointer_extents.width <= 0 ||
+      seat->pointer_extents.height <= 0)
+    {
+      g_mutex_unlock (&seat->pointer_prediction_mutex);
+      return;
+    }
+
+  if (libinput_event_get_type (event) == LIBINPUT_EVENT_POINTER_MOTION)
+    {
+      position.x = (seat->predicted_pointer.x +
+                    libinput_event_pointer_get_dx (pointer_event));
+      position.y = (seat->predicted_pointer.y +
+                    libinput_event_pointer_get_dy (pointer_event));
+    }
+  else
+    {
+      position.x =
+        libinput_event_pointer_get_absolute_x_transformed (pointer_event,
+                                                           seat->pointer_extents.width);
+      position.y =
+        libinput_event_pointer_get_absolute_y_transformed (pointer_event,
+                                                           seat->pointer_extents.height);
+    }
+
+  position.x = CLAMP (position.x, 0, seat->pointer_extents.width - 1);
+  position.y = CLAMP (position.y, 0, seat->pointer_extents.height - 1);
+  seat->predicted_pointer = position;
+
+  seat->pointer_position_notify (position.x, position.y,
+                                 seat->pointer_position_notify_user_data);
+
+  g_mutex_unlock (&seat->pointer_prediction_mutex);
+}
+
+/*
+ * Called from the main thread for every motion event read from libinput,
+ * before it is handled.
+ */
+static void
+consume_pending_motion (MetaSeatNative        *seat,
+                        struct libinput_event *event)
+{
+  if (!is_pointer_motion_event (event))
+    return;
+
+  g_mutex_lock (&seat->pointer_prediction_mutex);
+  if (seat->n_pending_motions > 0)
+    seat->n_pending_motions--;
+  g_mutex_unlock (&seat->pointer_prediction_mutex);
+}
+
+static void
+sync_predicted_pointer (MetaSeatNative *seat,
+                        ClutterStage   *stage,
+                        float           x,
+                        float           y)
+{
+  g_mutex_lock (&seat->pointer_prediction_mutex);
+
+  if (stage)
+    {
+      clutter_actor_get_size (CLUTTER_ACTOR (stage),
+                              &seat->pointer_extents.width,
+                              &seat->pointer_extents.height);
+    }
+
+  /* Motion read since is already accounted for in the prediction, which is
+   * more recent than this position.
+   */
+  if (seat->n_pending_motions > 0)
+    {
+      g_mutex_unlock (&seat->pointer_prediction_mutex);
+      return;
+    }
+
+  if (seat->pointer_position_notify &&
+      (seat->predicted_pointer.x != x || seat->predicted_pointer.y != y))
+    {
+      seat->pointer_position_notify (x, y,
+                                     seat->pointer_position_notify_user_data);
+    }
+  seat->predicted_pointer = GRAPHENE_POINT_INIT (x, y);
+
+  g_mutex_unlock (&seat->pointer_prediction_mutex);
+}
+
 static ClutterEvent *
 new_absolute_motion_event (MetaSeatNative     *seat,
                            ClutterInputDevice *input_device,
@@ -450,6 +624,8 @@ new_absolute_motion_event (MetaSeatNative     *seat,
     {
       seat->pointer_x = x;
       seat->pointer_y = y;
+
+      sync_predicted_pointer (seat, stage, x, y);
     }
 
   return event;
@@ -879,14 +1055,23 @@ meta_seat_native_notify_touch_event (MetaSeatNative     *seat,
 /*
  * MetaEventSource for reading input devices
  */
+static gboolean
+has_queued_events (MetaSeatNative *seat)
+{
+  return (g_atomic_pointer_get (&seat->queued_events) != NULL ||
+          !g_queue_is_empty (&seat->pending_events));
+}
+
 static gboolean
 meta_event_prepare (GSource *source,
                     gint    *timeout)
 {
+  MetaEventSource *event_source = (MetaEventSource *) source;
   gboolean retval;
 
   *timeout = -1;
-  retval = clutter_events_pending ();
+  retval = (has_queued_events (event_source->seat) ||
+            clutter_events_pending ());
 
   return retval;
 }
@@ -897,7 +1082,7 @@ meta_event_check (GSource *source)
   MetaEventSource *event_source = (MetaEventSource *) source;
   gboolean retval;
 
-  retval = ((event_source->event_poll_fd.revents & G_IO_IN) ||
+  retval = (has_queued_events (event_source->seat) ||
             clutter_events_pending ());
 
   return retval;
@@ -1256,28 +1441,12 @@ notify_pad_ring (ClutterInputDevice *input_device,
   queue_event (event);
 }
 
-static gboolean
-meta_event_dispatch (GSource     *g_source,
-                     GSourceFunc  callback,
-                     gpointer     user_data)
+static void
+forward_clutter_events (void)
 {
-  MetaEventSource *source = (MetaEventSource *) g_source;
-  MetaSeatNative *seat;
   ClutterEvent *event;
 
-  seat = source->seat;
-
-  /* Don't queue more events if we haven't finished handling the previous batch
-   */
-  if (clutter_events_pending ())
-    goto queue_event;
-
-  dispatch_libinput (seat);
-
- queue_event:
-  event = clutter_event_get ();
-
-  if (event)
+  while ((event = clutter_event_get ()))
     {
       ClutterModifierType event_state;
       ClutterInputDevice *input_device =
@@ -1289,17 +1458,67 @@ meta_event_dispatch (GSource     *g_source,
 
       /* Drop events if we don't have any stage to forward them to */
       if (!_clutter_input_device_get_stage (input_device))
-        return TRUE;
+        {
+          clutter_event_free (event);
+          continue;
+        }
 
-      /* update the device states *before* the event */
-      event_state = seat->button_state |
-        xkb_state_serialize_mods (seat->xkb, XKB_STATE_MODS_EFFECTIVE);
+      /* Update the device states *before* the event, with the state the
+       * event was created with, not the one left behind by later events.
+       * The pointer position is updated from the event by the stage.
+       */
+      event_state = clutter_event_get_state (event);
       _clutter_input_device_set_state (seat->core_pointer, event_state);
       _clutter_input_device_set_state (seat->core_keyboard, event_state);
 
       /* forward the event into clutter for emission etc. */
       _clutter_stage_queue_event (event->any.stage, event, FALSE);
     }
+}
+
+static gboolean
+meta_event_dispatch (GSource     *g_source,
+                     GSourceFunc  callback,
+                     gpointer     user_data)
+{
+  MetaEventSource *source = (MetaEventSource *) g_source;
+  MetaSeatNative *seat;
+  struct libinput_event *libinput_event;
+
+  seat = source->seat;
+
+  /* Reset before taking the events, the input thread sets it again when it
+   * queues more.
+   */
+  g_source_set_ready_time (g_source, -1);
+
+  handle_device_request (seat);
+
+  /* Events not coming from libinput, e.g. from virtual devices */
+  forward_clutter_events ();
+
+  /* Handle everything the input thread has read in one go, instead of
+   * iterating the main loop once per event, but forward the clutter events
+   * of each libinput event before handling the next one, so that the device
+   * state always matches the event being forwarded. Motion events are
+   * compressed by the stage.
+   */
+  while (TRUE)
+    {
+      lock_libinput (seat);
+      libinput_event = pop_libinput_event (seat);
+      if (libinput_event)
+        {
+          process_event (seat, libinput_event);
+          libinput_event_destroy (libinput_event);
+        }
+      g_rec_mutex_unlock (&seat->libinput_mutex);
+
+      if (!libinput_event)
+        break;
+
+      forward_clutter_events ();
+    }
 
   return TRUE;
 }
@@ -1315,7 +1534,6 @@ meta_event_source_new (MetaSeatNative *seat)
 {
   GSource *source;
   MetaEventSource *event_source;
-  gint fd;
 
   source = g_source_new (&event_funcs, sizeof (MetaEventSource));
   event_source = (MetaEventSource *) source;
@@ -1323,13 +1541,9 @@ meta_event_source_new (MetaSeatNative *seat)
   /* setup the source */
   event_source->seat = seat;
 
-  fd = libinput_get_fd (seat->libinput);
-  event_source->event_poll_fd.fd = fd;
-  event_source->event_poll_fd.events = G_IO_IN;
-
-  /* and finally configure and attach the GSource */
+  /* and finally configure and attach the GSource; it is woken up by the
+   * input thread whenever it queues events */
   g_source_set_priority (source, CLUTTER_PRIORITY_EVENTS);
-  g_source_add_poll (source, &event_source->event_poll_fd);
   g_source_set_can_recurse (source, TRUE);
   g_source_attach (source, NULL);
 
@@ -1341,14 +1555,195 @@ meta_event_source_free (MetaEventSource *source)
 {
   GSource *g_source = (GSource *) source;
 
-  /* ignore the return value of close, it's not like we can do something
-   * about it */
-  close (source->event_poll_fd.fd);
-
   g_source_destroy (g_source);
   g_source_unref (g_source);
 }
 
+/*
+ * Input thread reading libinput
+ */
+static void
+queue_libinput_event (MetaSeatNative        *seat,
+                      struct libinput_event *event)
+{
+  MetaQueuedEvent *queued_event;
+
+  queued_event = g_new0 (MetaQueuedEvent, 1);
+  queued_event->event = event;
+
+  do
+    queued_event->next = g_atomic_pointer_get (&seat->queued_events);
+  while (!g_atomic_pointer_compare_and_exchange (&seat->queued_events,
+                                                 queued_event->next,
+                                                 queued_event));
+}
+
+static void
+take_queued_events (MetaSeatNative *seat)
+{
+  MetaQueuedEvent *queued_event;
+  GList *events = NULL;
+
+  do
+    queued_event = g_atomic_pointer_get (&seat->queued_events);
+  while (!g_atomic_pointer_compare_and_exchange (&seat->queued_events,
+                                                 queued_event, NULL));
+
+  /* The list is last in, first out; reverse it into the pending queue */
+  while (queued_event)
+    {
+      MetaQueuedEvent *next = queued_event->next;
+
+      events = g_list_prepend (events, queued_event->event);
+      g_free (queued_event);
+      queued_event = next;
+    }
+
+  while (events)
+    {
+      g_queue_push_tail (&seat->pending_events, events->data);
+      events = g_list_delete_link (events, events);
+    }
+}
+
+/*
+ * Must be called with the libinput lock held. Events read by the input
+ * thread come first, as they were taken out of libinput before anything
+ * queued in it since.
+ */
+static struct libinput_event *
+pop_libinput_event (MetaSeatNative *seat)
+{
+  struct libinput_event *event;
+
+  take_queued_events (seat);
+
+  if (!g_queue_is_empty (&seat->pending_events))
+    return g_queue_pop_head (&seat->pending_events);
+
+  /* Not seen by the input thread, but consumed like the events it read */
+  event = libinput_get_event (seat->libinput);
+  if (event && is_pointer_motion_event (event))
+    {
+      g_mutex_lock (&seat->pointer_prediction_mutex);
+      seat->n_pending_motions++;
+      g_mutex_unlock (&seat->pointer_prediction_mutex);
+    }
+
+  return event;
+}
+
+static gboolean
+input_thread_dispatch_libinput (int          fd,
+                                GIOCondition condition,
+                                gpointer     user_data)
+{
+  MetaSeatNative *seat = user_data;
+  struct libinput_event *event;
+  gboolean queued = FALSE;
+
+  g_rec_mutex_lock (&seat->libinput_mutex);
+
+  libinput_dispatch (seat->libinput);
+
+  while ((event = libinput_get_event (seat->libinput)))
+    {
+      predict_pointer_position (seat, event);
+      queue_libinput_event (seat, event);
+      queued = TRUE;
+    }
+
+  g_rec_mutex_unlock (&seat->libinput_mutex);
+
+  /* Wake up the main thread in case it waits for libinput */
+  g_mutex_lock (&seat->device_request_mutex);
+  g_cond_broadcast (&seat->device_request_cond);
+  g_mutex_unlock (&seat->device_request_mutex);
+
+  if (queued)
+    g_source_set_ready_time ((GSource *) seat->event_source, 0);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+input_thread_func (gpointer user_data)
+{
+  MetaSeatNative *seat = user_data;
+
+  g_main_context_push_thread_default (seat->input_main_context);
+  g_main_loop_run (seat->input_main_loop);
+  g_main_context_pop_thread_default (seat->input_main_context);
+
+  g_mutex_lock (&seat->device_request_mutex);
+  seat->input_thread_exited = TRUE;
+  g_cond_broadcast (&seat->device_request_cond);
+  g_mutex_unlock (&seat->device_request_mutex);
+
+  return NULL;
+}
+
+static void
+start_input_thread (MetaSeatNative *seat)
+{
+  GSource *source;
+
+  seat->input_main_context = g_main_context_new ();
+  seat->input_main_loop = g_main_loop_new (seat->input_main_context, FALSE);
+  seat->input_thread_exited = FALSE;
+
+  source = g_unix_fd_source_new (libinput_get_fd (seat->libinput), G_IO_IN);
+  g_source_set_callback (source,
+                         (GSourceFunc) input_thread_dispatch_libinput,
+                         seat, NULL);
+  g_source_attach (source, seat->input_main_context);
+  g_source_unref (source);
+
+  seat->input_thread = g_thread_new ("Input thread", input_thread_func, seat);
+}
+
+static gboolean
+quit_input_main_loop (gpointer user_data)
+{
+  MetaSeatNative *seat = user_data;
+
+  g_main_loop_quit (seat->input_main_loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+stop_input_thread (MetaSeatNative *seat)
+{
+  if (!seat->input_thread)
+    return;
+
+  g_main_context_invoke (seat->input_main_context, quit_input_main_loop, seat);
+
+  /* The input thread may be waiting for a device to be opened or closed */
+  g_mutex_lock (&seat->device_request_mutex);
+  while (!seat->input_thread_exited)
+    {
+      if (seat->device_request)
+        handle_device_request_locked (seat);
+      else
+        g_cond_wait (&seat->device_request_cond, &seat->device_request_mutex);
+    }
+  g_mutex_unlock (&seat->device_request_mutex);
+
+  g_clear_pointer (&seat->input_thread, g_thread_join);
+  g_clear_pointer (&seat->input_main_loop, g_main_loop_unref);
+  g_clear_pointer (&seat->input_main_context, g_main_context_unref);
+}
+
+static void
+clear_queued_events (MetaSeatNative *seat)
+{
+  take_queued_events (seat);
+  g_queue_clear_full (&seat->pending_events,
+                      (GDestroyNotify) libinput_event_destroy);
+}
+
 static gboolean
 has_touchscreen (MetaSeatNative *seat)
 {
@@ -2362,6 +2757,8 @@ process_event (MetaSeatNative        *seat,
 {
   gboolean retval;
 
+  consume_pending_motion (seat, event);
+
   retval = filter_event (seat, event);
 
   if (retval != CLUTTER_EVENT_PROPAGATE)
@@ -2378,17 +2775,20 @@ process_events (MetaSeatNative *seat)
 {
   struct libinput_event *event;
 
-  while ((event = libinput_get_event (seat->libinput)))
+  lock_libinput (seat);
+
+  while ((event = pop_libinput_event (seat)))
     {
       process_event(seat, event);
       libinput_event_destroy(event);
     }
+
+  g_rec_mutex_unlock (&seat->libinput_mutex);
 }
 
 static int
-open_restricted (const char *path,
-                 int         flags,
-                 void       *user_data)
+open_device (const char *path,
+             int         flags)
 {
   gint fd;
 
@@ -2417,8 +2817,7 @@ open_restricted (const char *path,
 }
 
 static void
-close_restricted (int   fd,
-                  void *user_data)
+close_device (int fd)
 {
   if (device_close_callback)
     device_close_callback (fd, device_callback_data);
@@ -2426,6 +2825,117 @@ close_restricted (int   fd,
     close (fd);
 }
 
+/*
+ * Must be called on the main thread with device_request_mutex held.
+ */
+static void
+handle_device_request_locked (MetaSeatNative *seat)
+{
+  MetaDeviceRequest *request = seat->device_request;
+
+  if (!request)
+    return;
+
+  if (request->path)
+    request->fd = open_device (request->path, request->flags);
+  else
+    close_device (request->fd);
+
+  request->done = TRUE;
+  seat->device_request = NULL;
+  g_cond_broadcast (&seat->device_request_cond);
+}
+
+static void
+handle_device_request (MetaSeatNative *seat)
+{
+  g_mutex_lock (&seat->device_request_mutex);
+  handle_device_request_locked (seat);
+  g_mutex_unlock (&seat->device_request_mutex);
+}
+
+/*
+ * Called from the input thread, with the libinput lock held. The main
+ * thread handles the request either from the event source, or while it
+ * waits for the libinput lock, see lock_libinput().
+ */
+static void
+run_device_request (MetaSeatNative    *seat,
+                    MetaDeviceRequest *request)
+{
+  g_mutex_lock (&seat->device_request_mutex);
+
+  seat->device_request = request;
+  g_cond_broadcast (&seat->device_request_cond);
+  g_source_set_ready_time ((GSource *) seat->event_source, 0);
+
+  while (!request->done)
+    g_cond_wait (&seat->device_request_cond, &seat->device_request_mutex);
+
+  g_mutex_unlock (&seat->device_request_mutex);
+}
+
+/*
+ * Locks libinput from the main thread. The input thread may hold the lock
+ * while waiting for the main thread to open or close a device, so handle
+ * such requests until the lock is free.
+ */
+static void
+lock_libinput (MetaSeatNative *seat)
+{
+  g_mutex_lock (&seat->device_request_mutex);
+  while (!g_rec_mutex_trylock (&seat->libinput_mutex))
+    {
+      if (seat->device_request)
+        handle_device_request_locked (seat);
+      else
+        g_cond_wait (&seat->device_request_cond, &seat->device_request_mutex);
+    }
+  g_mutex_unlock (&seat->device_request_mutex);
+}
+
+static gboolean
+is_input_thread (MetaSeatNative *seat)
+{
+  return (seat->input_main_context &&
+          g_main_context_is_owner (seat->input_main_context));
+}
+
+static int
+open_restricted (const char *path,
+                 int         flags,
+                 void       *user_data)
+{
+  MetaSeatNative *seat = user_data;
+  MetaDeviceRequest request = { 0 };
+
+  if (!is_input_thread (seat))
+    return open_device (path, flags);
+
+  request.path = path;
+  request.flags = flags;
+  run_device_request (seat, &request);
+
+  return request.fd;
+}
+
+static void
+close_restricted (int   fd,
+                  void *user_data)
+{
+  MetaSeatNative *seat = user_data;
+  MetaDeviceRequest request = { 0 };
+
+  if (!is_input_thread (seat))
+    {
+      close_device (fd);
+      return;
+    }
+
+  request.fd = fd;
+  run_device_request (seat, &request);
+}
+
 static const struct libinput_interface libinput_interface = {
   open_restricted,
   close_restricted
@@ -2448,6 +2958,8 @@ meta_seat_native_constructed (GObject *object)
   _clutter_input_device_set_stage (device, stage);
   seat->pointer_x = INITIAL_POINTER_X;
   seat->pointer_y = INITIAL_POINTER_Y;
+  seat->predicted_pointer = GRAPHENE_POINT_INIT (INITIAL_POINTER_X,
+                                                 INITIAL_POINTER_Y);
   _clutter_input_device_set_coords (device, NULL,
                                     seat->pointer_x, seat->pointer_y,
                                     NULL);
@@ -2491,6 +3003,8 @@ meta_seat_native_constructed (GObject *object)
   source = meta_event_source_new (seat);
   seat->event_source = source;
 
+  start_input_thread (seat);
+
   seat->keymap = g_object_new (META_TYPE_KEYMAP_NATIVE, NULL);
   xkb_keymap = meta_keymap_native_get_keyboard_map (seat->keymap);
 
@@ -2567,8 +3081,11 @@ meta_seat_native_dispose (GObject *object)
       seat->stage_manager = NULL;
     }
 
+  stop_input_thread (seat);
+
   if (seat->libinput)
     {
+      clear_queued_events (seat);
       libinput_unref (seat->libinput);
       seat->libinput = NULL;
     }
@@ -2609,6 +3126,11 @@ meta_seat_native_finalize (GObject *object)
 
   g_free (seat->seat_id);
 
+  g_rec_mutex_clear (&seat->libinput_mutex);
+  g_cond_clear (&seat->device_request_cond);
+  g_mutex_clear (&seat->device_request_mutex);
+  g_mutex_clear (&seat->pointer_prediction_mutex);
+
   G_OBJECT_CLASS (meta_seat_native_parent_class)->finalize (object);
 }
 
@@ -2815,6 +3337,12 @@ meta_seat_native_stage_removed_cb (ClutterStageManager *manager,
 static void
 meta_seat_native_init (MetaSeatNative *seat)
 {
+  g_rec_mutex_init (&seat->libinput_mutex);
+  g_mutex_init (&seat->device_request_mutex);
+  g_cond_init (&seat->device_request_cond);
+  g_mutex_init (&seat->pointer_prediction_mutex);
+  g_queue_init (&seat->pending_events);
+
   seat->stage_manager = clutter_stage_manager_get_default ();
   g_object_ref (seat->stage_manager);
 
@@ -2951,6 +3479,51 @@ meta_seat_native_set_relative_motion_filter (MetaSeatNative           *seat,
   seat->relative_motion_filter_user_data = user_data;
 }
 
+/**
+ * meta_seat_native_set_pointer_position_notify: (skip)
+ * @seat: the #ClutterSeat created by the evdev backend
+ * @notify: the function to call
+ * @user_data: data to pass to @notify
+ *
+ * Sets a function to be called with the new pointer position as soon as a
+ * pointer motion is read from libinput, before the motion event is handled.
+ * It is called from the input thread with a predicted position, and from
+ * the main thread when the handled motion ended up somewhere else, e.g.
+ * because of a pointer constraint.
+ */
+void
+meta_seat_native_set_pointer_position_notify (MetaSeatNative            *seat,
+                                              MetaPointerPositionNotify  notify,
+                                              gpointer                   user_data)
+{
+  g_return_if_fail (META_IS_SEAT_NATIVE (seat));
+
+  g_mutex_lock (&seat->pointer_prediction_mutex);
+  seat->pointer_position_notify = notify;
+  seat->pointer_position_notify_user_data = user_data;
+  g_mutex_unlock (&seat->pointer_prediction_mutex);
+}
+
+/**
+ * meta_seat_native_set_pointer_prediction_inhibited: (skip)
+ * @seat: the #ClutterSeat created by the evdev backend
+ * @inhibited: whether to stop predicting the pointer position
+ *
+ * Stops the input thread from moving the cursor by itself, e.g. while pointer
+ * barriers or constraints are active. The cursor is then only moved once the
+ * main thread has handled the motion.
+ */
+void
+meta_seat_native_set_pointer_prediction_inhibited (MetaSeatNative *seat,
+                                                   gboolean        inhibited)
+{
+  g_return_if_fail (META_IS_SEAT_NATIVE (seat));
+
+  g_mutex_lock (&seat->pointer_prediction_mutex);
+  seat->pointer_prediction_inhibited = inhibited;
+  g_mutex_unlock (&seat->pointer_prediction_mutex);
+}
+
 /**
  * meta_seat_native_add_filter: (skip)
  * @func: (closure data): a filter function
@@ -3109,8 +3682,10 @@ meta_seat_native_release_devices (MetaSeatNative *seat)
       return;
     }
 
+  lock_libinput (seat);
   libinput_suspend (seat->libinput);
   process_events (seat);
+  g_rec_mutex_unlock (&seat->libinput_mutex);
 
   seat->released = TRUE;
 }
@@ -3136,9 +3711,11 @@ meta_seat_native_reclaim_devices (MetaSeatNative *seat)
       return;
     }
 
+  lock_libinput (seat);
   libinput_resume (seat->libinput);
   meta_seat_native_update_xkb_state (seat);
   process_events (seat);
+  g_rec_mutex_unlock (&seat->libinput_mutex);
 
   seat->released = FALSE;
 }
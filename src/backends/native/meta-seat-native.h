@@ -64,6 +64,9 @@ typedef void (* MetaRelativeMotionFilter) (ClutterInputDevice *device,
                                            float              *dx,
                                            float              *dy,
                                            gpointer            user_data);
+typedef void (* MetaPointerPositionNotify) (float    x,
+                                            float    y,
+                                            gpointer user_data);
 
 struct _MetaTouchState
 {
@@ -83,6 +86,26 @@ struct _MetaSeatNative
   struct libinput *libinput;
   struct libinput_seat *libinput_seat;
 
+  /* libinput is read from a dedicated thread, which hands the events over
+   * to the main thread through a lock-free list. libinput itself isn't
+   * thread safe, so every call into it must hold libinput_mutex.
+   */
+  GThread *input_thread;
+  GMainContext *input_main_context;
+  GMainLoop *input_main_loop;
+  GRecMutex libinput_mutex;
+  gpointer queued_events;
+  GQueue pending_events;
+
+  /* Devices are opened and closed through the launcher, which is only used
+   * from the main thread. The input thread posts the requests libinput makes
+   * while it dispatches and waits for the main thread to handle them.
+   */
+  GMutex device_request_mutex;
+  GCond device_request_cond;
+  gpointer device_request;
+  gboolean input_thread_exited;
+
   GSList *devices;
 
   ClutterInputDevice *core_pointer;
@@ -114,6 +137,21 @@ struct _MetaSeatNative
   MetaRelativeMotionFilter relative_motion_filter;
   gpointer relative_motion_filter_user_data;
 
+  /* The input thread moves the cursor by itself, from the pointer position
+   * it predicts from the motion events it reads. The prediction is reset to
+   * the actual pointer position whenever the main thread has caught up with
+   * all motion events read. Nothing is predicted while pointer barriers or
+   * constraints are active, as only the main thread can apply them.
+   * Protected by pointer_prediction_mutex.
+   */
+  GMutex pointer_prediction_mutex;
+  MetaPointerPositionNotify pointer_position_notify;
+  gpointer pointer_position_notify_user_data;
+  gboolean pointer_prediction_inhibited;
+  graphene_point_t predicted_pointer;
+  graphene_size_t pointer_extents;
+  int n_pending_motions;
+
   GSList *event_filters;
 
   MetaKeymapNative *keymap;
@@ -203,6 +241,8 @@ void meta_seat_native_set_libinput_seat (MetaSeatNative       *seat,
 
 void meta_seat_native_sync_leds (MetaSeatNative *seat);
 
+GRecMutexLocker * meta_seat_native_lock_libinput (MetaSeatNative *seat);
+
 ClutterInputDevice * meta_seat_native_get_device (MetaSeatNative *seat,
                                                   int             id);
 
@@ -273,6 +313,13 @@ void meta_seat_native_set_relative_motion_filter (MetaSeatNative           *seat
                                                   MetaRelativeMotionFilter  filter,
                                                   gpointer                  user_data);
 
+void meta_seat_native_set_pointer_position_notify (MetaSeatNative            *seat,
+                                                   MetaPointerPositionNotify  notify,
+                                                   gpointer                   user_data);
+
+void meta_seat_native_set_pointer_prediction_inhibited (MetaSeatNative *seat,
+                                                        gboolean        inhibited);
+
 typedef gboolean (* MetaEvdevFilterFunc) (struct libinput_event *event,
                                           gpointer               data);
 
@@ -111,37 +111,13 @@ meta_actor_vertices_are_untransformed (graphene_point3d_t *verts,
   return TRUE;
 }
 
-/**
- * meta_actor_painting_untransformed:
- * @paint_width: the width of the painted area
- * @paint_height: the height of the painted area
- * @sample_width: the width of the sampled area of the texture
- * @sample_height: the height of the sampled area of the texture
- * @x_origin: if the transform is only an integer translation
- *  then the X coordinate of the location of the origin under the transformation
- *  from drawing space to screen pixel space is returned here.
- * @y_origin: if the transform is only an integer translation
- *  then the X coordinate of the location of the origin under the transformation
- *  from drawing space to screen pixel space is returned here.
- *
- * Determines if the current painting transform is an integer translation.
- * This can differ from the result of meta_actor_is_untransformed() when
- * painting an actor if we're inside a inside a clone paint. @paint_width
- * and @paint_height are used to determine the vertices of the rectangle
- * we check to see if the painted area is "close enough" to the integer
- * transform.
- */
-gboolean
-meta_actor_painting_untransformed (CoglFramebuffer *fb,
-                                   int              paint_width,
-                                   int              paint_height,
-                                   int              sample_width,
-                                   int              sample_height,
-                                   int             *x_origin,
-                                   int             *y_origin)
+static void
+get_painting_vertices (CoglFramebuffer    *fb,
+                       int                 paint_width,
+                       int                 paint_height,
+                       graphene_point3d_t *vertices)
 {
   CoglMatrix modelview, projection, modelview_projection;
-  graphene_point3d_t vertices[4];
   float viewport[4];
   int i;
 
@@ -180,9 +156,92 @@ meta_actor_painting_untransformed (CoglFramebuffer *fb,
       vertices[i].y = MTX_GL_SCALE_Y (vertices[i].y, w,
                                       viewport[3], viewport[1]);
     }
+}
+
+/**
+ * meta_actor_painting_untransformed:
+ * @paint_width: the width of the painted area
+ * @paint_height: the height of the painted area
+ * @sample_width: the width of the sampled area of the texture
+ * @sample_height: the height of the sampled area of the texture
+ * @x_origin: if the transform is only an integer translation
+ *  then the X coordinate of the location of the origin under the transformation
+ *  from drawing space to screen pixel space is returned here.
+ * @y_origin: if the transform is only an integer translation
+ *  then the X coordinate of the location of the origin under the transformation
+ *  from drawing space to screen pixel space is returned here.
+ *
+ * Determines if the current painting transform is an integer translation.
+ * This can differ from the result of meta_actor_is_untransformed() when
+ * painting an actor if we're inside a inside a clone paint. @paint_width
+ * and @paint_height are used to determine the vertices of the rectangle
+ * we check to see if the painted area is "close enough" to the integer
+ * transform.
+ */
+gboolean
+meta_actor_painting_untransformed (CoglFramebuffer *fb,
+                                   int              paint_width,
+                                   int              paint_height,
+                                   int              sample_width,
+                                   int              sample_height,
+                                   int             *x_origin,
+                                   int             *y_origin)
+{
+  graphene_point3d_t vertices[4];
+
+  get_painting_vertices (fb, paint_width, paint_height, vertices);
 
   return meta_actor_vertices_are_untransformed (vertices,
                                                 sample_width, sample_height,
                                                 x_origin, y_origin);
 }
 
+/**
+ * meta_actor_painting_axis_aligned:
+ * @paint_width: the width of the painted area
+ * @paint_height: the height of the painted area
+ * @x_origin: (out): the X coordinate of the origin in screen pixel space
+ * @y_origin: (out): the Y coordinate of the origin in screen pixel space
+ * @x_scale: (out): the horizontal scale from drawing to screen pixel space
+ * @y_scale: (out): the vertical scale from drawing to screen pixel space
+ *
+ * Determines if the current painting transform is a combination of a
+ * translation and a positive scale, i.e. if the painted area stays an
+ * upright rectangle on screen, for example when painted through a scaled
+ * down #ClutterClone.
+ */
+gboolean
+meta_actor_painting_axis_aligned (CoglFramebuffer *fb,
+                                  int              paint_width,
+                                  int              paint_height,
+                                  float           *x_origin,
+                                  float           *y_origin,
+                                  float           *x_scale,
+                                  float           *y_scale)
+{
+  graphene_point3d_t v[4];
+  int v0x, v0y, v1x, v1y, v2x, v2y, v3x, v3y;
+
+  if (paint_width <= 0 || paint_height <= 0)
+    return FALSE;
+
+  get_painting_vertices (fb, paint_width, paint_height, v);
+
+  v0x = round_to_fixed (v[0].x); v0y = round_to_fixed (v[0].y);
+  v1x = round_to_fixed (v[1].x); v1y = round_to_fixed (v[1].y);
+  v2x = round_to_fixed (v[2].x); v2y = round_to_fixed (v[2].y);
+  v3x = round_to_fixed (v[3].x); v3y = round_to_fixed (v[3].y);
+
+  /* Not rotated/skewed/flipped? */
+  if (v0x != v2x || v0y != v1y ||
+      v3x != v1x || v3y != v2y ||
+      v1x <= v0x || v2y <= v0y)
+    return FALSE;
+
+  *x_origin = v[0].x;
+  *y_origin = v[0].y;
+  *x_scale = (v[1].x - v[0].x) / paint_width;
+  *y_scale = (v[2].y - v[0].y) / paint_height;
+
+  return TRUE;
+}
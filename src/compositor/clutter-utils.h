@@ -37,4 +37,12 @@ gboolean meta_actor_painting_untransformed (CoglFramebuffer *fb,
                                             int             *x_origin,
                                             int             *y_origin);
 
+gboolean meta_actor_painting_axis_aligned (CoglFramebuffer *fb,
+                                           int              paint_width,
+                                           int              paint_height,
+                                           float           *x_origin,
+                                           float           *y_origin,
+                                           float           *x_scale,
+                                           float           *y_scale);
+
 #endif /* __META_CLUTTER_UTILS_H__ */
@@ -63,6 +63,7 @@
 #include "clutter/clutter-mutter.h"
 #include "cogl/cogl.h"
 #include "compositor/meta-later-private.h"
+#include "compositor/meta-texture-budget.h"
 #include "compositor/meta-window-actor-x11.h"
 #include "compositor/meta-window-actor-private.h"
 #include "compositor/meta-window-group-private.h"
@@ -81,6 +82,8 @@
 #include "meta/window.h"
 #include "x11/meta-x11-display-private.h"
 
+#include "meta-dbus-texture-budget.h"
+
 #ifdef HAVE_WAYLAND
 #include "compositor/meta-window-actor-wayland.h"
 #include "wayland/meta-wayland-private.h"
@@ -98,6 +101,9 @@ enum
 
 static GParamSpec *obj_props[N_PROPS] = { NULL, };
 
+#define META_TEXTURE_BUDGET_DBUS_SERVICE "org.gnome.Mutter.TextureBudget"
+#define META_TEXTURE_BUDGET_DBUS_PATH "/org/gnome/Mutter/TextureBudget"
+
 typedef struct _MetaCompositorPrivate
 {
   GObject parent;
@@ -132,6 +138,9 @@ typedef struct _MetaCompositorPrivate
   MetaPluginManager *plugin_mgr;
 
   MetaLaters *laters;
+
+  MetaDBusTextureBudget *texture_budget_skeleton;
+  guint texture_budget_dbus_name_id;
 } MetaCompositorPrivate;
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (MetaCompositor, meta_compositor,
@@ -1228,6 +1237,81 @@ meta_compositor_init (MetaCompositor *compositor)
 {
 }
 
+static gboolean
+handle_get_texture_budget_stats (MetaDBusTextureBudget *skeleton,
+                                 GDBusMethodInvocation *invocation,
+                                 MetaCompositor        *compositor)
+{
+  MetaTextureBudgetStats stats;
+
+  meta_texture_budget_get_stats (&stats);
+
+  meta_dbus_texture_budget_complete_get_stats (skeleton, invocation,
+                                               stats.budget,
+                                               stats.memory_in_use,
+                                               stats.n_evictions,
+                                               stats.evicted_bytes);
+  return TRUE;
+}
+
+static void
+on_texture_budget_bus_acquired (GDBusConnection *connection,
+                                const char      *name,
+                                gpointer         user_data)
+{
+  MetaCompositor *compositor = user_data;
+  MetaCompositorPrivate *priv =
+    meta_compositor_get_instance_private (compositor);
+  GDBusInterfaceSkeleton *interface_skeleton =
+    G_DBUS_INTERFACE_SKELETON (priv->texture_budget_skeleton);
+  g_autoptr (GError) error = NULL;
+
+  if (!g_dbus_interface_skeleton_export (interface_skeleton,
+                                         connection,
+                                         META_TEXTURE_BUDGET_DBUS_PATH,
+                                         &error))
+    g_warning ("Failed to export texture budget object: %s", error->message);
+}
+
+static void
+on_texture_budget_name_acquired (GDBusConnection *connection,
+                                 const char      *name,
+                                 gpointer         user_data)
+{
+  meta_verbose ("Acquired name %s\n", name);
+}
+
+static void
+on_texture_budget_name_lost (GDBusConnection *connection,
+                             const char      *name,
+                             gpointer         user_data)
+{
+  meta_verbose ("Lost or failed to acquire name %s\n", name);
+}
+
+static void
+init_texture_budget_dbus (MetaCompositor *compositor)
+{
+  MetaCompositorPrivate *priv =
+    meta_compositor_get_instance_private (compositor);
+
+  priv->texture_budget_skeleton = meta_dbus_texture_budget_skeleton_new ();
+  g_signal_connect (priv->texture_budget_skeleton, "handle-get-stats",
+                    G_CALLBACK (handle_get_texture_budget_stats), compositor);
+
+  priv->texture_budget_dbus_name_id =
+    g_bus_own_name (G_BUS_TYPE_SESSION,
+                    META_TEXTURE_BUDGET_DBUS_SERVICE,
+                    G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+                    (meta_get_replace_current_wm () ?
+                     G_BUS_NAME_OWNER_FLAGS_REPLACE : 0),
+                    on_texture_budget_bus_acquired,
+                    on_texture_budget_name_acquired,
+                    on_texture_budget_name_lost,
+                    compositor,
+                    NULL);
+}
+
 static void
 meta_compositor_constructed (GObject *object)
 {
@@ -1253,6 +1337,8 @@ meta_compositor_constructed (GObject *object)
 
   priv->laters = meta_laters_new (compositor);
 
+  init_texture_budget_dbus (compositor);
+
   G_OBJECT_CLASS (meta_compositor_parent_class)->constructed (object);
 }
 
@@ -1266,6 +1352,9 @@ meta_compositor_dispose (GObject *object)
 
   g_clear_pointer (&priv->laters, meta_laters_free);
 
+  g_clear_handle_id (&priv->texture_budget_dbus_name_id, g_bus_unown_name);
+  g_clear_object (&priv->texture_budget_skeleton);
+
   g_clear_signal_handler (&priv->stage_presented_id, stage);
   g_clear_signal_handler (&priv->before_paint_handler_id, stage);
   g_clear_signal_handler (&priv->after_paint_handler_id, stage);
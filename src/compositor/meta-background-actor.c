@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include "compositor/meta-background-actor-private.h"
 #include "compositor/meta-background-content-private.h"
 
@@ -106,15 +108,37 @@ meta_background_actor_get_property (GObject      *object,
     }
 }
 
+static cairo_region_t *
+meta_background_actor_get_opaque_region (ClutterActor *actor)
+{
+  MetaBackgroundActor *self = META_BACKGROUND_ACTOR (actor);
+  ClutterActorBox content_box;
+  cairo_rectangle_int_t rect;
+
+  if (!self->content || !meta_background_content_is_opaque (self->content))
+    return NULL;
+
+  clutter_actor_get_content_box (actor, &content_box);
+  rect.x = ceilf (content_box.x1);
+  rect.y = ceilf (content_box.y1);
+  rect.width = MAX (floorf (content_box.x2) - rect.x, 0);
+  rect.height = MAX (floorf (content_box.y2) - rect.y, 0);
+
+  return cairo_region_create_rectangle (&rect);
+}
+
 static void
 meta_background_actor_class_init (MetaBackgroundActorClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
   GParamSpec *param_spec;
 
   object_class->set_property = meta_background_actor_set_property;
   object_class->get_property = meta_background_actor_get_property;
 
+  actor_class->get_opaque_region = meta_background_actor_get_opaque_region;
+
   param_spec = g_param_spec_object ("meta-display",
                                     "MetaDisplay",
                                     "MetaDisplay",
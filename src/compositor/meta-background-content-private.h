@@ -13,4 +13,6 @@ void meta_background_content_cull_out (MetaBackgroundContent *self,
 
 void meta_background_content_reset_culling (MetaBackgroundContent *self);
 
+gboolean meta_background_content_is_opaque (MetaBackgroundContent *self);
+
 #endif /* META_BACKGROUND_CONTENT_PRIVATE_H */
@@ -987,3 +987,11 @@ meta_background_content_reset_culling (MetaBackgroundContent *self)
   set_unobscured_region (self, NULL);
   set_clip_region (self, NULL);
 }
+
+gboolean
+meta_background_content_is_opaque (MetaBackgroundContent *self)
+{
+  /* The background texture, once there, always covers the whole content
+   * box; the overall opacity is taken care of by the actor. */
+  return self->background != NULL && self->texture_width > 0;
+}
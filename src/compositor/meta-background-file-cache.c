@@ -0,0 +1,348 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2020 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Decoding large background images (e.g. 6K JPEGs) is a noticeable part
+ * of the startup time. To avoid it, the decoded and orientation corrected
+ * pixels are stored uncompressed under $XDG_CACHE_HOME/mutter/backgrounds,
+ * in a file named after the checksum of the image URI. A small header
+ * records the modification time and size of the source file, so that
+ * stale entries are ignored and replaced. Cached images are mapped into
+ * memory and uploaded straight from the mapping.
+ */
+
+#include "config.h"
+
+#include "compositor/meta-background-file-cache.h"
+
+#include <errno.h>
+#include <stdint.h>
+
+#define CACHE_MAGIC 0x4347424d /* "MBGC" */
+#define CACHE_VERSION 1
+
+/* Uncompressed images are large, only keep the most recently used ones */
+#define MAX_CACHE_ENTRIES 4
+
+#define SOURCE_FILE_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+typedef struct _MetaBackgroundCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+
+  uint64_t source_size;
+  uint64_t source_mtime;
+  uint32_t source_mtime_usec;
+
+  uint32_t width;
+  uint32_t height;
+  uint32_t rowstride;
+  uint32_t has_alpha;
+
+  uint32_t padding[5];
+} MetaBackgroundCacheHeader;
+
+G_STATIC_ASSERT (sizeof (MetaBackgroundCacheHeader) == 64);
+
+gboolean
+meta_background_file_cache_is_enabled (void)
+{
+  return g_strcmp0 (g_getenv ("MUTTER_DEBUG_DISABLE_BACKGROUND_CACHE"),
+                    "1") != 0;
+}
+
+static char *
+get_cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "mutter", "backgrounds", NULL);
+}
+
+static char *
+get_cache_path (GFile *file)
+{
+  g_autofree char *uri = NULL;
+  g_autofree char *checksum = NULL;
+  g_autofree char *dir = NULL;
+
+  uri = g_file_get_uri (file);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, uri, -1);
+  dir = get_cache_dir ();
+
+  return g_build_filename (dir, checksum, NULL);
+}
+
+static GFileInfo *
+query_source_info (GFile        *file,
+                   GCancellable *cancellable)
+{
+  g_autoptr (GFileInfo) info = NULL;
+
+  info = g_file_query_info (file, SOURCE_FILE_ATTRIBUTES,
+                            G_FILE_QUERY_INFO_NONE,
+                            cancellable, NULL);
+  if (!info)
+    return NULL;
+
+  /* Without a modification time there is no way to tell stale entries */
+  if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+    return NULL;
+
+  return g_steal_pointer (&info);
+}
+
+static void
+fill_source_header (MetaBackgroundCacheHeader *header,
+                    GFileInfo                 *info)
+{
+  header->source_size = g_file_info_get_size (info);
+  header->source_mtime =
+    g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  header->source_mtime_usec =
+    g_file_info_get_attribute_uint32 (info,
+                                      G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+static gboolean
+is_header_valid (const MetaBackgroundCacheHeader *header,
+                 GFileInfo                       *info,
+                 size_t                           cache_size)
+{
+  MetaBackgroundCacheHeader source_header = { 0 };
+  int n_channels;
+
+  if (header->magic != CACHE_MAGIC ||
+      header->version != CACHE_VERSION)
+    return FALSE;
+
+  fill_source_header (&source_header, info);
+  if (header->source_size != source_header.source_size ||
+      header->source_mtime != source_header.source_mtime ||
+      header->source_mtime_usec != source_header.source_mtime_usec)
+    return FALSE;
+
+  n_channels = header->has_alpha ? 4 : 3;
+  if (header->width == 0 || header->height == 0 ||
+      header->width > G_MAXINT / n_channels ||
+      header->rowstride < header->width * n_channels)
+    return FALSE;
+
+  return cache_size - sizeof (*header) ==
+         (uint64_t) header->rowstride * header->height;
+}
+
+/*
+ * Returns the cached image for @file, if there is a cache entry matching
+ * the current version of the file. The returned pixbuf is backed by the
+ * mapped cache file, and must only be read from.
+ */
+GdkPixbuf *
+meta_background_file_cache_load (GFile        *file,
+                                 GCancellable *cancellable)
+{
+  g_autoptr (GFileInfo) info = NULL;
+  g_autofree char *path = NULL;
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GBytes) pixel_bytes = NULL;
+  const MetaBackgroundCacheHeader *header;
+  size_t size;
+
+  info = query_source_info (file, cancellable);
+  if (!info)
+    return NULL;
+
+  path = get_cache_path (file);
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (!mapped_file)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  header = g_bytes_get_data (bytes, &size);
+  if (size < sizeof (*header) ||
+      !is_header_valid (header, info, size))
+    return NULL;
+
+  pixel_bytes = g_bytes_new_from_bytes (bytes,
+                                        sizeof (*header),
+                                        size - sizeof (*header));
+
+  return gdk_pixbuf_new_from_bytes (pixel_bytes,
+                                    GDK_COLORSPACE_RGB,
+                                    header->has_alpha,
+                                    8,
+                                    header->width,
+                                    header->height,
+                                    header->rowstride);
+}
+
+static int
+compare_modification_time (gconstpointer a,
+                           gconstpointer b)
+{
+  GFileInfo *info_a = G_FILE_INFO (a);
+  GFileInfo *info_b = G_FILE_INFO (b);
+  uint64_t mtime_a, mtime_b;
+
+  mtime_a = g_file_info_get_attribute_uint64 (info_a,
+                                              G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  mtime_b = g_file_info_get_attribute_uint64 (info_b,
+                                              G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+  /* Most recent first */
+  if (mtime_a > mtime_b)
+    return -1;
+  else if (mtime_a < mtime_b)
+    return 1;
+  else
+    return 0;
+}
+
+static void
+prune_cache (GFile        *cache_dir,
+             GCancellable *cancellable)
+{
+  g_autoptr (GFileEnumerator) enumerator = NULL;
+  GList *infos = NULL;
+  GList *l;
+  GFileInfo *info;
+  int n_entries = 0;
+
+  enumerator = g_file_enumerate_children (cache_dir,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable, NULL);
+  if (!enumerator)
+    return;
+
+  while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+    infos = g_list_prepend (infos, info);
+
+  infos = g_list_sort (infos, compare_modification_time);
+
+  for (l = infos; l; l = l->next)
+    {
+      g_autoptr (GFile) child = NULL;
+
+      if (++n_entries <= MAX_CACHE_ENTRIES)
+        continue;
+
+      info = l->data;
+      child = g_file_get_child (cache_dir, g_file_info_get_name (info));
+      g_file_delete (child, cancellable, NULL);
+    }
+
+  g_list_free_full (infos, g_object_unref);
+}
+
+static gboolean
+write_cache_file (GFile                     *cache_file,
+                  MetaBackgroundCacheHeader *header,
+                  GdkPixbuf                 *pixbuf,
+                  GCancellable              *cancellable,
+                  GError                   **error)
+{
+  g_autoptr (GFileOutputStream) file_stream = NULL;
+  GOutputStream *stream;
+  g_autofree guchar *padding = NULL;
+  gsize pixels_size;
+  gsize padding_size;
+
+  file_stream = g_file_replace (cache_file, NULL, FALSE,
+                                G_FILE_CREATE_PRIVATE |
+                                G_FILE_CREATE_REPLACE_DESTINATION,
+                                cancellable, error);
+  if (!file_stream)
+    return FALSE;
+
+  stream = G_OUTPUT_STREAM (file_stream);
+
+  /* The last row of a pixbuf is not necessarily padded to the rowstride,
+   * but the cache file always is, to simplify validating it. */
+  pixels_size = gdk_pixbuf_get_byte_length (pixbuf);
+  padding_size = (gsize) header->rowstride * header->height - pixels_size;
+  padding = g_malloc0 (padding_size);
+
+  if (!g_output_stream_write_all (stream, header, sizeof (*header),
+                                  NULL, cancellable, error) ||
+      !g_output_stream_write_all (stream,
+                                  gdk_pixbuf_read_pixels (pixbuf),
+                                  pixels_size,
+                                  NULL, cancellable, error) ||
+      !g_output_stream_write_all (stream, padding, padding_size,
+                                  NULL, cancellable, error))
+    return FALSE;
+
+  return g_output_stream_close (stream, cancellable, error);
+}
+
+void
+meta_background_file_cache_store (GFile        *file,
+                                  GdkPixbuf    *pixbuf,
+                                  GCancellable *cancellable)
+{
+  g_autoptr (GFileInfo) info = NULL;
+  g_autofree char *dir_path = NULL;
+  g_autofree char *path = NULL;
+  g_autoptr (GFile) cache_dir = NULL;
+  g_autoptr (GFile) cache_file = NULL;
+  g_autoptr (GError) error = NULL;
+  MetaBackgroundCacheHeader header = { 0 };
+
+  if (gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample (pixbuf) != 8)
+    return;
+
+  info = query_source_info (file, cancellable);
+  if (!info)
+    return;
+
+  dir_path = get_cache_dir ();
+  if (g_mkdir_with_parents (dir_path, 0700) != 0)
+    {
+      g_warning ("Failed to create background cache directory '%s': %s",
+                 dir_path, g_strerror (errno));
+      return;
+    }
+
+  header.magic = CACHE_MAGIC;
+  header.version = CACHE_VERSION;
+  fill_source_header (&header, info);
+  header.width = gdk_pixbuf_get_width (pixbuf);
+  header.height = gdk_pixbuf_get_height (pixbuf);
+  header.rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  header.has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+
+  path = get_cache_path (file);
+  cache_file = g_file_new_for_path (path);
+  if (!write_cache_file (cache_file, &header, pixbuf, cancellable, &error))
+    {
+      g_warning ("Failed to write background cache '%s': %s",
+                 path, error->message);
+      g_file_delete (cache_file, NULL, NULL);
+      return;
+    }
+
+  cache_dir = g_file_new_for_path (dir_path);
+  prune_cache (cache_dir, cancellable);
+}
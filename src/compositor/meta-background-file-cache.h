@@ -0,0 +1,34 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2020 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_BACKGROUND_FILE_CACHE_H
+#define META_BACKGROUND_FILE_CACHE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
+
+gboolean meta_background_file_cache_is_enabled (void);
+
+GdkPixbuf * meta_background_file_cache_load (GFile        *file,
+                                             GCancellable *cancellable);
+
+void meta_background_file_cache_store (GFile        *file,
+                                       GdkPixbuf    *pixbuf,
+                                       GCancellable *cancellable);
+
+#endif /* META_BACKGROUND_FILE_CACHE_H */
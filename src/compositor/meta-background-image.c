@@ -31,6 +31,7 @@
 
 #include "clutter/clutter.h"
 #include "compositor/cogl-utils.h"
+#include "compositor/meta-background-file-cache.h"
 
 enum
 {
@@ -127,8 +128,20 @@ load_file (GTask               *task,
            GCancellable        *cancellable)
 {
   GError *error = NULL;
-  GdkPixbuf *pixbuf;
+  GdkPixbuf *pixbuf, *rotated;
   GFileInputStream *stream;
+  gboolean use_file_cache;
+
+  use_file_cache = meta_background_file_cache_is_enabled ();
+  if (use_file_cache)
+    {
+      pixbuf = meta_background_file_cache_load (image->file, cancellable);
+      if (pixbuf)
+        {
+          g_task_return_pointer (task, pixbuf, (GDestroyNotify) g_object_unref);
+          return;
+        }
+    }
 
   stream = g_file_read (image->file, NULL, &error);
   if (stream == NULL)
@@ -146,7 +159,22 @@ load_file (GTask               *task,
       return;
     }
 
-  g_task_return_pointer (task, pixbuf, (GDestroyNotify) g_object_unref);
+  rotated = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+  if (rotated != NULL)
+    {
+      g_object_unref (pixbuf);
+      pixbuf = rotated;
+    }
+
+  /* Hand out the image before writing the cache, the pixbuf is only read
+   * from in both places. */
+  g_task_return_pointer (task, g_object_ref (pixbuf),
+                         (GDestroyNotify) g_object_unref);
+
+  if (use_file_cache)
+    meta_background_file_cache_store (image->file, pixbuf, cancellable);
+
+  g_object_unref (pixbuf);
 }
 
 static void
@@ -159,9 +187,9 @@ file_loaded (GObject      *source_object,
   GError *catch_error = NULL;
   GTask *task;
   CoglTexture *texture;
-  GdkPixbuf *pixbuf, *rotated;
+  GdkPixbuf *pixbuf;
   int width, height, row_stride;
-  guchar *pixels;
+  const guint8 *pixels;
   gboolean has_alpha;
 
   task = G_TASK (result);
@@ -177,17 +205,10 @@ file_loaded (GObject      *source_object,
       goto out;
     }
 
-  rotated = gdk_pixbuf_apply_embedded_orientation (pixbuf);
-  if (rotated != NULL)
-    {
-      g_object_unref (pixbuf);
-      pixbuf = rotated;
-    }
-
   width = gdk_pixbuf_get_width (pixbuf);
   height = gdk_pixbuf_get_height (pixbuf);
   row_stride = gdk_pixbuf_get_rowstride (pixbuf);
-  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  pixels = gdk_pixbuf_read_pixels (pixbuf);
   has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
 
   texture = meta_create_texture (width, height,
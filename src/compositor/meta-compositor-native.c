@@ -22,8 +22,25 @@
 
 #include "compositor/meta-compositor-native.h"
 
+#include "backends/meta-cursor-renderer.h"
 #include "backends/meta-logical-monitor.h"
+#include "backends/native/meta-renderer-native.h"
+#include "clutter/clutter-mutter.h"
+#include "compositor/meta-cullable.h"
+#include "compositor/meta-shaped-texture-private.h"
 #include "compositor/meta-surface-actor-wayland.h"
+#include "core/boxes-private.h"
+
+/* Overlay planes are scarce, and small surfaces are cheap to composite, so
+ * leave the planes for large surfaces such as video */
+#define MIN_OVERLAY_AREA (256 * 256)
+
+typedef struct _OverlaySurface
+{
+  MetaSurfaceActor *surface_actor;
+  ClutterStageView *stage_view;
+  MetaRectangle stage_rect;
+} OverlaySurface;
 
 struct _MetaCompositorNative
 {
@@ -33,6 +50,8 @@ struct _MetaCompositorNative
 G_DEFINE_TYPE (MetaCompositorNative, meta_compositor_native,
                META_TYPE_COMPOSITOR_SERVER)
 
+static GQuark quark_overlay_surfaces;
+
 static MetaRendererView *
 get_window_view (MetaRenderer *renderer,
                  MetaWindow   *window)
@@ -115,6 +134,369 @@ maybe_assign_primary_plane (MetaCompositor *compositor)
   clutter_stage_view_assign_next_scanout (CLUTTER_STAGE_VIEW (view), scanout);
 }
 
+static void
+overlay_surface_free (OverlaySurface *overlay_surface)
+{
+  g_object_unref (overlay_surface->surface_actor);
+  g_free (overlay_surface);
+}
+
+static void
+overlay_surface_unset_overlay_view (OverlaySurface *overlay_surface)
+{
+  MetaSurfaceActor *surface_actor = overlay_surface->surface_actor;
+
+  /* The surface may have moved onto an overlay of another view meanwhile */
+  if (meta_surface_actor_get_overlay_view (surface_actor) ==
+      overlay_surface->stage_view)
+    meta_surface_actor_set_overlay_view (surface_actor, NULL);
+}
+
+static void
+overlay_surfaces_free (GList *overlay_surfaces)
+{
+  GList *l;
+
+  for (l = overlay_surfaces; l; l = l->next)
+    overlay_surface_unset_overlay_view (l->data);
+
+  g_list_free_full (overlay_surfaces, (GDestroyNotify) overlay_surface_free);
+}
+
+static OverlaySurface *
+find_overlay_surface (GList            *overlay_surfaces,
+                      MetaSurfaceActor *surface_actor)
+{
+  GList *l;
+
+  for (l = overlay_surfaces; l; l = l->next)
+    {
+      OverlaySurface *overlay_surface = l->data;
+
+      if (overlay_surface->surface_actor == surface_actor)
+        return overlay_surface;
+    }
+
+  return NULL;
+}
+
+static gboolean
+is_window_actor_overlay_candidate (MetaWindowActor *window_actor)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (window_actor);
+
+  if (meta_window_actor_effect_in_progress (window_actor))
+    return FALSE;
+
+  if (clutter_actor_has_transitions (actor))
+    return FALSE;
+
+  if (clutter_actor_has_effects (actor))
+    return FALSE;
+
+  if (clutter_actor_has_mapped_clones (actor))
+    return FALSE;
+
+  if (clutter_actor_get_paint_opacity (actor) != 255)
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+try_assign_overlay (CoglOnscreen        *onscreen,
+                    MetaSurfaceActor    *surface_actor,
+                    const MetaRectangle *view_layout,
+                    cairo_region_t      *covered_region,
+                    MetaRectangle       *out_stage_rect)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (surface_actor);
+  MetaShapedTexture *stex;
+  graphene_rect_t extents;
+  MetaRectangle stage_rect;
+  g_autoptr (CoglScanout) scanout = NULL;
+
+  if (!META_IS_SURFACE_ACTOR_WAYLAND (surface_actor))
+    return FALSE;
+
+  if (!clutter_actor_is_mapped (actor) ||
+      clutter_actor_has_mapped_clones (actor) ||
+      meta_surface_actor_is_frozen (surface_actor))
+    return FALSE;
+
+  /* Planes are blended using the alpha channel of the buffer, which may be
+   * left undefined by clients in opaque regions */
+  stex = meta_surface_actor_get_texture (surface_actor);
+  if (meta_shaped_texture_has_alpha (stex))
+    return FALSE;
+
+  if (!meta_cullable_is_untransformed (META_CULLABLE (surface_actor)))
+    return FALSE;
+
+  clutter_actor_get_transformed_extents (actor, &extents);
+  meta_rectangle_from_graphene_rect (&extents, META_ROUNDING_STRATEGY_ROUND,
+                                     &stage_rect);
+
+  if (stage_rect.width * stage_rect.height < MIN_OVERLAY_AREA)
+    return FALSE;
+
+  if (!meta_rectangle_contains_rect (view_layout, &stage_rect))
+    return FALSE;
+
+  /* Overlay planes are stacked above the composited output */
+  if (cairo_region_contains_rectangle (covered_region, &stage_rect) !=
+      CAIRO_REGION_OVERLAP_OUT)
+    return FALSE;
+
+  scanout = meta_surface_actor_wayland_try_acquire_overlay_scanout (
+    META_SURFACE_ACTOR_WAYLAND (surface_actor), onscreen);
+  if (!scanout)
+    return FALSE;
+
+  if (!meta_onscreen_native_assign_overlay (onscreen, scanout, &stage_rect))
+    return FALSE;
+
+  *out_stage_rect = stage_rect;
+  return TRUE;
+}
+
+static void
+add_covered_actor (cairo_region_t      *covered_region,
+                   ClutterActor        *actor,
+                   const MetaRectangle *view_layout)
+{
+  ClutterActorBox paint_box;
+  graphene_rect_t paint_rect;
+  MetaRectangle rect;
+
+  if (!clutter_actor_get_paint_box (actor, &paint_box))
+    {
+      cairo_region_union_rectangle (covered_region, view_layout);
+      return;
+    }
+
+  graphene_rect_init (&paint_rect,
+                      paint_box.x1, paint_box.y1,
+                      paint_box.x2 - paint_box.x1,
+                      paint_box.y2 - paint_box.y1);
+  meta_rectangle_from_graphene_rect (&paint_rect,
+                                     META_ROUNDING_STRATEGY_GROW,
+                                     &rect);
+  cairo_region_union_rectangle (covered_region, &rect);
+}
+
+static void
+assign_overlays_in_window_actor (MetaWindowActor     *window_actor,
+                                 gboolean             can_assign,
+                                 CoglOnscreen        *onscreen,
+                                 const MetaRectangle *view_layout,
+                                 cairo_region_t      *covered_region,
+                                 GList              **overlay_surfaces)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (window_actor);
+  gboolean is_candidate;
+  ClutterActor *child;
+
+  is_candidate = can_assign && is_window_actor_overlay_candidate (window_actor);
+
+  for (child = clutter_actor_get_last_child (actor);
+       child;
+       child = clutter_actor_get_previous_sibling (child))
+    {
+      MetaRectangle stage_rect;
+
+      if (!clutter_actor_is_mapped (child))
+        continue;
+
+      if (is_candidate &&
+          META_IS_SURFACE_ACTOR (child) &&
+          try_assign_overlay (onscreen, META_SURFACE_ACTOR (child),
+                              view_layout, covered_region,
+                              &stage_rect))
+        {
+          OverlaySurface *overlay_surface;
+
+          overlay_surface = g_new0 (OverlaySurface, 1);
+          overlay_surface->surface_actor = g_object_ref (child);
+          overlay_surface->stage_rect = stage_rect;
+          *overlay_surfaces = g_list_prepend (*overlay_surfaces,
+                                              overlay_surface);
+        }
+
+      add_covered_actor (covered_region, child, view_layout);
+    }
+
+  add_covered_actor (covered_region, actor, view_layout);
+}
+
+/*
+ * Walks @actor and its children in reverse paint order. Anything that isn't
+ * a window, such as shell chrome, popups or clones, is added to the covered
+ * region as a whole once its children were visited, since it may paint on
+ * top of anything below it.
+ */
+static void
+assign_overlays_in_actor (ClutterActor        *actor,
+                          gboolean             can_assign,
+                          CoglOnscreen        *onscreen,
+                          const MetaRectangle *view_layout,
+                          cairo_region_t      *covered_region,
+                          GList              **overlay_surfaces)
+{
+  ClutterActor *child;
+
+  if (!clutter_actor_is_mapped (actor))
+    return;
+
+  /* Effects on an ancestor redirect the painting of the windows below it */
+  if (clutter_actor_has_effects (actor) ||
+      (clutter_actor_get_offscreen_redirect (actor) &
+       CLUTTER_OFFSCREEN_REDIRECT_ALWAYS))
+    can_assign = FALSE;
+
+  if (META_IS_WINDOW_ACTOR (actor))
+    {
+      assign_overlays_in_window_actor (META_WINDOW_ACTOR (actor),
+                                       can_assign,
+                                       onscreen,
+                                       view_layout,
+                                       covered_region,
+                                       overlay_surfaces);
+      return;
+    }
+
+  for (child = clutter_actor_get_last_child (actor);
+       child;
+       child = clutter_actor_get_previous_sibling (child))
+    {
+      assign_overlays_in_actor (child,
+                                can_assign,
+                                onscreen,
+                                view_layout,
+                                covered_region,
+                                overlay_surfaces);
+    }
+
+  add_covered_actor (covered_region, actor, view_layout);
+}
+
+/*
+ * Walks the stage from the top down, and scans out the window surfaces that
+ * nothing is painted on top of from overlay planes. The surfaces are then
+ * left out when compositing, which makes frames where only they changed
+ * cheap.
+ */
+static GList *
+assign_overlay_planes (MetaCompositor   *compositor,
+                       ClutterStageView *stage_view,
+                       CoglOnscreen     *onscreen)
+{
+  MetaBackend *backend = meta_get_backend ();
+  MetaCursorRenderer *cursor_renderer =
+    meta_backend_get_cursor_renderer (backend);
+  ClutterStage *stage = meta_compositor_get_stage (compositor);
+  MetaRectangle view_layout;
+  cairo_region_t *covered_region;
+  GList *overlay_surfaces = NULL;
+  ClutterActor *child;
+
+  clutter_stage_view_get_layout (stage_view, &view_layout);
+  covered_region = cairo_region_create ();
+
+  if (meta_cursor_renderer_is_overlay_visible (cursor_renderer))
+    {
+      MetaCursorSprite *cursor_sprite;
+      graphene_rect_t cursor_rect;
+      MetaRectangle rect;
+
+      cursor_sprite = meta_cursor_renderer_get_cursor (cursor_renderer);
+      cursor_rect = meta_cursor_renderer_calculate_rect (cursor_renderer,
+                                                         cursor_sprite);
+      meta_rectangle_from_graphene_rect (&cursor_rect,
+                                         META_ROUNDING_STRATEGY_GROW,
+                                         &rect);
+      cairo_region_union_rectangle (covered_region, &rect);
+    }
+
+  for (child = clutter_actor_get_last_child (CLUTTER_ACTOR (stage));
+       child;
+       child = clutter_actor_get_previous_sibling (child))
+    {
+      assign_overlays_in_actor (child,
+                                TRUE,
+                                onscreen,
+                                &view_layout,
+                                covered_region,
+                                &overlay_surfaces);
+    }
+
+  cairo_region_destroy (covered_region);
+
+  return overlay_surfaces;
+}
+
+static void
+maybe_assign_overlay_planes (MetaCompositor   *compositor,
+                             ClutterStageView *stage_view)
+{
+  CoglFramebuffer *framebuffer;
+  CoglOnscreen *onscreen;
+  GList *old_overlay_surfaces;
+  GList *overlay_surfaces = NULL;
+  GList *l;
+
+  framebuffer = clutter_stage_view_get_framebuffer (stage_view);
+  if (!cogl_is_onscreen (framebuffer))
+    return;
+
+  onscreen = COGL_ONSCREEN (framebuffer);
+  meta_onscreen_native_clear_overlays (onscreen);
+
+  if (!meta_compositor_is_unredirect_inhibited (compositor) &&
+      !clutter_stage_view_are_overlays_inhibited (stage_view) &&
+      !clutter_stage_view_peek_scanout (stage_view) &&
+      meta_onscreen_native_can_use_overlays (onscreen))
+    overlay_surfaces = assign_overlay_planes (compositor, stage_view, onscreen);
+
+  old_overlay_surfaces = g_object_steal_qdata (G_OBJECT (stage_view),
+                                               quark_overlay_surfaces);
+  for (l = old_overlay_surfaces; l; l = l->next)
+    {
+      OverlaySurface *old_overlay_surface = l->data;
+      OverlaySurface *overlay_surface;
+
+      overlay_surface = find_overlay_surface (overlay_surfaces,
+                                              old_overlay_surface->surface_actor);
+      if (!overlay_surface)
+        overlay_surface_unset_overlay_view (old_overlay_surface);
+
+      /* The composited output below the overlay plane was left as is */
+      if (!overlay_surface ||
+          !meta_rectangle_equal (&overlay_surface->stage_rect,
+                                 &old_overlay_surface->stage_rect))
+        {
+          clutter_stage_view_add_redraw_clip (stage_view,
+                                              &old_overlay_surface->stage_rect);
+        }
+    }
+  g_list_free_full (old_overlay_surfaces,
+                    (GDestroyNotify) overlay_surface_free);
+
+  for (l = overlay_surfaces; l; l = l->next)
+    {
+      OverlaySurface *overlay_surface = l->data;
+
+      overlay_surface->stage_view = stage_view;
+      meta_surface_actor_set_overlay_view (overlay_surface->surface_actor,
+                                           stage_view);
+    }
+
+  g_object_set_qdata_full (G_OBJECT (stage_view),
+                           quark_overlay_surfaces,
+                           overlay_surfaces,
+                           (GDestroyNotify) overlay_surfaces_free);
+}
+
 static void
 meta_compositor_native_before_paint (MetaCompositor   *compositor,
                                      ClutterStageView *stage_view)
@@ -122,6 +504,7 @@ meta_compositor_native_before_paint (MetaCompositor   *compositor,
   MetaCompositorClass *parent_class;
 
   maybe_assign_primary_plane (compositor);
+  maybe_assign_overlay_planes (compositor, stage_view);
 
   parent_class = META_COMPOSITOR_CLASS (meta_compositor_native_parent_class);
   parent_class->before_paint (compositor, stage_view);
@@ -148,4 +531,7 @@ meta_compositor_native_class_init (MetaCompositorNativeClass *klass)
   MetaCompositorClass *compositor_class = META_COMPOSITOR_CLASS (klass);
 
   compositor_class->before_paint = meta_compositor_native_before_paint;
+
+  quark_overlay_surfaces =
+    g_quark_from_static_string ("-meta-compositor-native-overlay-surfaces");
 }
@@ -34,6 +34,11 @@ has_active_effects (ClutterActor *actor)
   g_autoptr (GList) effects = NULL;
   GList *l;
 
+  /* This is checked for every child on every frame; only build the list
+   * of effects when there is any */
+  if (!clutter_actor_has_effects (actor))
+    return FALSE;
+
   effects = clutter_actor_get_effects (actor);
   for (l = effects; l != NULL; l = l->next)
     {
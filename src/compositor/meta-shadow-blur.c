@@ -0,0 +1,693 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2010 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Box blur kernels used by MetaShadowFactory.
+ *
+ * Rows are always blurred with the scalar sliding window below. Columns
+ * can either be blurred by transposing the buffer and blurring its rows
+ * (the scalar path), or directly in place, running the same sliding
+ * window over a group of adjacent columns at once with SIMD registers.
+ * The latter needs no transpose at all, since a row of the buffer holds
+ * one pixel of each column in the group.
+ *
+ * All implementations produce bit identical results.
+ */
+
+#include "config.h"
+
+#include "compositor/meta-shadow-blur.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_BLUR_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define HAVE_BLUR_NEON
+#include <arm_neon.h>
+#endif
+
+/* Number of adjacent columns processed by one SIMD kernel invocation */
+#define SIMD_COLUMNS 16
+
+/* The SIMD kernels accumulate into 16 bit lanes; the rounded sum of a
+ * window is at most 256 * d - 1, so this is the largest filter width
+ * that can't overflow. Wider filters fall back to the scalar code. */
+#define SIMD_MAX_FILTER_SIZE 255
+
+/* This applies a single box blur pass to a horizontal range of pixels;
+ * since the box blur has the same weight for all pixels, we can
+ * implement an efficient sliding window algorithm where we add
+ * in pixels coming into the window from the right and remove
+ * them when they leave the windw to the left.
+ *
+ * d is the filter width; for even d shift indicates how the blurred
+ * result is aligned with the original - does ' x ' go to ' yy' (shift=1)
+ * or 'yy ' (shift=-1)
+ */
+static void
+blur_xspan (guchar *row,
+            guchar *tmp_buffer,
+            int     row_width,
+            int     x0,
+            int     x1,
+            int     d,
+            int     shift)
+{
+  int offset;
+  int sum = 0;
+  int i;
+
+  if (d % 2 == 1)
+    offset = d / 2;
+  else
+    offset = (d - shift) / 2;
+
+  /* All the conditionals in here look slow, but the branches will
+   * be well predicted and there are enough different possibilities
+   * that trying to write this as a series of unconditional loops
+   * is hard and not an obvious win. The main slow down here seems
+   * to be the integer division per pixel; one possible optimization
+   * would be to accumulate into two 16-bit integer buffers and
+   * only divide down after all three passes. (SSE parallel implementation
+   * of the divide step is possible.)
+   */
+  for (i = x0 - d + offset; i < x1 + offset; i++)
+    {
+      if (i >= 0 && i < row_width)
+        sum += row[i];
+
+      if (i >= x0 + offset)
+        {
+          if (i >= d)
+            sum -= row[i - d];
+
+          tmp_buffer[i - offset] = (sum + d / 2) / d;
+        }
+    }
+
+  memcpy (row + x0, tmp_buffer + x0, x1 - x0);
+}
+
+void
+meta_shadow_blur_rows (cairo_region_t *convolve_region,
+                       int             x_offset,
+                       int             y_offset,
+                       guchar         *buffer,
+                       int             buffer_width,
+                       int             buffer_height,
+                       int             d)
+{
+  int i, j;
+  int n_rectangles;
+  guchar *tmp_buffer;
+
+  tmp_buffer = g_malloc (buffer_width);
+
+  n_rectangles = cairo_region_num_rectangles (convolve_region);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (convolve_region, i, &rect);
+
+      for (j = y_offset + rect.y; j < y_offset + rect.y + rect.height; j++)
+        {
+          guchar *row = buffer + j * buffer_width;
+          int x0 = x_offset + rect.x;
+          int x1 = x0 + rect.width;
+
+          /* We want to produce a symmetric blur that spreads a pixel
+           * equally far to the left and right. If d is odd that happens
+           * naturally, but for d even, we approximate by using a blur
+           * on either side and then a centered blur of size d + 1.
+           * (technique also from the SVG specification)
+           */
+          if (d % 2 == 1)
+            {
+              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
+              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
+              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
+            }
+          else
+            {
+              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 1);
+              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, -1);
+              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d + 1, 0);
+            }
+        }
+    }
+
+  g_free (tmp_buffer);
+}
+
+/* Swaps width and height. Either swaps in-place and returns the original
+ * buffer or allocates a new buffer, frees the original buffer and returns
+ * the new buffer.
+ */
+static guchar *
+flip_buffer (guchar *buffer,
+             int     width,
+             int     height)
+{
+  /* Working in blocks increases cache efficiency, compared to reading
+   * or writing an entire column at once */
+#define BLOCK_SIZE 16
+
+  if (width == height)
+    {
+      int i0, j0;
+
+      for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
+        for (i0 = 0; i0 <= j0; i0 += BLOCK_SIZE)
+          {
+            int max_j = MIN(j0 + BLOCK_SIZE, height);
+            int max_i = MIN(i0 + BLOCK_SIZE, width);
+            int i, j;
+
+            if (i0 == j0)
+              {
+                for (j = j0; j < max_j; j++)
+                  for (i = i0; i < j; i++)
+                    {
+                      guchar tmp = buffer[j * width + i];
+                      buffer[j * width + i] = buffer[i * width + j];
+                      buffer[i * width + j] = tmp;
+                    }
+              }
+            else
+              {
+                for (j = j0; j < max_j; j++)
+                  for (i = i0; i < max_i; i++)
+                    {
+                      guchar tmp = buffer[j * width + i];
+                      buffer[j * width + i] = buffer[i * width + j];
+                      buffer[i * width + j] = tmp;
+                    }
+              }
+          }
+
+      return buffer;
+    }
+  else
+    {
+      guchar *new_buffer = g_malloc (height * width);
+      int i0, j0;
+
+      for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
+        for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
+          {
+            int max_j = MIN(j0 + BLOCK_SIZE, height);
+            int max_i = MIN(i0 + BLOCK_SIZE, width);
+            int i, j;
+
+            for (i = i0; i < max_i; i++)
+              for (j = j0; j < max_j; j++)
+                new_buffer[i * height + j] = buffer[j * width + i];
+          }
+
+      g_free (buffer);
+
+      return new_buffer;
+    }
+#undef BLOCK_SIZE
+}
+
+static int
+get_span_offset (int d,
+                 int shift)
+{
+  if (d % 2 == 1)
+    return d / 2;
+  else
+    return (d - shift) / 2;
+}
+
+/* Same as blur_xspan(), but for a single column of pixels, used for
+ * the columns left over after the SIMD kernels */
+static void
+blur_yspan (guchar *column,
+            guchar *tmp_buffer,
+            int     stride,
+            int     column_height,
+            int     y0,
+            int     y1,
+            int     d,
+            int     shift)
+{
+  int offset = get_span_offset (d, shift);
+  int sum = 0;
+  int i;
+
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < column_height)
+        sum += column[i * stride];
+
+      if (i >= y0 + offset)
+        {
+          if (i >= d)
+            sum -= column[(i - d) * stride];
+
+          tmp_buffer[i - offset] = (sum + d / 2) / d;
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    column[i * stride] = tmp_buffer[i];
+}
+
+/* The SIMD kernels divide by d with a float multiplication. For a
+ * numerator n < 2^16 and d <= 255, (n + 0.5) / d is at least 0.5 / d
+ * away from any integer, which is far more than the rounding error of
+ * the single precision product, so truncating it gives exactly n / d.
+ */
+
+#ifdef HAVE_BLUR_X86
+__attribute__((target ("sse2")))
+static inline __m128i
+divide_epu16_sse2 (__m128i n,
+                   __m128  inv_d)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128 half = _mm_set1_ps (0.5f);
+  __m128 lo, hi;
+
+  lo = _mm_cvtepi32_ps (_mm_unpacklo_epi16 (n, zero));
+  hi = _mm_cvtepi32_ps (_mm_unpackhi_epi16 (n, zero));
+  lo = _mm_mul_ps (_mm_add_ps (lo, half), inv_d);
+  hi = _mm_mul_ps (_mm_add_ps (hi, half), inv_d);
+
+  /* Results are at most 255, so signed saturation is harmless */
+  return _mm_packs_epi32 (_mm_cvttps_epi32 (lo), _mm_cvttps_epi32 (hi));
+}
+
+__attribute__((target ("sse2")))
+static void
+blur_yspan_sse2 (guchar *column,
+                 guchar *tmp_buffer,
+                 int     stride,
+                 int     column_height,
+                 int     y0,
+                 int     y1,
+                 int     d,
+                 int     shift)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i round = _mm_set1_epi16 (d / 2);
+  const __m128 inv_d = _mm_set1_ps (1.0f / d);
+  int offset = get_span_offset (d, shift);
+  __m128i sum_lo = zero;
+  __m128i sum_hi = zero;
+  int i;
+
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < column_height)
+        {
+          __m128i in = _mm_loadu_si128 ((__m128i *) (column + i * stride));
+
+          sum_lo = _mm_add_epi16 (sum_lo, _mm_unpacklo_epi8 (in, zero));
+          sum_hi = _mm_add_epi16 (sum_hi, _mm_unpackhi_epi8 (in, zero));
+        }
+
+      if (i >= y0 + offset)
+        {
+          __m128i lo, hi;
+
+          if (i >= d)
+            {
+              __m128i out =
+                _mm_loadu_si128 ((__m128i *) (column + (i - d) * stride));
+
+              sum_lo = _mm_sub_epi16 (sum_lo, _mm_unpacklo_epi8 (out, zero));
+              sum_hi = _mm_sub_epi16 (sum_hi, _mm_unpackhi_epi8 (out, zero));
+            }
+
+          lo = divide_epu16_sse2 (_mm_add_epi16 (sum_lo, round), inv_d);
+          hi = divide_epu16_sse2 (_mm_add_epi16 (sum_hi, round), inv_d);
+
+          _mm_storeu_si128 ((__m128i *) (tmp_buffer +
+                                         (i - offset) * SIMD_COLUMNS),
+                            _mm_packus_epi16 (lo, hi));
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    memcpy (column + i * stride, tmp_buffer + i * SIMD_COLUMNS, SIMD_COLUMNS);
+}
+
+__attribute__((target ("avx2")))
+static inline __m128i
+divide_epu16_avx2 (__m256i n,
+                   __m256  inv_d)
+{
+  const __m256 half = _mm256_set1_ps (0.5f);
+  __m256 lo, hi;
+  __m256i packed;
+
+  lo = _mm256_cvtepi32_ps (_mm256_cvtepu16_epi32 (_mm256_castsi256_si128 (n)));
+  hi = _mm256_cvtepi32_ps (_mm256_cvtepu16_epi32 (_mm256_extracti128_si256 (n, 1)));
+  lo = _mm256_mul_ps (_mm256_add_ps (lo, half), inv_d);
+  hi = _mm256_mul_ps (_mm256_add_ps (hi, half), inv_d);
+
+  /* The packs work per 128 bit lane, so restore the element order
+   * before narrowing to bytes */
+  packed = _mm256_packus_epi32 (_mm256_cvttps_epi32 (lo),
+                                _mm256_cvttps_epi32 (hi));
+  packed = _mm256_permute4x64_epi64 (packed, 0xd8);
+
+  return _mm_packus_epi16 (_mm256_castsi256_si128 (packed),
+                           _mm256_extracti128_si256 (packed, 1));
+}
+
+__attribute__((target ("avx2")))
+static void
+blur_yspan_avx2 (guchar *column,
+                 guchar *tmp_buffer,
+                 int     stride,
+                 int     column_height,
+                 int     y0,
+                 int     y1,
+                 int     d,
+                 int     shift)
+{
+  const __m256i round = _mm256_set1_epi16 (d / 2);
+  const __m256 inv_d = _mm256_set1_ps (1.0f / d);
+  int offset = get_span_offset (d, shift);
+  __m256i sum = _mm256_setzero_si256 ();
+  int i;
+
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < column_height)
+        {
+          __m128i in = _mm_loadu_si128 ((__m128i *) (column + i * stride));
+
+          sum = _mm256_add_epi16 (sum, _mm256_cvtepu8_epi16 (in));
+        }
+
+      if (i >= y0 + offset)
+        {
+          if (i >= d)
+            {
+              __m128i out =
+                _mm_loadu_si128 ((__m128i *) (column + (i - d) * stride));
+
+              sum = _mm256_sub_epi16 (sum, _mm256_cvtepu8_epi16 (out));
+            }
+
+          _mm_storeu_si128 ((__m128i *) (tmp_buffer +
+                                         (i - offset) * SIMD_COLUMNS),
+                            divide_epu16_avx2 (_mm256_add_epi16 (sum, round),
+                                               inv_d));
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    memcpy (column + i * stride, tmp_buffer + i * SIMD_COLUMNS, SIMD_COLUMNS);
+}
+#endif /* HAVE_BLUR_X86 */
+
+#ifdef HAVE_BLUR_NEON
+static inline uint8x8_t
+divide_u16_neon (uint16x8_t  n,
+                 float32x4_t inv_d)
+{
+  const float32x4_t half = vdupq_n_f32 (0.5f);
+  float32x4_t lo, hi;
+
+  lo = vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (n)));
+  hi = vcvtq_f32_u32 (vmovl_u16 (vget_high_u16 (n)));
+  lo = vmulq_f32 (vaddq_f32 (lo, half), inv_d);
+  hi = vmulq_f32 (vaddq_f32 (hi, half), inv_d);
+
+  return vmovn_u16 (vcombine_u16 (vmovn_u32 (vcvtq_u32_f32 (lo)),
+                                  vmovn_u32 (vcvtq_u32_f32 (hi))));
+}
+
+static void
+blur_yspan_neon (guchar *column,
+                 guchar *tmp_buffer,
+                 int     stride,
+                 int     column_height,
+                 int     y0,
+                 int     y1,
+                 int     d,
+                 int     shift)
+{
+  const uint16x8_t round = vdupq_n_u16 (d / 2);
+  const float32x4_t inv_d = vdupq_n_f32 (1.0f / d);
+  int offset = get_span_offset (d, shift);
+  uint16x8_t sum_lo = vdupq_n_u16 (0);
+  uint16x8_t sum_hi = vdupq_n_u16 (0);
+  int i;
+
+  for (i = y0 - d + offset; i < y1 + offset; i++)
+    {
+      if (i >= 0 && i < column_height)
+        {
+          uint8x16_t in = vld1q_u8 (column + i * stride);
+
+          sum_lo = vaddw_u8 (sum_lo, vget_low_u8 (in));
+          sum_hi = vaddw_u8 (sum_hi, vget_high_u8 (in));
+        }
+
+      if (i >= y0 + offset)
+        {
+          uint8x8_t lo, hi;
+
+          if (i >= d)
+            {
+              uint8x16_t out = vld1q_u8 (column + (i - d) * stride);
+
+              sum_lo = vsubw_u8 (sum_lo, vget_low_u8 (out));
+              sum_hi = vsubw_u8 (sum_hi, vget_high_u8 (out));
+            }
+
+          lo = divide_u16_neon (vaddq_u16 (sum_lo, round), inv_d);
+          hi = divide_u16_neon (vaddq_u16 (sum_hi, round), inv_d);
+
+          vst1q_u8 (tmp_buffer + (i - offset) * SIMD_COLUMNS,
+                    vcombine_u8 (lo, hi));
+        }
+    }
+
+  for (i = y0; i < y1; i++)
+    memcpy (column + i * stride, tmp_buffer + i * SIMD_COLUMNS, SIMD_COLUMNS);
+}
+#endif /* HAVE_BLUR_NEON */
+
+typedef void (* BlurYSpanFunc) (guchar *column,
+                                guchar *tmp_buffer,
+                                int     stride,
+                                int     column_height,
+                                int     y0,
+                                int     y1,
+                                int     d,
+                                int     shift);
+
+static BlurYSpanFunc
+get_simd_yspan_func (MetaShadowBlurImpl impl)
+{
+  switch (impl)
+    {
+    case META_SHADOW_BLUR_IMPL_SCALAR:
+      return NULL;
+#ifdef HAVE_BLUR_X86
+    case META_SHADOW_BLUR_IMPL_SSE2:
+      return blur_yspan_sse2;
+    case META_SHADOW_BLUR_IMPL_AVX2:
+      return blur_yspan_avx2;
+#endif
+#ifdef HAVE_BLUR_NEON
+    case META_SHADOW_BLUR_IMPL_NEON:
+      return blur_yspan_neon;
+#endif
+    default:
+      return NULL;
+    }
+}
+
+static void
+blur_column_group (BlurYSpanFunc  blur_yspan_func,
+                   guchar        *column,
+                   guchar        *tmp_buffer,
+                   int            stride,
+                   int            column_height,
+                   int            y0,
+                   int            y1,
+                   int            d)
+{
+  /* See meta_shadow_blur_rows() for the even filter size case */
+  if (d % 2 == 1)
+    {
+      blur_yspan_func (column, tmp_buffer, stride, column_height, y0, y1, d, 0);
+      blur_yspan_func (column, tmp_buffer, stride, column_height, y0, y1, d, 0);
+      blur_yspan_func (column, tmp_buffer, stride, column_height, y0, y1, d, 0);
+    }
+  else
+    {
+      blur_yspan_func (column, tmp_buffer, stride, column_height, y0, y1, d, 1);
+      blur_yspan_func (column, tmp_buffer, stride, column_height, y0, y1, d, -1);
+      blur_yspan_func (column, tmp_buffer, stride, column_height, y0, y1, d + 1, 0);
+    }
+}
+
+gboolean
+meta_shadow_blur_impl_is_supported (MetaShadowBlurImpl impl)
+{
+  switch (impl)
+    {
+    case META_SHADOW_BLUR_IMPL_SCALAR:
+      return TRUE;
+#ifdef HAVE_BLUR_X86
+    case META_SHADOW_BLUR_IMPL_SSE2:
+      return __builtin_cpu_supports ("sse2");
+    case META_SHADOW_BLUR_IMPL_AVX2:
+      return __builtin_cpu_supports ("avx2");
+#endif
+#ifdef HAVE_BLUR_NEON
+    case META_SHADOW_BLUR_IMPL_NEON:
+      return TRUE;
+#endif
+    default:
+      return FALSE;
+    }
+}
+
+const char *
+meta_shadow_blur_impl_to_string (MetaShadowBlurImpl impl)
+{
+  switch (impl)
+    {
+    case META_SHADOW_BLUR_IMPL_SCALAR:
+      return "scalar";
+    case META_SHADOW_BLUR_IMPL_SSE2:
+      return "sse2";
+    case META_SHADOW_BLUR_IMPL_AVX2:
+      return "avx2";
+    case META_SHADOW_BLUR_IMPL_NEON:
+      return "neon";
+    case META_N_SHADOW_BLUR_IMPLS:
+      break;
+    }
+
+  g_assert_not_reached ();
+}
+
+static MetaShadowBlurImpl
+choose_default_impl (void)
+{
+  const char *env;
+  int impl;
+
+  env = g_getenv ("MUTTER_DEBUG_SHADOW_BLUR");
+  if (env)
+    {
+      for (impl = 0; impl < META_N_SHADOW_BLUR_IMPLS; impl++)
+        {
+          if (g_str_equal (env, meta_shadow_blur_impl_to_string (impl)) &&
+              meta_shadow_blur_impl_is_supported (impl))
+            return impl;
+        }
+    }
+
+  for (impl = META_N_SHADOW_BLUR_IMPLS - 1; impl > 0; impl--)
+    {
+      if (meta_shadow_blur_impl_is_supported (impl))
+        return impl;
+    }
+
+  return META_SHADOW_BLUR_IMPL_SCALAR;
+}
+
+MetaShadowBlurImpl
+meta_shadow_blur_get_default_impl (void)
+{
+  static gsize default_impl = 0;
+
+  if (g_once_init_enter (&default_impl))
+    g_once_init_leave (&default_impl, choose_default_impl () + 1);
+
+  return default_impl - 1;
+}
+
+/* Blurs the columns of the buffer. The convolve region is in transposed
+ * coordinates, i.e. rect.y and rect.height select the columns and rect.x
+ * and rect.width the range of rows, the same way it is used for blurring
+ * the rows of a flipped buffer. Returns the blurred buffer, which for the
+ * scalar implementation might not be the buffer passed in.
+ */
+guchar *
+meta_shadow_blur_columns (MetaShadowBlurImpl  impl,
+                          cairo_region_t     *convolve_region,
+                          int                 x_offset,
+                          int                 y_offset,
+                          guchar             *buffer,
+                          int                 buffer_width,
+                          int                 buffer_height,
+                          int                 d)
+{
+  BlurYSpanFunc blur_yspan_func;
+  guchar *tmp_buffer;
+  int n_rectangles;
+  int i;
+
+  blur_yspan_func = get_simd_yspan_func (impl);
+
+  if (!blur_yspan_func || d + 1 > SIMD_MAX_FILTER_SIZE)
+    {
+      buffer = flip_buffer (buffer, buffer_width, buffer_height);
+      meta_shadow_blur_rows (convolve_region, y_offset, x_offset,
+                             buffer, buffer_height, buffer_width,
+                             d);
+      return flip_buffer (buffer, buffer_height, buffer_width);
+    }
+
+  tmp_buffer = g_malloc (buffer_height * SIMD_COLUMNS);
+
+  n_rectangles = cairo_region_num_rectangles (convolve_region);
+  for (i = 0; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int x0, x1, y0, y1;
+      int x;
+
+      cairo_region_get_rectangle (convolve_region, i, &rect);
+
+      x0 = x_offset + rect.y;
+      x1 = x0 + rect.height;
+      y0 = y_offset + rect.x;
+      y1 = y0 + rect.width;
+
+      for (x = x0; x + SIMD_COLUMNS <= x1; x += SIMD_COLUMNS)
+        blur_column_group (blur_yspan_func, buffer + x, tmp_buffer,
+                           buffer_width, buffer_height, y0, y1, d);
+
+      for (; x < x1; x++)
+        blur_column_group (blur_yspan, buffer + x, tmp_buffer,
+                           buffer_width, buffer_height, y0, y1, d);
+    }
+
+  g_free (tmp_buffer);
+
+  return buffer;
+}
@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "compositor/cogl-utils.h"
+#include "compositor/meta-shadow-blur.h"
 #include "compositor/region-utils.h"
 #include "meta/meta-shadow-factory.h"
 #include "meta/util.h"
@@ -496,8 +497,8 @@ get_box_filter_size (int radius)
 
 /* The "spread" of the filter is the number of pixels from an original
  * pixel that it's blurred image extends. (A no-op blur that doesn't
- * blur would have a spread of 0.) See comment in blur_rows() for why the
- * odd and even cases are different
+ * blur would have a spread of 0.) See comment in meta_shadow_blur_rows()
+ * for why the odd and even cases are different
  */
 static int
 get_shadow_spread (int radius)
@@ -515,112 +516,6 @@ get_shadow_spread (int radius)
     return 3 * (d / 2) - 1;
 }
 
-/* This applies a single box blur pass to a horizontal range of pixels;
- * since the box blur has the same weight for all pixels, we can
- * implement an efficient sliding window algorithm where we add
- * in pixels coming into the window from the right and remove
- * them when they leave the windw to the left.
- *
- * d is the filter width; for even d shift indicates how the blurred
- * result is aligned with the original - does ' x ' go to ' yy' (shift=1)
- * or 'yy ' (shift=-1)
- */
-static void
-blur_xspan (guchar *row,
-            guchar *tmp_buffer,
-            int     row_width,
-            int     x0,
-            int     x1,
-            int     d,
-            int     shift)
-{
-  int offset;
-  int sum = 0;
-  int i;
-
-  if (d % 2 == 1)
-    offset = d / 2;
-  else
-    offset = (d - shift) / 2;
-
-  /* All the conditionals in here look slow, but the branches will
-   * be well predicted and there are enough different possibilities
-   * that trying to write this as a series of unconditional loops
-   * is hard and not an obvious win. The main slow down here seems
-   * to be the integer division per pixel; one possible optimization
-   * would be to accumulate into two 16-bit integer buffers and
-   * only divide down after all three passes. (SSE parallel implementation
-   * of the divide step is possible.)
-   */
-  for (i = x0 - d + offset; i < x1 + offset; i++)
-    {
-      if (i >= 0 && i < row_width)
-        sum += row[i];
-
-      if (i >= x0 + offset)
-        {
-          if (i >= d)
-            sum -= row[i - d];
-
-          tmp_buffer[i - offset] = (sum + d / 2) / d;
-        }
-    }
-
-  memcpy (row + x0, tmp_buffer + x0, x1 - x0);
-}
-
-static void
-blur_rows (cairo_region_t   *convolve_region,
-           int               x_offset,
-           int               y_offset,
-           guchar           *buffer,
-           int               buffer_width,
-           int               buffer_height,
-           int               d)
-{
-  int i, j;
-  int n_rectangles;
-  guchar *tmp_buffer;
-
-  tmp_buffer = g_malloc (buffer_width);
-
-  n_rectangles = cairo_region_num_rectangles (convolve_region);
-  for (i = 0; i < n_rectangles; i++)
-    {
-      cairo_rectangle_int_t rect;
-
-      cairo_region_get_rectangle (convolve_region, i, &rect);
-
-      for (j = y_offset + rect.y; j < y_offset + rect.y + rect.height; j++)
-        {
-          guchar *row = buffer + j * buffer_width;
-          int x0 = x_offset + rect.x;
-          int x1 = x0 + rect.width;
-
-          /* We want to produce a symmetric blur that spreads a pixel
-           * equally far to the left and right. If d is odd that happens
-           * naturally, but for d even, we approximate by using a blur
-           * on either side and then a centered blur of size d + 1.
-           * (technique also from the SVG specification)
-           */
-          if (d % 2 == 1)
-            {
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 0);
-            }
-          else
-            {
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, 1);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d, -1);
-              blur_xspan (row, tmp_buffer, buffer_width, x0, x1, d + 1, 0);
-            }
-        }
-    }
-
-  g_free (tmp_buffer);
-}
-
 static void
 fade_bytes (guchar *bytes,
             int     width,
@@ -634,78 +529,6 @@ fade_bytes (guchar *bytes,
     bytes[i] = (bytes[i] * multiplier) >> 16;
 }
 
-/* Swaps width and height. Either swaps in-place and returns the original
- * buffer or allocates a new buffer, frees the original buffer and returns
- * the new buffer.
- */
-static guchar *
-flip_buffer (guchar *buffer,
-             int     width,
-             int     height)
-{
-  /* Working in blocks increases cache efficiency, compared to reading
-   * or writing an entire column at once */
-#define BLOCK_SIZE 16
-
-  if (width == height)
-    {
-      int i0, j0;
-
-      for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-        for (i0 = 0; i0 <= j0; i0 += BLOCK_SIZE)
-          {
-            int max_j = MIN(j0 + BLOCK_SIZE, height);
-            int max_i = MIN(i0 + BLOCK_SIZE, width);
-            int i, j;
-
-            if (i0 == j0)
-              {
-                for (j = j0; j < max_j; j++)
-                  for (i = i0; i < j; i++)
-                    {
-                      guchar tmp = buffer[j * width + i];
-                      buffer[j * width + i] = buffer[i * width + j];
-                      buffer[i * width + j] = tmp;
-                    }
-              }
-            else
-              {
-                for (j = j0; j < max_j; j++)
-                  for (i = i0; i < max_i; i++)
-                    {
-                      guchar tmp = buffer[j * width + i];
-                      buffer[j * width + i] = buffer[i * width + j];
-                      buffer[i * width + j] = tmp;
-                    }
-              }
-          }
-
-      return buffer;
-    }
-  else
-    {
-      guchar *new_buffer = g_malloc (height * width);
-      int i0, j0;
-
-      for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
-        for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-          {
-            int max_j = MIN(j0 + BLOCK_SIZE, height);
-            int max_i = MIN(i0 + BLOCK_SIZE, width);
-            int i, j;
-
-            for (i = i0; i < max_i; i++)
-              for (j = j0; j < max_j; j++)
-                new_buffer[i * height + j] = buffer[j * width + i];
-          }
-
-      g_free (buffer);
-
-      return new_buffer;
-    }
-#undef BLOCK_SIZE
-}
-
 static void
 make_shadow (MetaShadow     *shadow,
              cairo_region_t *region)
@@ -775,23 +598,20 @@ make_shadow (MetaShadow     *shadow,
         memset (buffer + buffer_width * j + x_offset + rect.x, 255, rect.width);
     }
 
-  /* Step 2: swap rows and columns */
-  buffer = flip_buffer (buffer, buffer_width, buffer_height);
-
-  /* Step 3: blur rows (really columns) */
-  blur_rows (column_convolve_region, y_offset, x_offset,
-             buffer, buffer_height, buffer_width,
-             d);
-
-  /* Step 4: swap rows and columns */
-  buffer = flip_buffer (buffer, buffer_height, buffer_width);
+  /* Step 2: blur columns; this either swaps rows and columns and blurs
+   * rows, or blurs groups of adjacent columns in place with SIMD */
+  buffer = meta_shadow_blur_columns (meta_shadow_blur_get_default_impl (),
+                                     column_convolve_region,
+                                     x_offset, y_offset,
+                                     buffer, buffer_width, buffer_height,
+                                     d);
 
-  /* Step 5: blur rows */
-  blur_rows (row_convolve_region, x_offset, y_offset,
-             buffer, buffer_width, buffer_height,
-             d);
+  /* Step 3: blur rows */
+  meta_shadow_blur_rows (row_convolve_region, x_offset, y_offset,
+                         buffer, buffer_width, buffer_height,
+                         d);
 
-  /* Step 6: fade out the top, if applicable */
+  /* Step 4: fade out the top, if applicable */
   if (shadow->key.top_fade >= 0)
     {
       for (j = y_offset; j < y_offset + MIN (shadow->key.top_fade, extents.height + shadow->outer_border_bottom); j++)
@@ -30,6 +30,9 @@
 #include "backends/meta-monitor-manager-private.h"
 #include "meta/meta-shaped-texture.h"
 
+typedef CoglTexture * (* MetaShapedTextureMaskFunc) (MetaShapedTexture *stex,
+                                                      gpointer           user_data);
+
 MetaShapedTexture *meta_shaped_texture_new (void);
 void meta_shaped_texture_set_texture (MetaShapedTexture *stex,
                                       CoglTexture       *texture);
@@ -68,7 +71,12 @@ int meta_shaped_texture_get_height (MetaShapedTexture *stex);
 
 void meta_shaped_texture_set_clip_region (MetaShapedTexture *stex,
                                           cairo_region_t    *clip_region);
+void meta_shaped_texture_set_overlay_view (MetaShapedTexture *stex,
+                                           ClutterStageView  *overlay_view);
 void meta_shaped_texture_set_opaque_region (MetaShapedTexture *stex,
                                             cairo_region_t    *opaque_region);
+void meta_shaped_texture_set_mask_func (MetaShapedTexture         *stex,
+                                        MetaShapedTextureMaskFunc  mask_func,
+                                        gpointer                   user_data);
 
 #endif
@@ -39,8 +39,10 @@
 #include <gdk/gdk.h>
 #include <math.h>
 
+#include "clutter/clutter-mutter.h"
 #include "cogl/cogl.h"
 #include "compositor/clutter-utils.h"
+#include "compositor/meta-texture-budget.h"
 #include "compositor/meta-texture-tower.h"
 #include "compositor/region-utils.h"
 #include "core/boxes-private.h"
@@ -62,6 +64,8 @@
 
 static void meta_shaped_texture_dispose  (GObject    *object);
 
+static size_t evict_textures (gpointer user_data);
+
 static void clutter_content_iface_init (ClutterContentInterface *iface);
 
 enum
@@ -83,11 +87,15 @@ struct _MetaShapedTexture
   GObject parent;
 
   MetaTextureTower *paint_tower;
+  MetaTextureBudgetEntry *budget_entry;
 
   CoglTexture *texture;
   CoglTexture *mask_texture;
   CoglSnippet *snippet;
 
+  MetaShapedTextureMaskFunc mask_func;
+  gpointer mask_func_data;
+
   CoglPipeline *base_pipeline;
   CoglPipeline *masked_pipeline;
   CoglPipeline *unblended_pipeline;
@@ -100,6 +108,9 @@ struct _MetaShapedTexture
   /* MetaCullable regions, see that documentation for more details */
   cairo_region_t *clip_region;
 
+  /* View scanning out the contents from an overlay plane, not owned */
+  ClutterStageView *overlay_view;
+
   gboolean size_invalid;
   MetaMonitorTransform transform;
   gboolean has_viewport_src_rect;
@@ -120,6 +131,7 @@ struct _MetaShapedTexture
   int buffer_scale;
 
   guint create_mipmaps : 1;
+  guint mask_evicted : 1;
 };
 
 G_DEFINE_TYPE_WITH_CODE (MetaShapedTexture, meta_shaped_texture, G_TYPE_OBJECT,
@@ -151,6 +163,7 @@ static void
 meta_shaped_texture_init (MetaShapedTexture *stex)
 {
   stex->paint_tower = meta_texture_tower_new ();
+  stex->budget_entry = meta_texture_budget_add (evict_textures, stex);
 
   stex->buffer_scale = 1;
   stex->texture = NULL;
@@ -236,6 +249,37 @@ meta_shaped_texture_set_clip_region (MetaShapedTexture *stex,
     stex->clip_region = cairo_region_reference (clip_region);
 }
 
+/*
+ * While the contents are scanned out from an overlay plane stacked above
+ * @overlay_view, painting them into the framebuffer of that view is
+ * skipped, leaving a hole in the composited output. They are still painted
+ * anywhere else, e.g. offscreen, and while overlays of the view are
+ * inhibited.
+ */
+void
+meta_shaped_texture_set_overlay_view (MetaShapedTexture *stex,
+                                      ClutterStageView  *overlay_view)
+{
+  stex->overlay_view = overlay_view;
+}
+
+static gboolean
+is_painting_overlay_view (MetaShapedTexture   *stex,
+                          ClutterPaintContext *paint_context)
+{
+  CoglFramebuffer *framebuffer;
+
+  if (!stex->overlay_view)
+    return FALSE;
+
+  if (clutter_stage_view_are_overlays_inhibited (stex->overlay_view))
+    return FALSE;
+
+  framebuffer = clutter_paint_context_get_framebuffer (paint_context);
+
+  return framebuffer == clutter_stage_view_get_framebuffer (stex->overlay_view);
+}
+
 static void
 meta_shaped_texture_reset_pipelines (MetaShapedTexture *stex)
 {
@@ -244,6 +288,65 @@ meta_shaped_texture_reset_pipelines (MetaShapedTexture *stex)
   g_clear_pointer (&stex->unblended_pipeline, cogl_object_unref);
 }
 
+static size_t
+get_mask_memory_size (MetaShapedTexture *stex)
+{
+  /* Only masks that can be recreated are subject to the texture budget */
+  if (!stex->mask_texture || !stex->mask_func)
+    return 0;
+
+  return ((size_t) cogl_texture_get_width (stex->mask_texture) *
+          cogl_texture_get_height (stex->mask_texture));
+}
+
+static size_t
+get_evictable_memory_size (MetaShapedTexture *stex)
+{
+  return (meta_texture_tower_get_memory_size (stex->paint_tower) +
+          get_mask_memory_size (stex));
+}
+
+static void
+update_budget_size (MetaShapedTexture *stex)
+{
+  if (!stex->budget_entry)
+    return;
+
+  meta_texture_budget_update_size (stex->budget_entry,
+                                   get_evictable_memory_size (stex));
+}
+
+static size_t
+evict_textures (gpointer user_data)
+{
+  MetaShapedTexture *stex = META_SHAPED_TEXTURE (user_data);
+  size_t freed;
+
+  freed = meta_texture_tower_evict (stex->paint_tower);
+
+  if (stex->mask_texture && stex->mask_func)
+    {
+      freed += get_mask_memory_size (stex);
+      g_clear_pointer (&stex->mask_texture, cogl_object_unref);
+      stex->mask_evicted = TRUE;
+    }
+
+  /* The cached pipelines may still reference the evicted textures */
+  meta_shaped_texture_reset_pipelines (stex);
+
+  return freed;
+}
+
+static void
+ensure_mask_texture (MetaShapedTexture *stex)
+{
+  if (!stex->mask_evicted)
+    return;
+
+  stex->mask_evicted = FALSE;
+  stex->mask_texture = stex->mask_func (stex, stex->mask_func_data);
+}
+
 static void
 meta_shaped_texture_dispose (GObject *object)
 {
@@ -251,6 +354,8 @@ meta_shaped_texture_dispose (GObject *object)
 
   g_clear_handle_id (&stex->remipmap_timeout_id, g_source_remove);
 
+  g_clear_pointer (&stex->budget_entry, meta_texture_budget_remove);
+
   if (stex->paint_tower)
     meta_texture_tower_free (stex->paint_tower);
   stex->paint_tower = NULL;
@@ -550,7 +655,10 @@ set_cogl_texture (MetaShapedTexture *stex,
    * damage. */
 
   if (stex->create_mipmaps)
-    meta_texture_tower_set_base_texture (stex->paint_tower, cogl_tex);
+    {
+      meta_texture_tower_set_base_texture (stex->paint_tower, cogl_tex);
+      update_budget_size (stex);
+    }
 }
 
 static gboolean
@@ -592,6 +700,7 @@ do_paint_content (MetaShapedTexture   *stex,
   cairo_region_t *blended_tex_region;
   CoglContext *ctx;
   CoglPipelineFilter filter;
+  CoglPipelineFilter min_filter;
   CoglFramebuffer *framebuffer;
   int sample_width, sample_height;
   gboolean debug_paint_opaque_region;
@@ -643,6 +752,13 @@ do_paint_content (MetaShapedTexture   *stex,
   else
     filter = COGL_PIPELINE_FILTER_LINEAR;
 
+  /* Let the GPU pick the mipmap level matching the paint scale */
+  if (filter == COGL_PIPELINE_FILTER_LINEAR &&
+      meta_texture_tower_is_mipmapped (stex->paint_tower, paint_tex))
+    min_filter = COGL_PIPELINE_FILTER_LINEAR_MIPMAP_NEAREST;
+  else
+    min_filter = filter;
+
   ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
 
   use_opaque_region = stex->opaque_region && opacity == 255;
@@ -703,7 +819,8 @@ do_paint_content (MetaShapedTexture   *stex,
 
           opaque_pipeline = get_unblended_pipeline (stex, ctx);
           cogl_pipeline_set_layer_texture (opaque_pipeline, 0, paint_tex);
-          cogl_pipeline_set_layer_filters (opaque_pipeline, 0, filter, filter);
+          cogl_pipeline_set_layer_filters (opaque_pipeline, 0,
+                                           min_filter, filter);
 
           n_rects = cairo_region_num_rectangles (region);
           for (i = 0; i < n_rects; i++)
@@ -755,7 +872,8 @@ do_paint_content (MetaShapedTexture   *stex,
         }
 
       cogl_pipeline_set_layer_texture (blended_pipeline, 0, paint_tex);
-      cogl_pipeline_set_layer_filters (blended_pipeline, 0, filter, filter);
+      cogl_pipeline_set_layer_filters (blended_pipeline, 0,
+                                       min_filter, filter);
 
       CoglColor color;
       cogl_color_init_from_4ub (&color, opacity, opacity, opacity, opacity);
@@ -878,6 +996,9 @@ meta_shaped_texture_paint_content (ClutterContent      *content,
   if (stex->clip_region && cairo_region_is_empty (stex->clip_region))
     return;
 
+  if (is_painting_overlay_view (stex, paint_context))
+    return;
+
   /* The GL EXT_texture_from_pixmap extension does allow for it to be
    * used together with SGIS_generate_mipmap, however this is very
    * rarely supported. Also, even when it is supported there
@@ -897,10 +1018,15 @@ meta_shaped_texture_paint_content (ClutterContent      *content,
   if (!paint_tex)
     return;
 
+  ensure_mask_texture (stex);
+
   opacity = clutter_actor_get_paint_opacity (actor);
   clutter_actor_get_content_box (actor, &alloc);
 
   do_paint_content (stex, root_node, paint_context, paint_tex, &alloc, opacity);
+
+  meta_texture_budget_mark_used (stex->budget_entry,
+                                 get_evictable_memory_size (stex));
 }
 
 static gboolean
@@ -942,6 +1068,7 @@ meta_shaped_texture_set_create_mipmaps (MetaShapedTexture *stex,
       stex->create_mipmaps = create_mipmaps;
       base_texture = create_mipmaps ? stex->texture : NULL;
       meta_texture_tower_set_base_texture (stex->paint_tower, base_texture);
+      update_budget_size (stex);
     }
 }
 
@@ -952,6 +1079,7 @@ meta_shaped_texture_set_mask_texture (MetaShapedTexture *stex,
   g_return_if_fail (META_IS_SHAPED_TEXTURE (stex));
 
   g_clear_pointer (&stex->mask_texture, cogl_object_unref);
+  stex->mask_evicted = FALSE;
 
   if (mask_texture != NULL)
     {
@@ -959,9 +1087,36 @@ meta_shaped_texture_set_mask_texture (MetaShapedTexture *stex,
       cogl_object_ref (stex->mask_texture);
     }
 
+  update_budget_size (stex);
+
   clutter_content_invalidate (CLUTTER_CONTENT (stex));
 }
 
+/*
+ * Sets a function recreating the mask texture. When set, the mask texture
+ * may be freed when the window has not been painted for a while and the
+ * texture memory budget is exceeded, and is recreated with @mask_func the
+ * next time it is painted.
+ */
+void
+meta_shaped_texture_set_mask_func (MetaShapedTexture         *stex,
+                                   MetaShapedTextureMaskFunc  mask_func,
+                                   gpointer                   user_data)
+{
+  g_return_if_fail (META_IS_SHAPED_TEXTURE (stex));
+
+  if (!mask_func && stex->mask_evicted)
+    {
+      stex->mask_evicted = FALSE;
+      clutter_content_invalidate (CLUTTER_CONTENT (stex));
+    }
+
+  stex->mask_func = mask_func;
+  stex->mask_func_data = user_data;
+
+  update_budget_size (stex);
+}
+
 /**
  * meta_shaped_texture_update_area:
  * @stex: #MetaShapedTexture
@@ -1478,6 +1633,7 @@ meta_shaped_texture_get_image (MetaShapedTexture     *stex,
     return NULL;
 
   ensure_size_valid (stex);
+  ensure_mask_texture (stex);
 
   if (stex->dst_width == 0 || stex->dst_height == 0)
     return NULL;
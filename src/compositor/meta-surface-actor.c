@@ -36,9 +36,15 @@ typedef struct _MetaSurfaceActorPrivate
   /* MetaCullable regions, see that documentation for more details */
   cairo_region_t *unobscured_region;
 
+  /* Reused every frame to hold the clip of the texture */
+  cairo_region_t *clip_region;
+
   /* Freeze/thaw accounting */
   cairo_region_t *pending_damage;
   guint frozen : 1;
+
+  /* View scanning out the contents from an overlay plane, not owned */
+  ClutterStageView *overlay_view;
 } MetaSurfaceActorPrivate;
 
 static void cullable_iface_init (MetaCullableInterface *iface);
@@ -77,18 +83,25 @@ effective_unobscured_region (MetaSurfaceActor *surface_actor)
   return priv->unobscured_region;
 }
 
+static int
+get_geometry_scale (MetaSurfaceActor *surface_actor)
+{
+  MetaWindowActor *window_actor;
+
+  window_actor = meta_window_actor_from_actor (CLUTTER_ACTOR (surface_actor));
+  return meta_window_actor_get_geometry_scale (window_actor);
+}
+
 static cairo_region_t*
 get_scaled_region (MetaSurfaceActor     *surface_actor,
                    cairo_region_t       *region,
                    ScalePerspectiveType  scale_perspective)
 {
-  MetaWindowActor *window_actor;
   cairo_region_t *scaled_region;
   int geometry_scale;
   float x, y;
 
-  window_actor = meta_window_actor_from_actor (CLUTTER_ACTOR (surface_actor));
-  geometry_scale = meta_window_actor_get_geometry_scale (window_actor);
+  geometry_scale = get_geometry_scale (surface_actor);
 
   clutter_actor_get_position (CLUTTER_ACTOR (surface_actor), &x, &y);
   cairo_region_translate (region, x, y);
@@ -113,6 +126,11 @@ get_scaled_region (MetaSurfaceActor     *surface_actor,
   return scaled_region;
 }
 
+/*
+ * Culling happens every frame for every window, so the regions kept by
+ * the surface actor are updated in place rather than recreated, which
+ * avoids allocating in the common case of unscaled windows.
+ */
 static void
 set_unobscured_region (MetaSurfaceActor *surface_actor,
                        cairo_region_t   *unobscured_region)
@@ -120,32 +138,44 @@ set_unobscured_region (MetaSurfaceActor *surface_actor,
   MetaSurfaceActorPrivate *priv =
     meta_surface_actor_get_instance_private (surface_actor);
 
-  g_clear_pointer (&priv->unobscured_region, cairo_region_destroy);
-  if (unobscured_region)
+  if (!unobscured_region)
     {
-      if (cairo_region_is_empty (unobscured_region))
+      g_clear_pointer (&priv->unobscured_region, cairo_region_destroy);
+      return;
+    }
+
+  if (cairo_region_is_empty (unobscured_region))
+    {
+      priv->unobscured_region =
+        meta_region_copy_into (priv->unobscured_region, unobscured_region);
+    }
+  else
+    {
+      cairo_rectangle_int_t bounds = { 0, };
+      float width, height;
+
+      clutter_content_get_preferred_size (CLUTTER_CONTENT (priv->texture),
+                                          &width,
+                                          &height);
+      bounds = (cairo_rectangle_int_t) {
+        .width = width,
+        .height = height,
+      };
+
+      if (get_geometry_scale (surface_actor) == 1)
         {
-          priv->unobscured_region = cairo_region_reference (unobscured_region);
+          priv->unobscured_region =
+            meta_region_copy_into (priv->unobscured_region, unobscured_region);
         }
       else
         {
-          cairo_rectangle_int_t bounds = { 0, };
-          float width, height;
-
-          clutter_content_get_preferred_size (CLUTTER_CONTENT (priv->texture),
-                                              &width,
-                                              &height);
-          bounds = (cairo_rectangle_int_t) {
-            .width = width,
-            .height = height,
-          };
-
+          g_clear_pointer (&priv->unobscured_region, cairo_region_destroy);
           priv->unobscured_region = get_scaled_region (surface_actor,
                                                        unobscured_region,
                                                        IN_ACTOR_PERSPECTIVE);
-
-          cairo_region_intersect_rectangle (priv->unobscured_region, &bounds);
         }
+
+      cairo_region_intersect_rectangle (priv->unobscured_region, &bounds);
     }
 }
 
@@ -159,14 +189,26 @@ set_clip_region (MetaSurfaceActor *surface_actor,
 
   if (clip_region && !cairo_region_is_empty (clip_region))
     {
-      cairo_region_t *region;
+      if (get_geometry_scale (surface_actor) == 1)
+        {
+          /* The texture only keeps a reference, so drop it before reusing
+           * the region, to make sure it's never seen half updated */
+          meta_shaped_texture_set_clip_region (stex, NULL);
+          priv->clip_region = meta_region_copy_into (priv->clip_region,
+                                                     clip_region);
+          meta_shaped_texture_set_clip_region (stex, priv->clip_region);
+        }
+      else
+        {
+          cairo_region_t *region;
 
-      region = get_scaled_region (surface_actor,
-                                  clip_region,
-                                  IN_ACTOR_PERSPECTIVE);
-      meta_shaped_texture_set_clip_region (stex, region);
+          region = get_scaled_region (surface_actor,
+                                      clip_region,
+                                      IN_ACTOR_PERSPECTIVE);
+          meta_shaped_texture_set_clip_region (stex, region);
 
-      cairo_region_destroy (region);
+          cairo_region_destroy (region);
+        }
     }
   else
     {
@@ -241,10 +283,35 @@ meta_surface_actor_dispose (GObject *object)
   g_clear_object (&priv->texture);
 
   set_unobscured_region (self, NULL);
+  g_clear_pointer (&priv->clip_region, cairo_region_destroy);
 
   G_OBJECT_CLASS (meta_surface_actor_parent_class)->dispose (object);
 }
 
+static cairo_region_t *
+meta_surface_actor_get_opaque_region (ClutterActor *actor)
+{
+  MetaSurfaceActor *surface_actor = META_SURFACE_ACTOR (actor);
+  MetaSurfaceActorPrivate *priv =
+    meta_surface_actor_get_instance_private (surface_actor);
+  cairo_region_t *opaque_region;
+  cairo_rectangle_int_t rect;
+
+  opaque_region = meta_shaped_texture_get_opaque_region (priv->texture);
+  if (opaque_region)
+    return cairo_region_copy (opaque_region);
+
+  if (!meta_shaped_texture_is_opaque (priv->texture))
+    return NULL;
+
+  rect = (cairo_rectangle_int_t) {
+    .width = meta_shaped_texture_get_width (priv->texture),
+    .height = meta_shaped_texture_get_height (priv->texture)
+  };
+
+  return cairo_region_create_rectangle (&rect);
+}
+
 static void
 meta_surface_actor_class_init (MetaSurfaceActorClass *klass)
 {
@@ -254,6 +321,7 @@ meta_surface_actor_class_init (MetaSurfaceActorClass *klass)
   object_class->dispose = meta_surface_actor_dispose;
   actor_class->pick = meta_surface_actor_pick;
   actor_class->get_paint_volume = meta_surface_actor_get_paint_volume;
+  actor_class->get_opaque_region = meta_surface_actor_get_opaque_region;
 
   signals[REPAINT_SCHEDULED] = g_signal_new ("repaint-scheduled",
                                              G_TYPE_FROM_CLASS (object_class),
@@ -282,8 +350,6 @@ meta_surface_actor_cull_out (MetaCullable   *cullable,
                              cairo_region_t *clip_region)
 {
   MetaSurfaceActor *surface_actor = META_SURFACE_ACTOR (cullable);
-  MetaSurfaceActorPrivate *priv =
-    meta_surface_actor_get_instance_private (surface_actor);
   uint8_t opacity = clutter_actor_get_opacity (CLUTTER_ACTOR (cullable));
 
   set_unobscured_region (surface_actor, unobscured_region);
@@ -291,30 +357,44 @@ meta_surface_actor_cull_out (MetaCullable   *cullable,
 
   if (opacity == 0xff)
     {
+      MetaSurfaceActorPrivate *priv =
+        meta_surface_actor_get_instance_private (surface_actor);
       cairo_region_t *opaque_region;
       cairo_region_t *scaled_opaque_region;
 
-      opaque_region = meta_shaped_texture_get_opaque_region (priv->texture);
-      if (opaque_region)
-        {
-          cairo_region_reference (opaque_region);
-        }
-      else if (meta_shaped_texture_is_opaque (priv->texture))
+      if (get_geometry_scale (surface_actor) == 1)
         {
-          cairo_rectangle_int_t rect;
+          /* Avoid copying the opaque region when no scaling is needed */
+          opaque_region = meta_shaped_texture_get_opaque_region (priv->texture);
+          if (opaque_region)
+            {
+              if (unobscured_region)
+                cairo_region_subtract (unobscured_region, opaque_region);
+              if (clip_region)
+                cairo_region_subtract (clip_region, opaque_region);
+            }
+          else if (meta_shaped_texture_is_opaque (priv->texture))
+            {
+              cairo_rectangle_int_t rect;
 
-          rect = (cairo_rectangle_int_t) {
-            .width = meta_shaped_texture_get_width (priv->texture),
-            .height = meta_shaped_texture_get_height (priv->texture)
-          };
+              rect = (cairo_rectangle_int_t) {
+                .width = meta_shaped_texture_get_width (priv->texture),
+                .height = meta_shaped_texture_get_height (priv->texture)
+              };
+
+              if (unobscured_region)
+                cairo_region_subtract_rectangle (unobscured_region, &rect);
+              if (clip_region)
+                cairo_region_subtract_rectangle (clip_region, &rect);
+            }
 
-          opaque_region = cairo_region_create_rectangle (&rect);
-        }
-      else
-        {
           return;
         }
 
+      opaque_region = clutter_actor_get_opaque_region (CLUTTER_ACTOR (cullable));
+      if (!opaque_region)
+        return;
+
       scaled_opaque_region = get_scaled_region (surface_actor,
                                                 opaque_region,
                                                 IN_STAGE_PERSPECTIVE);
@@ -591,6 +671,35 @@ meta_surface_actor_is_frozen (MetaSurfaceActor *self)
   return priv->frozen;
 }
 
+/*
+ * Marks the contents of the surface as being scanned out from an overlay
+ * plane stacked above the composited output of @overlay_view, or clears it
+ * when NULL. While on an overlay, the contents are not painted into that
+ * view, but the surface still occludes what is below it, so that damage to
+ * it only results in a cheap redraw.
+ */
+void
+meta_surface_actor_set_overlay_view (MetaSurfaceActor *self,
+                                     ClutterStageView *overlay_view)
+{
+  MetaSurfaceActorPrivate *priv =
+    meta_surface_actor_get_instance_private (self);
+
+  priv->overlay_view = overlay_view;
+
+  if (priv->texture)
+    meta_shaped_texture_set_overlay_view (priv->texture, overlay_view);
+}
+
+ClutterStageView *
+meta_surface_actor_get_overlay_view (MetaSurfaceActor *self)
+{
+  MetaSurfaceActorPrivate *priv =
+    meta_surface_actor_get_instance_private (self);
+
+  return priv->overlay_view;
+}
+
 void
 meta_surface_actor_set_transform (MetaSurfaceActor     *self,
                                   MetaMonitorTransform  transform)
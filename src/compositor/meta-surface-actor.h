@@ -55,6 +55,10 @@ gboolean meta_surface_actor_is_frozen (MetaSurfaceActor *actor);
 void meta_surface_actor_set_frozen (MetaSurfaceActor *actor,
                                     gboolean          frozen);
 
+void meta_surface_actor_set_overlay_view (MetaSurfaceActor *self,
+                                          ClutterStageView *overlay_view);
+ClutterStageView * meta_surface_actor_get_overlay_view (MetaSurfaceActor *self);
+
 void meta_surface_actor_set_transform (MetaSurfaceActor     *self,
                                        MetaMonitorTransform  transform);
 void meta_surface_actor_set_viewport_src_rect (MetaSurfaceActor *self,
@@ -0,0 +1,206 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2020 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Keeps track of GPU memory used by textures that can be recreated on
+ * demand, such as the scaled down levels of texture towers and shape
+ * masks of windows. Entries are kept in least recently used order, and
+ * when the memory in use exceeds the budget, the resources of entries
+ * that have not been used for a while are evicted.
+ *
+ * The budget defaults to DEFAULT_BUDGET_MB, and can be changed with the
+ * MUTTER_DEBUG_TEXTURE_BUDGET_MB environment variable.
+ */
+
+#include "config.h"
+
+#include "compositor/meta-texture-budget.h"
+
+#include <stdlib.h>
+
+#include "meta/util.h"
+
+#define DEFAULT_BUDGET_MB 256
+
+/* Resources used within this time are never evicted, even if over budget,
+ * to avoid recreating textures of visible windows every frame. */
+#define MIN_IDLE_TIME_US (G_USEC_PER_SEC * 10)
+
+struct _MetaTextureBudgetEntry
+{
+  GList link;
+
+  size_t size;
+  int64_t last_used_us;
+
+  MetaTextureBudgetEvictFunc evict_func;
+  gpointer user_data;
+};
+
+typedef struct _MetaTextureBudget
+{
+  /* Most recently used first */
+  GQueue entries;
+
+  size_t budget;
+  size_t memory_in_use;
+
+  uint64_t n_evictions;
+  uint64_t evicted_bytes;
+} MetaTextureBudget;
+
+static MetaTextureBudget *
+get_texture_budget (void)
+{
+  static MetaTextureBudget *texture_budget;
+
+  if (!texture_budget)
+    {
+      const char *budget_env;
+      size_t budget_mb = DEFAULT_BUDGET_MB;
+
+      budget_env = g_getenv ("MUTTER_DEBUG_TEXTURE_BUDGET_MB");
+      if (budget_env)
+        budget_mb = strtoul (budget_env, NULL, 10);
+
+      texture_budget = g_new0 (MetaTextureBudget, 1);
+      g_queue_init (&texture_budget->entries);
+      texture_budget->budget = budget_mb * 1024 * 1024;
+    }
+
+  return texture_budget;
+}
+
+static void
+enforce_budget (MetaTextureBudget *texture_budget)
+{
+  int64_t now_us;
+  GList *l;
+  int n_evicted = 0;
+  size_t evicted_bytes = 0;
+
+  now_us = g_get_monotonic_time ();
+
+  l = texture_budget->entries.tail;
+  while (l && texture_budget->memory_in_use > texture_budget->budget)
+    {
+      MetaTextureBudgetEntry *entry = l->data;
+      GList *prev = l->prev;
+      size_t freed;
+
+      if (now_us - entry->last_used_us < MIN_IDLE_TIME_US)
+        break;
+
+      if (entry->size > 0)
+        {
+          freed = MIN (entry->evict_func (entry->user_data), entry->size);
+
+          entry->size -= freed;
+          texture_budget->memory_in_use -= freed;
+
+          n_evicted++;
+          evicted_bytes += freed;
+        }
+
+      l = prev;
+    }
+
+  if (n_evicted == 0)
+    return;
+
+  texture_budget->n_evictions += n_evicted;
+  texture_budget->evicted_bytes += evicted_bytes;
+
+  meta_topic (META_DEBUG_COMPOSITOR,
+              "Evicted textures of %d windows (%zu kB), "
+              "%zu kB of %zu kB texture budget in use\n",
+              n_evicted, evicted_bytes / 1024,
+              texture_budget->memory_in_use / 1024,
+              texture_budget->budget / 1024);
+}
+
+MetaTextureBudgetEntry *
+meta_texture_budget_add (MetaTextureBudgetEvictFunc  evict_func,
+                         gpointer                    user_data)
+{
+  MetaTextureBudget *texture_budget = get_texture_budget ();
+  MetaTextureBudgetEntry *entry;
+
+  entry = g_new0 (MetaTextureBudgetEntry, 1);
+  entry->link.data = entry;
+  entry->evict_func = evict_func;
+  entry->user_data = user_data;
+  entry->last_used_us = g_get_monotonic_time ();
+
+  g_queue_push_head_link (&texture_budget->entries, &entry->link);
+
+  return entry;
+}
+
+void
+meta_texture_budget_remove (MetaTextureBudgetEntry *entry)
+{
+  MetaTextureBudget *texture_budget = get_texture_budget ();
+
+  texture_budget->memory_in_use -= entry->size;
+  g_queue_unlink (&texture_budget->entries, &entry->link);
+
+  g_free (entry);
+}
+
+void
+meta_texture_budget_update_size (MetaTextureBudgetEntry *entry,
+                                 size_t                  size)
+{
+  MetaTextureBudget *texture_budget = get_texture_budget ();
+
+  texture_budget->memory_in_use -= entry->size;
+  texture_budget->memory_in_use += size;
+  entry->size = size;
+
+  if (texture_budget->memory_in_use > texture_budget->budget)
+    enforce_budget (texture_budget);
+}
+
+void
+meta_texture_budget_mark_used (MetaTextureBudgetEntry *entry,
+                               size_t                  size)
+{
+  MetaTextureBudget *texture_budget = get_texture_budget ();
+
+  entry->last_used_us = g_get_monotonic_time ();
+
+  if (texture_budget->entries.head != &entry->link)
+    {
+      g_queue_unlink (&texture_budget->entries, &entry->link);
+      g_queue_push_head_link (&texture_budget->entries, &entry->link);
+    }
+
+  meta_texture_budget_update_size (entry, size);
+}
+
+void
+meta_texture_budget_get_stats (MetaTextureBudgetStats *stats)
+{
+  MetaTextureBudget *texture_budget = get_texture_budget ();
+
+  stats->budget = texture_budget->budget;
+  stats->memory_in_use = texture_budget->memory_in_use;
+  stats->n_evictions = texture_budget->n_evictions;
+  stats->evicted_bytes = texture_budget->evicted_bytes;
+}
@@ -0,0 +1,55 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Copyright 2020 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef META_TEXTURE_BUDGET_H
+#define META_TEXTURE_BUDGET_H
+
+#include <glib.h>
+#include <stdint.h>
+
+typedef struct _MetaTextureBudgetEntry MetaTextureBudgetEntry;
+
+typedef struct _MetaTextureBudgetStats
+{
+  size_t budget;
+  size_t memory_in_use;
+  uint64_t n_evictions;
+  uint64_t evicted_bytes;
+} MetaTextureBudgetStats;
+
+/*
+ * Frees the resources accounted for by an entry, and returns the number
+ * of bytes that were freed. The resources must be recreated lazily the
+ * next time they are needed.
+ */
+typedef size_t (* MetaTextureBudgetEvictFunc) (gpointer user_data);
+
+MetaTextureBudgetEntry * meta_texture_budget_add (MetaTextureBudgetEvictFunc  evict_func,
+                                                  gpointer                    user_data);
+
+void meta_texture_budget_remove (MetaTextureBudgetEntry *entry);
+
+void meta_texture_budget_update_size (MetaTextureBudgetEntry *entry,
+                                      size_t                  size);
+
+void meta_texture_budget_mark_used (MetaTextureBudgetEntry *entry,
+                                    size_t                  size);
+
+void meta_texture_budget_get_stats (MetaTextureBudgetStats *stats);
+
+#endif /* META_TEXTURE_BUDGET_H */
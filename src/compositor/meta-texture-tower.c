@@ -62,8 +62,46 @@ struct _MetaTextureTower
   CoglOffscreen *fbos[MAX_TEXTURE_LEVELS];
   Box invalid[MAX_TEXTURE_LEVELS];
   CoglPipeline *pipeline_template;
+
+  /* When set, only level 1 is rendered from the base texture, into a
+   * texture whose smaller levels are real mipmaps generated by the GPU
+   * the next time it is painted with a mipmap filter. */
+  gboolean use_gpu_mipmaps;
 };
 
+static gboolean
+can_use_gpu_mipmaps (void)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  if (g_strcmp0 (g_getenv ("MUTTER_DEBUG_DISABLE_GPU_MIPMAPS"), "1") == 0)
+    return FALSE;
+
+  return cogl_has_feature (ctx, COGL_FEATURE_ID_GENERATE_MIPMAP);
+}
+
+static void
+free_levels (MetaTextureTower *tower)
+{
+  int i;
+
+  for (i = 1; i < tower->n_levels; i++)
+    {
+      if (tower->textures[i] != NULL)
+        {
+          cogl_object_unref (tower->textures[i]);
+          tower->textures[i] = NULL;
+        }
+
+      if (tower->fbos[i] != NULL)
+        {
+          cogl_object_unref (tower->fbos[i]);
+          tower->fbos[i] = NULL;
+        }
+    }
+}
+
 /**
  * meta_texture_tower_new:
  *
@@ -115,8 +153,6 @@ void
 meta_texture_tower_set_base_texture (MetaTextureTower *tower,
                                      CoglTexture      *texture)
 {
-  int i;
-
   g_return_if_fail (tower != NULL);
 
   if (texture == tower->textures[0])
@@ -124,21 +160,7 @@ meta_texture_tower_set_base_texture (MetaTextureTower *tower,
 
   if (tower->textures[0] != NULL)
     {
-      for (i = 1; i < tower->n_levels; i++)
-        {
-          if (tower->textures[i] != NULL)
-            {
-              cogl_object_unref (tower->textures[i]);
-              tower->textures[i] = NULL;
-            }
-
-          if (tower->fbos[i] != NULL)
-            {
-              cogl_object_unref (tower->fbos[i]);
-              tower->fbos[i] = NULL;
-            }
-        }
-
+      free_levels (tower);
       cogl_object_unref (tower->textures[0]);
     }
 
@@ -156,6 +178,8 @@ meta_texture_tower_set_base_texture (MetaTextureTower *tower,
       tower->n_levels = 1 + MAX ((int)(M_LOG2E * log (width)), (int)(M_LOG2E * log (height)));
       tower->n_levels = MIN(tower->n_levels, MAX_TEXTURE_LEVELS);
 
+      tower->use_gpu_mipmaps = can_use_gpu_mipmaps ();
+
       meta_texture_tower_update_area (tower, 0, 0, width, height);
     }
   else
@@ -185,6 +209,7 @@ meta_texture_tower_update_area (MetaTextureTower *tower,
 {
   int texture_width, texture_height;
   Box invalid;
+  int n_levels;
   int i;
 
   g_return_if_fail (tower != NULL);
@@ -192,6 +217,12 @@ meta_texture_tower_update_area (MetaTextureTower *tower,
   if (tower->textures[0] == NULL)
     return;
 
+  /* With GPU mipmaps all smaller levels are derived from level 1 */
+  if (tower->use_gpu_mipmaps)
+    n_levels = MIN (tower->n_levels, 2);
+  else
+    n_levels = tower->n_levels;
+
   texture_width = cogl_texture_get_width (tower->textures[0]);
   texture_height = cogl_texture_get_height (tower->textures[0]);
 
@@ -200,7 +231,7 @@ meta_texture_tower_update_area (MetaTextureTower *tower,
   invalid.x2 = x + width;
   invalid.y2 = y + height;
 
-  for (i = 1; i < tower->n_levels; i++)
+  for (i = 1; i < n_levels; i++)
     {
       texture_width = MAX (1, texture_width / 2);
       texture_height = MAX (1, texture_height / 2);
@@ -365,6 +396,37 @@ texture_tower_create_texture (MetaTextureTower *tower,
   tower->invalid[level].y2 = height;
 }
 
+static gboolean
+texture_tower_create_mipmap_texture (MetaTextureTower *tower,
+                                     int               width,
+                                     int               height)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  CoglTexture *texture;
+  GError *catch_error = NULL;
+
+  texture = COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx, width, height));
+  cogl_primitive_texture_set_auto_mipmap (COGL_PRIMITIVE_TEXTURE (texture),
+                                          TRUE);
+
+  if (!cogl_texture_allocate (texture, &catch_error))
+    {
+      g_error_free (catch_error);
+      cogl_object_unref (texture);
+      return FALSE;
+    }
+
+  tower->textures[1] = texture;
+
+  tower->invalid[1].x1 = 0;
+  tower->invalid[1].y1 = 0;
+  tower->invalid[1].x2 = width;
+  tower->invalid[1].y2 = height;
+
+  return TRUE;
+}
+
 static void
 texture_tower_revalidate (MetaTextureTower *tower,
                           int               level)
@@ -418,6 +480,29 @@ texture_tower_revalidate (MetaTextureTower *tower,
   tower->invalid[level].y1 = tower->invalid[level].y2 = 0;
 }
 
+/**
+ * meta_texture_tower_is_mipmapped:
+ * @tower: a #MetaTextureTower
+ * @texture: a texture returned by meta_texture_tower_get_paint_texture()
+ *
+ * Checks whether @texture has mipmaps generated by the GPU, in which
+ * case it should be painted with a mipmap minification filter such as
+ * %COGL_PIPELINE_FILTER_LINEAR_MIPMAP_NEAREST; the GPU then picks the
+ * level matching the rendering scale.
+ *
+ * Return value: %TRUE if @texture should be painted with mipmapping
+ */
+gboolean
+meta_texture_tower_is_mipmapped (MetaTextureTower *tower,
+                                 CoglTexture      *texture)
+{
+  g_return_val_if_fail (tower != NULL, FALSE);
+
+  return (tower->use_gpu_mipmaps &&
+          texture != NULL &&
+          texture == tower->textures[1]);
+}
+
 /**
  * meta_texture_tower_get_paint_texture:
  * @tower: a #MetaTextureTower
@@ -452,6 +537,28 @@ meta_texture_tower_get_paint_texture (MetaTextureTower    *tower,
     return NULL;
   level = MIN (level, tower->n_levels - 1);
 
+  if (tower->use_gpu_mipmaps && level > 0)
+    {
+      if (tower->textures[1] == NULL &&
+          !texture_tower_create_mipmap_texture (tower,
+                                                MAX (1, texture_width / 2),
+                                                MAX (1, texture_height / 2)))
+        {
+          /* Fall back to rendering every level ourselves */
+          tower->use_gpu_mipmaps = FALSE;
+          meta_texture_tower_update_area (tower, 0, 0,
+                                          texture_width, texture_height);
+        }
+      else
+        {
+          if (tower->invalid[1].x2 != tower->invalid[1].x1 &&
+              tower->invalid[1].y2 != tower->invalid[1].y1)
+            texture_tower_revalidate (tower, 1);
+
+          return tower->textures[1];
+        }
+    }
+
   if (tower->textures[level] == NULL ||
       (tower->invalid[level].x2 != tower->invalid[level].x1 &&
        tower->invalid[level].y2 != tower->invalid[level].y1))
@@ -478,3 +585,62 @@ meta_texture_tower_get_paint_texture (MetaTextureTower    *tower,
 
   return tower->textures[level];
 }
+
+/**
+ * meta_texture_tower_get_memory_size:
+ * @tower: a #MetaTextureTower
+ *
+ * Gets the amount of memory used by the scaled down levels of the tower,
+ * not counting the base texture.
+ *
+ * Return value: the size in bytes of the allocated levels
+ */
+size_t
+meta_texture_tower_get_memory_size (MetaTextureTower *tower)
+{
+  size_t size = 0;
+  int i;
+
+  g_return_val_if_fail (tower != NULL, 0);
+
+  for (i = 1; i < tower->n_levels; i++)
+    {
+      size_t level_size;
+
+      if (tower->textures[i] == NULL)
+        continue;
+
+      level_size = ((size_t) cogl_texture_get_width (tower->textures[i]) *
+                    cogl_texture_get_height (tower->textures[i]) * 4);
+
+      /* GPU generated mipmaps take up another third */
+      if (meta_texture_tower_is_mipmapped (tower, tower->textures[i]))
+        level_size += level_size / 3;
+
+      size += level_size;
+    }
+
+  return size;
+}
+
+/**
+ * meta_texture_tower_evict:
+ * @tower: a #MetaTextureTower
+ *
+ * Frees the scaled down levels of the tower. They are recreated from
+ * the base texture the next time they are needed for painting.
+ *
+ * Return value: the number of bytes freed
+ */
+size_t
+meta_texture_tower_evict (MetaTextureTower *tower)
+{
+  size_t size;
+
+  g_return_val_if_fail (tower != NULL, 0);
+
+  size = meta_texture_tower_get_memory_size (tower);
+  free_levels (tower);
+
+  return size;
+}
@@ -24,6 +24,7 @@
 #define __META_TEXTURE_TOWER_H__
 
 #include "clutter/clutter.h"
+#include "core/util-private.h"
 
 G_BEGIN_DECLS
 
@@ -51,17 +52,27 @@ G_BEGIN_DECLS
 
 typedef struct _MetaTextureTower MetaTextureTower;
 
+META_EXPORT_TEST
 MetaTextureTower *meta_texture_tower_new               (void);
+META_EXPORT_TEST
 void              meta_texture_tower_free              (MetaTextureTower *tower);
+META_EXPORT_TEST
 void              meta_texture_tower_set_base_texture  (MetaTextureTower *tower,
                                                         CoglTexture      *texture);
+META_EXPORT_TEST
 void              meta_texture_tower_update_area       (MetaTextureTower *tower,
                                                         int               x,
                                                         int               y,
                                                         int               width,
                                                         int               height);
+META_EXPORT_TEST
+gboolean          meta_texture_tower_is_mipmapped      (MetaTextureTower    *tower,
+                                                        CoglTexture         *texture);
+META_EXPORT_TEST
 CoglTexture      *meta_texture_tower_get_paint_texture (MetaTextureTower    *tower,
                                                         ClutterPaintContext *paint_context);
+size_t            meta_texture_tower_get_memory_size   (MetaTextureTower    *tower);
+size_t            meta_texture_tower_evict             (MetaTextureTower    *tower);
 
 G_END_DECLS
 
@@ -87,6 +87,8 @@ struct _MetaWindowActorX11
 
   /* A region that matches the shape of the window, including frame bounds */
   cairo_region_t *shape_region;
+  /* The client shape the mask texture was built from, to recreate it */
+  cairo_region_t *mask_shape_region;
   /* The region we should clip to when painting the shadow */
   cairo_region_t *shadow_clip;
   /* The frame region */
@@ -396,6 +398,16 @@ surface_size_changed (MetaSurfaceActor *actor,
   meta_window_actor_x11_update_shape (actor_x11);
 }
 
+static void
+clear_mask_func (MetaSurfaceActor *surface_actor)
+{
+  MetaShapedTexture *stex;
+
+  stex = meta_surface_actor_get_texture (surface_actor);
+  if (stex)
+    meta_shaped_texture_set_mask_func (stex, NULL, NULL);
+}
+
 static void
 meta_window_actor_x11_assign_surface_actor (MetaWindowActor  *actor,
                                             MetaSurfaceActor *surface_actor)
@@ -410,6 +422,7 @@ meta_window_actor_x11_assign_surface_actor (MetaWindowActor  *actor,
     {
       g_warn_if_fail (meta_is_wayland_compositor ());
 
+      clear_mask_func (prev_surface_actor);
       g_clear_signal_handler (&actor_x11->size_changed_id, prev_surface_actor);
       clutter_actor_remove_child (CLUTTER_ACTOR (actor),
                                   CLUTTER_ACTOR (prev_surface_actor));
@@ -885,30 +898,24 @@ get_client_area_rect (MetaWindowActorX11    *actor_x11,
   get_client_area_rect_from_texture (actor_x11, stex, client_area);
 }
 
-static void
-build_and_scan_frame_mask (MetaWindowActorX11    *actor_x11,
-                           cairo_region_t        *shape_region)
+static CoglTexture *
+create_mask_texture (MetaWindowActorX11 *actor_x11,
+                     MetaShapedTexture  *stex,
+                     cairo_region_t     *shape_region,
+                     gboolean            scan_frame)
 {
   ClutterBackend *backend = clutter_get_default_backend ();
   MetaWindow *window =
     meta_window_actor_get_meta_window (META_WINDOW_ACTOR (actor_x11));
   CoglContext *ctx = clutter_backend_get_cogl_context (backend);
-  MetaSurfaceActor *surface =
-    meta_window_actor_get_surface (META_WINDOW_ACTOR (actor_x11));
   uint8_t *mask_data;
   unsigned int tex_width, tex_height;
-  MetaShapedTexture *stex;
   CoglTexture2D *mask_texture;
   int stride;
   cairo_t *cr;
   cairo_surface_t *image;
   GError *error = NULL;
 
-  stex = meta_surface_actor_get_texture (surface);
-  g_return_if_fail (stex);
-
-  meta_shaped_texture_set_mask_texture (stex, NULL);
-
   tex_width = meta_shaped_texture_get_width (stex);
   tex_height = meta_shaped_texture_get_height (stex);
 
@@ -960,10 +967,14 @@ build_and_scan_frame_mask (MetaWindowActorX11    *actor_x11,
 
       meta_frame_get_mask (window->frame, &frame_rect, cr);
 
-      cairo_surface_flush (image);
-      scanned_region = scan_visible_region (mask_data, stride, frame_paint_region);
-      cairo_region_union (shape_region, scanned_region);
-      cairo_region_destroy (scanned_region);
+      if (scan_frame)
+        {
+          cairo_surface_flush (image);
+          scanned_region = scan_visible_region (mask_data, stride,
+                                                frame_paint_region);
+          cairo_region_union (shape_region, scanned_region);
+          cairo_region_destroy (scanned_region);
+        }
       cairo_region_destroy (frame_paint_region);
     }
 
@@ -980,17 +991,43 @@ build_and_scan_frame_mask (MetaWindowActorX11    *actor_x11,
       g_error_free (error);
     }
 
-  if (mask_texture)
-    {
-      meta_shaped_texture_set_mask_texture (stex, COGL_TEXTURE (mask_texture));
-      cogl_object_unref (mask_texture);
-    }
-  else
-    {
-      meta_shaped_texture_set_mask_texture (stex, NULL);
-    }
-
   g_free (mask_data);
+
+  return COGL_TEXTURE (mask_texture);
+}
+
+static CoglTexture *
+recreate_mask_texture (MetaShapedTexture *stex,
+                       gpointer           user_data)
+{
+  MetaWindowActorX11 *actor_x11 = META_WINDOW_ACTOR_X11 (user_data);
+
+  return create_mask_texture (actor_x11, stex,
+                              actor_x11->mask_shape_region,
+                              FALSE);
+}
+
+static void
+build_and_scan_frame_mask (MetaWindowActorX11    *actor_x11,
+                           cairo_region_t        *shape_region)
+{
+  MetaSurfaceActor *surface =
+    meta_window_actor_get_surface (META_WINDOW_ACTOR (actor_x11));
+  MetaShapedTexture *stex;
+  CoglTexture *mask_texture;
+
+  stex = meta_surface_actor_get_texture (surface);
+  g_return_if_fail (stex);
+
+  meta_shaped_texture_set_mask_texture (stex, NULL);
+
+  g_clear_pointer (&actor_x11->mask_shape_region, cairo_region_destroy);
+  actor_x11->mask_shape_region = cairo_region_copy (shape_region);
+
+  mask_texture = create_mask_texture (actor_x11, stex, shape_region, TRUE);
+  meta_shaped_texture_set_mask_texture (stex, mask_texture);
+  meta_shaped_texture_set_mask_func (stex, recreate_mask_texture, actor_x11);
+  g_clear_pointer (&mask_texture, cogl_object_unref);
 }
 
 static void
@@ -1585,9 +1622,11 @@ meta_window_actor_x11_dispose (GObject *object)
     {
       g_clear_signal_handler (&actor_x11->repaint_scheduled_id, surface_actor);
       g_clear_signal_handler (&actor_x11->size_changed_id, surface_actor);
+      clear_mask_func (surface_actor);
     }
 
   g_clear_pointer (&actor_x11->shape_region, cairo_region_destroy);
+  g_clear_pointer (&actor_x11->mask_shape_region, cairo_region_destroy);
   g_clear_pointer (&actor_x11->shadow_clip, cairo_region_destroy);
   g_clear_pointer (&actor_x11->frame_bounds, cairo_region_destroy);
 
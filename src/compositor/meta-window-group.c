@@ -51,6 +51,50 @@ cullable_iface_init (MetaCullableInterface *iface)
   iface->reset_culling = meta_window_group_reset_culling;
 }
 
+/* Transforms a region in stage coordinates into the coordinate space of
+ * the window group as it is currently being painted onto @view */
+static cairo_region_t *
+stage_region_to_paint_region (const cairo_region_t *region,
+                              ClutterStageView     *view,
+                              float                 x_origin,
+                              float                 y_origin,
+                              float                 x_scale,
+                              float                 y_scale)
+{
+  cairo_rectangle_int_t view_layout;
+  cairo_region_t *paint_region;
+  float view_scale;
+  int n_rects, i;
+
+  clutter_stage_view_get_layout (view, &view_layout);
+  view_scale = clutter_stage_view_get_scale (view);
+
+  paint_region = cairo_region_create ();
+
+  n_rects = cairo_region_num_rectangles (region);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      float x1, y1, x2, y2;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      x1 = ((rect.x - view_layout.x) * view_scale - x_origin) / x_scale;
+      y1 = ((rect.y - view_layout.y) * view_scale - y_origin) / y_scale;
+      x2 = ((rect.x + rect.width - view_layout.x) * view_scale - x_origin) / x_scale;
+      y2 = ((rect.y + rect.height - view_layout.y) * view_scale - y_origin) / y_scale;
+
+      rect.x = floorf (x1);
+      rect.y = floorf (y1);
+      rect.width = ceilf (x2) - rect.x;
+      rect.height = ceilf (y2) - rect.y;
+
+      cairo_region_union_rectangle (paint_region, &rect);
+    }
+
+  return paint_region;
+}
+
 static void
 meta_window_group_paint (ClutterActor        *actor,
                          ClutterPaintContext *paint_context)
@@ -63,7 +107,6 @@ meta_window_group_paint (ClutterActor        *actor,
   cairo_region_t *clip_region;
   cairo_region_t *unobscured_region;
   cairo_rectangle_int_t visible_rect;
-  int paint_x_origin, paint_y_origin;
   int screen_width, screen_height;
 
   redraw_clip = clutter_paint_context_get_redraw_clip (paint_context);
@@ -75,58 +118,61 @@ meta_window_group_paint (ClutterActor        *actor,
 
   meta_display_get_size (window_group->display, &screen_width, &screen_height);
 
+  visible_rect.x = visible_rect.y = 0;
+  visible_rect.width = clutter_actor_get_width (CLUTTER_ACTOR (stage));
+  visible_rect.height = clutter_actor_get_height (CLUTTER_ACTOR (stage));
+
   /* Normally we expect an actor to be drawn at it's position on the screen.
    * However, if we're inside the paint of a ClutterClone, that won't be the
-   * case and we need to compensate. We look at the position of the window
-   * group under the current model-view matrix and the position of the actor.
-   * If they are both simply integer translations, then we can compensate
-   * easily, otherwise we give up.
-   *
-   * Possible cleanup: work entirely in paint space - we can compute the
-   * combination of the model-view matrix with the local matrix for each child
-   * actor and get a total transformation for that actor for how we are
-   * painting currently, and never worry about how actors are positioned
-   * on the stage.
+   * case and we need to compensate. We look at how the window group is
+   * mapped onto the view being painted under the current model-view matrix.
+   * As long as that is only a translation and a scale, the redraw clip and
+   * the visible area can be transformed into the space we are painting in;
+   * otherwise we give up.
    */
   if (clutter_actor_is_in_clone_paint (actor))
     {
+      ClutterStageView *view;
       CoglFramebuffer *fb;
+      cairo_region_t *visible_region;
+      float x_origin, y_origin, x_scale, y_scale;
 
+      view = clutter_paint_context_get_stage_view (paint_context);
       fb = clutter_paint_context_get_framebuffer (paint_context);
-      if (!meta_actor_painting_untransformed (fb,
-                                              screen_width,
-                                              screen_height,
-                                              screen_width,
-                                              screen_height,
-                                              &paint_x_origin,
-                                              &paint_y_origin) ||
+      if (!view ||
+          fb != clutter_stage_view_get_framebuffer (view) ||
+          !meta_actor_painting_axis_aligned (fb,
+                                             screen_width,
+                                             screen_height,
+                                             &x_origin, &y_origin,
+                                             &x_scale, &y_scale) ||
           !meta_cullable_is_untransformed (META_CULLABLE (actor)))
         {
           parent_actor_class->paint (actor, paint_context);
           return;
         }
+
+      clip_region = stage_region_to_paint_region (redraw_clip, view,
+                                                  x_origin, y_origin,
+                                                  x_scale, y_scale);
+
+      visible_region = cairo_region_create_rectangle (&visible_rect);
+      unobscured_region = stage_region_to_paint_region (visible_region, view,
+                                                        x_origin, y_origin,
+                                                        x_scale, y_scale);
+      cairo_region_destroy (visible_region);
     }
   else
     {
-      paint_x_origin = 0;
-      paint_y_origin = 0;
+      /* Get the clipped redraw bounds so that we can avoid painting shadows
+       * on windows that don't need to be painted in this frame. In the case
+       * of a multihead setup with mismatched monitor sizes, we could
+       * intersect this with an accurate union of the monitors to avoid
+       * painting shadows that are visible only in the holes. */
+      clip_region = cairo_region_copy (redraw_clip);
+      unobscured_region = cairo_region_create_rectangle (&visible_rect);
     }
 
-  visible_rect.x = visible_rect.y = 0;
-  visible_rect.width = clutter_actor_get_width (CLUTTER_ACTOR (stage));
-  visible_rect.height = clutter_actor_get_height (CLUTTER_ACTOR (stage));
-
-  unobscured_region = cairo_region_create_rectangle (&visible_rect);
-
-  /* Get the clipped redraw bounds so that we can avoid painting shadows on
-   * windows that don't need to be painted in this frame. In the case of a
-   * multihead setup with mismatched monitor sizes, we could intersect this
-   * with an accurate union of the monitors to avoid painting shadows that are
-   * visible only in the holes. */
-  clip_region = cairo_region_copy (redraw_clip);
-
-  cairo_region_translate (clip_region, -paint_x_origin, -paint_y_origin);
-
   meta_cullable_cull_out (META_CULLABLE (window_group), unobscured_region, clip_region);
 
   cairo_region_destroy (unobscured_region);
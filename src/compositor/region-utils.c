@@ -26,6 +26,11 @@
 
 #include <math.h>
 
+/* Regions are nearly always made of a handful of rectangles; keep those on
+ * the stack rather than allocating a temporary array, as some of these
+ * functions are called for every window every frame. */
+#define MAX_STACK_RECTS 16
+
 /* MetaRegionBuilder */
 
 /* Various algorithms in this file require unioning together a set of rectangles
@@ -176,12 +181,35 @@ meta_region_iterator_next (MetaRegionIterator *iter)
     }
 }
 
+/*
+ * Replaces the contents of @region with those of @src, or returns a copy
+ * of @src if @region is %NULL. Unlike destroying @region and copying @src,
+ * this doesn't allocate anything when @src is a single rectangle, so
+ * regions updated every frame should be kept around and updated this way.
+ * @region must not be shared with anyone else.
+ */
+cairo_region_t *
+meta_region_copy_into (cairo_region_t       *region,
+                       const cairo_region_t *src)
+{
+  if (!region)
+    return cairo_region_copy (src);
+
+  /* Subtracting a region from itself just resets it to be empty */
+  cairo_region_subtract (region, region);
+  cairo_region_union (region, src);
+
+  return region;
+}
+
 cairo_region_t *
 meta_region_scale_double (cairo_region_t       *region,
                           double                scale,
                           MetaRoundingStrategy  rounding_strategy)
 {
   int n_rects, i;
+  cairo_rectangle_int_t stack_rects[MAX_STACK_RECTS];
+  g_autofree cairo_rectangle_int_t *heap_rects = NULL;
   cairo_rectangle_int_t *rects;
   cairo_region_t *scaled_region;
 
@@ -192,7 +220,11 @@ meta_region_scale_double (cairo_region_t       *region,
 
   n_rects = cairo_region_num_rectangles (region);
 
-  rects = g_malloc (sizeof(cairo_rectangle_int_t) * n_rects);
+  if (n_rects <= MAX_STACK_RECTS)
+    rects = stack_rects;
+  else
+    rects = heap_rects = g_new (cairo_rectangle_int_t, n_rects);
+
   for (i = 0; i < n_rects; i++)
     {
       cairo_region_get_rectangle (region, i, &rects[i]);
@@ -203,8 +235,6 @@ meta_region_scale_double (cairo_region_t       *region,
 
   scaled_region = cairo_region_create_rectangles (rects, n_rects);
 
-  g_free (rects);
-
   return scaled_region;
 }
 
@@ -212,6 +242,8 @@ cairo_region_t *
 meta_region_scale (cairo_region_t *region, int scale)
 {
   int n_rects, i;
+  cairo_rectangle_int_t stack_rects[MAX_STACK_RECTS];
+  g_autofree cairo_rectangle_int_t *heap_rects = NULL;
   cairo_rectangle_int_t *rects;
   cairo_region_t *scaled_region;
 
@@ -220,7 +252,11 @@ meta_region_scale (cairo_region_t *region, int scale)
 
   n_rects = cairo_region_num_rectangles (region);
 
-  rects = g_malloc (sizeof(cairo_rectangle_int_t) * n_rects);
+  if (n_rects <= MAX_STACK_RECTS)
+    rects = stack_rects;
+  else
+    rects = heap_rects = g_new (cairo_rectangle_int_t, n_rects);
+
   for (i = 0; i < n_rects; i++)
     {
       cairo_region_get_rectangle (region, i, &rects[i]);
@@ -232,8 +268,6 @@ meta_region_scale (cairo_region_t *region, int scale)
 
   scaled_region = cairo_region_create_rectangles (rects, n_rects);
 
-  g_free (rects);
-
   return scaled_region;
 }
 
@@ -382,6 +416,8 @@ meta_region_transform (const cairo_region_t *region,
                        int                   height)
 {
   int n_rects, i;
+  cairo_rectangle_int_t stack_rects[MAX_STACK_RECTS];
+  g_autofree cairo_rectangle_int_t *heap_rects = NULL;
   cairo_rectangle_int_t *rects;
   cairo_region_t *transformed_region;
 
@@ -390,7 +426,11 @@ meta_region_transform (const cairo_region_t *region,
 
   n_rects = cairo_region_num_rectangles (region);
 
-  rects = g_new0 (cairo_rectangle_int_t, n_rects);
+  if (n_rects <= MAX_STACK_RECTS)
+    rects = stack_rects;
+  else
+    rects = heap_rects = g_new (cairo_rectangle_int_t, n_rects);
+
   for (i = 0; i < n_rects; i++)
     {
       cairo_region_get_rectangle (region, i, &rects[i]);
@@ -404,8 +444,6 @@ meta_region_transform (const cairo_region_t *region,
 
   transformed_region = cairo_region_create_rectangles (rects, n_rects);
 
-  g_free (rects);
-
   return transformed_region;
 }
 
@@ -416,6 +454,8 @@ meta_region_crop_and_scale (cairo_region_t  *region,
                             int              dst_height)
 {
   int n_rects, i;
+  cairo_rectangle_int_t stack_rects[MAX_STACK_RECTS];
+  g_autofree cairo_rectangle_int_t *heap_rects = NULL;
   cairo_rectangle_int_t *rects;
   cairo_region_t *viewport_region;
 
@@ -438,7 +478,11 @@ meta_region_crop_and_scale (cairo_region_t  *region,
 
   n_rects = cairo_region_num_rectangles (region);
 
-  rects = g_new0 (cairo_rectangle_int_t, n_rects);
+  if (n_rects <= MAX_STACK_RECTS)
+    rects = stack_rects;
+  else
+    rects = heap_rects = g_new (cairo_rectangle_int_t, n_rects);
+
   for (i = 0; i < n_rects; i++)
     {
       cairo_region_get_rectangle (region, i, &rects[i]);
@@ -452,7 +496,5 @@ meta_region_crop_and_scale (cairo_region_t  *region,
 
   viewport_region = cairo_region_create_rectangles (rects, n_rects);
 
-  g_free (rects);
-
   return viewport_region;
 }
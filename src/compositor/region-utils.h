@@ -94,6 +94,9 @@ void     meta_region_iterator_init      (MetaRegionIterator *iter,
 gboolean meta_region_iterator_at_end    (MetaRegionIterator *iter);
 void     meta_region_iterator_next      (MetaRegionIterator *iter);
 
+cairo_region_t * meta_region_copy_into (cairo_region_t       *region,
+                                        const cairo_region_t *src);
+
 cairo_region_t * meta_region_scale (cairo_region_t *region,
                                     int             scale);
 
@@ -0,0 +1,265 @@
+#include <clutter/clutter.h>
+
+#include "tests/clutter-test-utils.h"
+
+#define TEST_TYPE_COUNTING_CONTENT (test_counting_content_get_type ())
+G_DECLARE_FINAL_TYPE (TestCountingContent, test_counting_content,
+                      TEST, COUNTING_CONTENT, GObject)
+
+struct _TestCountingContent
+{
+  GObject parent;
+
+  int n_paints;
+};
+
+static void clutter_content_iface_init (ClutterContentInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestCountingContent, test_counting_content,
+                         G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_CONTENT,
+                                                clutter_content_iface_init))
+
+static void
+test_counting_content_paint_content (ClutterContent      *content,
+                                     ClutterActor        *actor,
+                                     ClutterPaintNode    *root_node,
+                                     ClutterPaintContext *paint_context)
+{
+  TEST_COUNTING_CONTENT (content)->n_paints++;
+}
+
+static void
+clutter_content_iface_init (ClutterContentInterface *iface)
+{
+  iface->paint_content = test_counting_content_paint_content;
+}
+
+static void
+test_counting_content_class_init (TestCountingContentClass *klass)
+{
+}
+
+static void
+test_counting_content_init (TestCountingContent *content)
+{
+}
+
+static void
+on_presented (ClutterStage     *stage,
+              ClutterStageView *view,
+              ClutterFrameInfo *frame_info,
+              gboolean         *was_presented)
+{
+  *was_presented = TRUE;
+}
+
+static void
+wait_for_paint (ClutterActor *stage)
+{
+  gboolean was_presented = FALSE;
+  gulong handler_id;
+
+  handler_id = g_signal_connect (stage, "presented",
+                                 G_CALLBACK (on_presented),
+                                 &was_presented);
+
+  clutter_actor_queue_redraw (stage);
+  while (!was_presented)
+    g_main_context_iteration (NULL, FALSE);
+
+  g_signal_handler_disconnect (stage, handler_id);
+}
+
+static ClutterActor *
+create_counting_actor (TestCountingContent **content)
+{
+  ClutterActor *actor;
+
+  *content = g_object_new (TEST_TYPE_COUNTING_CONTENT, NULL);
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_content (actor, CLUTTER_CONTENT (*content));
+  g_object_unref (*content);
+
+  return actor;
+}
+
+static ClutterActor *
+create_cover_actor (void)
+{
+  ClutterActor *actor;
+
+  actor = clutter_actor_new ();
+  clutter_actor_set_background_color (actor, CLUTTER_COLOR_Red);
+
+  return actor;
+}
+
+static void
+actor_occlusion_opaque (void)
+{
+  TestCountingContent *content;
+  ClutterActor *stage;
+  ClutterActor *covered;
+  ClutterActor *cover;
+  cairo_region_t *opaque_region;
+
+  stage = clutter_test_get_stage ();
+
+  covered = create_counting_actor (&content);
+  clutter_actor_set_position (covered, 10, 10);
+  clutter_actor_set_size (covered, 100, 100);
+  clutter_actor_add_child (stage, covered);
+
+  cover = create_cover_actor ();
+  clutter_actor_set_size (cover, 200, 200);
+  clutter_actor_add_child (stage, cover);
+
+  clutter_actor_show (stage);
+
+  wait_for_paint (stage);
+
+  opaque_region = clutter_actor_get_opaque_region (cover);
+  g_assert_nonnull (opaque_region);
+  g_assert_cmpint (cairo_region_contains_rectangle (opaque_region,
+                                                    &(cairo_rectangle_int_t) {
+                                                      .width = 200,
+                                                      .height = 200,
+                                                    }),
+                   ==,
+                   CAIRO_REGION_OVERLAP_IN);
+  cairo_region_destroy (opaque_region);
+
+  g_assert_cmpint (content->n_paints, ==, 0);
+
+  /* A translucent actor doesn't hide what is below it */
+  clutter_actor_set_opacity (cover, 128);
+  wait_for_paint (stage);
+  g_assert_cmpint (content->n_paints, >, 0);
+
+  /* Nor does an opaque actor only partially covering it */
+  content->n_paints = 0;
+  clutter_actor_set_opacity (cover, 255);
+  clutter_actor_set_size (cover, 50, 200);
+  wait_for_paint (stage);
+  g_assert_cmpint (content->n_paints, >, 0);
+
+  clutter_actor_destroy (cover);
+  clutter_actor_destroy (covered);
+}
+
+static void
+actor_occlusion_transformed (void)
+{
+  TestCountingContent *content;
+  ClutterActor *stage;
+  ClutterActor *covered;
+  ClutterActor *cover;
+
+  stage = clutter_test_get_stage ();
+
+  covered = create_counting_actor (&content);
+  clutter_actor_set_size (covered, 150, 150);
+  clutter_actor_add_child (stage, covered);
+
+  cover = create_cover_actor ();
+  clutter_actor_set_size (cover, 100, 100);
+  clutter_actor_set_scale (cover, 2.0, 2.0);
+  clutter_actor_add_child (stage, cover);
+
+  clutter_actor_show (stage);
+
+  /* Scaling keeps the opaque area axis aligned */
+  wait_for_paint (stage);
+  g_assert_cmpint (content->n_paints, ==, 0);
+
+  /* Rotated opaque areas are not used for occlusion */
+  clutter_actor_set_rotation_angle (cover, CLUTTER_Z_AXIS, 10.0);
+  wait_for_paint (stage);
+  g_assert_cmpint (content->n_paints, >, 0);
+
+  clutter_actor_destroy (cover);
+  clutter_actor_destroy (covered);
+}
+
+static void
+actor_occlusion_clone (void)
+{
+  TestCountingContent *content;
+  ClutterActor *stage;
+  ClutterActor *container;
+  ClutterActor *covered;
+  ClutterActor *cover;
+  ClutterActor *clone;
+
+  stage = clutter_test_get_stage ();
+
+  container = clutter_actor_new ();
+  clutter_actor_add_child (stage, container);
+
+  covered = create_counting_actor (&content);
+  clutter_actor_set_size (covered, 100, 100);
+  clutter_actor_add_child (container, covered);
+
+  cover = create_cover_actor ();
+  clutter_actor_set_size (cover, 200, 200);
+  clutter_actor_add_child (stage, cover);
+
+  /* The clone is painted on top of the cover, and must still paint the
+   * content that is occluded on the stage itself. */
+  clone = clutter_clone_new (container);
+  clutter_actor_set_position (clone, 300, 0);
+  clutter_actor_add_child (stage, clone);
+
+  clutter_actor_show (stage);
+
+  wait_for_paint (stage);
+  g_assert_cmpint (content->n_paints, >, 0);
+
+  clutter_actor_destroy (clone);
+  clutter_actor_destroy (cover);
+  clutter_actor_destroy (container);
+}
+
+static void
+actor_occlusion_unpainted (void)
+{
+  TestCountingContent *content;
+  ClutterActor *stage;
+  ClutterActor *covered;
+  ClutterActor *container;
+  ClutterActor *cover;
+
+  stage = clutter_test_get_stage ();
+
+  covered = create_counting_actor (&content);
+  clutter_actor_set_size (covered, 100, 100);
+  clutter_actor_add_child (stage, covered);
+
+  container = clutter_actor_new ();
+  clutter_actor_add_child (stage, container);
+
+  cover = create_cover_actor ();
+  clutter_actor_set_size (cover, 200, 200);
+  clutter_actor_add_child (container, cover);
+
+  clutter_actor_show (stage);
+
+  /* An opacity override doesn't make the child of a transparent actor
+   * painted */
+  clutter_actor_set_opacity (container, 0);
+  clutter_actor_set_opacity_override (cover, 255);
+  wait_for_paint (stage);
+  g_assert_cmpint (content->n_paints, >, 0);
+
+  clutter_actor_destroy (container);
+  clutter_actor_destroy (covered);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/occlusion/opaque", actor_occlusion_opaque)
+  CLUTTER_TEST_UNIT ("/actor/occlusion/transformed", actor_occlusion_transformed)
+  CLUTTER_TEST_UNIT ("/actor/occlusion/clone", actor_occlusion_clone)
+  CLUTTER_TEST_UNIT ("/actor/occlusion/unpainted", actor_occlusion_unpainted)
+)
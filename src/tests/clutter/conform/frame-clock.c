@@ -16,6 +16,10 @@ typedef struct _FakeHwClock
 
   int64_t next_presentation_time_us;
   gboolean has_pending_present;
+
+  /* When non-zero, report frames as having taken this long to render */
+  int64_t render_time_us;
+  int64_t last_dispatch_time_us;
 } FakeHwClock;
 
 typedef struct _FrameClockTest
@@ -49,6 +53,15 @@ fake_hw_clock_source_dispatch (GSource     *source,
 
       fake_hw_clock->has_pending_present = FALSE;
       init_frame_info (&frame_info, g_source_get_time (source));
+      if (fake_hw_clock->render_time_us)
+        {
+          frame_info.flags |= CLUTTER_FRAME_INFO_FLAG_GPU_RENDERING_DURATION;
+          frame_info.cpu_time_before_buffer_swap_us =
+            fake_hw_clock->last_dispatch_time_us +
+            fake_hw_clock->render_time_us / 2;
+          frame_info.gpu_rendering_duration_ns =
+            fake_hw_clock->render_time_us / 2 * 1000;
+        }
       clutter_frame_clock_notify_presented (frame_clock, &frame_info);
       if (callback)
         callback (user_data);
@@ -690,6 +703,90 @@ frame_clock_reschedule_on_idle (void)
   clutter_frame_clock_destroy (frame_clock);
 }
 
+typedef struct _RenderTimeFrameClockTest
+{
+  FrameClockTest base;
+
+  int64_t max_dispatch_to_presentation_us;
+} RenderTimeFrameClockTest;
+
+static ClutterFrameResult
+render_time_frame_clock_frame (ClutterFrameClock *frame_clock,
+                               int64_t            frame_count,
+                               int64_t            time_us,
+                               gpointer           user_data)
+{
+  RenderTimeFrameClockTest *test = user_data;
+  FakeHwClock *fake_hw_clock = test->base.fake_hw_clock;
+
+  g_assert_cmpint (frame_count, ==, expected_frame_count);
+
+  expected_frame_count++;
+
+  if (test_frame_count == 0)
+    {
+      g_main_loop_quit (test->base.main_loop);
+      return CLUTTER_FRAME_RESULT_IDLE;
+    }
+
+  /* Once the render time history is filled, frames should be started
+   * just in time for the next presentation instead of right after the
+   * previous one. */
+  if (frame_count > 20)
+    {
+      test->max_dispatch_to_presentation_us =
+        MAX (test->max_dispatch_to_presentation_us,
+             fake_hw_clock->next_presentation_time_us - time_us);
+    }
+
+  fake_hw_clock->last_dispatch_time_us = time_us;
+  fake_hw_clock->has_pending_present = TRUE;
+
+  test_frame_count--;
+
+  return CLUTTER_FRAME_RESULT_PENDING_PRESENTED;
+}
+
+static const ClutterFrameListenerIface render_time_frame_listener_iface = {
+  .frame = render_time_frame_clock_frame,
+};
+
+static void
+frame_clock_measured_render_time (void)
+{
+  RenderTimeFrameClockTest test = { 0 };
+  ClutterFrameClock *frame_clock;
+  FakeHwClock *fake_hw_clock;
+  GSource *source;
+
+  test_frame_count = 40;
+  expected_frame_count = 0;
+
+  test.base.main_loop = g_main_loop_new (NULL, FALSE);
+  frame_clock = clutter_frame_clock_new (refresh_rate,
+                                         &render_time_frame_listener_iface,
+                                         &test);
+  fake_hw_clock = fake_hw_clock_new (frame_clock,
+                                     schedule_update_hw_callback,
+                                     frame_clock);
+  fake_hw_clock->render_time_us = ms2us (2);
+  source = &fake_hw_clock->source;
+  g_source_attach (source, NULL);
+  test.base.fake_hw_clock = fake_hw_clock;
+
+  clutter_frame_clock_schedule_update (frame_clock);
+  g_main_loop_run (test.base.main_loop);
+
+  g_assert_cmpint (test.max_dispatch_to_presentation_us, >, 0);
+  g_assert_cmpint (test.max_dispatch_to_presentation_us, <,
+                   refresh_interval_us / 2);
+
+  g_main_loop_unref (test.base.main_loop);
+  clutter_frame_clock_destroy (frame_clock);
+  g_source_destroy (source);
+  g_source_unref (source);
+}
+
 static const ClutterFrameListenerIface dummy_frame_listener_iface = {
   .frame = NULL,
 };
@@ -756,5 +853,6 @@ CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/frame-clock/update", frame_clock_update)
   CLUTTER_TEST_UNIT ("/frame-clock/inhibit", frame_clock_inhibit)
   CLUTTER_TEST_UNIT ("/frame-clock/reschedule-on-idle", frame_clock_reschedule_on_idle)
+  CLUTTER_TEST_UNIT ("/frame-clock/measured-render-time", frame_clock_measured_render_time)
   CLUTTER_TEST_UNIT ("/frame-clock/destroy-signal", frame_clock_destroy_signal)
 )
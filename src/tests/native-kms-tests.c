@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "tests/native-kms-tests.h"
+
+#include <gio/gio.h>
+
+#include "backends/native/meta-kms-impl-atomic.h"
+#include "backends/native/meta-kms-update.h"
+
+static MetaKmsPlaneAssignment *
+assign_cursor_plane (MetaKmsUpdate *update,
+                     uint32_t       fb_id,
+                     uint32_t       bo_handle)
+{
+  MetaFixed16Rectangle rect;
+  MetaKmsPlaneAssignment *plane_assignment;
+
+  rect = (MetaFixed16Rectangle) {
+    .x = meta_fixed_16_from_int (0),
+    .y = meta_fixed_16_from_int (0),
+    .width = meta_fixed_16_from_int (64),
+    .height = meta_fixed_16_from_int (64),
+  };
+
+  plane_assignment = meta_kms_update_assign_plane (update, NULL, NULL,
+                                                   fb_id, rect, rect,
+                                                   META_KMS_ASSIGN_PLANE_FLAG_NONE);
+  meta_kms_plane_assignment_set_cursor_bo_handle (plane_assignment, bo_handle);
+
+  return plane_assignment;
+}
+
+static void
+meta_test_kms_atomic_cursor_without_fb (void)
+{
+  MetaKmsUpdate *update;
+  MetaKmsPlaneAssignment *plane_assignment;
+  g_autoptr (GError) error = NULL;
+
+  update = meta_kms_update_new ();
+
+  /* Only carrying the GEM handle, which must not end up in FB_ID */
+  plane_assignment = assign_cursor_plane (update, 0, 1);
+  g_assert_false (meta_kms_impl_atomic_check_plane_assignment (plane_assignment,
+                                                               &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+
+  meta_kms_update_free (update);
+}
+
+static void
+meta_test_kms_atomic_cursor_with_fb (void)
+{
+  MetaKmsUpdate *update;
+  MetaKmsPlaneAssignment *plane_assignment;
+
+  update = meta_kms_update_new ();
+
+  plane_assignment = assign_cursor_plane (update, 2, 1);
+  g_assert_true (meta_kms_impl_atomic_check_plane_assignment (plane_assignment,
+                                                              NULL));
+
+  plane_assignment = meta_kms_update_unassign_plane (update, NULL, NULL);
+  g_assert_true (meta_kms_impl_atomic_check_plane_assignment (plane_assignment,
+                                                              NULL));
+
+  meta_kms_update_free (update);
+}
+
+void
+init_native_kms_tests (void)
+{
+  g_test_add_func ("/backends/native/kms/atomic/cursor-without-fb",
+                   meta_test_kms_atomic_cursor_without_fb);
+  g_test_add_func ("/backends/native/kms/atomic/cursor-with-fb",
+                   meta_test_kms_atomic_cursor_with_fb);
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Maps a stack of overlapping Wayland test client windows and drags the top
+ * one around, and reports the average number of heap allocations made while
+ * painting a frame. Painting goes through MetaWindowGroup, which culls the
+ * MetaSurfaceActor of every window, so this covers the per frame region
+ * handling of the compositor. Allocations are counted by wrapping the glibc
+ * allocator, so the numbers are only available with glibc, and they include
+ * everything else the compositor does while painting. */
+
+#include "config.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "compositor/meta-plugin-manager.h"
+#include "core/main-private.h"
+#include "meta/main.h"
+#include "meta/meta-backend.h"
+#include "tests/meta-backend-test.h"
+#include "tests/test-utils.h"
+
+#define WINDOW_WIDTH 400
+#define WINDOW_HEIGHT 300
+
+static int n_windows = 100;
+static int n_frames = 500;
+
+static GOptionEntry entries[] = {
+  {
+    "num-windows", 'w',
+    0,
+    G_OPTION_ARG_INT, &n_windows,
+    "Number of windows", "WINDOWS"
+  },
+  {
+    "num-frames", 'f',
+    0,
+    G_OPTION_ARG_INT, &n_frames,
+    "Number of frames", "FRAMES"
+  },
+  { NULL }
+};
+
+static TestClient *test_client;
+static MetaWindow *top_window;
+
+static gboolean counting;
+static int n_allocations;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n_members, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+
+static inline void
+count_allocation (void)
+{
+  if (counting)
+    g_atomic_int_inc (&n_allocations);
+}
+
+void *
+malloc (size_t size)
+{
+  count_allocation ();
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n_members,
+        size_t size)
+{
+  count_allocation ();
+  return __libc_calloc (n_members, size);
+}
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+  count_allocation ();
+  return __libc_realloc (ptr, size);
+}
+
+/* The aligned variants all end up in __libc_memalign(); the obsolete
+ * valloc() and pvalloc() are not wrapped, so they are not counted */
+void *
+memalign (size_t alignment,
+          size_t size)
+{
+  count_allocation ();
+  return __libc_memalign (alignment, size);
+}
+
+void *
+aligned_alloc (size_t alignment,
+               size_t size)
+{
+  count_allocation ();
+  return __libc_memalign (alignment, size);
+}
+
+int
+posix_memalign (void   **ptr,
+                size_t   alignment,
+                size_t   size)
+{
+  void *mem;
+
+  if (alignment % sizeof (void *) != 0 ||
+      (alignment & (alignment - 1)) != 0 ||
+      alignment == 0)
+    return EINVAL;
+
+  count_allocation ();
+  mem = __libc_memalign (alignment, size);
+  if (!mem && size != 0)
+    return ENOMEM;
+
+  *ptr = mem;
+  return 0;
+}
+#endif /* __GLIBC__ */
+
+static void
+on_before_paint (ClutterStage     *stage,
+                 ClutterStageView *view)
+{
+  counting = TRUE;
+}
+
+static gboolean
+finish_bench (gpointer user_data)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (!test_client_quit (test_client, &error))
+    g_error ("Failed to quit test client: %s", error->message);
+
+  test_client_destroy (test_client);
+
+  meta_quit (META_EXIT_SUCCESS);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_after_paint (ClutterStage     *stage,
+                ClutterStageView *view)
+{
+  static int frame = 0;
+  static int64_t total_allocations = 0;
+  MetaRectangle rect;
+
+  counting = FALSE;
+
+  /* The first frames allocate resources that are kept around */
+  if (frame > 0)
+    total_allocations += g_atomic_int_get (&n_allocations);
+  g_atomic_int_set (&n_allocations, 0);
+
+  if (++frame == n_frames)
+    {
+      g_print ("%d windows, %d frames: %.1f allocations per frame\n",
+               n_windows, n_frames,
+               (double) total_allocations / (n_frames - 1));
+      g_signal_handlers_disconnect_by_func (stage, on_before_paint, NULL);
+      g_signal_handlers_disconnect_by_func (stage, on_after_paint, NULL);
+      g_idle_add (finish_bench, NULL);
+      return;
+    }
+
+  /* Move the top window around, like while it is being dragged, which
+   * keeps the redraws clipped so that occluded windows are culled */
+  meta_window_get_frame_rect (top_window, &rect);
+  meta_window_move_frame (top_window, FALSE,
+                          rect.x + (int) roundf (4.0f * sinf (frame / 10.0f)),
+                          rect.y + (int) roundf (4.0f * cosf (frame / 10.0f)));
+}
+
+static gboolean
+run_bench (gpointer user_data)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  g_autoptr (GError) error = NULL;
+  float stage_width, stage_height;
+  int columns;
+  int i;
+
+  test_client = test_client_new ("region-alloc-bench",
+                                 META_WINDOW_CLIENT_TYPE_WAYLAND,
+                                 &error);
+  if (!test_client)
+    g_error ("Failed to launch test client: %s", error->message);
+
+  clutter_actor_get_size (stage, &stage_width, &stage_height);
+  columns = (int) ceil (sqrt (n_windows));
+
+  for (i = 0; i < n_windows; i++)
+    {
+      g_autofree char *window_name = NULL;
+      g_autofree char *width = NULL;
+      g_autofree char *height = NULL;
+      MetaWindow *window;
+
+      window_name = g_strdup_printf ("window%d", i);
+      width = g_strdup_printf ("%d", WINDOW_WIDTH);
+      height = g_strdup_printf ("%d", WINDOW_HEIGHT);
+
+      if (!test_client_do (test_client, &error,
+                           "create", window_name,
+                           NULL) ||
+          !test_client_do (test_client, &error,
+                           "resize", window_name, width, height,
+                           NULL) ||
+          !test_client_do (test_client, &error,
+                           "show", window_name,
+                           NULL))
+        g_error ("Failed to show window: %s", error->message);
+
+      window = test_client_find_window (test_client, window_name, &error);
+      if (!window)
+        g_error ("Failed to find window: %s", error->message);
+      test_client_wait_for_window_shown (test_client, window);
+
+      meta_window_move_frame (window, FALSE,
+                              (i % columns) *
+                              (stage_width - WINDOW_WIDTH) / columns,
+                              (i / columns) *
+                              (stage_height - WINDOW_HEIGHT) / columns);
+
+      top_window = window;
+    }
+
+  g_signal_connect (stage, "before-paint", G_CALLBACK (on_before_paint), NULL);
+  g_signal_connect (stage, "after-paint", G_CALLBACK (on_after_paint), NULL);
+
+  clutter_actor_queue_redraw (stage);
+
+  return G_SOURCE_REMOVE;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr (GOptionContext) context = NULL;
+  g_autoptr (GError) error = NULL;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_set_ignore_unknown_options (context, TRUE);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    g_error ("Failed to parse arguments: %s", error->message);
+
+#ifndef __GLIBC__
+  g_print ("Counting allocations requires glibc\n");
+  return 77;
+#endif
+
+  test_init (&argc, &argv);
+
+  meta_plugin_manager_load (test_get_plugin_name ());
+
+  meta_override_compositor_configuration (META_COMPOSITOR_TYPE_WAYLAND,
+                                          META_TYPE_BACKEND_TEST);
+
+  meta_init ();
+  meta_register_with_session ();
+
+  g_idle_add (run_bench, NULL);
+
+  return meta_run ();
+}
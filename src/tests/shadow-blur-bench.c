@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the shadow column blur implementations against the scalar
+ * code for a range of typical shadow radii and window sizes, and checks
+ * that they all produce the same result. */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compositor/meta-shadow-blur.h"
+
+#define N_ITERATIONS 20
+
+static const int radii[] = { 4, 12, 24, 48, 96 };
+
+static const struct
+{
+  int width;
+  int height;
+} sizes[] = {
+  { 300, 200 },
+  { 800, 600 },
+  { 1920, 1080 },
+};
+
+static guchar *
+create_shape_buffer (int width,
+                     int height,
+                     int spread)
+{
+  guchar *buffer;
+  int y;
+
+  buffer = g_malloc0 (width * height);
+  for (y = spread; y < height - spread; y++)
+    memset (buffer + y * width + spread, 255, width - 2 * spread);
+
+  return buffer;
+}
+
+static gboolean
+run_benchmark (int width,
+               int height,
+               int radius)
+{
+  int d = (int) (0.5 + radius * (0.75 * sqrt (2 * M_PI)));
+  int spread = 3 * (d / 2);
+  int buffer_width = (width + 2 * spread + 3) & ~3;
+  int buffer_height = (height + 2 * spread + 3) & ~3;
+  cairo_region_t *convolve_region;
+  g_autofree guchar *reference = NULL;
+  gint64 scalar_time = 0;
+  MetaShadowBlurImpl impl;
+
+  /* Column blurs take the region in transposed coordinates */
+  convolve_region =
+    cairo_region_create_rectangle (&(cairo_rectangle_int_t) {
+                                     .width = buffer_height,
+                                     .height = buffer_width,
+                                   });
+
+  for (impl = 0; impl < META_N_SHADOW_BLUR_IMPLS; impl++)
+    {
+      g_autofree guchar *buffer = NULL;
+      gint64 start_time, elapsed;
+      int i;
+
+      if (!meta_shadow_blur_impl_is_supported (impl))
+        continue;
+
+      elapsed = 0;
+      for (i = 0; i < N_ITERATIONS; i++)
+        {
+          g_clear_pointer (&buffer, g_free);
+          buffer = create_shape_buffer (buffer_width, buffer_height, spread);
+
+          start_time = g_get_monotonic_time ();
+          buffer = meta_shadow_blur_columns (impl, convolve_region, 0, 0,
+                                             buffer,
+                                             buffer_width, buffer_height,
+                                             d);
+          elapsed += g_get_monotonic_time () - start_time;
+        }
+
+      if (impl == META_SHADOW_BLUR_IMPL_SCALAR)
+        {
+          scalar_time = elapsed;
+          reference = g_steal_pointer (&buffer);
+        }
+      else if (memcmp (buffer, reference, buffer_width * buffer_height) != 0)
+        {
+          g_printerr ("%s result differs from scalar for %dx%d, radius %d\n",
+                      meta_shadow_blur_impl_to_string (impl),
+                      width, height, radius);
+          cairo_region_destroy (convolve_region);
+          return FALSE;
+        }
+
+      g_print ("%4dx%-4d radius %2d %-6s %8.3f ms  %5.2fx\n",
+               width, height, radius,
+               meta_shadow_blur_impl_to_string (impl),
+               elapsed / (1000.0 * N_ITERATIONS),
+               (double) scalar_time / MAX (elapsed, 1));
+    }
+
+  cairo_region_destroy (convolve_region);
+
+  return TRUE;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gboolean success = TRUE;
+  unsigned int i, j;
+
+  g_print ("Default implementation: %s\n",
+           meta_shadow_blur_impl_to_string (meta_shadow_blur_get_default_impl ()));
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      for (j = 0; j < G_N_ELEMENTS (radii); j++)
+        {
+          if (!run_benchmark (sizes[i].width, sizes[i].height, radii[j]))
+            success = FALSE;
+        }
+    }
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
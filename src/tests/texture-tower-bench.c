@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Paints a number of constantly updating, scaled down and animating
+ * windows through MetaTextureTower, similar to an overview, and reports
+ * the average frame time. Run with MUTTER_DEBUG_DISABLE_GPU_MIPMAPS=1 to
+ * compare against the per level offscreen rendering path. */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clutter/clutter.h>
+
+#include "compositor/meta-texture-tower.h"
+#include "tests/clutter-test-utils.h"
+
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 600
+#define DAMAGE_SIZE 64
+
+static int n_windows = 50;
+static int n_frames = 500;
+
+static GOptionEntry entries[] = {
+  {
+    "num-windows", 'w',
+    0,
+    G_OPTION_ARG_INT, &n_windows,
+    "Number of windows", "WINDOWS"
+  },
+  {
+    "num-frames", 'f',
+    0,
+    G_OPTION_ARG_INT, &n_frames,
+    "Number of frames", "FRAMES"
+  },
+  { NULL }
+};
+
+#define TOWER_TYPE_CONTENT (tower_content_get_type ())
+G_DECLARE_FINAL_TYPE (TowerContent, tower_content,
+                      TOWER, CONTENT, GObject)
+
+struct _TowerContent
+{
+  GObject parent;
+
+  CoglTexture *texture;
+  MetaTextureTower *tower;
+  CoglPipeline *pipeline;
+  uint8_t *damage_data;
+  int frame;
+};
+
+static void clutter_content_iface_init (ClutterContentInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TowerContent, tower_content, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_CONTENT,
+                                                clutter_content_iface_init))
+
+static void
+tower_content_damage (TowerContent *content)
+{
+  int x, y;
+
+  /* Simulate a client updating a part of its window every frame */
+  content->frame++;
+  x = (content->frame * 37) % (WINDOW_WIDTH - DAMAGE_SIZE);
+  y = (content->frame * 23) % (WINDOW_HEIGHT - DAMAGE_SIZE);
+  memset (content->damage_data, content->frame & 0xff,
+          DAMAGE_SIZE * DAMAGE_SIZE * 4);
+
+  cogl_texture_set_region (content->texture,
+                           0, 0,
+                           x, y,
+                           DAMAGE_SIZE, DAMAGE_SIZE,
+                           DAMAGE_SIZE, DAMAGE_SIZE,
+                           COGL_PIXEL_FORMAT_BGRA_8888_PRE,
+                           DAMAGE_SIZE * 4,
+                           content->damage_data);
+  meta_texture_tower_update_area (content->tower,
+                                  x, y, DAMAGE_SIZE, DAMAGE_SIZE);
+}
+
+static void
+tower_content_paint_content (ClutterContent      *clutter_content,
+                             ClutterActor        *actor,
+                             ClutterPaintNode    *root_node,
+                             ClutterPaintContext *paint_context)
+{
+  TowerContent *content = TOWER_CONTENT (clutter_content);
+  g_autoptr (ClutterPaintNode) node = NULL;
+  CoglPipelineFilter min_filter;
+  CoglPipeline *pipeline;
+  CoglTexture *paint_texture;
+  ClutterActorBox box;
+
+  tower_content_damage (content);
+
+  paint_texture = meta_texture_tower_get_paint_texture (content->tower,
+                                                        paint_context);
+  if (!paint_texture)
+    return;
+
+  if (meta_texture_tower_is_mipmapped (content->tower, paint_texture))
+    min_filter = COGL_PIPELINE_FILTER_LINEAR_MIPMAP_NEAREST;
+  else
+    min_filter = COGL_PIPELINE_FILTER_LINEAR;
+
+  pipeline = cogl_pipeline_copy (content->pipeline);
+  cogl_pipeline_set_layer_texture (pipeline, 0, paint_texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   min_filter,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+
+  clutter_actor_get_content_box (actor, &box);
+
+  node = clutter_pipeline_node_new (pipeline);
+  clutter_paint_node_add_rectangle (node, &box);
+  clutter_paint_node_add_child (root_node, node);
+
+  cogl_object_unref (pipeline);
+}
+
+static void
+clutter_content_iface_init (ClutterContentInterface *iface)
+{
+  iface->paint_content = tower_content_paint_content;
+}
+
+static void
+tower_content_finalize (GObject *object)
+{
+  TowerContent *content = TOWER_CONTENT (object);
+
+  meta_texture_tower_free (content->tower);
+  cogl_object_unref (content->texture);
+  cogl_object_unref (content->pipeline);
+  g_free (content->damage_data);
+
+  G_OBJECT_CLASS (tower_content_parent_class)->finalize (object);
+}
+
+static void
+tower_content_class_init (TowerContentClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = tower_content_finalize;
+}
+
+static void
+tower_content_init (TowerContent *content)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  content->texture =
+    COGL_TEXTURE (cogl_texture_2d_new_with_size (ctx,
+                                                 WINDOW_WIDTH,
+                                                 WINDOW_HEIGHT));
+  content->pipeline = cogl_pipeline_new (ctx);
+  content->damage_data = g_malloc (DAMAGE_SIZE * DAMAGE_SIZE * 4);
+
+  content->tower = meta_texture_tower_new ();
+  meta_texture_tower_set_base_texture (content->tower, content->texture);
+}
+
+static gboolean
+queue_redraw (gpointer stage)
+{
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+on_after_paint (ClutterStage     *stage,
+                ClutterStageView *view,
+                GTimer           *timer)
+{
+  static int frame = 0;
+  ClutterActor *child;
+  double scale;
+
+  if (frame == 0)
+    g_timer_start (timer);
+
+  if (++frame == n_frames)
+    {
+      g_timer_stop (timer);
+      g_print ("%d windows, %d frames: %.3f ms per frame\n",
+               n_windows, n_frames,
+               1000.0 * g_timer_elapsed (timer, NULL) / (n_frames - 1));
+      clutter_test_quit ();
+      return;
+    }
+
+  /* Animate the scale of all windows, like when entering the overview */
+  scale = 0.15 + 0.1 * (1.0 + sin (frame / 20.0));
+  for (child = clutter_actor_get_first_child (CLUTTER_ACTOR (stage));
+       child;
+       child = clutter_actor_get_next_sibling (child))
+    clutter_actor_set_scale (child, scale, scale);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_autoptr (GTimer) timer = NULL;
+  ClutterActor *stage;
+  int columns;
+  int i;
+
+  g_setenv ("CLUTTER_DEFAULT_FPS", "1000", FALSE);
+
+  clutter_test_init_with_args (&argc, &argv,
+                               NULL,
+                               entries,
+                               NULL);
+
+  stage = clutter_test_get_stage ();
+  clutter_actor_set_size (stage, 1024, 768);
+  clutter_actor_set_background_color (stage, CLUTTER_COLOR_Black);
+
+  columns = (int) ceil (sqrt (n_windows));
+
+  for (i = 0; i < n_windows; i++)
+    {
+      g_autoptr (ClutterContent) content = NULL;
+      ClutterActor *actor;
+
+      content = g_object_new (TOWER_TYPE_CONTENT, NULL);
+
+      actor = clutter_actor_new ();
+      clutter_actor_set_content (actor, content);
+      clutter_actor_set_size (actor, WINDOW_WIDTH, WINDOW_HEIGHT);
+      clutter_actor_set_position (actor,
+                                  (i % columns) * 1024.0 / columns,
+                                  (i / columns) * 768.0 / columns);
+      clutter_actor_add_child (stage, actor);
+    }
+
+  timer = g_timer_new ();
+
+  g_print ("Texture tower benchmark using %s\n",
+           g_getenv ("MUTTER_DEBUG_DISABLE_GPU_MIPMAPS") ?
+           "per level offscreen rendering" : "GPU mipmaps when supported");
+
+  g_signal_connect (stage, "after-paint", G_CALLBACK (on_after_paint), timer);
+  clutter_threads_add_idle (queue_redraw, stage);
+
+  clutter_actor_show (stage);
+
+  clutter_test_main ();
+
+  clutter_actor_destroy (stage);
+
+  return 0;
+}
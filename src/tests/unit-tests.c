@@ -34,6 +34,7 @@
 #include "tests/monitor-unit-tests.h"
 #include "tests/monitor-store-unit-tests.h"
 #include "tests/monitor-transform-tests.h"
+#include "tests/native-kms-tests.h"
 #include "tests/test-utils.h"
 #include "tests/wayland-unit-tests.h"
 #include "wayland/meta-wayland.h"
@@ -256,6 +257,9 @@ init_tests (int argc, char **argv)
   init_boxes_tests ();
   init_wayland_tests ();
   init_monitor_transform_tests ();
+#ifdef HAVE_NATIVE_BACKEND
+  init_native_kms_tests ();
+#endif
 }
 
 int
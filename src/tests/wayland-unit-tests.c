@@ -20,10 +20,13 @@
 #include "tests/wayland-unit-tests.h"
 
 #include <gio/gio.h>
+#include <glib-unix.h>
+#include <unistd.h>
 #include <wayland-server.h>
 
 #include "wayland/meta-wayland.h"
 #include "wayland/meta-wayland-actor-surface.h"
+#include "wayland/meta-wayland-buffer.h"
 #include "wayland/meta-wayland-surface.h"
 #include "wayland/meta-wayland-private.h"
 
@@ -36,6 +39,9 @@ typedef struct _WaylandTestClient
   GMainLoop *main_loop;
 } WaylandTestClient;
 
+/* key: MetaWaylandSurface, value: write end of the pipe blocking its commit */
+static GHashTable *blocked_commit_fds;
+
 static char *
 get_test_client_path (const char *test_client_name)
 {
@@ -129,6 +135,16 @@ subsurface_remap_toplevel (void)
   wayland_test_client_finish (wayland_test_client);
 }
 
+static void
+subsurface_parent_queued_commit (void)
+{
+  WaylandTestClient *wayland_test_client;
+
+  wayland_test_client =
+    wayland_test_client_new ("subsurface-parent-queued-commit");
+  wayland_test_client_finish (wayland_test_client);
+}
+
 static void
 on_actor_destroyed (ClutterActor       *actor,
                     struct wl_resource *callback)
@@ -162,8 +178,64 @@ sync_actor_destroy (struct wl_client   *client,
                     callback);
 }
 
+/*
+ * Makes the next commit of the surface wait for an acquire fence that is only
+ * signalled by unblock_commits. A pipe is readable like a signalled fence.
+ */
+static void
+block_next_commit (struct wl_client   *client,
+                   struct wl_resource *resource,
+                   struct wl_resource *surface_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  g_autoptr (GError) error = NULL;
+  int fds[2];
+
+  g_assert_cmpint (surface->pending_state->acquire_fence_fd, <, 0);
+  g_assert_false (g_hash_table_contains (blocked_commit_fds, surface));
+
+  if (!g_unix_open_pipe (fds, FD_CLOEXEC, &error))
+    g_error ("Failed to create pipe: %s", error->message);
+
+  surface->pending_state->acquire_fence_fd = fds[0];
+  g_hash_table_insert (blocked_commit_fds, surface, GINT_TO_POINTER (fds[1]));
+}
+
+static void
+unblock_commits (struct wl_client   *client,
+                 struct wl_resource *resource,
+                 struct wl_resource *surface_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  gpointer fd;
+
+  g_assert_true (g_hash_table_steal_extended (blocked_commit_fds, surface,
+                                              NULL, &fd));
+
+  g_assert_cmpint (write (GPOINTER_TO_INT (fd), "", 1), ==, 1);
+  close (GPOINTER_TO_INT (fd));
+
+  /* Apply what is ready before handling the next request */
+  meta_wayland_surface_process_queued_commits (surface);
+}
+
+static void
+verify_buffer (struct wl_client   *client,
+               struct wl_resource *resource,
+               struct wl_resource *surface_resource,
+               struct wl_resource *buffer_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  MetaWaylandBuffer *buffer = meta_wayland_buffer_from_resource (buffer_resource);
+
+  g_assert_true (surface->buffer_ref->buffer == buffer);
+}
+
 static const struct test_driver_interface meta_test_driver_interface = {
   sync_actor_destroy,
+  block_next_commit,
+  unblock_commits,
+  verify_buffer,
 };
 
 static void
@@ -188,6 +260,8 @@ pre_run_wayland_tests (void)
   compositor = meta_wayland_compositor_get_default ();
   g_assert_nonnull (compositor);
 
+  blocked_commit_fds = g_hash_table_new (NULL, NULL);
+
   if (wl_global_create (compositor->wayland_display,
                         &test_driver_interface,
                         1,
@@ -200,4 +274,6 @@ init_wayland_tests (void)
 {
   g_test_add_func ("/wayland/subsurface/remap-toplevel",
                    subsurface_remap_toplevel);
+  g_test_add_func ("/wayland/subsurface/parent-queued-commit",
+                   subsurface_parent_queued_commit);
 }
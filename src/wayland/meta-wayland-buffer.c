@@ -68,6 +68,19 @@
 #define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
 #endif
 
+/* Damage smaller than this is uploaded directly from the client buffer;
+ * larger damage is staged through a pixel buffer object first. */
+#define SHM_STAGING_MIN_SIZE (256 * 1024)
+
+/* Number of pixels that may be uploaded in addition to the damage when
+ * merging two damage rectangles into their bounding box. */
+#define SHM_COALESCE_SLACK_PIXELS (64 * 64)
+
+/* Damage larger than this gets a staging buffer of its own, instead of one
+ * of the compositor's shared ones, that is freed again once the upload has
+ * been queued. */
+#define SHM_STAGING_POOL_MAX_SIZE (16 * 1024 * 1024)
+
 enum
 {
   RESOURCE_DESTROYED,
@@ -559,6 +572,217 @@ meta_wayland_buffer_is_y_inverted (MetaWaylandBuffer *buffer)
   return buffer->is_y_inverted;
 }
 
+static size_t
+get_staged_rectangle_size (const cairo_rectangle_int_t *rect,
+                           int                          bpp)
+{
+  size_t size = (size_t) rect->width * bpp * rect->height;
+
+  /* Keep each staged rectangle aligned for the upload */
+  return (size + 15) & ~((size_t) 15);
+}
+
+static int64_t
+rectangle_area (const cairo_rectangle_int_t *rect)
+{
+  return (int64_t) rect->width * rect->height;
+}
+
+/* Merges damage rectangles into their bounding box as long as that
+ * doesn't upload too many undamaged pixels. Clients often damage many
+ * small adjacent areas, and every upload has a fixed cost. Uploading a
+ * few extra pixels is harmless since the buffer holds the complete
+ * contents. Returns the number of rectangles written to @rects, which
+ * must have room for all rectangles of @region.
+ */
+static int
+coalesce_damage_rectangles (cairo_region_t        *region,
+                            cairo_rectangle_int_t *rects)
+{
+  cairo_rectangle_int_t current;
+  int64_t current_damage_area;
+  int n_rectangles;
+  int n_rects = 0;
+  int i;
+
+  n_rectangles = cairo_region_num_rectangles (region);
+  if (n_rectangles == 0)
+    return 0;
+
+  cairo_region_get_rectangle (region, 0, &current);
+  current_damage_area = rectangle_area (&current);
+
+  for (i = 1; i < n_rectangles; i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_rectangle_int_t merged;
+      int64_t damage_area;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      merged.x = MIN (current.x, rect.x);
+      merged.y = MIN (current.y, rect.y);
+      merged.width = MAX (current.x + current.width,
+                          rect.x + rect.width) - merged.x;
+      merged.height = MAX (current.y + current.height,
+                           rect.y + rect.height) - merged.y;
+
+      /* Damage rectangles from a region never overlap */
+      damage_area = current_damage_area + rectangle_area (&rect);
+
+      if (rectangle_area (&merged) <=
+          damage_area + damage_area / 4 + SHM_COALESCE_SLACK_PIXELS)
+        {
+          current = merged;
+          current_damage_area = damage_area;
+        }
+      else
+        {
+          rects[n_rects++] = current;
+          current = rect;
+          current_damage_area = rectangle_area (&rect);
+        }
+    }
+
+  rects[n_rects++] = current;
+
+  return n_rects;
+}
+
+static CoglPixelBuffer *
+acquire_shm_staging_buffer (size_t size)
+{
+  ClutterBackend *clutter_backend = clutter_get_default_backend ();
+  CoglContext *cogl_context =
+    clutter_backend_get_cogl_context (clutter_backend);
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  MetaWaylandShmStagingPool *pool = &compositor->shm_staging_pool;
+  MetaWaylandShmStagingBuffer *staging_buffer;
+
+  if (size > SHM_STAGING_POOL_MAX_SIZE)
+    return cogl_pixel_buffer_new (cogl_context, size, NULL);
+
+  staging_buffer = &pool->buffers[pool->next];
+  pool->next = (pool->next + 1) % META_WAYLAND_SHM_STAGING_POOL_SIZE;
+
+  if (!staging_buffer->buffer || staging_buffer->size < size)
+    {
+      g_clear_pointer (&staging_buffer->buffer, cogl_object_unref);
+
+      staging_buffer->buffer = cogl_pixel_buffer_new (cogl_context,
+                                                      size, NULL);
+      if (!staging_buffer->buffer)
+        {
+          staging_buffer->size = 0;
+          return NULL;
+        }
+
+      staging_buffer->size = size;
+    }
+
+  return cogl_object_ref (staging_buffer->buffer);
+}
+
+/* Copies all rectangles into a pixel buffer object in one go and then
+ * uploads them from there. The upload itself then doesn't need to wait
+ * for the texture to become idle and can be done by the GPU in the
+ * background; since it is queued in the same GL command stream as the
+ * drawing that samples the texture, no further synchronization is
+ * needed before painting. Mapping with COGL_BUFFER_MAP_HINT_DISCARD
+ * lets the driver hand out fresh storage when a shared staging buffer
+ * is still in use by a previous upload.
+ */
+static gboolean
+upload_shm_rectangles_staged (CoglTexture           *texture,
+                              const uint8_t         *data,
+                              int32_t                stride,
+                              CoglPixelFormat        format,
+                              int                    bpp,
+                              cairo_rectangle_int_t *rects,
+                              int                    n_rects,
+                              size_t                 staging_size,
+                              gboolean              *staged,
+                              GError               **error)
+{
+  CoglPixelBuffer *pixel_buffer;
+  CoglBuffer *staging_buffer;
+  g_autofree size_t *offsets = NULL;
+  uint8_t *staging_data;
+  size_t offset;
+  gboolean succeeded = TRUE;
+  int i;
+
+  *staged = FALSE;
+
+  pixel_buffer = acquire_shm_staging_buffer (staging_size);
+  if (!pixel_buffer)
+    return TRUE;
+
+  staging_buffer = COGL_BUFFER (pixel_buffer);
+  staging_data = cogl_buffer_map_range (staging_buffer,
+                                        0, staging_size,
+                                        COGL_BUFFER_ACCESS_WRITE,
+                                        COGL_BUFFER_MAP_HINT_DISCARD,
+                                        NULL);
+  if (!staging_data)
+    {
+      cogl_object_unref (pixel_buffer);
+      return TRUE;
+    }
+
+  offsets = g_new (size_t, n_rects);
+  offset = 0;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t *rect = &rects[i];
+      const uint8_t *src = data + rect->x * bpp + rect->y * stride;
+      int row_size = rect->width * bpp;
+      int y;
+
+      offsets[i] = offset;
+
+      for (y = 0; y < rect->height; y++)
+        memcpy (staging_data + offset + y * row_size,
+                src + y * stride,
+                row_size);
+
+      offset += get_staged_rectangle_size (rect, bpp);
+    }
+
+  cogl_buffer_unmap (staging_buffer);
+
+  *staged = TRUE;
+
+  for (i = 0; succeeded && i < n_rects; i++)
+    {
+      cairo_rectangle_int_t *rect = &rects[i];
+      CoglBitmap *bitmap;
+
+      bitmap = cogl_bitmap_new_from_buffer (staging_buffer,
+                                            format,
+                                            rect->width, rect->height,
+                                            rect->width * bpp,
+                                            offsets[i]);
+
+      succeeded =
+        _cogl_texture_set_region_from_bitmap (texture,
+                                              0, 0,
+                                              rect->width, rect->height,
+                                              bitmap,
+                                              rect->x, rect->y,
+                                              0,
+                                              error);
+      cogl_object_unref (bitmap);
+    }
+
+  /* GL keeps the storage of a deleted buffer until the uploads queued
+   * from it have completed, so a buffer outside the pool can go now */
+  cogl_object_unref (pixel_buffer);
+
+  return succeeded;
+}
+
 static gboolean
 process_shm_buffer_damage (MetaWaylandBuffer *buffer,
                            CoglTexture       *texture,
@@ -566,35 +790,57 @@ process_shm_buffer_damage (MetaWaylandBuffer *buffer,
                            GError           **error)
 {
   struct wl_shm_buffer *shm_buffer;
-  int i, n_rectangles;
+  g_autofree cairo_rectangle_int_t *rects = NULL;
+  int i, n_rects;
   gboolean set_texture_failed = FALSE;
+  gboolean staged = FALSE;
   CoglPixelFormat format;
-
-  n_rectangles = cairo_region_num_rectangles (region);
+  const uint8_t *data;
+  int32_t stride;
+  size_t staging_size;
+  int bpp;
 
   shm_buffer = wl_shm_buffer_get (buffer->resource);
 
   shm_buffer_get_cogl_pixel_format (shm_buffer, &format, NULL);
   g_return_val_if_fail (cogl_pixel_format_get_n_planes (format) == 1, FALSE);
 
+  bpp = cogl_pixel_format_get_bytes_per_pixel (format, 0);
+
+  rects = g_new (cairo_rectangle_int_t,
+                 MAX (1, cairo_region_num_rectangles (region)));
+  n_rects = coalesce_damage_rectangles (region, rects);
+
+  staging_size = 0;
+  for (i = 0; i < n_rects; i++)
+    staging_size += get_staged_rectangle_size (&rects[i], bpp);
+
   wl_shm_buffer_begin_access (shm_buffer);
 
-  for (i = 0; i < n_rectangles; i++)
+  data = wl_shm_buffer_get_data (shm_buffer);
+  stride = wl_shm_buffer_get_stride (shm_buffer);
+
+  if (staging_size >= SHM_STAGING_MIN_SIZE)
     {
-      const uint8_t *data = wl_shm_buffer_get_data (shm_buffer);
-      int32_t stride = wl_shm_buffer_get_stride (shm_buffer);
-      cairo_rectangle_int_t rect;
-      int bpp;
+      set_texture_failed =
+        !upload_shm_rectangles_staged (texture,
+                                       data, stride, format, bpp,
+                                       rects, n_rects,
+                                       staging_size,
+                                       &staged,
+                                       error);
+    }
 
-      bpp = cogl_pixel_format_get_bytes_per_pixel (format, 0);
-      cairo_region_get_rectangle (region, i, &rect);
+  for (i = 0; !staged && i < n_rects; i++)
+    {
+      cairo_rectangle_int_t *rect = &rects[i];
 
       if (!_cogl_texture_set_region (texture,
-                                     rect.width, rect.height,
+                                     rect->width, rect->height,
                                      format,
                                      stride,
-                                     data + rect.x * bpp + rect.y * stride,
-                                     rect.x, rect.y,
+                                     data + rect->x * bpp + rect->y * stride,
+                                     rect->x, rect->y,
                                      0,
                                      error))
         {
@@ -732,6 +978,24 @@ meta_wayland_buffer_try_acquire_scanout (MetaWaylandBuffer *buffer,
   return NULL;
 }
 
+CoglScanout *
+meta_wayland_buffer_try_acquire_overlay_scanout (MetaWaylandBuffer *buffer,
+                                                 CoglOnscreen      *onscreen)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+
+  /* Only dma-buf buffers carry the format modifier needed to tell whether
+   * an overlay plane can scan them out */
+  if (buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    return NULL;
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (buffer);
+  if (!dma_buf)
+    return NULL;
+
+  return meta_wayland_dma_buf_try_acquire_overlay_scanout (dma_buf, onscreen);
+}
+
 static void
 meta_wayland_buffer_finalize (GObject *object)
 {
@@ -813,3 +1077,17 @@ meta_wayland_init_shm (MetaWaylandCompositor *compositor)
       wl_display_add_shm_format (compositor->wayland_display, shm_formats[i]);
     }
 }
+
+void
+meta_wayland_shm_finalize (MetaWaylandCompositor *compositor)
+{
+  MetaWaylandShmStagingPool *pool = &compositor->shm_staging_pool;
+  int i;
+
+  for (i = 0; i < META_WAYLAND_SHM_STAGING_POOL_SIZE; i++)
+    {
+      g_clear_pointer (&pool->buffers[i].buffer, cogl_object_unref);
+      pool->buffers[i].size = 0;
+    }
+  pool->next = 0;
+}
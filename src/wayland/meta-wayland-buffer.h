@@ -33,6 +33,21 @@
 #include "wayland/meta-wayland-egl-stream.h"
 #include "wayland/meta-wayland-dma-buf.h"
 
+/* Staging buffers are shared by all SHM buffers and reused in turn. */
+#define META_WAYLAND_SHM_STAGING_POOL_SIZE 2
+
+typedef struct _MetaWaylandShmStagingBuffer
+{
+  CoglPixelBuffer *buffer;
+  size_t size;
+} MetaWaylandShmStagingBuffer;
+
+typedef struct _MetaWaylandShmStagingPool
+{
+  MetaWaylandShmStagingBuffer buffers[META_WAYLAND_SHM_STAGING_POOL_SIZE];
+  int next;
+} MetaWaylandShmStagingPool;
+
 typedef enum _MetaWaylandBufferType
 {
   META_WAYLAND_BUFFER_TYPE_UNKNOWN,
@@ -90,7 +105,11 @@ void                    meta_wayland_buffer_process_damage      (MetaWaylandBuff
                                                                  cairo_region_t        *region);
 CoglScanout *           meta_wayland_buffer_try_acquire_scanout (MetaWaylandBuffer     *buffer,
                                                                  CoglOnscreen          *onscreen);
+CoglScanout *           meta_wayland_buffer_try_acquire_overlay_scanout (MetaWaylandBuffer *buffer,
+                                                                         CoglOnscreen      *onscreen);
 
 void meta_wayland_init_shm (MetaWaylandCompositor *compositor);
 
+void meta_wayland_shm_finalize (MetaWaylandCompositor *compositor);
+
 #endif /* META_WAYLAND_BUFFER_H */
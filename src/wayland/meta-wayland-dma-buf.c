@@ -40,6 +40,12 @@
 #include "wayland/meta-wayland-dma-buf.h"
 
 #include <drm_fourcc.h>
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <linux/sync_file.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 #include "backends/meta-backend-private.h"
 #include "backends/meta-egl-ext.h"
@@ -76,6 +82,10 @@ struct _MetaWaylandDmaBufBuffer
   int fds[META_WAYLAND_DMA_BUF_MAX_FDS];
   uint32_t offsets[META_WAYLAND_DMA_BUF_MAX_FDS];
   uint32_t strides[META_WAYLAND_DMA_BUF_MAX_FDS];
+
+  /* Imported once, and reused every time the buffer is scanned out */
+  CoglScanout *scanout;
+  gboolean scanout_import_failed;
 };
 
 G_DEFINE_TYPE (MetaWaylandDmaBufBuffer, meta_wayland_dma_buf_buffer, G_TYPE_OBJECT);
@@ -253,44 +263,38 @@ import_scanout_gbm_bo (MetaWaylandDmaBufBuffer *dma_buf,
 }
 #endif
 
-CoglScanout *
-meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
-                                          CoglOnscreen            *onscreen)
-{
 #ifdef HAVE_NATIVE_BACKEND
+static CoglScanout *
+import_scanout_buffer (MetaWaylandDmaBufBuffer *dma_buf)
+{
   MetaBackend *backend = meta_get_backend ();
   MetaRenderer *renderer = meta_backend_get_renderer (backend);
   MetaRendererNative *renderer_native = META_RENDERER_NATIVE (renderer);
   MetaGpuKms *gpu_kms;
   int n_planes;
-  uint32_t drm_format;
-  uint64_t drm_modifier;
-  uint32_t stride;
   struct gbm_bo *gbm_bo;
   gboolean use_modifier;
   g_autoptr (GError) error = NULL;
   MetaDrmBufferGbm *fb;
 
+  if (dma_buf->scanout)
+    return g_object_ref (dma_buf->scanout);
+
+  if (dma_buf->scanout_import_failed)
+    return NULL;
+
   for (n_planes = 0; n_planes < META_WAYLAND_DMA_BUF_MAX_FDS; n_planes++)
     {
       if (dma_buf->fds[n_planes] < 0)
         break;
     }
 
-  drm_format = dma_buf->drm_format;
-  drm_modifier = dma_buf->drm_modifier;
-  stride = dma_buf->strides[0];
-  if (!meta_onscreen_native_is_buffer_scanout_compatible (onscreen,
-                                                          drm_format,
-                                                          drm_modifier,
-                                                          stride))
-    return NULL;
-
   gpu_kms = meta_renderer_native_get_primary_gpu (renderer_native);
   gbm_bo = import_scanout_gbm_bo (dma_buf, gpu_kms, n_planes, &use_modifier);
   if (!gbm_bo)
     {
       g_debug ("Failed to import scanout gbm_bo: %s", g_strerror (errno));
+      dma_buf->scanout_import_failed = TRUE;
       return NULL;
     }
 
@@ -301,15 +305,141 @@ meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
     {
       g_debug ("Failed to create scanout buffer: %s", error->message);
       gbm_bo_destroy (gbm_bo);
+      dma_buf->scanout_import_failed = TRUE;
       return NULL;
     }
 
-  return COGL_SCANOUT (fb);
+  dma_buf->scanout = COGL_SCANOUT (fb);
+
+  return g_object_ref (dma_buf->scanout);
+}
+#endif
+
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
+                                          CoglOnscreen            *onscreen)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  if (!meta_onscreen_native_is_buffer_scanout_compatible (onscreen,
+                                                          dma_buf->drm_format,
+                                                          dma_buf->drm_modifier,
+                                                          dma_buf->strides[0]))
+    return NULL;
+
+  return import_scanout_buffer (dma_buf);
 #else
   return NULL;
 #endif
 }
 
+CoglScanout *
+meta_wayland_dma_buf_try_acquire_overlay_scanout (MetaWaylandDmaBufBuffer *dma_buf,
+                                                  CoglOnscreen            *onscreen)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  if (!meta_onscreen_native_is_buffer_overlay_compatible (onscreen,
+                                                          dma_buf->drm_format,
+                                                          dma_buf->drm_modifier))
+    return NULL;
+
+  return import_scanout_buffer (dma_buf);
+#else
+  return NULL;
+#endif
+}
+
+static gboolean
+is_dma_buf_readable (int fd)
+{
+  struct pollfd pollfd = {
+    .fd = fd,
+    .events = POLLIN,
+  };
+
+  return poll (&pollfd, 1, 0) > 0;
+}
+
+static int
+export_write_fence (int fd)
+{
+#ifdef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+  struct dma_buf_export_sync_file export_sync_file = {
+    .flags = DMA_BUF_SYNC_READ,
+    .fd = -1,
+  };
+
+  if (ioctl (fd, DMA_BUF_IOCTL_EXPORT_SYNC_FILE, &export_sync_file) == 0)
+    return export_sync_file.fd;
+#endif
+
+  return -1;
+}
+
+static int
+merge_fences (int fence_fd,
+              int other_fence_fd)
+{
+  struct sync_merge_data merge_data = {
+    .name = "mutter-implicit-fence",
+    .fd2 = other_fence_fd,
+  };
+
+  if (ioctl (fence_fd, SYNC_IOC_MERGE, &merge_data) < 0)
+    {
+      close (other_fence_fd);
+      return fence_fd;
+    }
+
+  close (fence_fd);
+  close (other_fence_fd);
+
+  return merge_data.fence;
+}
+
+/**
+ * meta_wayland_dma_buf_get_implicit_fence:
+ * @dma_buf: A #MetaWaylandDmaBufBuffer object
+ *
+ * Fetches a fence for the GPU writes to the buffer that are still in flight,
+ * as implicitly synchronized by the kernel. If the kernel can't export them
+ * as a sync file, a duplicate of the dma-buf file descriptor is returned
+ * instead, which also waits for writes that are queued later on.
+ *
+ * Returns: A file descriptor that polls readable once the writes have
+ * finished, to be closed by the caller, or -1 if the buffer is ready.
+ */
+int
+meta_wayland_dma_buf_get_implicit_fence (MetaWaylandDmaBufBuffer *dma_buf)
+{
+  int fence_fd = -1;
+  int i;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
+    {
+      int fd = dma_buf->fds[i];
+      int plane_fence_fd;
+
+      if (fd < 0 || is_dma_buf_readable (fd))
+        continue;
+
+      plane_fence_fd = export_write_fence (fd);
+      if (plane_fence_fd < 0)
+        {
+          if (fence_fd >= 0)
+            close (fence_fd);
+
+          return fcntl (fd, F_DUPFD_CLOEXEC, 0);
+        }
+
+      if (fence_fd < 0)
+        fence_fd = plane_fence_fd;
+      else
+        fence_fd = merge_fences (fence_fd, plane_fence_fd);
+    }
+
+  return fence_fd;
+}
+
 static void
 buffer_params_add (struct wl_client   *client,
                    struct wl_resource *resource,
@@ -730,6 +860,8 @@ meta_wayland_dma_buf_buffer_finalize (GObject *object)
   MetaWaylandDmaBufBuffer *dma_buf = META_WAYLAND_DMA_BUF_BUFFER (object);
   int i;
 
+  g_clear_object (&dma_buf->scanout);
+
   for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
     {
       if (dma_buf->fds[i] != -1)
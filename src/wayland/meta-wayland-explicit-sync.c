@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Implements zwp_linux_explicit_synchronization_v1. Acquire fences are sync
+ * files that are attached to the pending surface state; commits carrying a
+ * fence that hasn't signalled yet are queued by the surface instead of being
+ * applied, so that sampling from the buffer never stalls on the client's GPU
+ * work. Buffer releases are sent once the buffer is no longer in use, and
+ * the GPU work that was submitted up until then has finished.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-explicit-sync.h"
+
+#include <linux/sync_file.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "backends/meta-backend-private.h"
+#include "clutter/clutter-mutter.h"
+#include "wayland/meta-wayland-dma-buf.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "linux-explicit-synchronization-unstable-v1-server-protocol.h"
+
+typedef struct _MetaWaylandBufferRelease
+{
+  struct wl_list link;
+  struct wl_resource *resource;
+
+  CoglFramebuffer *framebuffer;
+  CoglFenceClosure *fence_closure;
+} MetaWaylandBufferRelease;
+
+static gboolean
+is_sync_file (int fd)
+{
+  struct sync_file_info info = { 0 };
+
+  return ioctl (fd, SYNC_IOC_FILE_INFO, &info) == 0;
+}
+
+gboolean
+meta_wayland_sync_file_is_signalled (int sync_file_fd)
+{
+  struct pollfd pollfd = {
+    .fd = sync_file_fd,
+    .events = POLLIN,
+  };
+
+  return poll (&pollfd, 1, 0) > 0;
+}
+
+static void
+buffer_release_destructor (struct wl_resource *resource)
+{
+  MetaWaylandBufferRelease *release = wl_resource_get_user_data (resource);
+
+  if (release->fence_closure)
+    cogl_framebuffer_cancel_fence_callback (release->framebuffer,
+                                            release->fence_closure);
+  g_clear_pointer (&release->framebuffer, cogl_object_unref);
+
+  wl_list_remove (&release->link);
+  g_free (release);
+}
+
+static void
+send_immediate_release (MetaWaylandBufferRelease *release)
+{
+  zwp_linux_buffer_release_v1_send_immediate_release (release->resource);
+  wl_resource_destroy (release->resource);
+}
+
+static void
+on_buffer_release_fence (CoglFence *fence,
+                         void      *user_data)
+{
+  MetaWaylandBufferRelease *release = user_data;
+
+  release->fence_closure = NULL;
+  send_immediate_release (release);
+}
+
+static CoglFramebuffer *
+get_release_framebuffer (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterActor *stage = meta_backend_get_stage (backend);
+  GList *views;
+
+  views = clutter_stage_peek_stage_views (CLUTTER_STAGE (stage));
+  if (!views)
+    return NULL;
+
+  return clutter_stage_view_get_framebuffer (views->data);
+}
+
+void
+meta_wayland_buffer_release_list_send (struct wl_list *release_list)
+{
+  MetaWaylandBufferRelease *release, *next;
+  CoglFramebuffer *framebuffer;
+
+  if (wl_list_empty (release_list))
+    return;
+
+  /* By the time a buffer is no longer in use, all GPU work sampling from it
+   * has been submitted. All views share the same GL context, so a fence on
+   * any of them signals once that work has finished.
+   */
+  framebuffer = get_release_framebuffer ();
+
+  wl_list_for_each_safe (release, next, release_list, link)
+    {
+      wl_list_remove (&release->link);
+      wl_list_init (&release->link);
+
+      if (framebuffer)
+        {
+          release->fence_closure =
+            cogl_framebuffer_add_fence_callback (framebuffer,
+                                                 on_buffer_release_fence,
+                                                 release);
+        }
+
+      if (release->fence_closure)
+        release->framebuffer = cogl_object_ref (framebuffer);
+      else
+        send_immediate_release (release);
+    }
+
+  if (framebuffer)
+    cogl_framebuffer_flush (framebuffer);
+}
+
+void
+meta_wayland_buffer_release_list_send_immediate (struct wl_list *release_list)
+{
+  MetaWaylandBufferRelease *release, *next;
+
+  wl_list_for_each_safe (release, next, release_list, link)
+    send_immediate_release (release);
+}
+
+gboolean
+meta_wayland_explicit_sync_validate_state (MetaWaylandSurface      *surface,
+                                           MetaWaylandSurfaceState *state)
+{
+  struct wl_resource *resource = surface->explicit_sync.resource;
+
+  if (state->acquire_fence_fd < 0 &&
+      wl_list_empty (&state->buffer_release_list))
+    return TRUE;
+
+  if (!state->buffer)
+    {
+      /* Releases stay valid after the synchronization object is destroyed,
+       * but there is nothing left to raise the error on */
+      if (!resource)
+        {
+          meta_wayland_buffer_release_list_send_immediate (
+            &state->buffer_release_list);
+          return TRUE;
+        }
+
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_BUFFER,
+                              "no buffer attached to surface");
+      return FALSE;
+    }
+
+  if (state->acquire_fence_fd >= 0 &&
+      !meta_wayland_dma_buf_from_buffer (state->buffer))
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_UNSUPPORTED_BUFFER,
+                              "acquire fences are only supported for "
+                              "dma-buf buffers");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+surface_synchronization_destructor (struct wl_resource *resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  MetaWaylandSurfaceState *pending;
+
+  if (!surface)
+    return;
+
+  g_clear_signal_handler (&surface->explicit_sync.destroy_handler_id, surface);
+
+  /* Fences set since the last commit are discarded with the object, while
+   * release objects stay valid */
+  pending = meta_wayland_surface_get_pending_state (surface);
+  if (pending->acquire_fence_fd >= 0)
+    {
+      close (pending->acquire_fence_fd);
+      pending->acquire_fence_fd = -1;
+    }
+
+  surface->explicit_sync.resource = NULL;
+}
+
+static void
+on_surface_destroyed (MetaWaylandSurface *surface)
+{
+  wl_resource_set_user_data (surface->explicit_sync.resource, NULL);
+}
+
+static void
+surface_synchronization_destroy (struct wl_client   *client,
+                                 struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+surface_synchronization_set_acquire_fence (struct wl_client   *client,
+                                           struct wl_resource *resource,
+                                           int32_t             fd)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  MetaWaylandSurfaceState *pending;
+
+  if (!surface)
+    {
+      close (fd);
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+                              "wl_surface for this synchronization object "
+                              "no longer exists");
+      return;
+    }
+
+  if (!is_sync_file (fd))
+    {
+      close (fd);
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_INVALID_FENCE,
+                              "acquire fence is not a sync file");
+      return;
+    }
+
+  pending = meta_wayland_surface_get_pending_state (surface);
+  if (pending->acquire_fence_fd >= 0)
+    {
+      close (fd);
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_FENCE,
+                              "acquire fence already set for this commit");
+      return;
+    }
+
+  pending->acquire_fence_fd = fd;
+}
+
+static void
+surface_synchronization_get_release (struct wl_client   *client,
+                                     struct wl_resource *resource,
+                                     uint32_t            release_id)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  MetaWaylandSurfaceState *pending;
+  MetaWaylandBufferRelease *release;
+
+  if (!surface)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+                              "wl_surface for this synchronization object "
+                              "no longer exists");
+      return;
+    }
+
+  pending = meta_wayland_surface_get_pending_state (surface);
+  if (!wl_list_empty (&pending->buffer_release_list))
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_RELEASE,
+                              "release already requested for this commit");
+      return;
+    }
+
+  release = g_new0 (MetaWaylandBufferRelease, 1);
+  wl_list_init (&release->link);
+  release->resource = wl_resource_create (client,
+                                          &zwp_linux_buffer_release_v1_interface,
+                                          wl_resource_get_version (resource),
+                                          release_id);
+  if (!release->resource)
+    {
+      g_free (release);
+      wl_client_post_no_memory (client);
+      return;
+    }
+
+  wl_resource_set_implementation (release->resource,
+                                  NULL,
+                                  release,
+                                  buffer_release_destructor);
+
+  wl_list_insert (pending->buffer_release_list.prev, &release->link);
+}
+
+static const struct zwp_linux_surface_synchronization_v1_interface
+meta_wayland_surface_synchronization_interface = {
+  surface_synchronization_destroy,
+  surface_synchronization_set_acquire_fence,
+  surface_synchronization_get_release,
+};
+
+static void
+explicit_synchronization_destroy (struct wl_client   *client,
+                                  struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+explicit_synchronization_get_synchronization (struct wl_client   *client,
+                                              struct wl_resource *resource,
+                                              uint32_t            id,
+                                              struct wl_resource *surface_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  struct wl_resource *sync_resource;
+
+  if (surface->explicit_sync.resource)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_ERROR_SYNCHRONIZATION_EXISTS,
+                              "synchronization object already exists on "
+                              "surface");
+      return;
+    }
+
+  sync_resource =
+    wl_resource_create (client,
+                        &zwp_linux_surface_synchronization_v1_interface,
+                        wl_resource_get_version (resource),
+                        id);
+  wl_resource_set_implementation (sync_resource,
+                                  &meta_wayland_surface_synchronization_interface,
+                                  surface,
+                                  surface_synchronization_destructor);
+
+  surface->explicit_sync.resource = sync_resource;
+  surface->explicit_sync.destroy_handler_id =
+    g_signal_connect (surface,
+                      "destroy",
+                      G_CALLBACK (on_surface_destroyed),
+                      NULL);
+}
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+meta_wayland_explicit_synchronization_interface = {
+  explicit_synchronization_destroy,
+  explicit_synchronization_get_synchronization,
+};
+
+static void
+explicit_synchronization_bind (struct wl_client *client,
+                               void             *data,
+                               uint32_t          version,
+                               uint32_t          id)
+{
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client,
+                                 &zwp_linux_explicit_synchronization_v1_interface,
+                                 version,
+                                 id);
+  wl_resource_set_implementation (resource,
+                                  &meta_wayland_explicit_synchronization_interface,
+                                  data,
+                                  NULL);
+}
+
+void
+meta_wayland_init_explicit_sync (MetaWaylandCompositor *compositor)
+{
+  if (wl_global_create (compositor->wayland_display,
+                        &zwp_linux_explicit_synchronization_v1_interface,
+                        META_ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION,
+                        compositor,
+                        explicit_synchronization_bind) == NULL)
+    g_error ("Failed to register a global explicit synchronization object");
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_WAYLAND_EXPLICIT_SYNC_H
+#define META_WAYLAND_EXPLICIT_SYNC_H
+
+#include <wayland-server.h>
+
+#include "wayland/meta-wayland-types.h"
+
+void meta_wayland_init_explicit_sync (MetaWaylandCompositor *compositor);
+
+gboolean meta_wayland_explicit_sync_validate_state (MetaWaylandSurface      *surface,
+                                                    MetaWaylandSurfaceState *state);
+
+gboolean meta_wayland_sync_file_is_signalled (int sync_file_fd);
+
+void meta_wayland_buffer_release_list_send (struct wl_list *release_list);
+
+void meta_wayland_buffer_release_list_send_immediate (struct wl_list *release_list);
+
+#endif /* META_WAYLAND_EXPLICIT_SYNC_H */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef META_WAYLAND_PRESENTATION_TIME_PRIVATE_H
+#define META_WAYLAND_PRESENTATION_TIME_PRIVATE_H
+
+#include <wayland-server.h>
+
+#include "wayland/meta-wayland-types.h"
+
+typedef struct _MetaWaylandPresentationFeedback
+{
+  struct wl_list link;
+  struct wl_resource *resource;
+
+  /* Whether the surface was scanned out when the frame was painted */
+  gboolean is_scanout;
+} MetaWaylandPresentationFeedback;
+
+typedef struct _MetaWaylandPresentationTime
+{
+  /* Surfaces with committed feedbacks that haven't been painted yet */
+  GList *feedback_surfaces;
+} MetaWaylandPresentationTime;
+
+void meta_wayland_init_presentation_time (MetaWaylandCompositor *compositor);
+
+void meta_wayland_presentation_feedback_discard_list (struct wl_list *feedback_list);
+
+void meta_wayland_presentation_time_queue_feedbacks (MetaWaylandCompositor *compositor,
+                                                     MetaWaylandSurface    *surface,
+                                                     struct wl_list        *feedback_list);
+
+void meta_wayland_presentation_time_remove_surface (MetaWaylandCompositor *compositor,
+                                                    MetaWaylandSurface    *surface);
+
+#endif /* META_WAYLAND_PRESENTATION_TIME_PRIVATE_H */
@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2020 Red Hat Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Implements wp_presentation. Feedbacks are attached to the surface when
+ * the content update they belong to is applied, moved to the stage view
+ * the surface was painted on after painting, and sent once the view
+ * reports the frame as presented, with the timestamp and retrace counter
+ * of the page flip.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-presentation-time-private.h"
+
+#include <time.h>
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-logical-monitor.h"
+#include "backends/meta-monitor-manager-private.h"
+#include "clutter/clutter-mutter.h"
+#include "compositor/meta-surface-actor.h"
+#include "wayland/meta-wayland-outputs.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "presentation-time-server-protocol.h"
+
+static GQuark quark_view_feedbacks;
+
+static void
+wp_presentation_feedback_destructor (struct wl_resource *resource)
+{
+  MetaWaylandPresentationFeedback *feedback =
+    wl_resource_get_user_data (resource);
+
+  wl_list_remove (&feedback->link);
+  g_free (feedback);
+}
+
+static void
+discard_feedback (MetaWaylandPresentationFeedback *feedback)
+{
+  wp_presentation_feedback_send_discarded (feedback->resource);
+  wl_resource_destroy (feedback->resource);
+}
+
+void
+meta_wayland_presentation_feedback_discard_list (struct wl_list *feedback_list)
+{
+  MetaWaylandPresentationFeedback *feedback, *next;
+
+  wl_list_for_each_safe (feedback, next, feedback_list, link)
+    discard_feedback (feedback);
+}
+
+static void
+view_feedbacks_free (struct wl_list *feedback_list)
+{
+  meta_wayland_presentation_feedback_discard_list (feedback_list);
+  g_free (feedback_list);
+}
+
+static struct wl_list *
+ensure_view_feedbacks (ClutterStageView *stage_view)
+{
+  struct wl_list *feedback_list;
+
+  feedback_list = g_object_get_qdata (G_OBJECT (stage_view),
+                                      quark_view_feedbacks);
+  if (feedback_list)
+    return feedback_list;
+
+  feedback_list = g_new0 (struct wl_list, 1);
+  wl_list_init (feedback_list);
+  g_object_set_qdata_full (G_OBJECT (stage_view),
+                           quark_view_feedbacks,
+                           feedback_list,
+                           (GDestroyNotify) view_feedbacks_free);
+
+  return feedback_list;
+}
+
+static MetaWaylandOutput *
+get_output_for_view (MetaWaylandCompositor *compositor,
+                     ClutterStageView      *stage_view)
+{
+  MetaMonitorManager *monitor_manager =
+    meta_backend_get_monitor_manager (compositor->backend);
+  MetaLogicalMonitor *logical_monitor;
+  MetaRectangle view_layout;
+
+  clutter_stage_view_get_layout (stage_view, &view_layout);
+  logical_monitor =
+    meta_monitor_manager_get_logical_monitor_from_rect (monitor_manager,
+                                                        &view_layout);
+  if (!logical_monitor)
+    return NULL;
+
+  return g_hash_table_lookup (compositor->outputs,
+                              &logical_monitor->winsys_id);
+}
+
+static void
+present_feedback (MetaWaylandPresentationFeedback *feedback,
+                  ClutterFrameInfo                *frame_info,
+                  MetaWaylandOutput               *wayland_output)
+{
+  struct wl_client *client = wl_resource_get_client (feedback->resource);
+  int64_t presentation_time_us;
+  uint64_t time_s;
+  uint32_t time_ns;
+  uint32_t refresh_ns = 0;
+  uint32_t sequence = 0;
+  uint32_t flags = 0;
+
+  if (wayland_output)
+    {
+      GList *l;
+
+      for (l = wayland_output->resources; l; l = l->next)
+        {
+          struct wl_resource *output_resource = l->data;
+
+          if (wl_resource_get_client (output_resource) == client)
+            wp_presentation_feedback_send_sync_output (feedback->resource,
+                                                       output_resource);
+        }
+    }
+
+  presentation_time_us = frame_info->presentation_time;
+  if (presentation_time_us == 0)
+    presentation_time_us = g_get_monotonic_time ();
+
+  time_s = presentation_time_us / G_USEC_PER_SEC;
+  time_ns = (presentation_time_us % G_USEC_PER_SEC) * 1000;
+
+  if (frame_info->refresh_rate > 0.0)
+    refresh_ns = (uint32_t) (0.5 + 1000000000.0 / frame_info->refresh_rate);
+
+  if (frame_info->flags & CLUTTER_FRAME_INFO_FLAG_VSYNC)
+    flags |= WP_PRESENTATION_FEEDBACK_KIND_VSYNC;
+
+  /* The timestamp comes from the page flip event of the kernel, which is
+   * sent when the flip has completed */
+  if (frame_info->flags & CLUTTER_FRAME_INFO_FLAG_HW_CLOCK)
+    {
+      flags |= WP_PRESENTATION_FEEDBACK_KIND_HW_CLOCK |
+               WP_PRESENTATION_FEEDBACK_KIND_HW_COMPLETION;
+      sequence = frame_info->sequence;
+    }
+
+  if (frame_info->flags & CLUTTER_FRAME_INFO_FLAG_ZERO_COPY &&
+      feedback->is_scanout)
+    flags |= WP_PRESENTATION_FEEDBACK_KIND_ZERO_COPY;
+
+  wp_presentation_feedback_send_presented (feedback->resource,
+                                           time_s >> 32,
+                                           time_s & 0xffffffff,
+                                           time_ns,
+                                           refresh_ns,
+                                           0,
+                                           sequence,
+                                           flags);
+
+  wl_resource_destroy (feedback->resource);
+}
+
+static void
+on_after_paint (ClutterStage          *stage,
+                ClutterStageView      *stage_view,
+                MetaWaylandCompositor *compositor)
+{
+  struct wl_list *view_feedbacks = NULL;
+  GList *l;
+
+  l = compositor->presentation_time.feedback_surfaces;
+  while (l)
+    {
+      GList *l_cur = l;
+      MetaWaylandSurface *surface = l->data;
+      MetaSurfaceActor *actor;
+      MetaWaylandPresentationFeedback *feedback;
+      gboolean is_scanout;
+
+      l = l->next;
+
+      actor = meta_wayland_surface_get_actor (surface);
+      if (!actor)
+        continue;
+
+      if (!clutter_actor_has_mapped_clones (CLUTTER_ACTOR (actor)) &&
+          meta_surface_actor_is_obscured (actor))
+        continue;
+
+      if (!clutter_actor_is_effectively_on_stage_view (CLUTTER_ACTOR (actor),
+                                                       stage_view))
+        continue;
+
+      if (!view_feedbacks)
+        view_feedbacks = ensure_view_feedbacks (stage_view);
+
+      is_scanout = meta_wayland_surface_is_scanned_out (surface);
+      wl_list_for_each (feedback,
+                        &surface->presentation_time.feedback_list,
+                        link)
+        feedback->is_scanout = is_scanout;
+
+      wl_list_insert_list (view_feedbacks->prev,
+                           &surface->presentation_time.feedback_list);
+      wl_list_init (&surface->presentation_time.feedback_list);
+
+      compositor->presentation_time.feedback_surfaces =
+        g_list_delete_link (compositor->presentation_time.feedback_surfaces,
+                            l_cur);
+    }
+}
+
+static void
+on_presented (ClutterStage          *stage,
+              ClutterStageView      *stage_view,
+              ClutterFrameInfo      *frame_info,
+              MetaWaylandCompositor *compositor)
+{
+  struct wl_list *view_feedbacks;
+  MetaWaylandPresentationFeedback *feedback, *next;
+  MetaWaylandOutput *wayland_output;
+
+  view_feedbacks = g_object_get_qdata (G_OBJECT (stage_view),
+                                       quark_view_feedbacks);
+  if (!view_feedbacks || wl_list_empty (view_feedbacks))
+    return;
+
+  wayland_output = get_output_for_view (compositor, stage_view);
+
+  wl_list_for_each_safe (feedback, next, view_feedbacks, link)
+    present_feedback (feedback, frame_info, wayland_output);
+}
+
+void
+meta_wayland_presentation_time_queue_feedbacks (MetaWaylandCompositor *compositor,
+                                                MetaWaylandSurface    *surface,
+                                                struct wl_list        *feedback_list)
+{
+  MetaWaylandPresentationTime *presentation_time =
+    &compositor->presentation_time;
+
+  wl_list_insert_list (surface->presentation_time.feedback_list.prev,
+                       feedback_list);
+  wl_list_init (feedback_list);
+
+  if (g_list_find (presentation_time->feedback_surfaces, surface))
+    return;
+
+  presentation_time->feedback_surfaces =
+    g_list_prepend (presentation_time->feedback_surfaces, surface);
+}
+
+void
+meta_wayland_presentation_time_remove_surface (MetaWaylandCompositor *compositor,
+                                               MetaWaylandSurface    *surface)
+{
+  MetaWaylandPresentationTime *presentation_time =
+    &compositor->presentation_time;
+
+  meta_wayland_presentation_feedback_discard_list (
+    &surface->presentation_time.feedback_list);
+
+  presentation_time->feedback_surfaces =
+    g_list_remove (presentation_time->feedback_surfaces, surface);
+}
+
+static void
+wp_presentation_destroy (struct wl_client   *client,
+                         struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+wp_presentation_feedback (struct wl_client   *client,
+                          struct wl_resource *resource,
+                          struct wl_resource *surface_resource,
+                          uint32_t            callback_id)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  MetaWaylandSurfaceState *pending;
+  MetaWaylandPresentationFeedback *feedback;
+
+  feedback = g_new0 (MetaWaylandPresentationFeedback, 1);
+  wl_list_init (&feedback->link);
+  feedback->resource = wl_resource_create (client,
+                                           &wp_presentation_feedback_interface,
+                                           wl_resource_get_version (resource),
+                                           callback_id);
+  if (!feedback->resource)
+    {
+      g_free (feedback);
+      wl_client_post_no_memory (client);
+      return;
+    }
+
+  wl_resource_set_implementation (feedback->resource,
+                                  NULL,
+                                  feedback,
+                                  wp_presentation_feedback_destructor);
+
+  if (!surface)
+    {
+      discard_feedback (feedback);
+      return;
+    }
+
+  pending = meta_wayland_surface_get_pending_state (surface);
+  wl_list_insert (pending->presentation_feedback_list.prev, &feedback->link);
+}
+
+static const struct wp_presentation_interface
+meta_wayland_presentation_interface = {
+  wp_presentation_destroy,
+  wp_presentation_feedback,
+};
+
+static void
+wp_presentation_bind (struct wl_client *client,
+                      void             *data,
+                      uint32_t          version,
+                      uint32_t          id)
+{
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client,
+                                 &wp_presentation_interface,
+                                 version,
+                                 id);
+  wl_resource_set_implementation (resource,
+                                  &meta_wayland_presentation_interface,
+                                  data,
+                                  NULL);
+
+  /* Presentation times are based on the timestamps of page flip events,
+   * which are in the monotonic clock domain */
+  wp_presentation_send_clock_id (resource, CLOCK_MONOTONIC);
+}
+
+void
+meta_wayland_init_presentation_time (MetaWaylandCompositor *compositor)
+{
+  ClutterActor *stage = meta_backend_get_stage (compositor->backend);
+
+  quark_view_feedbacks =
+    g_quark_from_static_string ("-meta-wayland-presentation-feedbacks");
+
+  g_signal_connect (stage, "after-paint",
+                    G_CALLBACK (on_after_paint), compositor);
+  g_signal_connect (stage, "presented",
+                    G_CALLBACK (on_presented), compositor);
+
+  if (wl_global_create (compositor->wayland_display,
+                        &wp_presentation_interface,
+                        META_WP_PRESENTATION_VERSION,
+                        compositor,
+                        wp_presentation_bind) == NULL)
+    g_error ("Failed to register a global wp-presentation object");
+}
@@ -26,7 +26,9 @@
 #include "clutter/clutter.h"
 #include "core/window-private.h"
 #include "meta/meta-cursor-tracker.h"
+#include "wayland/meta-wayland-buffer.h"
 #include "wayland/meta-wayland-pointer-gestures.h"
+#include "wayland/meta-wayland-presentation-time-private.h"
 #include "wayland/meta-wayland-seat.h"
 #include "wayland/meta-wayland-surface.h"
 #include "wayland/meta-wayland-tablet-manager.h"
@@ -86,6 +88,10 @@ struct _MetaWaylandCompositor
   MetaWaylandTabletManager *tablet_manager;
 
   GHashTable *scheduled_surface_associations;
+
+  MetaWaylandPresentationTime presentation_time;
+
+  MetaWaylandShmStagingPool shm_staging_pool;
 };
 
 #define META_TYPE_WAYLAND_COMPOSITOR (meta_wayland_compositor_get_type ())
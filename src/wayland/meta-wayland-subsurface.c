@@ -368,8 +368,12 @@ wl_subsurface_destructor (struct wl_resource *resource)
 
   if (surface->sub.parent)
     {
+      MetaWaylandSurface *parent = surface->sub.parent;
+
       wl_list_remove (&surface->sub.parent_destroy_listener.link);
       surface->sub.parent = NULL;
+
+      meta_wayland_surface_release_subsurface_commits (parent, surface);
     }
 
   surface->wl_subsurface = NULL;
@@ -500,7 +504,16 @@ wl_subsurface_set_desync (struct wl_client   *client,
 
   if (was_effectively_synchronized &&
       !is_surface_effectively_synchronized (surface))
-    meta_wayland_surface_apply_cached_state (surface);
+    {
+      meta_wayland_surface_apply_cached_state (surface);
+
+      /* The parent no longer waits for queued commits of this surface */
+      if (surface->sub.parent)
+        {
+          meta_wayland_surface_release_subsurface_commits (surface->sub.parent,
+                                                           surface);
+        }
+    }
 }
 
 static const struct wl_subsurface_interface meta_wayland_wl_subsurface_interface = {
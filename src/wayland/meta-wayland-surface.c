@@ -24,7 +24,9 @@
 
 #include "wayland/meta-wayland-surface.h"
 
+#include <glib-unix.h>
 #include <gobject/gvaluecollector.h>
+#include <unistd.h>
 #include <wayland-server.h>
 
 #include "backends/meta-cursor-tracker-private.h"
@@ -41,6 +43,8 @@
 #include "wayland/meta-wayland-actor-surface.h"
 #include "wayland/meta-wayland-buffer.h"
 #include "wayland/meta-wayland-data-device.h"
+#include "wayland/meta-wayland-dma-buf.h"
+#include "wayland/meta-wayland-explicit-sync.h"
 #include "wayland/meta-wayland-gtk-shell.h"
 #include "wayland/meta-wayland-keyboard.h"
 #include "wayland/meta-wayland-legacy-xdg-shell.h"
@@ -136,6 +140,7 @@ meta_wayland_buffer_ref_new (void)
 
   buffer_ref = g_new0 (MetaWaylandBufferRef, 1);
   g_ref_count_init (&buffer_ref->ref_count);
+  wl_list_init (&buffer_ref->release_list);
 
   return buffer_ref;
 }
@@ -153,6 +158,7 @@ meta_wayland_buffer_ref_unref (MetaWaylandBufferRef *buffer_ref)
   if (g_ref_count_dec (&buffer_ref->ref_count))
     {
       g_warn_if_fail (buffer_ref->use_count == 0);
+      meta_wayland_buffer_release_list_send (&buffer_ref->release_list);
       g_clear_object (&buffer_ref->buffer);
       g_free (buffer_ref);
     }
@@ -177,8 +183,13 @@ meta_wayland_buffer_ref_dec_use_count (MetaWaylandBufferRef *buffer_ref)
 
   buffer_ref->use_count--;
 
-  if (buffer_ref->use_count == 0 && buffer->resource)
+  if (buffer_ref->use_count > 0)
+    return;
+
+  if (buffer->resource)
     wl_buffer_send_release (buffer->resource);
+
+  meta_wayland_buffer_release_list_send (&buffer_ref->release_list);
 }
 
 static void
@@ -457,6 +468,11 @@ meta_wayland_surface_state_set_default (MetaWaylandSurfaceState *state)
   state->surface_damage = cairo_region_create ();
   state->buffer_damage = cairo_region_create ();
   wl_list_init (&state->frame_callback_list);
+  wl_list_init (&state->presentation_feedback_list);
+
+  state->acquire_fence_fd = -1;
+  wl_list_init (&state->buffer_release_list);
+  state->subsurface_commits = NULL;
 
   state->has_new_geometry = FALSE;
   state->has_acked_configure_serial = FALSE;
@@ -483,6 +499,21 @@ meta_wayland_surface_state_clear (MetaWaylandSurfaceState *state)
 
   wl_list_for_each_safe (cb, next, &state->frame_callback_list, link)
     wl_resource_destroy (cb->resource);
+
+  meta_wayland_presentation_feedback_discard_list (
+    &state->presentation_feedback_list);
+
+  if (state->acquire_fence_fd >= 0)
+    {
+      close (state->acquire_fence_fd);
+      state->acquire_fence_fd = -1;
+    }
+
+  g_clear_pointer (&state->subsurface_commits, g_hash_table_unref);
+
+  /* The buffer of a state that is never applied isn't used at all */
+  meta_wayland_buffer_release_list_send_immediate (
+    &state->buffer_release_list);
 }
 
 static void
@@ -505,11 +536,29 @@ meta_wayland_surface_state_merge_into (MetaWaylandSurfaceState *from,
       to->buffer = from->buffer;
       to->dx = from->dx;
       to->dy = from->dy;
+
+      meta_wayland_buffer_release_list_send_immediate (
+        &to->buffer_release_list);
+    }
+
+  wl_list_insert_list (&to->buffer_release_list, &from->buffer_release_list);
+  wl_list_init (&from->buffer_release_list);
+
+  if (from->acquire_fence_fd >= 0)
+    {
+      if (to->acquire_fence_fd >= 0)
+        close (to->acquire_fence_fd);
+      to->acquire_fence_fd = from->acquire_fence_fd;
+      from->acquire_fence_fd = -1;
     }
 
   wl_list_insert_list (&to->frame_callback_list, &from->frame_callback_list);
   wl_list_init (&from->frame_callback_list);
 
+  wl_list_insert_list (&to->presentation_feedback_list,
+                       &from->presentation_feedback_list);
+  wl_list_init (&from->presentation_feedback_list);
+
   cairo_region_union (to->surface_damage, from->surface_damage);
   cairo_region_union (to->buffer_damage, from->buffer_damage);
 
@@ -667,6 +716,10 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
 
       g_set_object (&surface->buffer_ref->buffer, state->buffer);
 
+      wl_list_insert_list (&surface->buffer_ref->release_list,
+                           &state->buffer_release_list);
+      wl_list_init (&state->buffer_release_list);
+
       if (state->buffer)
         meta_wayland_surface_ref_buffer_use_count (surface);
 
@@ -755,6 +808,20 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
         surface->input_region = NULL;
     }
 
+  /* Content updates that were never painted are superseded by a new buffer */
+  if (state->newly_attached)
+    {
+      meta_wayland_presentation_feedback_discard_list (
+        &surface->presentation_time.feedback_list);
+    }
+
+  if (!wl_list_empty (&state->presentation_feedback_list))
+    {
+      meta_wayland_presentation_time_queue_feedbacks (surface->compositor,
+                                                      surface,
+                                                      &state->presentation_feedback_list);
+    }
+
   if (surface->role)
     {
       meta_wayland_surface_role_apply_state (surface->role, state);
@@ -846,17 +913,9 @@ meta_wayland_surface_ensure_cached_state (MetaWaylandSurface *surface)
 }
 
 static void
-meta_wayland_surface_commit (MetaWaylandSurface *surface)
+meta_wayland_surface_commit_state (MetaWaylandSurface      *surface,
+                                   MetaWaylandSurfaceState *state)
 {
-  MetaWaylandSurfaceState *pending = surface->pending_state;
-
-  COGL_TRACE_BEGIN_SCOPED (MetaWaylandSurfaceCommit,
-                           "WaylandSurface (commit)");
-
-  if (pending->buffer &&
-      !meta_wayland_buffer_is_realized (pending->buffer))
-    meta_wayland_buffer_realize (pending->buffer);
-
   /*
    * If this is a sub-surface and it is in effective synchronous mode, only
    * cache the pending surface state until either one of the following two
@@ -870,12 +929,352 @@ meta_wayland_surface_commit (MetaWaylandSurface *surface)
       MetaWaylandSurfaceState *cached_state;
 
       cached_state = meta_wayland_surface_ensure_cached_state (surface);
-      meta_wayland_surface_state_merge_into (pending, cached_state);
+      meta_wayland_surface_state_merge_into (state, cached_state);
+    }
+  else
+    {
+      meta_wayland_surface_apply_state (surface, state);
+    }
+}
+
+static gboolean
+is_state_ready (MetaWaylandSurfaceState *state)
+{
+  if (state->acquire_fence_fd < 0)
+    return TRUE;
+
+  if (!meta_wayland_sync_file_is_signalled (state->acquire_fence_fd))
+    return FALSE;
+
+  close (state->acquire_fence_fd);
+  state->acquire_fence_fd = -1;
+
+  return TRUE;
+}
+
+static gboolean
+has_queued_synchronized_subsurface_commits (MetaWaylandSurface *surface)
+{
+  MetaWaylandSurface *subsurface_surface;
+
+  META_WAYLAND_SURFACE_FOREACH_SUBSURFACE (surface, subsurface_surface)
+    {
+      if (!meta_wayland_surface_should_cache_state (subsurface_surface))
+        continue;
+
+      if (!g_queue_is_empty (&subsurface_surface->commit_queue.states))
+        return TRUE;
+
+      if (has_queued_synchronized_subsurface_commits (subsurface_surface))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+on_commit_fence_signalled (int           fd,
+                           GIOCondition  condition,
+                           gpointer      user_data)
+{
+  MetaWaylandSurface *surface = user_data;
+
+  surface->commit_queue.fence_source_id = 0;
+  meta_wayland_surface_process_queued_commits (surface);
+
+  return G_SOURCE_REMOVE;
+}
+
+static unsigned int
+get_n_claimed_subsurface_commits (MetaWaylandSurface *surface,
+                                  MetaWaylandSurface *subsurface_surface)
+{
+  unsigned int n_claimed = 0;
+  GList *l;
+
+  for (l = surface->commit_queue.states.head; l; l = l->next)
+    {
+      MetaWaylandSurfaceState *state = l->data;
+
+      if (!state->subsurface_commits)
+        continue;
+
+      n_claimed +=
+        GPOINTER_TO_UINT (g_hash_table_lookup (state->subsurface_commits,
+                                               subsurface_surface));
+    }
+
+  return n_claimed;
+}
+
+/*
+ * Records in @state, about to be queued, how many of the queued commits of
+ * each synchronized subsurface were made before it. Only those are applied
+ * together with @state; later ones wait for the next commit of @surface.
+ */
+static void
+claim_subsurface_commits (MetaWaylandSurface      *surface,
+                          MetaWaylandSurfaceState *state)
+{
+  MetaWaylandSurface *subsurface_surface;
+
+  META_WAYLAND_SURFACE_FOREACH_SUBSURFACE (surface, subsurface_surface)
+    {
+      unsigned int n_queued;
+      unsigned int n_claimed;
+
+      if (!meta_wayland_surface_should_cache_state (subsurface_surface))
+        continue;
+
+      n_queued = g_queue_get_length (&subsurface_surface->commit_queue.states);
+      n_claimed = get_n_claimed_subsurface_commits (surface,
+                                                    subsurface_surface);
+      if (n_queued == n_claimed)
+        continue;
+
+      if (!state->subsurface_commits)
+        state->subsurface_commits = g_hash_table_new (NULL, NULL);
+
+      g_hash_table_insert (state->subsurface_commits,
+                           subsurface_surface,
+                           GUINT_TO_POINTER (n_queued - n_claimed));
+    }
+}
+
+/*
+ * Whether a synchronized ancestor of @surface has queued commits. Commits of
+ * @surface must then be queued too, as caching them right away would have
+ * them applied along with the ancestor's queued commits made before them.
+ */
+static gboolean
+has_queued_ancestor_commits (MetaWaylandSurface *surface)
+{
+  while (surface->sub.parent &&
+         meta_wayland_surface_should_cache_state (surface))
+    {
+      surface = surface->sub.parent;
+
+      if (!g_queue_is_empty (&surface->commit_queue.states))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Whether a synchronized ancestor of @surface has a queued commit made before
+ * @state. Applying that commit applies the cached state of its synchronized
+ * subsurfaces, down to @surface.
+ */
+static gboolean
+has_older_ancestor_commits (MetaWaylandSurface      *surface,
+                            MetaWaylandSurfaceState *state)
+{
+  while (surface->sub.parent &&
+         meta_wayland_surface_should_cache_state (surface))
+    {
+      MetaWaylandSurfaceState *ancestor_state;
+
+      surface = surface->sub.parent;
+
+      ancestor_state = g_queue_peek_head (&surface->commit_queue.states);
+      if (ancestor_state && ancestor_state->queue_serial < state->queue_serial)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * A queued commit of a synchronized subsurface may only be cached once it is
+ * claimed by the oldest queued commit of the parent, or when the parent has
+ * nothing queued, and no commit of another ancestor made before it is still
+ * queued.
+ */
+static gboolean
+take_parent_claim (MetaWaylandSurface      *surface,
+                   MetaWaylandSurfaceState *state)
+{
+  MetaWaylandSurface *parent = surface->sub.parent;
+  MetaWaylandSurfaceState *parent_state;
+  unsigned int n_claimed;
+
+  if (!parent || !meta_wayland_surface_should_cache_state (surface))
+    return TRUE;
+
+  if (has_older_ancestor_commits (surface, state))
+    return FALSE;
+
+  parent_state = g_queue_peek_head (&parent->commit_queue.states);
+  if (!parent_state)
+    return TRUE;
+
+  if (!parent_state->subsurface_commits)
+    return FALSE;
+
+  n_claimed = GPOINTER_TO_UINT (g_hash_table_lookup (parent_state->subsurface_commits,
+                                                     surface));
+  if (n_claimed == 0)
+    return FALSE;
+
+  if (n_claimed == 1)
+    {
+      g_hash_table_remove (parent_state->subsurface_commits, surface);
     }
   else
     {
-      meta_wayland_surface_apply_state (surface, surface->pending_state);
+      g_hash_table_insert (parent_state->subsurface_commits,
+                           surface,
+                           GUINT_TO_POINTER (n_claimed - 1));
     }
+
+  return TRUE;
+}
+
+static void
+process_queued_commits (MetaWaylandSurface *surface)
+{
+  while (TRUE)
+    {
+      MetaWaylandSurface *subsurface_surface;
+      MetaWaylandSurfaceState *state;
+
+      META_WAYLAND_SURFACE_FOREACH_SUBSURFACE (surface, subsurface_surface)
+        {
+          if (meta_wayland_surface_should_cache_state (subsurface_surface))
+            process_queued_commits (subsurface_surface);
+        }
+
+      state = g_queue_peek_head (&surface->commit_queue.states);
+      if (!state)
+        return;
+
+      if (!is_state_ready (state))
+        {
+          if (!surface->commit_queue.fence_source_id)
+            {
+              surface->commit_queue.fence_source_id =
+                g_unix_fd_add (state->acquire_fence_fd, G_IO_IN,
+                               on_commit_fence_signalled, surface);
+            }
+          return;
+        }
+
+      /* The fence was closed by is_state_ready (), stop watching it */
+      g_clear_handle_id (&surface->commit_queue.fence_source_id,
+                         g_source_remove);
+
+      /* Wait for the subsurface commits made before this one */
+      if (state->subsurface_commits &&
+          g_hash_table_size (state->subsurface_commits) > 0)
+        return;
+
+      if (!take_parent_claim (surface, state))
+        return;
+
+      g_queue_pop_head (&surface->commit_queue.states);
+      meta_wayland_surface_commit_state (surface, state);
+      g_object_unref (state);
+    }
+}
+
+void
+meta_wayland_surface_process_queued_commits (MetaWaylandSurface *surface)
+{
+  /* Queued commits of synchronized subsurfaces are processed along with the
+   * ones of their parents, so start from the top */
+  while (surface->sub.parent &&
+         meta_wayland_surface_should_cache_state (surface))
+    surface = surface->sub.parent;
+
+  process_queued_commits (surface);
+}
+
+/*
+ * Makes the queued commits of @surface stop waiting for the ones of
+ * @subsurface_surface, when it was desynchronized or is no longer a
+ * subsurface of @surface.
+ */
+void
+meta_wayland_surface_release_subsurface_commits (MetaWaylandSurface *surface,
+                                                 MetaWaylandSurface *subsurface_surface)
+{
+  GList *l;
+
+  for (l = surface->commit_queue.states.head; l; l = l->next)
+    {
+      MetaWaylandSurfaceState *state = l->data;
+
+      if (state->subsurface_commits)
+        g_hash_table_remove (state->subsurface_commits, subsurface_surface);
+    }
+
+  meta_wayland_surface_process_queued_commits (surface);
+}
+
+static void
+queue_pending_state (MetaWaylandSurface *surface)
+{
+  static uint64_t queue_serial;
+
+  surface->pending_state->queue_serial = ++queue_serial;
+  claim_subsurface_commits (surface, surface->pending_state);
+
+  /* Hand the pending state object itself over to the queue, as others may
+   * be waiting for it to be applied */
+  g_queue_push_tail (&surface->commit_queue.states, surface->pending_state);
+  surface->pending_state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE,
+                                         NULL);
+
+  meta_wayland_surface_process_queued_commits (surface);
+}
+
+static void
+meta_wayland_surface_commit (MetaWaylandSurface *surface)
+{
+  MetaWaylandSurfaceState *pending = surface->pending_state;
+
+  COGL_TRACE_BEGIN_SCOPED (MetaWaylandSurfaceCommit,
+                           "WaylandSurface (commit)");
+
+  if (pending->buffer &&
+      !meta_wayland_buffer_is_realized (pending->buffer))
+    meta_wayland_buffer_realize (pending->buffer);
+
+  if (!meta_wayland_explicit_sync_validate_state (surface, pending))
+    return;
+
+  /* Without an explicit acquire fence, wait for the writes to the dma-buf
+   * that the kernel synchronizes implicitly */
+  if (pending->newly_attached && pending->buffer &&
+      pending->acquire_fence_fd < 0)
+    {
+      MetaWaylandDmaBufBuffer *dma_buf;
+
+      dma_buf = meta_wayland_dma_buf_from_buffer (pending->buffer);
+      if (dma_buf)
+        {
+          pending->acquire_fence_fd =
+            meta_wayland_dma_buf_get_implicit_fence (dma_buf);
+        }
+    }
+
+  /*
+   * Content updates whose buffer is still being rendered to are queued
+   * instead of waiting for the client's GPU work to finish when sampling
+   * from the buffer, which keeps the previous buffer on screen until then.
+   * Later commits are queued behind them to keep the order in which they
+   * are applied, as are commits of parents of synchronized subsurfaces
+   * with queued commits, and commits of synchronized subsurfaces whose
+   * ancestors have queued commits.
+   */
+  if (g_queue_is_empty (&surface->commit_queue.states) &&
+      is_state_ready (pending) &&
+      !has_queued_synchronized_subsurface_commits (surface) &&
+      !has_queued_ancestor_commits (surface))
+    meta_wayland_surface_commit_state (surface, pending);
+  else
+    queue_pending_state (surface);
 }
 
 static void
@@ -1330,6 +1729,8 @@ wl_surface_destructor (struct wl_resource *resource)
   g_clear_pointer (&surface->texture, cogl_object_unref);
   g_clear_pointer (&surface->buffer_ref, meta_wayland_buffer_ref_unref);
 
+  g_clear_handle_id (&surface->commit_queue.fence_source_id, g_source_remove);
+  g_queue_clear_full (&surface->commit_queue.states, g_object_unref);
   g_clear_object (&surface->cached_state);
   g_clear_object (&surface->pending_state);
 
@@ -1339,6 +1740,7 @@ wl_surface_destructor (struct wl_resource *resource)
     cairo_region_destroy (surface->input_region);
 
   meta_wayland_compositor_remove_frame_callback_surface (compositor, surface);
+  meta_wayland_presentation_time_remove_surface (compositor, surface);
 
   g_hash_table_foreach (surface->outputs,
                         surface_output_disconnect_signals,
@@ -1395,6 +1797,7 @@ meta_wayland_surface_create (MetaWaylandCompositor *compositor,
                                   wl_surface_destructor);
 
   wl_list_init (&surface->unassigned.pending_frame_callback_list);
+  wl_list_init (&surface->presentation_time.feedback_list);
 
   surface->outputs = g_hash_table_new (NULL, NULL);
   surface->shortcut_inhibited_seats = g_hash_table_new (NULL, NULL);
@@ -1596,6 +1999,7 @@ static void
 meta_wayland_surface_init (MetaWaylandSurface *surface)
 {
   surface->pending_state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE, NULL);
+  g_queue_init (&surface->commit_queue.states);
 
   surface->buffer_ref = meta_wayland_buffer_ref_new ();
 
@@ -1983,16 +2387,30 @@ scanout_destroyed (gpointer  data,
 {
   MetaWaylandBufferRef *buffer_ref = data;
 
+  buffer_ref->n_scanouts--;
   meta_wayland_buffer_ref_dec_use_count (buffer_ref);
   meta_wayland_buffer_ref_unref (buffer_ref);
 }
 
+static CoglScanout *
+track_scanout (MetaWaylandSurface *surface,
+               CoglScanout        *scanout)
+{
+  MetaWaylandBufferRef *buffer_ref;
+
+  buffer_ref = meta_wayland_buffer_ref_ref (surface->buffer_ref);
+  meta_wayland_buffer_ref_inc_use_count (buffer_ref);
+  buffer_ref->n_scanouts++;
+  g_object_weak_ref (G_OBJECT (scanout), scanout_destroyed, buffer_ref);
+
+  return scanout;
+}
+
 CoglScanout *
 meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
                                           CoglOnscreen       *onscreen)
 {
   CoglScanout *scanout;
-  MetaWaylandBufferRef *buffer_ref;
 
   if (!surface->buffer_ref->buffer)
     return NULL;
@@ -2005,9 +2423,94 @@ meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
   if (!scanout)
     return NULL;
 
-  buffer_ref = meta_wayland_buffer_ref_ref (surface->buffer_ref);
-  meta_wayland_buffer_ref_inc_use_count (buffer_ref);
-  g_object_weak_ref (G_OBJECT (scanout), scanout_destroyed, buffer_ref);
+  return track_scanout (surface, scanout);
+}
 
-  return scanout;
+static gboolean
+is_subsurface_mapped (GNode    *node,
+                      gpointer  data)
+{
+  MetaWaylandSurface *surface = node->data;
+  MetaSurfaceActor *actor = meta_wayland_surface_get_actor (surface);
+  gboolean *is_mapped = data;
+
+  if (actor && clutter_actor_is_mapped (CLUTTER_ACTOR (actor)))
+    {
+      *is_mapped = TRUE;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+has_mapped_subsurfaces_above (MetaWaylandSurface *surface)
+{
+  GNode *n;
+
+  /* Subsurface branches after the leaf of the surface are stacked above it */
+  for (n = g_node_next_sibling (surface->subsurface_leaf_node);
+       n;
+       n = g_node_next_sibling (n))
+    {
+      gboolean is_mapped = FALSE;
+
+      g_node_traverse (n,
+                       G_IN_ORDER,
+                       G_TRAVERSE_LEAVES,
+                       -1,
+                       is_subsurface_mapped,
+                       &is_mapped);
+      if (is_mapped)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Like meta_wayland_surface_try_acquire_scanout(), but for scanning out the
+ * surface from an overlay plane. The whole buffer is scanned out, so
+ * surfaces that are cropped or transformed are not eligible, and neither
+ * are surfaces with mapped subsurfaces on top, which the plane would hide.
+ */
+CoglScanout *
+meta_wayland_surface_try_acquire_overlay_scanout (MetaWaylandSurface *surface,
+                                                  CoglOnscreen       *onscreen)
+{
+  CoglScanout *scanout;
+
+  if (!surface->buffer_ref->buffer)
+    return NULL;
+
+  if (surface->buffer_ref->use_count == 0)
+    return NULL;
+
+  if (surface->buffer_transform != META_MONITOR_TRANSFORM_NORMAL)
+    return NULL;
+
+  if (surface->viewport.has_src_rect)
+    return NULL;
+
+  if (has_mapped_subsurfaces_above (surface))
+    return NULL;
+
+  scanout =
+    meta_wayland_buffer_try_acquire_overlay_scanout (surface->buffer_ref->buffer,
+                                                     onscreen);
+  if (!scanout)
+    return NULL;
+
+  return track_scanout (surface, scanout);
+}
+
+/*
+ * Returns TRUE if the current buffer of @surface is scanned out directly,
+ * or is about to be. Scanouts are only kept alive by the renderer while
+ * their buffer is on screen or queued to be.
+ */
+gboolean
+meta_wayland_surface_is_scanned_out (MetaWaylandSurface *surface)
+{
+  return surface->buffer_ref->n_scanouts > 0;
 }
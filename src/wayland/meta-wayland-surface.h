@@ -99,6 +99,20 @@ struct _MetaWaylandSurfaceState
   /* wl_surface.frame */
   struct wl_list frame_callback_list;
 
+  /* wp_presentation.feedback */
+  struct wl_list presentation_feedback_list;
+
+  /* zwp_linux_surface_synchronization_v1 */
+  int acquire_fence_fd;
+  struct wl_list buffer_release_list;
+
+  /* Number of queued commits of each synchronized subsurface that were
+   * made before this state was committed, when it is queued */
+  GHashTable *subsurface_commits;
+
+  /* Order in which queued states were committed, across all surfaces */
+  uint64_t queue_serial;
+
   MetaRectangle new_geometry;
   gboolean has_new_geometry;
 
@@ -143,6 +157,10 @@ typedef struct _MetaWaylandBufferRef
   grefcount ref_count;
   MetaWaylandBuffer *buffer;
   unsigned int use_count;
+  unsigned int n_scanouts;
+
+  /* zwp_linux_buffer_release_v1 objects to send when no longer in use */
+  struct wl_list release_list;
 } MetaWaylandBufferRef;
 
 struct _MetaWaylandSurface
@@ -185,6 +203,12 @@ struct _MetaWaylandSurface
   /* State cached due to inter-surface synchronization such. */
   MetaWaylandSurfaceState *cached_state;
 
+  /* Committed states waiting for their acquire fences, oldest first. */
+  struct {
+    GQueue states;
+    guint fence_source_id;
+  } commit_queue;
+
   /* Extension resources. */
   struct wl_resource *wl_subsurface;
 
@@ -225,8 +249,20 @@ struct _MetaWaylandSurface
     int dst_height;
   } viewport;
 
+  /* zwp_linux_surface_synchronization_v1 */
+  struct {
+    struct wl_resource *resource;
+    gulong destroy_handler_id;
+  } explicit_sync;
+
   /* table of seats for which shortcuts are inhibited */
   GHashTable *shortcut_inhibited_seats;
+
+  /* wp_presentation */
+  struct {
+    /* Feedbacks of applied content updates, until painted */
+    struct wl_list feedback_list;
+  } presentation_time;
 };
 
 void                meta_wayland_shell_init     (MetaWaylandCompositor *compositor);
@@ -244,6 +280,11 @@ MetaWaylandSurfaceState *
 
 void                meta_wayland_surface_apply_cached_state (MetaWaylandSurface *surface);
 
+void                meta_wayland_surface_process_queued_commits (MetaWaylandSurface *surface);
+
+void                meta_wayland_surface_release_subsurface_commits (MetaWaylandSurface *surface,
+                                                                     MetaWaylandSurface *subsurface_surface);
+
 gboolean            meta_wayland_surface_is_effectively_synchronized (MetaWaylandSurface *surface);
 
 gboolean            meta_wayland_surface_assign_role (MetaWaylandSurface *surface,
@@ -342,6 +383,11 @@ int                 meta_wayland_surface_get_height (MetaWaylandSurface *surface
 CoglScanout *       meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
                                                               CoglOnscreen       *onscreen);
 
+CoglScanout *       meta_wayland_surface_try_acquire_overlay_scanout (MetaWaylandSurface *surface,
+                                                                      CoglOnscreen       *onscreen);
+
+gboolean            meta_wayland_surface_is_scanned_out (MetaWaylandSurface *surface);
+
 static inline GNode *
 meta_get_next_subsurface_sibling (GNode *n)
 {
@@ -55,5 +55,7 @@
 #define META_GTK_TEXT_INPUT_VERSION         1
 #define META_ZWP_TEXT_INPUT_V3_VERSION      1
 #define META_WP_VIEWPORTER_VERSION          1
+#define META_WP_PRESENTATION_VERSION        1
+#define META_ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION 1
 
 #endif
@@ -35,6 +35,7 @@
 #include "wayland/meta-wayland-data-device.h"
 #include "wayland/meta-wayland-dma-buf.h"
 #include "wayland/meta-wayland-egl-stream.h"
+#include "wayland/meta-wayland-explicit-sync.h"
 #include "wayland/meta-wayland-inhibit-shortcuts-dialog.h"
 #include "wayland/meta-wayland-inhibit-shortcuts.h"
 #include "wayland/meta-wayland-outputs.h"
@@ -444,6 +445,8 @@ meta_wayland_compositor_setup (MetaWaylandCompositor *compositor)
   meta_wayland_pointer_constraints_init (compositor);
   meta_wayland_xdg_foreign_init (compositor);
   meta_wayland_dma_buf_init (compositor);
+  meta_wayland_init_explicit_sync (compositor);
+  meta_wayland_init_presentation_time (compositor);
   meta_wayland_keyboard_shortcuts_inhibit_init (compositor);
   meta_wayland_surface_inhibit_shortcuts_dialog_init ();
   meta_wayland_text_input_init (compositor);
@@ -514,6 +517,7 @@ meta_wayland_finalize (void)
   compositor = meta_wayland_compositor_get_default ();
 
   meta_xwayland_shutdown (&compositor->xwayland_manager);
+  meta_wayland_shm_finalize (compositor);
   g_clear_pointer (&compositor->display_name, g_free);
 }
 
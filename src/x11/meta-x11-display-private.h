@@ -114,6 +114,9 @@ struct _MetaX11Display
   GHashTable *prop_hooks;
   int n_prop_hooks;
 
+  /* Managed by xprops.c */
+  GHashTable *prefetched_properties;
+
   /* Managed by group-props.c */
   MetaGroupPropHooks *group_prop_hooks;
 
@@ -176,6 +176,36 @@ meta_window_load_initial_properties (MetaWindow *window)
   g_free (values);
 }
 
+void
+meta_x11_display_prefetch_initial_properties (MetaX11Display *x11_display,
+                                              Window          xwindow)
+{
+  MetaPropValue *values;
+  int i, j;
+
+  values = g_new0 (MetaPropValue, x11_display->n_prop_hooks);
+
+  /* Whether the window is override-redirect isn't known yet, so fetch
+   * everything that might be loaded */
+  j = 0;
+  for (i = 0; i < x11_display->n_prop_hooks; i++)
+    {
+      MetaWindowPropHooks *hooks = &x11_display->prop_hooks_table[i];
+
+      if ((hooks->flags & LOAD_INIT) &&
+          hooks->type != META_PROP_VALUE_INVALID)
+        {
+          values[j].type = hooks->type;
+          values[j].atom = hooks->property;
+          ++j;
+        }
+    }
+
+  meta_prop_prefetch_values (x11_display, xwindow, values, j);
+
+  g_free (values);
+}
+
 /* Fill in the MetaPropValue used to get the value of "property" */
 static void
 init_prop_value (MetaWindow          *window,
@@ -59,6 +59,18 @@ void meta_window_reload_property_from_xwindow (MetaWindow      *window,
  */
 void meta_window_load_initial_properties (MetaWindow *window);
 
+/**
+ * meta_x11_display_prefetch_initial_properties:
+ * @x11_display: The X11 display.
+ * @xwindow:     The X handle for the window.
+ *
+ * Requests the standard properties that
+ * meta_window_load_initial_properties() loads for a window that is
+ * about to be managed, without waiting for the replies.
+ */
+void meta_x11_display_prefetch_initial_properties (MetaX11Display *x11_display,
+                                                   Window          xwindow);
+
 /**
  * meta_x11_display_init_window_prop_hooks:
  * @x11_display:  The X11 display.
@@ -3507,69 +3507,56 @@ wm_state_to_string (int state)
 }
 #endif
 
-MetaWindow *
-meta_window_x11_new (MetaDisplay       *display,
-                     Window             xwindow,
-                     gboolean           must_be_viewable,
-                     MetaCompEffect     effect)
+static gboolean
+is_manageable_xwindow (MetaX11Display    *x11_display,
+                       Window             xwindow,
+                       XWindowAttributes *attrs)
 {
-  MetaX11Display *x11_display = display->x11_display;
-  XWindowAttributes attrs;
-  gulong existing_wm_state;
-  MetaWindow *window = NULL;
-  gulong event_mask;
-
-  meta_verbose ("Attempting to manage 0x%lx\n", xwindow);
-
-  if (meta_x11_display_xwindow_is_a_no_focus_window (x11_display, xwindow))
-    {
-      meta_verbose ("Not managing no_focus_window 0x%lx\n",
-                    xwindow);
-      return NULL;
-    }
-
-  meta_x11_error_trap_push (x11_display); /* Push a trap over all of window
-                                       * creation, to reduce XSync() calls
-                                       */
-  /*
-   * This function executes without any server grabs held. This means that
-   * the window could have already gone away, or could go away at any point,
-   * so we must be careful with X error handling.
-   */
-
-  if (!XGetWindowAttributes (x11_display->xdisplay, xwindow, &attrs))
-    {
-      meta_verbose ("Failed to get attributes for window 0x%lx\n",
-                    xwindow);
-      goto error;
-    }
-
-  if (attrs.root != x11_display->xroot)
+  if (attrs->root != x11_display->xroot)
     {
       meta_verbose ("Not on our screen\n");
-      goto error;
+      return FALSE;
     }
 
-  if (attrs.class == InputOnly)
+  if (attrs->class == InputOnly)
     {
       meta_verbose ("Not managing InputOnly windows\n");
-      goto error;
+      return FALSE;
     }
 
-  if (is_our_xwindow (x11_display, xwindow, &attrs))
+  if (is_our_xwindow (x11_display, xwindow, attrs))
     {
       meta_verbose ("Not managing our own windows\n");
-      goto error;
+      return FALSE;
     }
 
-  if (maybe_filter_xwindow (display, xwindow, must_be_viewable, &attrs))
+  return TRUE;
+}
+
+/*
+ * Decides whether @xwindow should be managed, and if so, which WM_STATE
+ * it already has.
+ */
+static gboolean
+should_manage_xwindow (MetaDisplay       *display,
+                       Window             xwindow,
+                       gboolean           must_be_viewable,
+                       XWindowAttributes *attrs,
+                       gulong            *existing_wm_state)
+{
+  MetaX11Display *x11_display = display->x11_display;
+
+  if (!is_manageable_xwindow (x11_display, xwindow, attrs))
+    return FALSE;
+
+  if (maybe_filter_xwindow (display, xwindow, must_be_viewable, attrs))
     {
       meta_verbose ("Not managing filtered window\n");
-      goto error;
+      return FALSE;
     }
 
-  existing_wm_state = WithdrawnState;
-  if (must_be_viewable && attrs.map_state != IsViewable)
+  *existing_wm_state = WithdrawnState;
+  if (must_be_viewable && attrs->map_state != IsViewable)
     {
       /* Only manage if WM_STATE is IconicState or NormalState */
       uint32_t state;
@@ -3582,34 +3569,54 @@ meta_window_x11_new (MetaDisplay       *display,
             (state == IconicState || state == NormalState)))
         {
           meta_verbose ("Deciding not to manage unmapped or unviewable window 0x%lx\n", xwindow);
-          goto error;
+          return FALSE;
         }
 
-      existing_wm_state = state;
+      *existing_wm_state = state;
       meta_verbose ("WM_STATE of %lx = %s\n", xwindow,
-                    wm_state_to_string (existing_wm_state));
+                    wm_state_to_string (*existing_wm_state));
     }
 
+  return TRUE;
+}
+
+/*
+ * Selects the events we need on @xwindow and resets its border and
+ * gravity. The event mask is changed with a checked request, whose cookie
+ * is returned, so that the caller can find out whether the window went
+ * away while doing so. Errors of the other requests must be trapped by
+ * the caller.
+ */
+static xcb_void_cookie_t
+setup_xwindow (MetaX11Display          *x11_display,
+               Window                   xwindow,
+               const XWindowAttributes *attrs)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  xcb_void_cookie_t cookie;
+  uint32_t event_mask;
+
   /*
    * XAddToSaveSet can only be called on windows created by a different
    * client.  with Mutter we want to be able to create manageable windows
    * from within the process (such as a dummy desktop window). As we do not
-   * want this call failing to prevent the window from being managed, we
-   * call this before creating the return-checked error trap.
+   * want this call failing to prevent the window from being managed, only
+   * the event mask request below is checked.
    */
   XAddToSaveSet (x11_display->xdisplay, xwindow);
 
-  meta_x11_error_trap_push (x11_display);
-
   event_mask = PropertyChangeMask;
-  if (attrs.override_redirect)
+  if (attrs->override_redirect)
     event_mask |= StructureNotifyMask;
 
   /* If the window is from this client (a menu, say) we need to augment
    * the event mask, not replace it. For windows from other clients,
-   * attrs.your_event_mask will be empty at this point.
+   * attrs->your_event_mask will be empty at this point.
    */
-  XSelectInput (x11_display->xdisplay, xwindow, attrs.your_event_mask | event_mask);
+  event_mask |= attrs->your_event_mask;
+  cookie = xcb_change_window_attributes_checked (xcb_conn, xwindow,
+                                                 XCB_CW_EVENT_MASK,
+                                                 &event_mask);
 
   {
     unsigned char mask_bits[XIMaskLen (XI_LASTEVENT)] = { 0 };
@@ -3627,11 +3634,11 @@ meta_window_x11_new (MetaDisplay       *display,
     XShapeSelectInput (x11_display->xdisplay, xwindow, ShapeNotifyMask);
 
   /* Get rid of any borders */
-  if (attrs.border_width != 0)
+  if (attrs->border_width != 0)
     XSetWindowBorderWidth (x11_display->xdisplay, xwindow, 0);
 
   /* Get rid of weird gravities */
-  if (attrs.win_gravity != NorthWestGravity)
+  if (attrs->win_gravity != NorthWestGravity)
     {
       XSetWindowAttributes set_attrs;
 
@@ -3643,25 +3650,50 @@ meta_window_x11_new (MetaDisplay       *display,
                                &set_attrs);
     }
 
-  if (meta_x11_error_trap_pop_with_return (x11_display) != Success)
+  return cookie;
+}
+
+static gboolean
+check_setup_xwindow (MetaX11Display    *x11_display,
+                     Window             xwindow,
+                     xcb_void_cookie_t  cookie)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  xcb_generic_error_t *error;
+
+  error = xcb_request_check (xcb_conn, cookie);
+  if (error)
     {
       meta_verbose ("Window 0x%lx disappeared just as we tried to manage it\n",
                     xwindow);
-      goto error;
+      free (error);
+      return FALSE;
     }
 
+  return TRUE;
+}
+
+static MetaWindow *
+create_window (MetaDisplay       *display,
+               Window             xwindow,
+               gulong             existing_wm_state,
+               MetaCompEffect     effect,
+               XWindowAttributes *attrs)
+{
+  MetaWindow *window;
+
   window = _meta_window_shared_new (display,
                                     META_WINDOW_CLIENT_TYPE_X11,
                                     NULL,
                                     xwindow,
                                     existing_wm_state,
                                     effect,
-                                    &attrs);
+                                    attrs);
 
   MetaWindowX11 *window_x11 = META_WINDOW_X11 (window);
   MetaWindowX11Private *priv = meta_window_x11_get_instance_private (window_x11);
 
-  priv->border_width = attrs.border_width;
+  priv->border_width = attrs->border_width;
 
   meta_window_grab_keys (window);
   if (window->type != META_WINDOW_DOCK && !window->override_redirect)
@@ -3670,14 +3702,280 @@ meta_window_x11_new (MetaDisplay       *display,
       meta_display_grab_focus_window_button (window->display, window);
     }
 
+  return window;
+}
+
+/*
+ * This function executes without any server grabs held. This means that
+ * the window could have already gone away, or could go away at any point,
+ * so we must be careful with X error handling. The caller pushes a trap
+ * over all of window creation, to reduce XSync() calls.
+ */
+static MetaWindow *
+window_x11_new_with_attributes (MetaDisplay             *display,
+                                Window                   xwindow,
+                                gboolean                 must_be_viewable,
+                                MetaCompEffect           effect,
+                                const XWindowAttributes *attrs_in)
+{
+  MetaX11Display *x11_display = display->x11_display;
+  XWindowAttributes attrs = *attrs_in;
+  gulong existing_wm_state;
+  xcb_void_cookie_t cookie;
+
+  if (!should_manage_xwindow (display, xwindow, must_be_viewable, &attrs,
+                              &existing_wm_state))
+    return NULL;
+
+  cookie = setup_xwindow (x11_display, xwindow, &attrs);
+  if (!check_setup_xwindow (x11_display, xwindow, cookie))
+    return NULL;
+
+  return create_window (display, xwindow, existing_wm_state, effect, &attrs);
+}
+
+MetaWindow *
+meta_window_x11_new (MetaDisplay       *display,
+                     Window             xwindow,
+                     gboolean           must_be_viewable,
+                     MetaCompEffect     effect)
+{
+  MetaX11Display *x11_display = display->x11_display;
+  XWindowAttributes attrs;
+  MetaWindow *window = NULL;
+
+  meta_verbose ("Attempting to manage 0x%lx\n", xwindow);
+
+  if (meta_x11_display_xwindow_is_a_no_focus_window (x11_display, xwindow))
+    {
+      meta_verbose ("Not managing no_focus_window 0x%lx\n",
+                    xwindow);
+      return NULL;
+    }
+
+  meta_x11_error_trap_push (x11_display); /* Push a trap over all of window
+                                       * creation, to reduce XSync() calls
+                                       */
+
+  if (XGetWindowAttributes (x11_display->xdisplay, xwindow, &attrs))
+    {
+      window = window_x11_new_with_attributes (display, xwindow,
+                                               must_be_viewable, effect,
+                                               &attrs);
+    }
+  else
+    {
+      meta_verbose ("Failed to get attributes for window 0x%lx\n",
+                    xwindow);
+    }
+
   meta_x11_error_trap_pop (x11_display); /* pop the XSync()-reducing trap */
   return window;
+}
+
+static Visual *
+visual_from_id (MetaX11Display *x11_display,
+                VisualID        visual_id)
+{
+  Screen *screen = DefaultScreenOfDisplay (x11_display->xdisplay);
+  int i, j;
+
+  /* Walks the depths and visuals Xlib cached for the screen when the
+   * display was opened, unlike XGetVisualInfo() which copies them */
+  for (i = 0; i < screen->ndepths; i++)
+    {
+      Depth *depth = &screen->depths[i];
+
+      for (j = 0; j < depth->nvisuals; j++)
+        {
+          if (depth->visuals[j].visualid == visual_id)
+            return &depth->visuals[j];
+        }
+    }
 
-error:
-  meta_x11_error_trap_pop (x11_display);
   return NULL;
 }
 
+static gboolean
+get_window_attributes_finish (MetaX11Display                     *x11_display,
+                              xcb_get_window_attributes_cookie_t  attrs_cookie,
+                              xcb_get_geometry_cookie_t           geometry_cookie,
+                              XWindowAttributes                  *attrs)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  xcb_get_window_attributes_reply_t *attrs_reply;
+  xcb_get_geometry_reply_t *geometry_reply;
+  xcb_generic_error_t *attrs_error = NULL;
+  xcb_generic_error_t *geometry_error = NULL;
+  gboolean ret = FALSE;
+
+  attrs_reply = xcb_get_window_attributes_reply (xcb_conn, attrs_cookie,
+                                                 &attrs_error);
+  geometry_reply = xcb_get_geometry_reply (xcb_conn, geometry_cookie,
+                                           &geometry_error);
+  if (!attrs_reply || !geometry_reply)
+    goto out;
+
+  /* Filled in like XGetWindowAttributes() would */
+  attrs->x = geometry_reply->x;
+  attrs->y = geometry_reply->y;
+  attrs->width = geometry_reply->width;
+  attrs->height = geometry_reply->height;
+  attrs->border_width = geometry_reply->border_width;
+  attrs->depth = geometry_reply->depth;
+  attrs->root = geometry_reply->root;
+  attrs->screen = DefaultScreenOfDisplay (x11_display->xdisplay);
+  attrs->visual = visual_from_id (x11_display, attrs_reply->visual);
+  attrs->class = attrs_reply->_class;
+  attrs->bit_gravity = attrs_reply->bit_gravity;
+  attrs->win_gravity = attrs_reply->win_gravity;
+  attrs->backing_store = attrs_reply->backing_store;
+  attrs->backing_planes = attrs_reply->backing_planes;
+  attrs->backing_pixel = attrs_reply->backing_pixel;
+  attrs->save_under = attrs_reply->save_under;
+  attrs->colormap = attrs_reply->colormap;
+  attrs->map_installed = attrs_reply->map_is_installed;
+  attrs->map_state = attrs_reply->map_state;
+  attrs->all_event_masks = attrs_reply->all_event_masks;
+  attrs->your_event_mask = attrs_reply->your_event_mask;
+  attrs->do_not_propagate_mask = attrs_reply->do_not_propagate_mask;
+  attrs->override_redirect = attrs_reply->override_redirect;
+
+  ret = TRUE;
+
+out:
+  free (attrs_reply);
+  free (geometry_reply);
+  free (attrs_error);
+  free (geometry_error);
+
+  return ret;
+}
+
+/**
+ * meta_window_x11_manage_windows:
+ * @display: A #MetaDisplay
+ * @xwindows: (array length=n_xwindows): Existing X windows
+ * @n_xwindows: The number of windows
+ *
+ * Manages windows that already exist and are viewable, such as when
+ * starting up. Instead of a number of round trips for each window, the
+ * attributes and properties of all windows are requested at once, and the
+ * replies are collected while each window is managed in turn.
+ */
+void
+meta_window_x11_manage_windows (MetaDisplay  *display,
+                                const Window *xwindows,
+                                int           n_xwindows)
+{
+  MetaX11Display *x11_display = display->x11_display;
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  xcb_get_window_attributes_cookie_t *attrs_cookies;
+  xcb_get_geometry_cookie_t *geometry_cookies;
+  xcb_void_cookie_t *setup_cookies;
+  XWindowAttributes *attrs;
+  gulong *existing_wm_states;
+  gboolean *has_attrs;
+  int i;
+
+  attrs_cookies = g_new0 (xcb_get_window_attributes_cookie_t, n_xwindows);
+  geometry_cookies = g_new0 (xcb_get_geometry_cookie_t, n_xwindows);
+  setup_cookies = g_new0 (xcb_void_cookie_t, n_xwindows);
+  attrs = g_new0 (XWindowAttributes, n_xwindows);
+  existing_wm_states = g_new0 (gulong, n_xwindows);
+  has_attrs = g_new0 (gboolean, n_xwindows);
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      attrs_cookies[i] = xcb_get_window_attributes (xcb_conn, xwindows[i]);
+      geometry_cookies[i] = xcb_get_geometry (xcb_conn, xwindows[i]);
+    }
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      has_attrs[i] = get_window_attributes_finish (x11_display,
+                                                   attrs_cookies[i],
+                                                   geometry_cookies[i],
+                                                   &attrs[i]);
+    }
+
+  /* A single error trap covers the whole batch, so that popping it syncs
+   * once for all windows rather than once per window. Whether a window
+   * went away in the meantime is found out through a checked request
+   * made while setting it up. */
+  meta_x11_error_trap_push (x11_display);
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      MetaPropValue wm_state = { 0, };
+
+      if (!has_attrs[i] ||
+          meta_x11_display_xwindow_is_a_no_focus_window (x11_display,
+                                                         xwindows[i]) ||
+          !is_manageable_xwindow (x11_display, xwindows[i], &attrs[i]))
+        {
+          has_attrs[i] = FALSE;
+          continue;
+        }
+
+      /* Property changes must be selected for before the properties are
+       * fetched, so that none are missed in between */
+      XSelectInput (x11_display->xdisplay, xwindows[i],
+                    attrs[i].your_event_mask | PropertyChangeMask);
+
+      wm_state.type = META_PROP_VALUE_CARDINAL;
+      wm_state.atom = x11_display->atom_WM_STATE;
+      wm_state.required_type = x11_display->atom_WM_STATE;
+      meta_prop_prefetch_values (x11_display, xwindows[i], &wm_state, 1);
+
+      meta_x11_display_prefetch_initial_properties (x11_display, xwindows[i]);
+    }
+
+  /* Set up all windows first, and only then check whether any of them
+   * went away, which costs a single round trip for the whole batch */
+  for (i = 0; i < n_xwindows; i++)
+    {
+      if (!has_attrs[i])
+        continue;
+
+      meta_verbose ("Attempting to manage 0x%lx\n", xwindows[i]);
+
+      if (!should_manage_xwindow (display, xwindows[i], TRUE, &attrs[i],
+                                  &existing_wm_states[i]))
+        {
+          XSelectInput (x11_display->xdisplay, xwindows[i],
+                        attrs[i].your_event_mask);
+          has_attrs[i] = FALSE;
+          continue;
+        }
+
+      setup_cookies[i] = setup_xwindow (x11_display, xwindows[i], &attrs[i]);
+    }
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      if (!has_attrs[i])
+        continue;
+
+      if (!check_setup_xwindow (x11_display, xwindows[i], setup_cookies[i]))
+        continue;
+
+      create_window (display, xwindows[i], existing_wm_states[i],
+                     META_COMP_EFFECT_NONE, &attrs[i]);
+    }
+
+  meta_prop_discard_prefetched_values (x11_display);
+
+  meta_x11_error_trap_pop (x11_display);
+
+  g_free (attrs_cookies);
+  g_free (geometry_cookies);
+  g_free (setup_cookies);
+  g_free (attrs);
+  g_free (existing_wm_states);
+  g_free (has_attrs);
+}
+
 void
 meta_window_x11_recalc_window_type (MetaWindow *window)
 {
@@ -106,6 +106,12 @@ typedef struct
   unsigned char  *prop;
 } GetPropertyResults;
 
+typedef struct
+{
+  Atom                      required_type;
+  xcb_get_property_cookie_t cookie;
+} PrefetchedProperty;
+
 static gboolean
 validate_or_free_results (GetPropertyResults *results,
                           int                 expected_format,
@@ -186,6 +192,51 @@ async_get_property (xcb_connection_t *xcb_conn, Window xwindow,
                            xatom, required_type, 0, G_MAXUINT32);
 }
 
+static gboolean
+take_prefetched_property (MetaX11Display            *x11_display,
+                          Window                     xwindow,
+                          Atom                       xatom,
+                          Atom                       required_type,
+                          xcb_get_property_cookie_t *cookie)
+{
+  GHashTable *window_properties;
+  PrefetchedProperty *prefetched;
+
+  if (!x11_display->prefetched_properties)
+    return FALSE;
+
+  window_properties = g_hash_table_lookup (x11_display->prefetched_properties,
+                                           GUINT_TO_POINTER (xwindow));
+  if (!window_properties)
+    return FALSE;
+
+  prefetched = g_hash_table_lookup (window_properties,
+                                    GUINT_TO_POINTER (xatom));
+  if (!prefetched || prefetched->required_type != required_type)
+    return FALSE;
+
+  *cookie = prefetched->cookie;
+  g_hash_table_remove (window_properties, GUINT_TO_POINTER (xatom));
+
+  return TRUE;
+}
+
+static xcb_get_property_cookie_t
+start_get_property (MetaX11Display *x11_display,
+                    Window          xwindow,
+                    Atom            xatom,
+                    Atom            required_type)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  xcb_get_property_cookie_t cookie;
+
+  if (take_prefetched_property (x11_display, xwindow, xatom, required_type,
+                                &cookie))
+    return cookie;
+
+  return async_get_property (xcb_conn, xwindow, xatom, required_type);
+}
+
 static gboolean
 async_get_property_finish (xcb_connection_t          *xcb_conn,
                            xcb_get_property_cookie_t  cookie,
@@ -242,7 +293,7 @@ get_property (MetaX11Display     *x11_display,
   results->bytes_after = 0;
   results->format = 0;
 
-  cookie = async_get_property (xcb_conn, xwindow, xatom, req_type);
+  cookie = start_get_property (x11_display, xwindow, xatom, req_type);
   return async_get_property_finish (xcb_conn, cookie, results);
 }
 
@@ -827,6 +878,62 @@ latin1_to_utf8 (const char *text)
   return g_string_free (str, FALSE);
 }
 
+static void
+ensure_required_type (MetaX11Display *x11_display,
+                      MetaPropValue  *value)
+{
+  if (value->required_type != None)
+    return;
+
+  switch (value->type)
+    {
+    case META_PROP_VALUE_INVALID:
+      /* This means we don't really want a value, e.g. got
+       * property notify on an atom we don't care about.
+       */
+      if (value->atom != None)
+        meta_bug ("META_PROP_VALUE_INVALID requested in %s\n", G_STRFUNC);
+      break;
+    case META_PROP_VALUE_UTF8_LIST:
+    case META_PROP_VALUE_UTF8:
+      value->required_type = x11_display->atom_UTF8_STRING;
+      break;
+    case META_PROP_VALUE_STRING:
+    case META_PROP_VALUE_STRING_AS_UTF8:
+      value->required_type = XA_STRING;
+      break;
+    case META_PROP_VALUE_MOTIF_HINTS:
+      value->required_type = AnyPropertyType;
+      break;
+    case META_PROP_VALUE_CARDINAL_LIST:
+    case META_PROP_VALUE_CARDINAL:
+      value->required_type = XA_CARDINAL;
+      break;
+    case META_PROP_VALUE_WINDOW:
+      value->required_type = XA_WINDOW;
+      break;
+    case META_PROP_VALUE_ATOM_LIST:
+      value->required_type = XA_ATOM;
+      break;
+    case META_PROP_VALUE_TEXT_PROPERTY:
+      value->required_type = AnyPropertyType;
+      break;
+    case META_PROP_VALUE_WM_HINTS:
+      value->required_type = XA_WM_HINTS;
+      break;
+    case META_PROP_VALUE_CLASS_HINT:
+      value->required_type = XA_STRING;
+      break;
+    case META_PROP_VALUE_SIZE_HINTS:
+      value->required_type = XA_WM_SIZE_HINTS;
+      break;
+    case META_PROP_VALUE_SYNC_COUNTER:
+    case META_PROP_VALUE_SYNC_COUNTER_LIST:
+      value->required_type = XA_CARDINAL;
+      break;
+    }
+}
+
 void
 meta_prop_get_values (MetaX11Display *x11_display,
                       Window          xwindow,
@@ -851,67 +958,15 @@ meta_prop_get_values (MetaX11Display *x11_display,
   i = 0;
   while (i < n_values)
     {
-      if (values[i].required_type == None)
-        {
-          switch (values[i].type)
-            {
-            case META_PROP_VALUE_INVALID:
-              /* This means we don't really want a value, e.g. got
-               * property notify on an atom we don't care about.
-               */
-              if (values[i].atom != None)
-                meta_bug ("META_PROP_VALUE_INVALID requested in %s\n", G_STRFUNC);
-              break;
-            case META_PROP_VALUE_UTF8_LIST:
-            case META_PROP_VALUE_UTF8:
-              values[i].required_type = x11_display->atom_UTF8_STRING;
-              break;
-            case META_PROP_VALUE_STRING:
-            case META_PROP_VALUE_STRING_AS_UTF8:
-              values[i].required_type = XA_STRING;
-              break;
-            case META_PROP_VALUE_MOTIF_HINTS:
-              values[i].required_type = AnyPropertyType;
-              break;
-            case META_PROP_VALUE_CARDINAL_LIST:
-            case META_PROP_VALUE_CARDINAL:
-              values[i].required_type = XA_CARDINAL;
-              break;
-            case META_PROP_VALUE_WINDOW:
-              values[i].required_type = XA_WINDOW;
-              break;
-            case META_PROP_VALUE_ATOM_LIST:
-              values[i].required_type = XA_ATOM;
-              break;
-            case META_PROP_VALUE_TEXT_PROPERTY:
-              values[i].required_type = AnyPropertyType;
-              break;
-            case META_PROP_VALUE_WM_HINTS:
-              values[i].required_type = XA_WM_HINTS;
-              break;
-            case META_PROP_VALUE_CLASS_HINT:
-              values[i].required_type = XA_STRING;
-              break;
-            case META_PROP_VALUE_SIZE_HINTS:
-              values[i].required_type = XA_WM_SIZE_HINTS;
-              break;
-            case META_PROP_VALUE_SYNC_COUNTER:
-            case META_PROP_VALUE_SYNC_COUNTER_LIST:
-	      values[i].required_type = XA_CARDINAL;
-              break;
-            }
-        }
+      ensure_required_type (x11_display, &values[i]);
 
       if (values[i].atom != None)
-        tasks[i] = async_get_property (xcb_conn, xwindow, values[i].atom, values[i].required_type);
+        tasks[i] = start_get_property (x11_display, xwindow,
+                                       values[i].atom,
+                                       values[i].required_type);
       ++i;
     }
 
-  /* Get replies for all our tasks */
-  meta_topic (META_DEBUG_SYNC, "Syncing to get %d GetProperty replies in %s\n",
-              n_values, G_STRFUNC);
-  XSync (x11_display->xdisplay, False);
-
   /* Collect results, should arrive in order requested */
   i = 0;
   while (i < n_values)
@@ -1043,6 +1098,81 @@ meta_prop_get_values (MetaX11Display *x11_display,
   g_free (tasks);
 }
 
+void
+meta_prop_prefetch_values (MetaX11Display *x11_display,
+                           Window          xwindow,
+                           MetaPropValue  *values,
+                           int             n_values)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  GHashTable *window_properties;
+  int i;
+
+  if (!x11_display->prefetched_properties)
+    {
+      x11_display->prefetched_properties =
+        g_hash_table_new_full (NULL, NULL,
+                               NULL,
+                               (GDestroyNotify) g_hash_table_unref);
+    }
+
+  window_properties = g_hash_table_lookup (x11_display->prefetched_properties,
+                                           GUINT_TO_POINTER (xwindow));
+  if (!window_properties)
+    {
+      window_properties = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+      g_hash_table_insert (x11_display->prefetched_properties,
+                           GUINT_TO_POINTER (xwindow),
+                           window_properties);
+    }
+
+  for (i = 0; i < n_values; i++)
+    {
+      PrefetchedProperty *prefetched;
+
+      ensure_required_type (x11_display, &values[i]);
+
+      if (values[i].atom == None ||
+          g_hash_table_contains (window_properties,
+                                 GUINT_TO_POINTER (values[i].atom)))
+        continue;
+
+      prefetched = g_new0 (PrefetchedProperty, 1);
+      prefetched->required_type = values[i].required_type;
+      prefetched->cookie = async_get_property (xcb_conn, xwindow,
+                                               values[i].atom,
+                                               values[i].required_type);
+      g_hash_table_insert (window_properties,
+                           GUINT_TO_POINTER (values[i].atom),
+                           prefetched);
+    }
+}
+
+void
+meta_prop_discard_prefetched_values (MetaX11Display *x11_display)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  GHashTableIter iter;
+  GHashTable *window_properties;
+
+  if (!x11_display->prefetched_properties)
+    return;
+
+  g_hash_table_iter_init (&iter, x11_display->prefetched_properties);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &window_properties))
+    {
+      GHashTableIter property_iter;
+      PrefetchedProperty *prefetched;
+
+      g_hash_table_iter_init (&property_iter, window_properties);
+      while (g_hash_table_iter_next (&property_iter, NULL,
+                                     (gpointer *) &prefetched))
+        xcb_discard_reply (xcb_conn, prefetched->cookie.sequence);
+    }
+
+  g_clear_pointer (&x11_display->prefetched_properties, g_hash_table_unref);
+}
+
 static void
 free_value (MetaPropValue *value)
 {
@@ -189,6 +189,19 @@ void meta_prop_get_values (MetaX11Display *x11_display,
 void meta_prop_free_values (MetaPropValue *values,
                             int            n_values);
 
+/* Sends the requests for the values without waiting for the replies, so
+ * that the requests for many windows can be sent at once. Later calls of
+ * meta_prop_get_values() and the other getters for the same window, atom
+ * and type take the prefetched reply instead of sending a new request,
+ * until meta_prop_discard_prefetched_values() is called.
+ */
+void meta_prop_prefetch_values (MetaX11Display *x11_display,
+                                Window          xwindow,
+                                MetaPropValue  *values,
+                                int             n_values);
+
+void meta_prop_discard_prefetched_values (MetaX11Display *x11_display);
+
 #endif
 
 